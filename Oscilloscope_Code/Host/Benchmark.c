@@ -0,0 +1,1602 @@
+/* ========================================
+ *
+ * Tiny Scope kernel benchmark
+ *
+ * Author: Scott Oslund
+ *
+ * Program Synopsis:
+ * This program builds the helper function kernels (Middle,
+ * FindTrigger, FindFrequency, Copy and DrawWaveForm) and the
+ * processing kernels added since for a PC and runs them over
+ * the deterministic signal corpus. For every
+ * kernel and signal it prints one JSON object per line with the
+ * cost per sample, the throughput and whether the result was
+ * correct (the autoset kernel must choose a timebase that puts
+ * two to three periods on the screen, and the calibration
+ * kernel must undo a modelled ADC's gain, offset and INL to a
+ * code). If a previous run's output is given as an argument
+ * each kernel line is also compared against that stored
+ * baseline.
+ * Then the resolution the high resolution mode gains is
+ * measured on noisy signals at a few timebases, and finally
+ * each input filter is timed at each order and its gain at a
+ * few frequencies checked against its coefficients. Last, UART,
+ * I2C and SPI buses are rendered as noisy analog levels and
+ * decoded a block at a time, and the events checked against
+ * the ones rendered. The logic analyzer's record and its
+ * drawing at a few zooms are checked and timed the same way,
+ * and so are the measurement statistics against floating point
+ * over long streams of values, and the mask test against a
+ * plain count of the columns out of the mask for frames that
+ * should pass and fail and over a stream of them.
+ *
+ * Build and run (from this directory):
+ *   gcc -O2 -DHOST_BUILD -I. -I../Lab-Project.cydsn Benchmark.c SignalCorpus.c HostPlatform.c
+ *       ../Lab-Project.cydsn/main_cm4.c ../Lab-Project.cydsn/HelperFunctions.c
+ *       ../Lab-Project.cydsn/Profiler.c ../Lab-Project.cydsn/Trace.c ../Lab-Project.cydsn/ScopeStats.c
+ *       ../Lab-Project.cydsn/Latency.c ../Lab-Project.cydsn/Trigger.c ../Lab-Project.cydsn/Acquisition.c
+ *       ../Lab-Project.cydsn/Segmented.c ../Lab-Project.cydsn/Deep.c ../Lab-Project.cydsn/EquivTime.c
+ *       ../Lab-Project.cydsn/HighRes.c ../Lab-Project.cydsn/Average.c ../Lab-Project.cydsn/MathTrace.c
+ *       ../Lab-Project.cydsn/XY.c ../Lab-Project.cydsn/Correlate.c ../Lab-Project.cydsn/Filter.c
+ *       ../Lab-Project.cydsn/Autoset.c ../Lab-Project.cydsn/Calibrate.c ../Lab-Project.cydsn/Decode.c
+ *       ../Lab-Project.cydsn/Logic.c ../Lab-Project.cydsn/Measure.c ../Lab-Project.cydsn/Mask.c -lm
+ *       -o benchmark
+ *   ./benchmark > bench_output.txt
+ *   ./benchmark bench_output.txt
+ *
+ * ========================================
+*/
+
+/* Included files */
+#include <time.h>
+#include <math.h>
+#include <complex.h>
+#include "SignalCorpus.h"
+
+/* Defines */
+#define KERNEL_MIDDLE 0           // ids of the kernels that are benchmarked
+#define KERNEL_FIND_TRIGGER 1
+#define KERNEL_FIND_FREQUENCY 2
+#define KERNEL_COPY 3
+#define KERNEL_DRAW_WAVEFORM 4
+#define KERNEL_TRIGGER_PULSE 5
+#define KERNEL_SPLIT 6
+#define KERNEL_DEEP_BUILD 7
+#define KERNEL_DEEP_VIEW 8
+#define KERNEL_HIRES 9
+#define KERNEL_AVERAGE 10
+#define KERNEL_MATH 11
+#define KERNEL_XY 12              // runs after the deep memory kernels since the hit buffer overwrites their record
+#define KERNEL_XCORR_FFT 13       // the delay measurement over the whole window, by FFT
+#define KERNEL_XCORR_DIRECT 14    // the delay measurement over a small window, summed directly
+#define KERNEL_AUTOSET 15         // analyzing a block of both channels and choosing the settings
+#define KERNEL_CALIBRATE 16       // putting a block through a correction table
+#define NUM_KERNELS 17
+#define MATH_OPS 5                // operations the math kernel runs, MATH_ADD to MATH_DERIVATIVE
+#define MIN_BENCH_NS 20000000     // each measurement is repeated until it has run for at least 20 ms
+#define START_REPS 16             // number of repetitions the calibration starts from
+#define FREQ_TOLERANCE 3          // percent a measured frequency may differ from the expected one
+#define LINE_LEN 512              // longest line read from a baseline file
+#define BENCH_PULSE_MAX 300       // the pulse trigger looks for pulses shorter than this many samples
+#define ENOB_SAMPLES (X_PIXELS * MAX_XSCALE / INDEX_DIVISOR + 1)  // samples under a whole screen at the slowest timebase
+#define AVG_SETTLE_FRAMES 64      // frames of the same frame the average check settles the exponential average with
+#define BENCH_XCORR_DELAY 37      // samples channel 2 of the FFT correlation kernel is behind channel 1
+#define BENCH_XCORR_WINDOW 16     // the window of the direct correlation kernel
+#define BENCH_XCORR_NEAR 5        // samples channel 2 of the direct correlation kernel is behind channel 1
+#define XCORR_TOLERANCE ((1 << XCORR_FRACTION_BITS) / 4)  // a measured delay may be a quarter of a sample out
+#define FILTER_BLOCKS 16          // blocks of a test sine the filter check runs through
+#define FILTER_SETTLE 8           // blocks the filter is given to settle before its gain is measured
+#define FILTER_AMPLITUDE 0x300    // amplitude of the test sines in codes
+#define FILTER_TOLERANCE 0.01     // a measured gain may differ this much from the one the coefficients give
+#define FILTER_TESTS 3            // frequencies each filter is checked at
+#define BENCH_CAL_POINTS 9        // references the calibration kernel's channel is calibrated with
+#define BENCH_CAL_GAIN 0.97       // the modelled ADC's gain,
+#define BENCH_CAL_OFFSET 40.0     // offset in codes
+#define BENCH_CAL_BOW 8.0         // and the codes its INL bows by at mid-scale
+#define DECODE_BLOCKS 8           // blocks of a bus the decode check renders and decodes a block at a time
+#define DECODE_SAMPLES (DECODE_BLOCKS * SIZE)
+#define DECODE_MAX_EVENTS 1024    // events the rendered bus may carry
+#define DECODE_HIGH 3000          // the bus levels in millivolts
+#define DECODE_LOW 200
+#define DECODE_NOISE 100          // peak noise on the bus in codes
+#define DECODE_IDLE 400           // samples the bus idles for between messages
+#define DECODE_MESSAGE_MAX 6000   // longest a message may take, so the last one ends before the record does
+#define DECODE_I2C_HALF 8         // samples of each half of an I2C clock
+#define DECODE_SPI_HALF 6         // and of an SPI clock
+#define DECODE_SPI_GAP 100        // samples of the gap between SPI bytes, longer than DEC_SPI_GAP
+#define LOGIC_BENCH_PERIOD 154000  // samples after which the logic check's channels repeat
+#define LOGIC_BENCH_BURST 4000    // samples of each period channel 1 toggles in, every four samples
+#define LOGIC_BENCH_SQUARE 1000   // samples of each half period of channel 2
+#define LOGIC_BENCH_SECONDS 5     // length of the logic record, as much of the busy channel as the capture memory holds
+#define LOGIC_BENCH_STEP 7919     // samples between the levels the logic check reads back
+#define MEAS_BENCH_VALUES 100000  // values each measurement statistics check adds
+#define MEAS_BENCH_WINDOW 64      // the window of the windowed checks
+#define MEAS_MEAN_TOLERANCE (1.0 / (1 << MEAS_FRACTION_BITS))  // a mean may be a step of its fraction out
+#define MEAS_SIGMA_TOLERANCE 0.005  // a standard deviation may be this fraction out,
+#define MEAS_SIGMA_STEPS 2.0      // plus this many steps of its fraction
+#define MASK_BENCH_PERIOD 100     // columns of each period of the mask check's frame
+#define MASK_BENCH_MARGIN 4       // pixels either side of the frame its mask allows
+#define MASK_BENCH_GLITCH 5       // columns of the glitch put into the failing frames
+#define MASK_BENCH_STREAM 1000    // frames the mask check's stream tests
+#define MASK_BENCH_BLOCKS 100     // blocks the mask check's block test cuts frames from
+#define MASK_BENCH_COLUMN 100     // column of each block the block test glitches, between two drawn samples
+#define ENOB_SLACK 0.25           // bits the measured resolution gain may fall short of the ideal half bit per doubling
+
+/* Structures */
+typedef struct BENCH_CASE{        // everything a kernel needs to run over one corpus signal
+    const SIGNAL_SPEC *spec;      // the signal being measured
+    uint16_t data[SIZE];          // one ping-pong buffer worth of the signal
+    uint16_t middle;              // result of Middle, used as the input of FindFrequency
+    SCOPE_SETTINGS scope;         // settings passed to FindTrigger
+    WAVEFORM_DATA wave;           // coordinates used by Copy and DrawWaveForm
+    uint16_t pairs[2][SIZE];      // the signal interleaved with its reverse, laid out in the channel buffers as the interleaved DMA leaves them
+    uint16_t split[2][SIZE];      // channel buffers split in place by Acq_Split
+    uint16_t deepLow[2][X_PIXELS];  // smallest sample under each pixel column of the whole deep record
+    uint16_t deepHigh[2][X_PIXELS]; // largest sample under each pixel column
+    int32_t hires[X_PIXELS];      // column means written by the high resolution kernel, in 1/16 of a code
+    int32_t avgAcc[X_PIXELS];     // accumulator of the averaging kernel
+    int avgY[X_PIXELS];           // frame the averaging kernel folds in and writes the average over
+    uint16_t reversed[SIZE];      // the signal reversed, the second channel of the math kernels
+    int32_t math[MATH_OPS][SIZE]; // the result of each math operation
+    int xyReady;                  // TRUE once the XY hit buffer has been cleared of the deep record
+    uint16_t ahead[SIZE];         // the signal BENCH_XCORR_DELAY samples on, the channel 1 of the FFT correlation kernel
+    uint16_t near[SIZE];          // the signal BENCH_XCORR_NEAR samples on, the channel 1 of the direct correlation kernel
+    AUTOSET_CHANNEL autoset[2];   // the analysis of the autoset kernel, channel 2 flat
+    SCOPE_SETTINGS chosen;        // the settings it chose
+    uint16_t flat[SIZE];          // a flat channel at mid-scale, the channel 2 of the autoset kernel
+    uint16_t distorted[SIZE];     // the signal as the modelled ADC reads it
+    uint16_t corrected[SIZE];     // and corrected by the calibration kernel
+}BENCH_CASE;
+
+typedef struct FILTER_SPEC{      // one filter setting the filter sweep times and checks
+    const char *name;
+    int type;                     // one of the FILT_ types
+    int fir;                      // TRUE for an FIR
+    int order;
+    int cutoff;                   // in HZ
+    int test[FILTER_TESTS];       // frequencies the gain is checked at, in HZ
+    double designGain;            // the gain the design should have at the second test frequency
+    double designTolerance;       // how far from designGain it may be
+}FILTER_SPEC;
+
+typedef struct DECODE_SPEC{      // one bus the decode sweep renders, decodes and times
+    const char *name;
+    int protocol;                 // one of the DEC_ protocols
+    int baud;                     // the UART baud rate
+}DECODE_SPEC;
+
+typedef struct MEAS_SPEC{        // one stream of values the measurement statistics check adds
+    const char *name;
+    int32_t center;               // the values are spread evenly either side of this
+    int32_t spread;
+    int window;                   // the window, or 0 for all values
+}MEAS_SPEC;
+
+typedef struct MASK_SPEC{        // one frame the mask check tests against the mask made from the clean frame
+    const char *name;
+    int shift;                    // columns the frame is moved right
+    int offset;                   // pixels it is moved down
+    int noise;                    // peak noise added to each column in pixels
+    int glitch;                   // pixels the glitch columns are moved up, or 0 for none
+    int pass;                     // TRUE if the frame should pass
+}MASK_SPEC;
+
+typedef struct BASELINE_ENTRY{    // one measurement read back from a stored baseline
+    char kernel[STRLEN];
+    char signal[STRLEN];
+    double nsPerSample;
+}BASELINE_ENTRY;
+
+/* Globals shared with main_cm4.c */
+extern WAVEFORM_DATA WAVE;
+
+/* Globals */
+static const char *KERNEL_NAMES[NUM_KERNELS] = {"Middle","FindTrigger","FindFrequency","Copy","DrawWaveForm","TriggerPulse","Split","DeepBuild","DeepView","HiRes","Average","Math","XYPlot","XCorrFFT","XCorrDirect","Autoset","Calibrate"};
+static const SIGNAL_SPEC ENOB_SIGNALS[] = {      // the noisy signals the high resolution gain is measured on
+    {"enob_sine_noise8",  SIGNAL_SINE, 50, 0, ADC_CENTER, 0x200, 0, 8,  50},
+    {"enob_sine_noise32", SIGNAL_SINE, 50, 0, ADC_CENTER, 0x200, 0, 32, 50},
+    {"enob_sine_noise96", SIGNAL_SINE, 50, 0, ADC_CENTER, 0x200, 0, 96, 50},
+};
+static const int ENOB_XSCALES[] = {DEFAULT, 4 * DEFAULT, MAX_XSCALE};
+static const FILTER_SPEC FILTER_SPECS[] = {    // at its cutoff an IIR should be at half power and an FIR long enough for its transition band to be narrow at half amplitude
+    {"fir_lowpass",  FILT_LOWPASS,  TRUE,  2,  10000, {1000, 10000, 40000}, 0.5,    0.5},
+    {"fir_lowpass",  FILT_LOWPASS,  TRUE,  4,  10000, {1000, 10000, 40000}, 0.5,    0.5},
+    {"fir_lowpass",  FILT_LOWPASS,  TRUE,  8,  10000, {1000, 10000, 40000}, 0.5,    0.5},
+    {"fir_lowpass",  FILT_LOWPASS,  TRUE,  16, 10000, {1000, 10000, 40000}, 0.5,    0.5},
+    {"fir_lowpass",  FILT_LOWPASS,  TRUE,  32, 10000, {1000, 10000, 40000}, 0.5,    0.05},
+    {"fir_lowpass",  FILT_LOWPASS,  TRUE,  62, 10000, {1000, 10000, 40000}, 0.5,    0.05},
+    {"fir_highpass", FILT_HIGHPASS, TRUE,  32, 10000, {1000, 10000, 40000}, 0.5,    0.05},
+    {"iir_lowpass",  FILT_LOWPASS,  FALSE, 2,  10000, {1000, 10000, 40000}, 0.7071, 0.01},
+    {"iir_lowpass",  FILT_LOWPASS,  FALSE, 4,  10000, {1000, 10000, 40000}, 0.7071, 0.01},
+    {"iir_lowpass",  FILT_LOWPASS,  FALSE, 6,  10000, {1000, 10000, 40000}, 0.7071, 0.01},
+    {"iir_lowpass",  FILT_LOWPASS,  FALSE, 8,  10000, {1000, 10000, 40000}, 0.7071, 0.01},
+    {"iir_highpass", FILT_HIGHPASS, FALSE, 4,  1000,  {200,   1000, 10000}, 0.7071, 0.01},
+    {"notch",        FILT_NOTCH,    FALSE, 2,  50,    {500,   50,   60},    0,      0.01},
+    {"ac",           FILT_AC,       FALSE, 1,  0,     {50,    200,  2000},  1,      0.01},
+};
+static const DECODE_SPEC DECODE_SPECS[] = {
+    {"uart_9600",  DEC_UART, 9600},
+    {"uart_19200", DEC_UART, 19200},
+    {"uart_57600", DEC_UART, 57600},
+    {"i2c",        DEC_I2C,  0},
+    {"spi",        DEC_SPI,  0},
+};
+static const uint8_t DECODE_BYTES[] = {0x41, 0x5A, 0x00, 0xFF, 0xA5, 0x3C, 0x81, 0x7E};  // the bytes of each message
+static uint16_t FilterIn[FILTER_BLOCKS * SIZE];
+static uint16_t FilterOut[FILTER_BLOCKS * SIZE];
+static uint8_t DecodeLevels[2][DECODE_SAMPLES];  // the logic levels of the rendered bus
+static uint16_t DecodeBus[2][DECODE_SAMPLES];     // and the codes the scope reads them as
+static DEC_EVENT DecodeExpected[DECODE_MAX_EVENTS];
+static int DecodeExpectedCount;
+static uint16_t LogicBus[2][LOGIC_BENCH_PERIOD];  // one period of the logic check's channels
+static const uint32_t LOGIC_SPANS[] = {LOGIC_BENCH_SECONDS * SAMPLING_RATE, LOGIC_BENCH_SECONDS * SAMPLING_RATE / 64, 4096, X_PIXELS};
+static const MEAS_SPEC MEAS_SPECS[] = {
+    {"freq_all",      1000,    5,     0},
+    {"freq_window",   1000,    5,     MEAS_BENCH_WINDOW},
+    {"delay_all",     1000000, 50000, 0},
+    {"delay_window",  -250000, 50000, MEAS_BENCH_WINDOW},
+    {"phase_all",     0,       1799,  0},
+};
+static const MASK_SPEC MASK_SPECS[] = {
+    {"same",     0, 0,                     0,                 0,  TRUE},
+    {"jitter",   1, 0,                     0,                 0,  TRUE},
+    {"noise",    0, 0,                     MASK_BENCH_MARGIN, 0,  TRUE},
+    {"glitch",   0, 0,                     0,                 20, FALSE},
+    {"offset",   0, MASK_BENCH_MARGIN + 2, 0,                 0,  FALSE},
+};
+static int32_t MeasValues[MEAS_BENCH_VALUES];
+static uint16_t EnobNoisy[ENOB_SAMPLES];
+static uint16_t EnobClean[ENOB_SAMPLES];
+static BASELINE_ENTRY *BASELINE;  // one entry for each kernel and corpus signal
+static int BaselineCount = 0;
+static volatile uint32_t Sink;    // results are written here so the compiler cannot drop the kernel calls
+static BENCH_CASE CASE;
+
+
+/*
+NowNs:
+Returns a monotonic time stamp in nanoseconds.
+*/
+static uint64_t NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+
+/*
+Distort:
+Returns the raw code the modelled ADC of the calibration kernel reads for an ideal code: off in gain and offset,
+and bowed by BENCH_CAL_BOW codes at mid-scale.
+*/
+static double Distort(double code)
+{
+    double x = code / MAX_ADC_OUTPUT;
+    return code * BENCH_CAL_GAIN + BENCH_CAL_OFFSET + 4 * BENCH_CAL_BOW * x * (1 - x);
+}
+
+
+/*
+PrepareCase:
+Renders a corpus signal into the case buffer and builds the settings and coordinates the kernels use. The
+coordinates are formatted the same way Proccess_Channel does in free-run mode with the default scales.
+*/
+static void PrepareCase(BENCH_CASE *c, const SIGNAL_SPEC *spec)
+{
+    SCOPE_SETTINGS scope = {0};                                            // settings the kernels do not use stay zero
+
+    scope.xScale = DEFAULT;
+    scope.yScale = INVERT_YSCALE/DEFAULT;
+    scope.freeRun = TRUE;
+    scope.triggerDir = POSITIVE;
+    scope.triggerLevel = spec->center;                                     // triggering through the middle of the signal
+    scope.Running = TRUE;
+    scope.triggerChannel = CHANNEL_1;
+
+    c->spec = spec;
+    c->scope = scope;
+    GenerateSignal(spec, c->data, SIZE, 0);
+    GenerateSignal(spec, c->ahead, SIZE, BENCH_XCORR_DELAY);
+    GenerateSignal(spec, c->near, SIZE, BENCH_XCORR_NEAR);
+    c->middle = Middle(c->data);
+    for(int i=0;i<SIZE;i++){
+        int k = i % ACQ_SEGMENT;                                           // the pair's place in its segment
+        uint16_t *pair = (k < ACQ_SEGMENT/2 ? c->pairs[0] + 2*k : c->pairs[1] + 2*(k - ACQ_SEGMENT/2)) + i / ACQ_SEGMENT * ACQ_SEGMENT;
+        pair[0] = c->data[i];
+        pair[1] = c->data[SIZE-1-i];
+        c->reversed[i] = c->data[SIZE-1-i];
+        c->flat[i] = ADC_CENTER;
+        c->distorted[i] = (c->data[i] & UNDERFLOW_CHECK) ? c->data[i] : (uint16_t)lround(Distort(c->data[i]));
+    }
+    Deep_Plan();                                                           // a deep record of the whole capture memory, the
+    for(int i=0;i<DEEP.depth;i++){                                         // signal repeated on channel 1 and reversed on channel 2
+        uint16_t v1 = c->data[i % SIZE];
+        uint16_t v2 = c->data[SIZE - 1 - i % SIZE];
+        ACQ_Pool[i] = (v1 & UNDERFLOW_CHECK) ? 0 : v1;
+        ACQ_Pool[DEEP.depth + i] = (v2 & UNDERFLOW_CHECK) ? 0 : v2;
+    }
+    DEEP.length = DEEP.depth;
+    Deep_Build();
+    c->xyReady = FALSE;
+
+    uint64_t index = 0;
+    for(int i=0;i<X_PIXELS;i++){
+        c->wave.Wave1X[i] = i;
+        if(c->data[index/INDEX_SCALE] & UNDERFLOW_CHECK){
+            c->wave.Wave1Y[i] = 0;
+        } else {
+            c->wave.Wave1Y[i] = -c->data[index/INDEX_SCALE]*VOLTAGE_INT*scope.yScale/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN);
+        }
+        index = (index + (scope.xScale*INDEX_SCALE)/INDEX_DIVISOR) % MAX_INDEX;
+    }
+}
+
+
+/*
+RunKernel:
+Runs one kernel once over the case and returns its result (or a checksum for the kernels that return nothing).
+*/
+static uint32_t RunKernel(int kernel, BENCH_CASE *c)
+{
+    switch(kernel){
+        case KERNEL_MIDDLE:
+            return Middle(c->data);
+        case KERNEL_FIND_TRIGGER:
+            return (uint32_t)FindTrigger(c->data, c->scope);
+        case KERNEL_FIND_FREQUENCY:
+            return FindFrequency(c->data, c->middle);
+        case KERNEL_COPY:
+            Copy(c->wave.Wave1Y, c->wave.Prev_Wave1Y);
+            return c->wave.Prev_Wave1Y[X_PIXELS-1];
+        case KERNEL_DRAW_WAVEFORM:
+            HOST_LinesDrawn = 0;
+            DrawWaveForm(c->wave.Wave1X, c->wave.Wave1Y, X_PIXELS, Y_PIXELS);
+            return HOST_LinesDrawn;
+        case KERNEL_TRIGGER_PULSE:
+            Trigger_Reset();                                                  // each run streams the block from a clean state
+            return Trigger_Scan(c->data, SIZE, c->scope);
+        case KERNEL_SPLIT:
+            memcpy(c->split, c->pairs, sizeof(c->split));                     // each run splits the block as the DMA left it
+            for(int s=0;s<ACQ_SEGMENTS;s++){
+                Acq_Split(c->split[0] + s * ACQ_SEGMENT, c->split[1] + s * ACQ_SEGMENT, ACQ_SEGMENT);
+            }
+            return c->split[0][SIZE-1] + c->split[1][SIZE-1];
+        case KERNEL_DEEP_BUILD:
+            Deep_Build();
+            return DEEP.level[0][DEEP.levels-1][0];
+        case KERNEL_HIRES: {                                                  // the column means of a frame at the default timebase
+            uint64_t index = 0;
+            for(int p=0;p<X_PIXELS;p++){
+                uint64_t next = index + (c->scope.xScale*INDEX_SCALE)/INDEX_DIVISOR;
+                int count = (int)(next / INDEX_SCALE - index / INDEX_SCALE);
+                c->hires[p] = HiRes_Mean(HiRes_Sum(c->data + index / INDEX_SCALE, count), count);
+                index = next;
+            }
+            return c->hires[0];
+        }
+        case KERNEL_AVERAGE:                                                  // one frame folded into a full exponential average
+            memcpy(c->avgY, c->wave.Wave1Y, sizeof(c->avgY));
+            Avg_Update(c->avgAcc, c->avgY, (1u << AVG_DEFAULT_SHIFT) + 1, AVG_DEFAULT_SHIFT);
+            return c->avgY[0];
+        case KERNEL_MATH:                                                     // every operation over the block, channel 2 the signal reversed
+            for(int op=0;op<MATH_OPS;op++){
+                MATH.op = MATH_ADD + op;
+                MATH.source = CHANNEL_1;
+                Math_Block(c->data, c->reversed, 0, SIZE, TRUE);
+                for(int n=0;n<SIZE;n++){
+                    c->math[op][n] = Math_Value(n);                           // every sample, as if each were drawn
+                }
+            }
+            MATH.op = MATH_OFF;
+            return c->math[0][SIZE-1] + c->math[MATH_OPS-1][SIZE-1];
+        case KERNEL_XY:                                                       // one block plotted against its reverse and the changes drawn
+            XY.on = TRUE;
+            if(!c->xyReady){
+                Xy_Reset();
+                c->xyReady = TRUE;
+            }
+            Xy_Block(c->data, c->reversed, SIZE, c->scope);
+            Xy_Draw();
+            XY.on = FALSE;
+            return XY.active;
+        case KERNEL_XCORR_FFT:                                                // the signal against itself a little later
+            XCORR.maxLag = XCORR_MAX_LAG;
+            return Xcorr_Measure(c->ahead, c->data, SIZE) ? (uint32_t)XCORR.delay : 0;
+        case KERNEL_XCORR_DIRECT:
+            XCORR.maxLag = BENCH_XCORR_WINDOW;
+            return Xcorr_Measure(c->near, c->data, SIZE) ? (uint32_t)XCORR.delay : 0;
+        case KERNEL_AUTOSET: {                                                // the signal on channel 1 and nothing on channel 2
+            int offsets[2];
+            Autoset_Measure(c->data, SIZE, &c->autoset[0]);
+            Autoset_Measure(c->flat, SIZE, &c->autoset[1]);
+            c->chosen = c->scope;
+            return Autoset_Choose(c->autoset, &c->chosen, offsets) ? (uint32_t)c->chosen.xScale : 0;
+        }
+        case KERNEL_CALIBRATE:                                                // the modelled ADC's block back to the signal
+            memcpy(c->corrected, c->distorted, sizeof(c->corrected));
+            Cal_Correct(&CAL[0], c->corrected, SIZE);
+            return c->corrected[SIZE-1];
+        case KERNEL_DEEP_VIEW:                                                // the columns of the whole record, as Deep_Draw works them out
+            for(int ch=0;ch<2;ch++){
+                for(int p=0;p<X_PIXELS;p++){
+                    Deep_Range(ch, p * DEEP.length / X_PIXELS, (p + 1) * DEEP.length / X_PIXELS,
+                               &c->deepLow[ch][p], &c->deepHigh[ch][p]);
+                }
+            }
+            return c->deepLow[0][0] + c->deepHigh[1][X_PIXELS-1];
+        default:
+            return 0;
+    }
+}
+
+
+/*
+SamplesPerCall:
+Returns the number of samples (or pixels) one call of a kernel works through, used for the per-sample cost.
+*/
+static int SamplesPerCall(int kernel)
+{
+    if(kernel == KERNEL_COPY || kernel == KERNEL_DRAW_WAVEFORM || kernel == KERNEL_DEEP_VIEW || kernel == KERNEL_AVERAGE){
+        return X_PIXELS;
+    }
+    if(kernel == KERNEL_HIRES){
+        return X_PIXELS * DEFAULT / INDEX_DIVISOR;                           // the samples under one frame at the default timebase
+    }
+    if(kernel == KERNEL_MATH){
+        return MATH_OPS * SIZE;
+    }
+    if(kernel == KERNEL_DEEP_BUILD){
+        return 2 * DEEP.depth;
+    }
+    if(kernel == KERNEL_AUTOSET){
+        return 2 * SIZE;
+    }
+    return SIZE;
+}
+
+
+/*
+CheckResult:
+Decides whether a kernel result is correct for the signal in the case. The expectations come from the signal
+model rather than from the current kernels so that a faster kernel which changes results is caught.
+*/
+static int CheckResult(int kernel, BENCH_CASE *c, uint32_t result)
+{
+    const SIGNAL_SPEC *spec = c->spec;
+    int max = 0;
+    int min = MAX_ADC_OUTPUT;
+
+    for(int i=0;i<SIZE;i++){                                                  // range of the valid (not underflowed) codes
+        if(!(c->data[i] & UNDERFLOW_CHECK)){
+            if(c->data[i] > max) max = c->data[i];
+            if(c->data[i] < min) min = c->data[i];
+        }
+    }
+
+    switch(kernel){
+        case KERNEL_MIDDLE: {
+            if(spec->type == SIGNAL_FLAT){
+                return result == 0;                                           // a flat signal has no middle
+            }
+            int expected = (max + min) / 2;
+            int tolerance = (max - min) / 16 + NOISE_THRESHOLD / 2;           // Middle only looks at every CHECK_FREQ-th sample
+            return abs((int)result - expected) <= tolerance;
+        }
+        case KERNEL_FIND_TRIGGER: {
+            int crossing = FALSE;
+            for(int i=NOISE_MARGIN;i<SIZE-NOISE_MARGIN && !crossing;i++){     // is there a clean rising crossing to find at all
+                crossing = !((c->data[i] | c->data[i+1]) & UNDERFLOW_CHECK)
+                && c->data[i] < c->scope.triggerLevel && c->data[i+1] >= c->scope.triggerLevel;
+            }
+            if(!crossing){
+                return result == ERROR;                                       // nothing to trigger on
+            }
+            if(result == ERROR || result % INDEX_SCALE){
+                return FALSE;
+            }
+            int i = result / INDEX_SCALE;                                     // the trigger condition must hold at the index returned
+            return c->data[i] < c->scope.triggerLevel && c->data[i+1] >= c->scope.triggerLevel;
+        }
+        case KERNEL_FIND_FREQUENCY:
+            if(spec->type == SIGNAL_FLAT || (spec->expectedFreq != UNKNOWN_FREQ
+            && SAMPLING_RATE / spec->expectedFreq >= SIZE - 2 * NOISE_MARGIN)){
+                return (int)result == ERROR;                                  // two crossings of the same slope do not fit in one buffer
+            }
+            if(spec->expectedFreq == UNKNOWN_FREQ){                           // a chirp must report something inside its sweep
+                return (int)result >= spec->freq && (int)result <= spec->freqEnd;
+            }
+            return abs((int)result - spec->expectedFreq) * 100 <= spec->expectedFreq * FREQ_TOLERANCE;
+        case KERNEL_COPY:
+            return !memcmp(c->wave.Wave1Y, c->wave.Prev_Wave1Y, sizeof(c->wave.Wave1Y));
+        case KERNEL_DRAW_WAVEFORM:
+            return result == X_PIXELS - 1;                                    // one line between each pair of points
+        case KERNEL_TRIGGER_PULSE: {
+            int period = spec->freq ? SAMPLING_RATE / spec->freq : 0;
+            int width = spec->type == SIGNAL_PWM ? period * spec->duty / 100 : period / 2;
+            if(spec->type == SIGNAL_CHIRP){
+                return result == ERROR || result < SIZE * INDEX_SCALE;       // the pulse widths sweep through the limit
+            }
+            if(spec->type == SIGNAL_FLAT || period >= SIZE || width >= BENCH_PULSE_MAX){
+                return result == ERROR;                                       // no complete pulse short enough in the block
+            }
+            return result != ERROR && result < SIZE * INDEX_SCALE && !(result % INDEX_SCALE);
+        }
+        case KERNEL_SPLIT:
+            for(int i=0;i<SIZE;i++){
+                if(c->split[0][i] != c->data[i] || c->split[1][i] != c->data[SIZE-1-i]){
+                    return FALSE;                                             // a sample went to the wrong channel or place
+                }
+            }
+            return TRUE;
+        case KERNEL_DEEP_BUILD: {
+            uint16_t lo = ACQ_Pool[0];                                        // the top level must hold the extremes of the record
+            uint16_t hi = lo;
+            for(int i=1;i<DEEP.length;i++){
+                if(ACQ_Pool[i] < lo) lo = ACQ_Pool[i];
+                if(ACQ_Pool[i] > hi) hi = ACQ_Pool[i];
+            }
+            uint16_t *top = DEEP.level[0][DEEP.levels-1];
+            return result == lo && top[0] == lo && top[DEEP.buckets[DEEP.levels-1]] == hi;
+        }
+        case KERNEL_DEEP_VIEW:
+            for(int ch=0;ch<2;ch++){
+                uint16_t *samples = ACQ_Pool + ch * DEEP.depth;
+                for(int p=0;p<X_PIXELS;p++){
+                    int start = p * DEEP.length / X_PIXELS;
+                    int end = (p + 1) * DEEP.length / X_PIXELS;
+                    int slack = (end - start) / 2;                            // buckets may reach half a column past either end
+                    uint16_t exactLow = MAX_ADC_OUTPUT, exactHigh = 0, wideLow = MAX_ADC_OUTPUT, wideHigh = 0;
+                    for(int i=start-slack;i<end+slack;i++){
+                        if(i < 0 || i >= DEEP.length) continue;
+                        uint16_t v = samples[i];
+                        if(v < wideLow) wideLow = v;
+                        if(v > wideHigh) wideHigh = v;
+                        if(i >= start && i < end){
+                            if(v < exactLow) exactLow = v;
+                            if(v > exactHigh) exactHigh = v;
+                        }
+                    }
+                    if(c->deepLow[ch][p] > exactLow || c->deepHigh[ch][p] < exactHigh
+                    || c->deepLow[ch][p] < wideLow || c->deepHigh[ch][p] > wideHigh){
+                        return FALSE;                                         // a column missed a sample or took one from too far away
+                    }
+                }
+            }
+            return TRUE;
+        case KERNEL_HIRES: {
+            uint64_t index = 0;
+            for(int p=0;p<X_PIXELS;p++){                                      // each mean must be the exact mean rounded to 1/16 of a code
+                uint64_t next = index + (c->scope.xScale*INDEX_SCALE)/INDEX_DIVISOR;
+                double sum = 0;
+                for(uint64_t n=index/INDEX_SCALE;n<next/INDEX_SCALE;n++){
+                    sum += (c->data[n] & UNDERFLOW_CHECK) ? 0 : c->data[n];
+                }
+                double exact = sum * (1 << HIRES_FRACTION_BITS) / (double)(next / INDEX_SCALE - index / INDEX_SCALE);
+                if(fabs(c->hires[p] - exact) > 0.5 + 1e-9){
+                    return FALSE;
+                }
+                index = next;
+            }
+            return TRUE;
+        }
+        case KERNEL_AVERAGE:
+            for(uint32_t f=1;f<=4;f++){                                       // the frame raised 0, 2, 4 and 6 pixels averages
+                for(int p=0;p<X_PIXELS;p++){                                  // to exactly 3 pixels up while the average fills
+                    c->avgY[p] = c->wave.Wave1Y[p] + 2 * (f - 1);
+                }
+                Avg_Update(c->avgAcc, c->avgY, f, AVG_DEFAULT_SHIFT);
+            }
+            for(int p=0;p<X_PIXELS;p++){
+                if(c->avgY[p] != c->wave.Wave1Y[p] + 3){
+                    return FALSE;
+                }
+            }
+            for(uint32_t f=5;f<5+AVG_SETTLE_FRAMES;f++){                      // and the exponential average then settles back onto the frame
+                memcpy(c->avgY, c->wave.Wave1Y, sizeof(c->avgY));
+                Avg_Update(c->avgAcc, c->avgY, f, AVG_DEFAULT_SHIFT);
+            }
+            return !memcmp(c->avgY, c->wave.Wave1Y, sizeof(c->avgY));
+        case KERNEL_MATH: {
+            int64_t sum = 0;
+            for(int n=0;n<SIZE;n++){                                          // each result worked out the slow way from the codes
+                int64_t a = (c->data[n] & UNDERFLOW_CHECK) ? 0 : c->data[n];
+                int64_t b = (c->reversed[n] & UNDERFLOW_CHECK) ? 0 : c->reversed[n];
+                int64_t prev = n == 0 ? a : ((c->data[n-1] & UNDERFLOW_CHECK) ? 0 : c->data[n-1]);
+                sum += a;
+                if(c->math[0][n] != a + b || c->math[1][n] != a - b || c->math[2][n] != (a * b) / (1 << MATH_PRODUCT_SHIFT)
+                || c->math[3][n] != sum || c->math[4][n] != a - prev){
+                    return FALSE;
+                }
+            }
+            return TRUE;
+        }
+        case KERNEL_XY: {
+            static uint8_t expected[XY_HIT_BYTES];                            // the cells the block should light, from the same mapping
+            int32_t gain = (int32_t)(((int64_t)VOLTAGE_INT * c->scope.yScale << XY_GAIN_SHIFT) / (MAX_ADC_OUTPUT * VOLTAGE_SCALE_DOWN));
+            int distinct = 0;
+            memset(expected, 0, sizeof(expected));
+            for(int n=0;n<SIZE;n++){
+                int32_t v1 = (c->data[n] & UNDERFLOW_CHECK) ? 0 : c->data[n];
+                int32_t v2 = (c->reversed[n] & UNDERFLOW_CHECK) ? 0 : c->reversed[n];
+                int x = X_PIXELS / 2 + (((v1 - XY_CENTER) * gain) >> XY_GAIN_SHIFT);
+                int y = Y_PIXELS / 2 - (((v2 - XY_CENTER) * gain) >> XY_GAIN_SHIFT);
+                int cell = (y >> XY_CELL_SHIFT) * XY_COLUMNS + (x >> XY_CELL_SHIFT);
+                if(x >= 0 && x < X_PIXELS && y >= 0 && y < Y_PIXELS && !expected[cell]){
+                    expected[cell] = TRUE;
+                    distinct++;
+                }
+            }
+            XY.on = TRUE;                                                     // a fresh plot must light exactly those cells and draw each once
+            Xy_Reset();
+            Xy_Block(c->data, c->reversed, SIZE, c->scope);
+            HOST_RectsDrawn = 0;
+            Xy_Draw();
+            XY.on = FALSE;
+            if(XY.active != distinct || (int)HOST_RectsDrawn != distinct){
+                return FALSE;
+            }
+            for(int p=0;p<XY_HIT_BYTES;p++){
+                if(!((uint8_t *)ACQ_Pool)[p] != !expected[p]){
+                    return FALSE;
+                }
+            }
+            return TRUE;
+        }
+        case KERNEL_XCORR_FFT:
+        case KERNEL_XCORR_DIRECT: {
+            int delay = kernel == KERNEL_XCORR_FFT ? BENCH_XCORR_DELAY : BENCH_XCORR_NEAR;
+            if(spec->type == SIGNAL_FLAT){
+                return !XCORR.valid;                                          // a flat signal has nothing to line up
+            }
+            if(XCORR.direct != (kernel == KERNEL_XCORR_DIRECT)){
+                return FALSE;                                                 // each window must take the path it is timed on
+            }
+            return abs((int32_t)result - delay * (1 << XCORR_FRACTION_BITS)) <= XCORR_TOLERANCE;
+        }
+        case KERNEL_AUTOSET: {
+            int swing = max - min;
+            if(spec->type == SIGNAL_FLAT){
+                return result == 0 && c->chosen.freeRun;                      // nothing to trigger on
+            }
+            if(c->chosen.triggerChannel != CHANNEL_1 || c->chosen.freeRun || abs(c->chosen.triggerLevel - (max + min) / 2) > swing / 16
+            || -CODE_TO_PIXEL(swing, c->chosen.yScale) > AUTOSET_FILL_PIXELS){
+                return FALSE;                                                 // the trigger must be on the signal, through its middle, and it must fit
+            }
+            if(c->chosen.yScale != INVERT_YSCALE/MIN_YSCALE && -CODE_TO_PIXEL(swing, INVERT_YSCALE/MIN_YSCALE) <= AUTOSET_FILL_PIXELS){
+                return FALSE;                                                 // and not be shown smaller than it needs to be
+            }
+            if(spec->expectedFreq == UNKNOWN_FREQ){                           // a chirp's timebase must suit a frequency of its sweep
+                double samples = (double)X_PIXELS * result / INDEX_DIVISOR;
+                return samples * spec->freqEnd / SAMPLING_RATE >= 2 && samples * spec->freq / SAMPLING_RATE <= 3;
+            }
+            if(2 * SAMPLING_RATE / spec->expectedFreq >= SIZE){
+                return result == MAX_XSCALE;                                  // under two periods in the block - the slowest timebase
+            }
+            double periods = (double)X_PIXELS * result / INDEX_DIVISOR * spec->expectedFreq / SAMPLING_RATE;
+            return periods >= 2 && periods <= 3;                              // two to three periods on the screen
+        }
+        case KERNEL_CALIBRATE:
+            for(int n=0;n<SIZE;n++){                                          // every sample back to within a code of the signal
+                if(c->data[n] & UNDERFLOW_CHECK ? c->corrected[n] != c->data[n] : abs(c->corrected[n] - c->data[n]) > 1){
+                    return FALSE;
+                }
+            }
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+
+/*
+Enob:
+Returns the effective number of bits of a reading whose error from the true value has the given rms, taking the
+full ADC range as the signal - an ideal converter's rounding alone has an rms of 1/sqrt(12) of a code.
+*/
+static double Enob(double rms)
+{
+    return log2((MAX_ADC_OUTPUT + 1) / (rms * sqrt(12.0)));
+}
+
+
+/*
+EnobSweep:
+Measures the resolution the high resolution mode gains on noisy signals. Each signal is rendered once with its
+noise and once without over a whole screen at the slowest timebase. At each timebase the error of the single
+samples from the clean ones and the error of the column means from the means of the clean samples give the
+effective bits of each; the gain must come within ENOB_SLACK bits of half a bit per doubling of the samples in a
+column. Prints one JSON line per signal and timebase and returns the number of measurements that fell short.
+*/
+static int EnobSweep(int *cases)
+{
+    int failures = 0;
+
+    for(size_t s=0;s<sizeof(ENOB_SIGNALS)/sizeof(ENOB_SIGNALS[0]);s++){
+        SIGNAL_SPEC clean = ENOB_SIGNALS[s];
+        clean.noise = 0;
+        GenerateSignal(&ENOB_SIGNALS[s], EnobNoisy, ENOB_SAMPLES, 0);
+        GenerateSignal(&clean, EnobClean, ENOB_SAMPLES, 0);
+
+        for(size_t x=0;x<sizeof(ENOB_XSCALES)/sizeof(ENOB_XSCALES[0]);x++){
+            int xScale = ENOB_XSCALES[x];
+            uint64_t index = 0;
+            double rawError = 0, meanError = 0;
+            int samples = 0;
+
+            for(int p=0;p<X_PIXELS;p++){
+                uint64_t next = index + (xScale*INDEX_SCALE)/INDEX_DIVISOR;
+                int first = index / INDEX_SCALE;
+                int count = (int)(next / INDEX_SCALE) - first;
+                double cleanMean = (double)HiRes_Sum(EnobClean + first, count) / count;
+                double mean = (double)HiRes_Mean(HiRes_Sum(EnobNoisy + first, count), count) / (1 << HIRES_FRACTION_BITS);
+                for(int n=first;n<first+count;n++){
+                    rawError += ((double)EnobNoisy[n] - EnobClean[n]) * ((double)EnobNoisy[n] - EnobClean[n]);
+                }
+                meanError += (mean - cleanMean) * (mean - cleanMean);
+                samples += count;
+                index = next;
+            }
+
+            double raw = Enob(sqrt(rawError / samples));
+            double hires = Enob(sqrt(meanError / X_PIXELS));
+            double perColumn = (double)samples / X_PIXELS;
+            double expected = 0.5 * log2(perColumn);
+            int correct = hires - raw >= expected - ENOB_SLACK;
+            printf("{\"enob\":true,\"signal\":\"%s\",\"xscale\":%d,\"samples_per_column\":%.2f,\"enob_raw\":%.2f,"
+                   "\"enob_hires\":%.2f,\"gain_bits\":%.2f,\"expected_bits\":%.2f,\"correct\":%s}\n",
+                   ENOB_SIGNALS[s].name, xScale, perColumn, raw, hires, hires - raw, expected, correct ? "true" : "false");
+            (*cases)++;
+            if(!correct){
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+
+/*
+ModelGain:
+Returns the gain at freq HZ that a filter's coefficients give, worked out in floating point from the taps or the
+biquads (or the AC coupling pole) rather than from running the fixed point kernels.
+*/
+static double ModelGain(const FILTER_CHANNEL *f, int freq)
+{
+    double w = 2 * M_PI * freq / SAMPLING_RATE;
+    double complex z1 = cexp(-I * w);                                        // z to the minus one
+    double complex h = 1;
+
+    if(f->type == FILT_AC){
+        h = (1 - z1) / (1 - (1 - 1.0 / (1 << FILT_AC_SHIFT)) * z1);
+    } else if(f->fir && f->type != FILT_NOTCH){
+        h = 0;
+        for(int k=0;k<=f->order;k++){
+            h += f->taps[k] / (double)(1 << FILT_TAP_BITS) * cpow(z1, k);
+        }
+    } else {
+        for(int s=0;s<f->sections;s++){
+            const FILTER_SECTION *q = &f->section[s];
+            double one = 1 << FILT_COEF_BITS;
+            h *= (q->b0 / one + q->b1 / one * z1 + q->b2 / one * z1 * z1) / (1 + q->a1 / one * z1 + q->a2 / one * z1 * z1);
+        }
+    }
+    return cabs(h);
+}
+
+
+/*
+MeasureGain:
+Runs a sine of freq HZ through the filter a block at a time and returns the amplitude that comes out over the
+amplitude that went in. The amplitude is fitted by least squares to a level plus a sine and cosine of the same
+frequency over the blocks after the filter has settled.
+*/
+static double MeasureGain(FILTER_CHANNEL *f, int freq)
+{
+    double w = 2 * M_PI * freq / SAMPLING_RATE;
+    double m[3][3] = {{0}}, v[3] = {0};
+
+    Filt_Design(f);
+    for(int n=0;n<FILTER_BLOCKS*SIZE;n++){
+        FilterOut[n] = (uint16_t)lround(ADC_CENTER + FILTER_AMPLITUDE * sin(w * n));
+    }
+    for(int b=0;b<FILTER_BLOCKS;b++){
+        Filt_Run(f, FilterOut + b * SIZE, SIZE);
+    }
+    for(int n=FILTER_SETTLE*SIZE;n<FILTER_BLOCKS*SIZE;n++){                   // the normal equations of the fit
+        double basis[3] = {1, sin(w * n), cos(w * n)};
+        for(int r=0;r<3;r++){
+            for(int c=0;c<3;c++){
+                m[r][c] += basis[r] * basis[c];
+            }
+            v[r] += basis[r] * FilterOut[n];
+        }
+    }
+    for(int p=0;p<3;p++){                                                     // solved by elimination
+        for(int r=p+1;r<3;r++){
+            double k = m[r][p] / m[p][p];
+            for(int c=p;c<3;c++){
+                m[r][c] -= k * m[p][c];
+            }
+            v[r] -= k * v[p];
+        }
+    }
+    double x[3];
+    for(int r=2;r>=0;r--){
+        x[r] = v[r];
+        for(int c=r+1;c<3;c++){
+            x[r] -= m[r][c] * x[c];
+        }
+        x[r] /= m[r][r];
+    }
+    return sqrt(x[1] * x[1] + x[2] * x[2]) / FILTER_AMPLITUDE;
+}
+
+
+/*
+FilterSweep:
+Times each filter of FILTER_SPECS over blocks of a noisy sine and checks it: at each test frequency the gain
+measured through the fixed point kernels must match the gain its coefficients give, and at the second test
+frequency the coefficients must give the gain the design calls for. Prints one JSON line per filter and returns
+the number of filters that failed.
+*/
+static int FilterSweep(int *cases)
+{
+    int failures = 0;
+    FILTER_CHANNEL filter;
+
+    GenerateSignal(&SIGNAL_CORPUS[6], FilterIn, FILTER_BLOCKS * SIZE, 0);    // the noisy sine
+    for(size_t s=0;s<sizeof(FILTER_SPECS)/sizeof(FILTER_SPECS[0]);s++){
+        const FILTER_SPEC *spec = &FILTER_SPECS[s];
+        double measured[FILTER_TESTS], model[FILTER_TESTS];
+        uint64_t elapsed = 0;
+        uint64_t reps = START_REPS;
+        int correct = TRUE;
+
+        memset(&filter, 0, sizeof(filter));
+        filter.type = spec->type;
+        filter.fir = spec->fir;
+        filter.order = spec->order;
+        filter.cutoff = spec->cutoff;
+        for(int t=0;t<FILTER_TESTS;t++){
+            measured[t] = MeasureGain(&filter, spec->test[t]);
+            model[t] = ModelGain(&filter, spec->test[t]);
+            correct = correct && fabs(measured[t] - model[t]) <= FILTER_TOLERANCE;
+        }
+        correct = correct && fabs(model[1] - spec->designGain) <= spec->designTolerance;
+
+        Filt_Design(&filter);
+        for(;;){                                                              // timed over the corpus noisy sine a block at a time
+            uint64_t start = NowNs();
+            for(uint64_t r=0;r<reps;r++){
+                int b = r % FILTER_BLOCKS;
+                memcpy(FilterOut, FilterIn + b * SIZE, SIZE * sizeof(uint16_t));
+                Filt_Run(&filter, FilterOut, SIZE);
+                Sink += FilterOut[SIZE-1];
+            }
+            elapsed = NowNs() - start;
+            if(elapsed >= MIN_BENCH_NS){
+                break;
+            }
+            reps *= 2;
+        }
+        double nsPerSample = (double)elapsed / ((double)reps * SIZE);
+        printf("{\"filter\":\"%s\",\"order\":%d,\"cutoff\":%d,\"ns_per_sample\":%.4f,\"msamples_per_s\":%.2f,"
+               "\"gain\":[%.4f,%.4f,%.4f],\"model_gain\":[%.4f,%.4f,%.4f],\"correct\":%s}\n",
+               spec->name, spec->order, spec->cutoff, nsPerSample, 1000.0 / nsPerSample, measured[0], measured[1], measured[2],
+               model[0], model[1], model[2], correct ? "true" : "false");
+        (*cases)++;
+        if(!correct){
+            failures++;
+        }
+    }
+    return failures;
+}
+
+
+/*
+Hold:
+Holds the rendered bus at the levels ch1 and ch2 for n samples from at. Returns the sample after them.
+*/
+static int Hold(int at, int ch1, int ch2, int n)
+{
+    for(int i=at;i<at+n && i<DECODE_SAMPLES;i++){
+        DecodeLevels[0][i] = ch1;
+        DecodeLevels[1][i] = ch2;
+    }
+    return at + n;
+}
+
+
+/*
+Expect:
+Adds an event to the ones the decoder must find.
+*/
+static void Expect(uint32_t time, int kind, int value, int flags)
+{
+    DEC_EVENT *e = &DecodeExpected[DecodeExpectedCount++];
+
+    e->time = time;
+    e->kind = kind;
+    e->value = value;
+    e->flags = flags;
+}
+
+
+/*
+I2cByte:
+Renders an I2C byte from at with its ACK bit (low for an ACK), with SCL low on either side. SDA changes in the
+middle of SCL low and is read on the rising edge.
+*/
+static int I2cByte(int at, int value, int ack)
+{
+    for(int b=0;b<9;b++){
+        int sda = b < 8 ? (value >> (7 - b)) & 1 : !ack;
+        at = Hold(at, 0, DecodeLevels[1][at-1], DECODE_I2C_HALF / 2);
+        at = Hold(at, 0, sda, DECODE_I2C_HALF / 2);
+        at = Hold(at, 1, sda, DECODE_I2C_HALF);
+    }
+    return Hold(at, 0, DecodeLevels[1][at-1], DECODE_I2C_HALF / 2);
+}
+
+
+/*
+RenderMessage:
+Renders one message of a bus from at and adds its events to the expected ones. A UART message is the bytes of
+DECODE_BYTES as 8N1 frames with two idle bits between them; an SPI message is the same bytes with a gap between
+each; an I2C message writes two bytes to address 0x50, then after a repeated start reads one byte back and NACKs
+it. Returns the sample after the message.
+*/
+static int RenderMessage(const DECODE_SPEC *spec, int at)
+{
+    if(spec->protocol == DEC_UART){
+        double bit = (double)SAMPLING_RATE / spec->baud;
+        for(size_t k=0;k<sizeof(DECODE_BYTES);k++){
+            int start = at;
+            Expect(start, DEC_EV_BYTE, DECODE_BYTES[k], 0);
+            for(int b=0;b<12;b++){                                            // start bit, 8 data bits, stop bit and two idle bits
+                int level = b == 0 ? 0 : (b <= 8 ? (DECODE_BYTES[k] >> (b - 1)) & 1 : 1);
+                int end = start + (int)lround((b + 1) * bit);
+                at = Hold(at, level, 1, end - at);
+            }
+        }
+    } else if(spec->protocol == DEC_SPI){
+        for(size_t k=0;k<sizeof(DECODE_BYTES);k++){
+            Expect(at + DECODE_SPI_HALF, DEC_EV_BYTE, DECODE_BYTES[k], 0);
+            for(int b=0;b<8;b++){
+                int mosi = (DECODE_BYTES[k] >> (7 - b)) & 1;
+                at = Hold(at, 0, mosi, DECODE_SPI_HALF);
+                at = Hold(at, 1, mosi, DECODE_SPI_HALF);
+            }
+            at = Hold(at, 0, DecodeLevels[1][at-1], DECODE_SPI_GAP);
+        }
+    } else {
+        Expect(at, DEC_EV_START, 0, 0);
+        at = Hold(at, 1, 0, DECODE_I2C_HALF);                                 // start
+        at = Hold(at, 0, 0, DECODE_I2C_HALF / 2);
+        Expect(at + DECODE_I2C_HALF, DEC_EV_ADDRESS, 0x50, 0);
+        at = I2cByte(at, 0x50 << 1, TRUE);
+        Expect(at + DECODE_I2C_HALF, DEC_EV_DATA, 0x12, 0);
+        at = I2cByte(at, 0x12, TRUE);
+        Expect(at + DECODE_I2C_HALF, DEC_EV_DATA, 0x34, 0);
+        at = I2cByte(at, 0x34, TRUE);
+        at = Hold(at, 0, 1, DECODE_I2C_HALF / 2);                             // repeated start
+        at = Hold(at, 1, 1, DECODE_I2C_HALF);
+        Expect(at, DEC_EV_START, 0, 0);
+        at = Hold(at, 1, 0, DECODE_I2C_HALF);
+        at = Hold(at, 0, 0, DECODE_I2C_HALF / 2);
+        Expect(at + DECODE_I2C_HALF, DEC_EV_ADDRESS, 0x50, DEC_FLAG_READ);
+        at = I2cByte(at, (0x50 << 1) | 1, TRUE);
+        Expect(at + DECODE_I2C_HALF, DEC_EV_DATA, 0xAB, DEC_FLAG_ERROR);
+        at = I2cByte(at, 0xAB, FALSE);
+        at = Hold(at, 0, 0, DECODE_I2C_HALF / 2);                             // stop
+        at = Hold(at, 1, 0, DECODE_I2C_HALF);
+        Expect(at, DEC_EV_STOP, 0, 0);
+    }
+    return Hold(at, spec->protocol == DEC_SPI ? 0 : 1, 1, DECODE_IDLE);
+}
+
+
+/*
+DecodeSweep:
+Renders each bus of DECODE_SPECS as message after message over DECODE_BLOCKS blocks of noisy analog levels and
+decodes it a block at a time. The events must match the ones rendered in kind, value, flags and sample (a UART
+byte to within a sample, as its start edge is rounded). Then the decoding is timed over the blocks. Prints one
+JSON line per bus and returns the number that decoded wrong.
+*/
+static int DecodeSweep(int *cases)
+{
+    int failures = 0;
+    uint32_t noise = 1;
+
+    for(size_t s=0;s<sizeof(DECODE_SPECS)/sizeof(DECODE_SPECS[0]);s++){
+        const DECODE_SPEC *spec = &DECODE_SPECS[s];
+        uint64_t elapsed = 0;
+        uint64_t reps = START_REPS;
+        int matched = 0;
+        int found = 0;
+
+        DecodeExpectedCount = 0;
+        int at = Hold(0, spec->protocol == DEC_SPI ? 0 : 1, 1, DECODE_IDLE);
+        while(at + DECODE_MESSAGE_MAX < DECODE_SAMPLES){
+            at = RenderMessage(spec, at);
+        }
+        Hold(at, spec->protocol == DEC_SPI ? 0 : 1, 1, DECODE_SAMPLES - at);
+        for(int c=0;c<2;c++){
+            for(int i=0;i<DECODE_SAMPLES;i++){
+                noise = noise * 1103515245 + 12345;
+                int n = (int)((noise >> 16) % (2 * DECODE_NOISE + 1)) - DECODE_NOISE;
+                DecodeBus[c][i] = MILLIVOLTS_TO_CODE(DecodeLevels[c][i] ? DECODE_HIGH : DECODE_LOW) + n;
+            }
+        }
+
+        DECODE.protocol = spec->protocol;
+        DECODE.baud = spec->baud ? spec->baud : DEC_DEFAULT_BAUD;
+        DECODE.spiFalling = FALSE;
+        DECODE.level = MILLIVOLTS_TO_CODE(DEC_DEFAULT_LEVEL);
+        DECODE.stream = FALSE;
+        Dec_Reset();
+        for(int b=0;b<DECODE_BLOCKS;b++){                                     // checked a block at a time, the decoder carrying its state across
+            uint32_t before = DECODE.head;
+            Dec_Run(DecodeBus[0] + b * SIZE, DecodeBus[1] + b * SIZE, SIZE);
+            for(uint32_t k=before;k!=DECODE.head;k++,found++){
+                const DEC_EVENT *e = &DECODE.ring[k & (DEC_RING_SIZE - 1)];
+                const DEC_EVENT *x = &DecodeExpected[found];
+                int slack = spec->protocol == DEC_UART ? 1 : 0;
+                if(found < DecodeExpectedCount && e->kind == x->kind && e->value == x->value && e->flags == x->flags &&
+                   e->time + slack >= x->time && e->time <= x->time + slack){
+                    matched++;
+                }
+            }
+        }
+        int correct = found == DecodeExpectedCount && matched == DecodeExpectedCount;
+
+        for(;;){                                                              // timed over the blocks again and again
+            uint64_t start = NowNs();
+            for(uint64_t r=0;r<reps;r++){
+                int b = r % DECODE_BLOCKS;
+                Dec_Run(DecodeBus[0] + b * SIZE, DecodeBus[1] + b * SIZE, SIZE);
+            }
+            elapsed = NowNs() - start;
+            if(elapsed >= MIN_BENCH_NS){
+                break;
+            }
+            reps *= 2;
+        }
+        Sink += DECODE.head;
+        double nsPerSample = (double)elapsed / ((double)reps * SIZE);
+        printf("{\"decode\":\"%s\",\"events\":%d,\"expected\":%d,\"matched\":%d,\"ns_per_sample\":%.4f,"
+               "\"msamples_per_s\":%.2f,\"correct\":%s}\n",
+               spec->name, found, DecodeExpectedCount, matched, nsPerSample, 1000.0 / nsPerSample, correct ? "true" : "false");
+        (*cases)++;
+        if(!correct){
+            failures++;
+        }
+    }
+    DECODE.protocol = DEC_OFF;
+    return failures;
+}
+
+
+/*
+LogicLevel:
+Returns the level of a channel of the logic check at sample t: channel 1 toggles every four samples for
+LOGIC_BENCH_BURST samples and then idles low for the rest of the period, with gaps longer than a word holds, and
+channel 2 is a square wave.
+*/
+static int LogicLevel(int channel, uint32_t t)
+{
+    uint32_t phase = t % LOGIC_BENCH_PERIOD;
+
+    if(channel == 0){
+        return phase < LOGIC_BENCH_BURST ? (phase >> 2) & 1 : 0;
+    }
+    return (phase / LOGIC_BENCH_SQUARE) & 1;
+}
+
+
+/*
+LogicRecord:
+Records LOGIC_BENCH_SECONDS of the logic check's channels a block at a time. Returns the samples recorded.
+*/
+static uint32_t LogicRecord(void)
+{
+    uint32_t total = LOGIC_BENCH_SECONDS * SAMPLING_RATE;
+    uint32_t at = 0;
+
+    LOGIC.length = 0;
+    while(at < total){
+        uint32_t phase = at % LOGIC_BENCH_PERIOD;
+        uint32_t n = SIZE;
+        if(n > LOGIC_BENCH_PERIOD - phase){
+            n = LOGIC_BENCH_PERIOD - phase;
+        }
+        if(n > total - at){
+            n = total - at;
+        }
+        uint32_t recorded = Logic_Record(LogicBus[0] + phase, LogicBus[1] + phase, n);
+        at += recorded;
+        if(recorded < n){
+            break;
+        }
+    }
+    return at;
+}
+
+
+/*
+LogicSweep:
+Checks and times the logic analyzer on LOGIC_BENCH_SECONDS of two noisy digital channels. The record must be the
+whole length, hold every edge and read back the right level every LOGIC_BENCH_STEP samples; its cost per sample
+and the memory it used are printed. Then the record is drawn at a few zooms: every pixel column must show the
+level at its first sample and whether an edge falls under it, and the time per draw is printed. Returns the
+number of checks that failed.
+*/
+static int LogicSweep(int *cases)
+{
+    int failures = 0;
+    uint32_t noise = 1;
+    uint32_t expected[2] = {0, 0};
+    uint32_t total = LOGIC_BENCH_SECONDS * SAMPLING_RATE;
+    uint64_t elapsed = 0;
+    uint64_t reps = 1;
+    LOGIC_CURSOR k;
+    SCOPE_SETTINGS scope = {0};
+
+    for(int c=0;c<2;c++){
+        for(uint32_t i=0;i<LOGIC_BENCH_PERIOD;i++){
+            noise = noise * 1103515245 + 12345;
+            int n = (int)((noise >> 16) % (2 * DECODE_NOISE + 1)) - DECODE_NOISE;
+            LogicBus[c][i] = MILLIVOLTS_TO_CODE(LogicLevel(c, i) ? DECODE_HIGH : DECODE_LOW) + n;
+        }
+        for(uint32_t t=1;t<total;t++){
+            expected[c] += LogicLevel(c, t) != LogicLevel(c, t - 1);
+        }
+    }
+
+    LOGIC.level = MILLIVOLTS_TO_CODE(LOGIC_DEFAULT_LEVEL);
+    uint32_t length = LogicRecord();
+    int correct = length == total && LOGIC.edges[0] == expected[0] && LOGIC.edges[1] == expected[1];
+    for(int c=0;c<2;c++){
+        Logic_Cursor(&k, c);
+        for(uint32_t t=0;t<total;t+=LOGIC_BENCH_STEP){
+            Logic_Seek(&k, t);
+            correct = correct && k.level == LogicLevel(c, t);
+        }
+    }
+    for(;;){                                                                  // the whole record again and again
+        uint64_t start = NowNs();
+        for(uint64_t r=0;r<reps;r++){
+            Sink += LogicRecord();
+        }
+        elapsed = NowNs() - start;
+        if(elapsed >= MIN_BENCH_NS){
+            break;
+        }
+        reps *= 2;
+    }
+    double nsPerSample = (double)elapsed / ((double)reps * total);
+    printf("{\"logic\":\"record\",\"samples\":%lu,\"edges\":[%lu,%lu],\"words\":[%d,%d],\"bytes_per_edge\":%.2f,"
+           "\"ns_per_sample\":%.4f,\"msamples_per_s\":%.2f,\"correct\":%s}\n",
+           (unsigned long)LOGIC.length, (unsigned long)LOGIC.edges[0], (unsigned long)LOGIC.edges[1], LOGIC.words[0], LOGIC.words[1],
+           2.0 * (LOGIC.words[0] + LOGIC.words[1]) / (LOGIC.edges[0] + LOGIC.edges[1]), nsPerSample, 1000.0 / nsPerSample,
+           correct ? "true" : "false");
+    (*cases)++;
+    if(!correct){
+        failures++;
+    }
+
+    scope.yScale = DEFAULT;
+    for(size_t z=0;z<sizeof(LOGIC_SPANS)/sizeof(LOGIC_SPANS[0]);z++){
+        LOGIC.span = LOGIC_SPANS[z];
+        LOGIC.viewStart = (total - LOGIC.span) / 2;
+        correct = TRUE;
+        for(int c=0;c<2;c++){                                                 // the columns, read back the way Logic_Draw reads them
+            Logic_Cursor(&k, c);
+            for(int p=0;p<X_PIXELS;p++){
+                uint32_t first = LOGIC.viewStart + (uint32_t)(((uint64_t)p * LOGIC.span) / X_PIXELS);
+                uint32_t end = LOGIC.viewStart + (uint32_t)(((uint64_t)(p + 1) * LOGIC.span) / X_PIXELS);
+                int edge = FALSE;
+                for(uint32_t t=first+1;t<end && !edge;t++){
+                    edge = LogicLevel(c, t) != LogicLevel(c, first);
+                }
+                Logic_Seek(&k, first);
+                correct = correct && k.level == LogicLevel(c, first) && (k.next < end) == edge;
+            }
+        }
+        reps = START_REPS;
+        for(;;){
+            uint64_t start = NowNs();
+            for(uint64_t r=0;r<reps;r++){
+                Logic_Draw(scope);
+            }
+            elapsed = NowNs() - start;
+            if(elapsed >= MIN_BENCH_NS){
+                break;
+            }
+            reps *= 2;
+        }
+        printf("{\"logic\":\"draw\",\"span\":%lu,\"us_per_draw\":%.2f,\"correct\":%s}\n",
+               (unsigned long)LOGIC.span, (double)elapsed / reps / 1000.0, correct ? "true" : "false");
+        (*cases)++;
+        if(!correct){
+            failures++;
+        }
+    }
+    return failures;
+}
+
+
+/*
+MeasureSweep:
+Adds a stream of pseudo-random values for each of MEAS_SPECS to the measurement statistics, over all of them or a
+window of the latest, and checks the count, mean, standard deviation and extremes against the same worked out
+directly in floating point from the values they should cover. Then the cost of adding a value is timed. Prints
+one JSON line per stream and returns the number that were wrong.
+*/
+static int MeasureSweep(int *cases)
+{
+    int failures = 0;
+    uint32_t noise = 7;
+
+    for(size_t m=0;m<sizeof(MEAS_SPECS)/sizeof(MEAS_SPECS[0]);m++){
+        const MEAS_SPEC *spec = &MEAS_SPECS[m];
+        const MEAS_STAT *stat = &MEAS.stat[MEAS_DELAY];
+        uint64_t elapsed = 0;
+        uint64_t reps = 1;
+        double sum = 0, squares = 0;
+        int32_t min = INT32_MAX, max = INT32_MIN;
+
+        for(int i=0;i<MEAS_BENCH_VALUES;i++){
+            noise = noise * 1103515245 + 12345;
+            MeasValues[i] = spec->center + (int32_t)((noise >> 8) % (2 * spec->spread + 1)) - spec->spread;
+        }
+        int first = spec->window ? MEAS_BENCH_VALUES - spec->window : 0;   // the values the statistics should cover
+        int count = MEAS_BENCH_VALUES - first;
+        for(int i=first;i<MEAS_BENCH_VALUES;i++){
+            sum += MeasValues[i];
+            min = MeasValues[i] < min ? MeasValues[i] : min;
+            max = MeasValues[i] > max ? MeasValues[i] : max;
+        }
+        double refMean = sum / count;
+        for(int i=first;i<MEAS_BENCH_VALUES;i++){
+            squares += (MeasValues[i] - refMean) * (MeasValues[i] - refMean);
+        }
+        double refSigma = sqrt(squares / (count - 1));
+
+        MEAS.window = spec->window;
+        Meas_Reset();
+        for(int i=0;i<MEAS_BENCH_VALUES;i++){
+            Meas_Add(MEAS_DELAY, MeasValues[i]);
+        }
+        double mean = (double)Meas_Mean(stat) / (1 << MEAS_FRACTION_BITS);
+        double sigma = (double)Meas_Sigma(stat) / (1 << MEAS_HALF_BITS);
+        int correct = stat->count == (uint32_t)count && stat->min == min && stat->max == max
+                   && fabs(mean - refMean) <= MEAS_MEAN_TOLERANCE
+                   && fabs(sigma - refSigma) <= refSigma * MEAS_SIGMA_TOLERANCE + MEAS_SIGMA_STEPS / (1 << MEAS_HALF_BITS);
+
+        for(;;){                                                              // the stream again and again
+            uint64_t start = NowNs();
+            for(uint64_t r=0;r<reps;r++){
+                for(int i=0;i<MEAS_BENCH_VALUES;i++){
+                    Meas_Add(MEAS_DELAY, MeasValues[i]);
+                }
+            }
+            elapsed = NowNs() - start;
+            if(elapsed >= MIN_BENCH_NS){
+                break;
+            }
+            reps *= 2;
+        }
+        Sink += stat->count;
+        printf("{\"measure\":\"%s\",\"values\":%d,\"window\":%d,\"mean\":%.4f,\"ref_mean\":%.4f,\"sigma\":%.4f,"
+               "\"ref_sigma\":%.4f,\"ns_per_value\":%.2f,\"correct\":%s}\n",
+               spec->name, MEAS_BENCH_VALUES, spec->window, mean, refMean, sigma, refSigma,
+               (double)elapsed / ((double)reps * MEAS_BENCH_VALUES), correct ? "true" : "false");
+        (*cases)++;
+        if(!correct){
+            failures++;
+        }
+    }
+    MEAS.window = 0;
+    Meas_Reset();
+    return failures;
+}
+
+
+/*
+MaskFrame:
+Writes one of the mask check's frames: a sine at DEFAULT mV per division moved, made noisy and glitched as the spec
+says.
+*/
+static void MaskFrame(int16_t y[], const MASK_SPEC *spec, uint32_t *noise)
+{
+    for(int i=0;i<X_PIXELS;i++){
+        double phase = 2 * M_PI * (i - spec->shift) / MASK_BENCH_PERIOD;
+        int code = (int)lround(0x400 + FILTER_AMPLITUDE * sin(phase));
+        y[i] = CODE_TO_PIXEL(code, DEFAULT) + spec->offset;
+        if(spec->noise){
+            *noise = *noise * 1103515245 + 12345;
+            y[i] += (int)((*noise >> 8) % (2 * spec->noise + 1)) - spec->noise;
+        }
+        if(spec->glitch && i >= X_PIXELS / 2 && i < X_PIXELS / 2 + MASK_BENCH_GLITCH){
+            y[i] -= spec->glitch;
+        }
+    }
+}
+
+
+/*
+MaskBlocks:
+Cuts a frame from every block of a sine, the way the scope tests each triggered block. A mask made from the samples
+one frame of the first block draws must pass every block, and must fail every block once a sample between two drawn
+samples is glitched to 0. Times the block test and returns 1 if it went wrong, 0 otherwise.
+*/
+static int MaskBlocks(SCOPE_SETTINGS *scope, int *cases)
+{
+    static uint16_t block[SIZE];
+    const SIGNAL_SPEC *spec = &SIGNAL_CORPUS[2];                              // the 500 Hz sine
+    uint64_t step = (scope->xScale*INDEX_SCALE)/INDEX_DIVISOR;
+    uint64_t elapsed = 0;
+    uint32_t passed = 0, failed = 0;
+    int y[X_PIXELS];
+
+    GenerateSignal(spec, block, SIZE, 0);
+    uint64_t t = FindTrigger(block, *scope);
+    for(int i=0;i<X_PIXELS;i++){
+        y[i] = CODE_TO_PIXEL(block[(t + i*step)/INDEX_SCALE], scope->yScale);
+    }
+    Mask_Create(y, MASK_BENCH_MARGIN);
+    for(int glitch=0;glitch<2;glitch++){
+        Mask_Reset();
+        for(int b=0;b<MASK_BENCH_BLOCKS;b++){
+            GenerateSignal(spec, block, SIZE, (uint32_t)b * SIZE);
+            t = FindTrigger(block, *scope);
+            if(glitch){
+                block[(t + MASK_BENCH_COLUMN*step)/INDEX_SCALE + step/INDEX_SCALE/2] = 0;
+            }
+            uint64_t start = NowNs();
+            Mask_Block(block, SIZE, t, scope);
+            elapsed += NowNs() - start;
+        }
+        if(glitch){
+            failed = MASK.failed;
+        } else {
+            passed = MASK.passed;
+        }
+    }
+    int correct = passed == MASK_BENCH_BLOCKS && failed == MASK_BENCH_BLOCKS;
+    printf("{\"mask\":\"blocks\",\"blocks\":%d,\"clean_passed\":%lu,\"glitched_failed\":%lu,\"ns_per_block\":%.1f,"
+           "\"correct\":%s}\n", MASK_BENCH_BLOCKS, (unsigned long)passed, (unsigned long)failed,
+           (double)elapsed / (2 * MASK_BENCH_BLOCKS), correct ? "true" : "false");
+    (*cases)++;
+    return correct ? 0 : 1;
+}
+
+
+/*
+MaskSweep:
+Makes a mask from a clean frame, then for each spec tests a frame against it, checking the columns the kernel finds
+out of the mask against a plain count and whether the frame passes, and times the test. Last, a stream of the
+frames in turn is put through the frame test and its counts checked. Returns the number of failures.
+*/
+static int MaskSweep(int *cases)
+{
+    static const MASK_SPEC clean = {"clean", 0, 0, 0, 0, TRUE};
+    SCOPE_SETTINGS scope = {DEFAULT, DEFAULT, FALSE, POSITIVE, DEFAULT, TRUE, CHANNEL_1, FALSE, ACQ_SEPARATE};
+    static int16_t frames[sizeof(MASK_SPECS)/sizeof(MASK_SPECS[0])][X_PIXELS];
+    int specs = sizeof(MASK_SPECS)/sizeof(MASK_SPECS[0]);
+    int failures = 0;
+    uint32_t noise = 11;
+    int16_t cleanFrame[X_PIXELS];
+    int y[X_PIXELS];
+
+    MaskFrame(cleanFrame, &clean, &noise);
+    for(int i=0;i<X_PIXELS;i++){
+        y[i] = cleanFrame[i];
+    }
+    Mask_Create(y, MASK_BENCH_MARGIN);
+    for(int m=0;m<specs;m++){
+        const MASK_SPEC *spec = &MASK_SPECS[m];
+        uint64_t elapsed = 0;
+        uint64_t reps = 1;
+        int ref = 0;
+
+        MaskFrame(frames[m], spec, &noise);
+        for(int i=0;i<X_PIXELS;i++){
+            if(frames[m][i] < MASK.top[i] || frames[m][i] > MASK.bottom[i]){
+                ref++;
+            }
+        }
+        int out = Mask_Test(frames[m], frames[m], MASK.top, MASK.bottom, X_PIXELS);
+        int correct = out == ref && (spec->pass ? out == 0 : out > 0)
+                   && (!spec->glitch || out == MASK_BENCH_GLITCH);
+
+        for(;;){                                                              // the same frame again and again
+            uint64_t start = NowNs();
+            for(uint64_t r=0;r<reps;r++){
+                Sink += Mask_Test(frames[m], frames[m], MASK.top, MASK.bottom, X_PIXELS);
+            }
+            elapsed = NowNs() - start;
+            if(elapsed >= MIN_BENCH_NS){
+                break;
+            }
+            reps *= 2;
+        }
+        double nsPerFrame = (double)elapsed / reps;
+        printf("{\"mask\":\"%s\",\"columns_out\":%d,\"ref_columns_out\":%d,\"ns_per_frame\":%.1f,"
+               "\"ns_per_column\":%.3f,\"frames_per_s\":%.0f,\"correct\":%s}\n",
+               spec->name, out, ref, nsPerFrame, nsPerFrame / X_PIXELS, 1e9 / nsPerFrame, correct ? "true" : "false");
+        (*cases)++;
+        if(!correct){
+            failures++;
+        }
+    }
+
+    int expectFailed = 0, expectOut = 0, lastFailed = 0;
+    MASK.xScale = scope.xScale;
+    MASK.yScale = scope.yScale;
+    MASK.channel = CHANNEL_1;
+    MASK.stopOnFail = FALSE;
+    MASK.on = TRUE;
+    Mask_Reset();
+    for(int f=0;f<MASK_BENCH_STREAM;f++){
+        int m = f % specs;
+        Mask_Frame(frames[m], frames[m], &scope);
+        if(!MASK_SPECS[m].pass){
+            expectFailed++;
+            expectOut += Mask_Test(frames[m], frames[m], MASK.top, MASK.bottom, X_PIXELS);
+            lastFailed = f + 1;
+        }
+    }
+    int correct = MASK.frames == MASK_BENCH_STREAM && MASK.failed == (uint32_t)expectFailed
+               && MASK.passed == (uint32_t)(MASK_BENCH_STREAM - expectFailed) && MASK.violations == (uint32_t)expectOut
+               && MASK.snapFrame == (uint32_t)lastFailed;
+    for(int i=0;i<X_PIXELS;i++){
+        correct = correct && MASK.snapY[i] == frames[(lastFailed - 1) % specs][i];
+    }
+    printf("{\"mask\":\"stream\",\"frames\":%lu,\"passed\":%lu,\"failed\":%lu,\"columns_out\":%lu,"
+           "\"snapshot_frame\":%lu,\"correct\":%s}\n",
+           (unsigned long)MASK.frames, (unsigned long)MASK.passed, (unsigned long)MASK.failed,
+           (unsigned long)MASK.violations, (unsigned long)MASK.snapFrame, correct ? "true" : "false");
+    (*cases)++;
+    if(!correct){
+        failures++;
+    }
+    failures += MaskBlocks(&scope, cases);
+    MASK.on = FALSE;
+    MASK.defined = FALSE;
+    Mask_Reset();
+    return failures;
+}
+
+
+/*
+LoadBaseline:
+Reads the kernel lines of a previous benchmark run so the new measurements can be compared against it. There
+is room for one line per kernel and corpus signal; any more are reported and not compared. Returns FALSE if the
+file could not be opened.
+*/
+static int LoadBaseline(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    int size = NUM_KERNELS * SIGNAL_CORPUS_SIZE;
+    int extra = 0;
+    char line[LINE_LEN];
+    BASELINE_ENTRY entry;
+
+    if(!file){
+        return FALSE;
+    }
+    BASELINE = calloc(size, sizeof(BASELINE_ENTRY));
+    if(!BASELINE){
+        fclose(file);
+        return FALSE;
+    }
+    while(fgets(line, sizeof(line), file)){
+        char *ns = strstr(line, "\"ns_per_sample\":");
+        if(ns && sscanf(line, "{\"kernel\":\"%49[^\"]\",\"signal\":\"%49[^\"]\"", entry.kernel, entry.signal) == 2
+        && sscanf(ns + strlen("\"ns_per_sample\":"), "%lf", &entry.nsPerSample) == 1){
+            if(BaselineCount < size){
+                BASELINE[BaselineCount++] = entry;
+            } else {
+                extra++;
+            }
+        }
+    }
+    fclose(file);
+    if(extra){
+        fprintf(stderr, "baseline %s has %d kernel lines past the %d that fit - they are not compared\n", path, extra, size);
+    }
+    return TRUE;
+}
+
+
+/*
+FindBaseline:
+Returns the stored baseline for a kernel and signal, or NULL if the baseline has no such measurement.
+*/
+static const BASELINE_ENTRY *FindBaseline(const char *kernel, const char *signal)
+{
+    for(int i=0;i<BaselineCount;i++){
+        if(!strcmp(BASELINE[i].kernel, kernel) && !strcmp(BASELINE[i].signal, signal)){
+            return &BASELINE[i];
+        }
+    }
+    return NULL;
+}
+
+
+/*
+Main:
+Runs every kernel over every corpus signal, printing one JSON line per measurement followed by a summary line.
+*/
+int main(int argc, char *argv[])
+{
+    int failures = 0;
+    int cases = 0;
+
+    if(argc > 1 && !LoadBaseline(argv[1])){
+        fprintf(stderr, "could not open baseline %s\n", argv[1]);
+        return 1;
+    }
+
+    TRIGGER.type = TRIGGER_PULSE;                                             // settings for the pulse trigger kernel
+    TRIGGER.pulseCondition = PULSE_LESS;
+    TRIGGER.pulseMax = BENCH_PULSE_MAX;
+    for(int k=0;k<BENCH_CAL_POINTS;k++){                                      // the calibration kernel's channel, from references from ground to full scale
+        int mv = k * MAX_VOLTAGE / (BENCH_CAL_POINTS - 1);
+        Cal_AddPoint(CHANNEL_1, (int32_t)lround(Distort((double)mv * MAX_ADC_OUTPUT / MAX_VOLTAGE) * (1 << CAL_FRACTION_BITS)), mv);
+    }
+
+    for(int s=0;s<SIGNAL_CORPUS_SIZE;s++){
+        PrepareCase(&CASE, &SIGNAL_CORPUS[s]);
+
+        for(int k=0;k<NUM_KERNELS;k++){
+            uint32_t result = RunKernel(k, &CASE);
+            int correct = CheckResult(k, &CASE, result);
+            uint64_t elapsed = 0;
+            uint64_t reps = START_REPS;
+
+            for(;;){                                                          // double the repetitions until the run is long enough to time
+                uint64_t start = NowNs();
+                for(uint64_t r=0;r<reps;r++){
+                    Sink += RunKernel(k, &CASE);
+                }
+                elapsed = NowNs() - start;
+                if(elapsed >= MIN_BENCH_NS){
+                    break;
+                }
+                reps *= 2;
+            }
+
+            double nsPerSample = (double)elapsed / ((double)reps * SamplesPerCall(k));
+            printf("{\"kernel\":\"%s\",\"signal\":\"%s\",\"samples\":%d,\"reps\":%llu,\"ns_per_sample\":%.4f,"
+                   "\"msamples_per_s\":%.2f,\"result\":%d,\"correct\":%s",
+                   KERNEL_NAMES[k], CASE.spec->name, SamplesPerCall(k), (unsigned long long)reps, nsPerSample,
+                   1000.0 / nsPerSample, (int)result, correct ? "true" : "false");
+
+            const BASELINE_ENTRY *base = FindBaseline(KERNEL_NAMES[k], CASE.spec->name);
+            if(base){
+                printf(",\"baseline_ns_per_sample\":%.4f,\"speedup\":%.3f", base->nsPerSample, base->nsPerSample / nsPerSample);
+            }
+            printf("}\n");
+
+            cases++;
+            if(!correct){
+                failures++;
+            }
+        }
+    }
+
+    failures += EnobSweep(&cases);
+    failures += FilterSweep(&cases);
+    failures += DecodeSweep(&cases);
+    failures += LogicSweep(&cases);
+    failures += MeasureSweep(&cases);
+    failures += MaskSweep(&cases);
+
+    printf("{\"summary\":true,\"cases\":%d,\"failures\":%d,\"realtime_ns_per_sample\":%.1f}\n",
+           cases, failures, 1e9 / SAMPLING_RATE);
+    return 0;
+}
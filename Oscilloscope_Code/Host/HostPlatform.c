@@ -0,0 +1,161 @@
+/* ========================================
+ *
+ * Tiny Scope host platform definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file implements the PSoC and emWin stand-ins declared
+ * in HostPlatform.h. Drawing calls are counted instead of
+ * being sent to a display, UART output is written to stdout,
+ * and UART input is read from a string set by the host program.
+ *
+ * ========================================
+*/
+
+/* included files */
+#include <stdio.h>
+#include "HostPlatform.h"
+
+/* Counters */
+uint32_t HOST_LinesDrawn = 0;
+uint32_t HOST_StringsDrawn = 0;
+uint32_t HOST_PixelsDrawn = 0;
+uint32_t HOST_RectsDrawn = 0;
+
+/* Variables */
+static const char *HostInput = "";                // the remaining characters the UART stand-in will hand out
+
+
+/*
+GUI_DrawLine:
+Host stand-in for the emWin line function. It only counts the call so a run can check how many lines were drawn.
+*/
+void GUI_DrawLine(int x0, int y0, int x1, int y1)
+{
+    (void)x0; (void)y0; (void)x1; (void)y1;
+    HOST_LinesDrawn++;
+}
+
+
+/*
+GUI_DrawPixel:
+Host stand-in for the emWin pixel function. It only counts the call.
+*/
+void GUI_DrawPixel(int x, int y)
+{
+    (void)x; (void)y;
+    HOST_PixelsDrawn++;
+}
+
+
+/*
+GUI_FillRect:
+Host stand-in for the emWin filled rectangle function. It only counts the call.
+*/
+void GUI_FillRect(int x0, int y0, int x1, int y1)
+{
+    (void)x0; (void)y0; (void)x1; (void)y1;
+    HOST_RectsDrawn++;
+}
+
+
+/*
+GUI_DispStringAt:
+Host stand-in for the emWin string function. It only counts the call.
+*/
+void GUI_DispStringAt(const char *s, int x, int y)
+{
+    (void)s; (void)x; (void)y;
+    HOST_StringsDrawn++;
+}
+
+
+/*
+GUI_SetColor, GUI_SetLineStyle, GUI_SetPenSize:
+Host stand-ins for the emWin drawing state functions. The host has no display so these do nothing.
+*/
+void GUI_SetColor(GUI_COLOR color)
+{
+    (void)color;
+}
+
+void GUI_SetLineStyle(int style)
+{
+    (void)style;
+}
+
+void GUI_SetPenSize(int size)
+{
+    (void)size;
+}
+
+
+/*
+GUI_Clear:
+Host stand-in for clearing the display. The host has no display so this does nothing.
+*/
+void GUI_Clear(void)
+{
+}
+
+
+/*
+UART_GetArray:
+Host stand-in for the UART receive function. It hands out the characters of the string set by HOST_SetInput
+and returns the number of characters copied (0 once the input is used up), just like the component API.
+*/
+uint32_t UART_GetArray(void *buffer, uint32_t size)
+{
+    uint32_t count = 0;
+    while(count < size && *HostInput){
+        ((char *)buffer)[count++] = *HostInput++;
+    }
+    return count;
+}
+
+
+/*
+UART_PutString, UART_PutArrayBlocking:
+Host stand-ins for the UART transmit functions. Everything is written to stdout.
+*/
+void UART_PutString(const char *string)
+{
+    fputs(string, stdout);
+}
+
+void UART_PutArrayBlocking(const void *buffer, uint32_t size)
+{
+    fwrite(buffer, 1, size, stdout);
+}
+
+
+/*
+HOST_SetInput:
+Sets the string of characters the UART stand-in will return, so a host program can feed commands to GetInput.
+*/
+void HOST_SetInput(const char *commands)
+{
+    HostInput = commands;
+}
+
+
+/*
+Cy_DMA_Channel_ClearInterrupt:
+Host stand-in for acknowledging a DMA interrupt. The simulator calls the ISRs directly so there is nothing to clear.
+*/
+void Cy_DMA_Channel_ClearInterrupt(void *base, uint32_t channel)
+{
+    (void)base; (void)channel;
+}
+
+
+/*
+ADC_GetResult16:
+Host stand-in for reading the potentiometers. It returns a fixed mid-scale reading.
+*/
+uint16_t ADC_GetResult16(uint32_t chan)
+{
+    (void)chan;
+    return HOST_POT_READING;
+}
@@ -0,0 +1,82 @@
+/* ========================================
+ *
+ * Tiny Scope host platform header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file stands in for project.h and GUI.h when the
+ * tiny scope sources are compiled on a PC with HOST_BUILD
+ * defined. It provides just enough of the PSoC and emWin
+ * APIs for the helper functions to build and run, so the
+ * kernels can be benchmarked and simulated off target.
+ *
+ * ========================================
+*/
+
+#ifndef HOST_PLATFORM_H
+#define HOST_PLATFORM_H
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+
+/* Defines for the emWin stand-ins */
+#define GUI_BLACK 0x000000
+#define GUI_WHITE 0xFFFFFF
+#define GUI_RED 0x0000FF
+#define GUI_YELLOW 0x00FFFF
+#define GUI_GREEN 0x00FF00
+#define GUI_BLUE 0xFF0000
+#define GUI_LIGHTGRAY 0xD3D3D3
+#define GUI_LS_SOLID 0
+#define GUI_LS_DASH 1
+#define HOST_POT_READING 0x400    // the potentiometer reading the host returns (mid-scale)
+
+/* Defines for the DMA stand-ins */
+#define DMA_1_HW NULL
+#define DMA_2_HW NULL
+#define DMA_1_DW_CHANNEL 0
+#define DMA_2_DW_CHANNEL 1
+
+typedef uint32_t GUI_COLOR;
+
+/* Counters the host stand-ins keep so a run can check what would have reached the hardware */
+extern uint32_t HOST_LinesDrawn;              // number of GUI_DrawLine calls since the last reset
+extern uint32_t HOST_StringsDrawn;            // number of GUI_DispStringAt calls since the last reset
+extern uint32_t HOST_PixelsDrawn;             // number of GUI_DrawPixel calls since the last reset
+extern uint32_t HOST_RectsDrawn;              // number of GUI_FillRect calls since the last reset
+
+/* emWin stand-ins */
+void GUI_DrawLine(int x0, int y0, int x1, int y1);
+
+void GUI_DrawPixel(int x, int y);
+
+void GUI_FillRect(int x0, int y0, int x1, int y1);
+
+void GUI_DispStringAt(const char *s, int x, int y);
+
+void GUI_SetColor(GUI_COLOR color);
+
+void GUI_SetLineStyle(int style);
+
+void GUI_SetPenSize(int size);
+
+void GUI_Clear(void);
+
+/* UART stand-ins - input is read from HOST_SetInput, output goes to stdout */
+uint32_t UART_GetArray(void *buffer, uint32_t size);
+
+void UART_PutString(const char *string);
+
+void UART_PutArrayBlocking(const void *buffer, uint32_t size);
+
+void HOST_SetInput(const char *commands);
+
+/* DMA stand-in - the host simulator fills the buffers itself so there is nothing to acknowledge */
+void Cy_DMA_Channel_ClearInterrupt(void *base, uint32_t channel);
+
+/* ADC stand-in used for the potentiometer readings */
+uint16_t ADC_GetResult16(uint32_t chan);
+
+#endif /* HOST_PLATFORM_H */
@@ -0,0 +1,96 @@
+/* ========================================
+ *
+ * Tiny Scope signal corpus definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file defines the deterministic test signals and the
+ * function that renders them into ADC code buffers. Noise is
+ * derived from the sample number rather than a running random
+ * generator so every run produces identical buffers.
+ *
+ * ========================================
+*/
+
+/* included files */
+#include <math.h>
+#include "SignalCorpus.h"
+
+/* The corpus - name, type, freq, freqEnd, center, amplitude, duty, noise, expected frequency */
+const SIGNAL_SPEC SIGNAL_CORPUS[] = {
+    {"sine_50hz",        SIGNAL_SINE,   50,   0,    ADC_CENTER, 0x300, 0,  0,    50},
+    {"sine_200hz",       SIGNAL_SINE,   200,  0,    ADC_CENTER, 0x300, 0,  0,    200},
+    {"sine_500hz",       SIGNAL_SINE,   500,  0,    ADC_CENTER, 0x300, 0,  0,    500},
+    {"sine_1000hz",      SIGNAL_SINE,   1000, 0,    ADC_CENTER, 0x300, 0,  0,    1000},
+    {"square_300hz",     SIGNAL_SQUARE, 300,  0,    ADC_CENTER, 0x300, 50, 0,    300},
+    {"pwm_200hz_20pct",  SIGNAL_PWM,    200,  0,    ADC_CENTER, 0x300, 20, 0,    200},
+    {"noisy_sine_400hz", SIGNAL_SINE,   400,  0,    ADC_CENTER, 0x280, 0,  0x60, 400},
+    {"clipped_sine_250hz", SIGNAL_SINE, 250,  0,    0x300,      0x500, 0,  0,    250},
+    {"flat",             SIGNAL_FLAT,   0,    0,    ADC_CENTER, 0,     0,  0,    UNKNOWN_FREQ},
+    {"chirp_100_1000hz", SIGNAL_CHIRP,  100,  1000, ADC_CENTER, 0x300, 0,  0,    UNKNOWN_FREQ},
+};
+
+const int SIGNAL_CORPUS_SIZE = sizeof(SIGNAL_CORPUS) / sizeof(SIGNAL_CORPUS[0]);
+
+
+/*
+NoiseAt:
+Returns deterministic noise in the range [-peak, peak] for a given sample number using an integer hash.
+*/
+static int NoiseAt(uint32_t sample, int peak)
+{
+    if(peak == 0){
+        return 0;
+    }
+    uint32_t h = sample * 0x9E3779B1u;                      // multiplicative hash of the sample number
+    h ^= h >> 15;
+    h *= 0x85EBCA77u;
+    h ^= h >> 13;
+    return (int)(h % (uint32_t)(2 * peak + 1)) - peak;
+}
+
+
+/*
+GenerateSignal:
+Renders size samples of a corpus signal into arr, starting at sample number firstSample so consecutive calls
+produce a continuous signal. Values above the ADC range are clamped and values below zero wrap to the
+negative codes the SAR returns, which have the UNDERFLOW_CHECK bit set.
+*/
+void GenerateSignal(const SIGNAL_SPEC *spec, uint16_t arr[], int size, uint32_t firstSample)
+{
+    const double twoPi = 6.283185307179586;
+
+    for(int i=0;i<size;i++){
+        uint32_t n = firstSample + i;                                       // absolute sample number
+        double t = (double)n / SAMPLING_RATE;                               // time of the sample in seconds
+        double phase = 0;                                                   // position within the period in [0,1)
+        double value = 0;
+
+        switch(spec->type){
+            case SIGNAL_SINE:
+                value = sin(twoPi * spec->freq * t);
+                break;
+            case SIGNAL_SQUARE:
+            case SIGNAL_PWM:
+                phase = fmod(spec->freq * t, 1.0);
+                value = (phase * 100 < spec->duty) ? 1.0 : -1.0;
+                break;
+            case SIGNAL_CHIRP: {
+                double span = (double)SIZE / SAMPLING_RATE;                 // the sweep repeats every buffer
+                double tc = fmod(t, span);
+                value = sin(twoPi * (spec->freq * tc + (spec->freqEnd - spec->freq) * tc * tc / (2 * span)));
+                break;
+            }
+            default:
+                value = 0;
+                break;
+        }
+
+        int code = spec->center + (int)lround(value * spec->amplitude) + NoiseAt(n, spec->noise);
+        if(code > MAX_ADC_OUTPUT){
+            code = MAX_ADC_OUTPUT;                                          // the ADC saturates at the top of its range
+        }
+        arr[i] = (uint16_t)code;                                            // negative codes keep their two's complement form
+    }
+}
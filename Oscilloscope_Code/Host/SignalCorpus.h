@@ -0,0 +1,51 @@
+/* ========================================
+ *
+ * Tiny Scope signal corpus header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file declares the deterministic set of test signals
+ * used by the host benchmark and simulator. Each signal is
+ * generated as raw ADC codes exactly like the DMA would
+ * leave them in a ping-pong buffer.
+ *
+ * ========================================
+*/
+
+#ifndef SIGNAL_CORPUS_H
+#define SIGNAL_CORPUS_H
+
+/* Includes */
+#include "HelperFunctions.h"
+
+/* Defines */
+#define SIGNAL_SINE 0             // sine wave
+#define SIGNAL_SQUARE 1           // square wave (50% duty)
+#define SIGNAL_PWM 2              // pulse train with the duty cycle given in percent
+#define SIGNAL_FLAT 3             // constant level
+#define SIGNAL_CHIRP 4            // linear frequency sweep from freq to freqEnd over one buffer
+#define ADC_CENTER 0x400          // mid-scale ADC code the corpus signals are centered on
+#define UNKNOWN_FREQ 0            // expected frequency of a signal that has no single frequency
+
+/* Structures */
+typedef struct SIGNAL_SPEC{
+    const char *name;             // name reported in the benchmark output
+    int type;                     // one of the SIGNAL_ defines
+    int freq;                     // frequency in HZ (start frequency for a chirp)
+    int freqEnd;                  // end frequency in HZ for a chirp
+    int center;                   // center of the signal in ADC codes
+    int amplitude;                // peak amplitude in ADC codes (may exceed the ADC range to clip)
+    int duty;                     // duty cycle in percent for PWM signals
+    int noise;                    // peak uniform noise added in ADC codes
+    int expectedFreq;             // the frequency FindFrequency should report (UNKNOWN_FREQ if none)
+}SIGNAL_SPEC;
+
+/* Globals */
+extern const SIGNAL_SPEC SIGNAL_CORPUS[];
+extern const int SIGNAL_CORPUS_SIZE;
+
+/* Function prototypes */
+void GenerateSignal(const SIGNAL_SPEC *spec, uint16_t arr[], int size, uint32_t firstSample);
+
+#endif /* SIGNAL_CORPUS_H */
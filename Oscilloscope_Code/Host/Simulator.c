@@ -0,0 +1,193 @@
+/* ========================================
+ *
+ * Tiny Scope host simulator
+ *
+ * Author: Scott Oslund
+ *
+ * Program Synopsis:
+ * This program runs the real acquisition pipeline from
+ * main_cm4.c on a PC. It plays the part of the DMAs by
+ * rendering corpus signals into the ping-pong buffers (or the
+ * ring of pairs in interleaved acquisition mode) and
+ * calling the ISRs, then runs the same tasks the
+ * main loop does: polling for commands, processing the
+ * channels and updating the display. UART commands are
+ * given on the command line (separated by ';') and are fed
+ * to GetInput before the first block and after the last one.
+ * With "realtime" as the last argument each block is handed
+ * over no sooner than the SAR would have finished it, so the
+ * latency figures include the time spent waiting for samples.
+ * By default the profile table is printed when the run ends,
+ * so the same annotations used on target can be read from
+ * the simulation.
+ *
+ * Build and run (from this directory):
+ *   gcc -O2 -DHOST_BUILD -I. -I../Lab-Project.cydsn Simulator.c SignalCorpus.c HostPlatform.c
+ *       ../Lab-Project.cydsn/main_cm4.c ../Lab-Project.cydsn/HelperFunctions.c
+ *       ../Lab-Project.cydsn/Profiler.c ../Lab-Project.cydsn/Trace.c ../Lab-Project.cydsn/ScopeStats.c
+ *       ../Lab-Project.cydsn/Latency.c ../Lab-Project.cydsn/Trigger.c ../Lab-Project.cydsn/Acquisition.c
+ *       ../Lab-Project.cydsn/Segmented.c ../Lab-Project.cydsn/Deep.c ../Lab-Project.cydsn/EquivTime.c
+ *       ../Lab-Project.cydsn/HighRes.c ../Lab-Project.cydsn/Average.c ../Lab-Project.cydsn/MathTrace.c
+ *       ../Lab-Project.cydsn/XY.c ../Lab-Project.cydsn/Correlate.c ../Lab-Project.cydsn/Filter.c
+ *       ../Lab-Project.cydsn/Autoset.c ../Lab-Project.cydsn/Calibrate.c ../Lab-Project.cydsn/Decode.c
+ *       ../Lab-Project.cydsn/Logic.c ../Lab-Project.cydsn/Measure.c ../Lab-Project.cydsn/Mask.c -lm
+ *       -o simulator
+ *   ./simulator [blocks] [ch1 signal] [ch2 signal] ["start commands"] ["end commands"] [realtime]
+ *
+ * The end commands default to "profile". To view the event trace as a timeline:
+ *   ./simulator 400 sine_500hz square_300hz "" "trace_dump" | ./tracetojson > trace.json
+ *
+ * ========================================
+*/
+
+/* Included files */
+#include "SignalCorpus.h"
+
+/* Defines */
+#define DEFAULT_BLOCKS 400        // number of DMA blocks simulated when none is given (about 5.5 s of signal)
+#define COMMAND_LEN 1024          // longest command string accepted on the command line
+
+/* Globals shared with main_cm4.c */
+extern SCOPE_SETTINGS SCOPE;
+extern WAVEFORM_DATA WAVE;
+extern uint16_t CH1_Data1[SIZE];
+extern uint16_t CH1_Data2[SIZE];
+extern uint16_t CH2_Data1[SIZE];
+extern uint16_t CH2_Data2[SIZE];
+
+/* Functions from main_cm4.c */
+void RunTasks(uint16_t mainIterations);
+
+/* Variables */
+static char Commands[COMMAND_LEN];
+static uint16_t Scratch[2][SIZE];  // both channels' samples before they are interleaved
+static int Realtime = FALSE;       // TRUE if samples are handed over at the sampling rate
+static uint64_t StartNs;           // host time the simulated acquisition started
+
+
+/*
+FindSignal:
+Returns the corpus signal with the given name, or NULL if there is none.
+*/
+static const SIGNAL_SPEC *FindSignal(const char *name)
+{
+    for(int i=0;i<SIGNAL_CORPUS_SIZE;i++){
+        if(!strcmp(SIGNAL_CORPUS[i].name, name)){
+            return &SIGNAL_CORPUS[i];
+        }
+    }
+    return NULL;
+}
+
+
+/*
+NowNs:
+Returns the host's monotonic clock in nanoseconds.
+*/
+static uint64_t NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+
+/*
+WaitForSample:
+In real time mode waits until the given sample would have been taken, counting from the start of the run.
+*/
+static void WaitForSample(uint64_t sample)
+{
+    uint64_t due = StartNs + sample * 1000000000u / SAMPLING_RATE;
+
+    while(Realtime && NowNs() < due){
+        struct timespec pause = {0, 100000};                                   // 100 us steps keep the pacing fine enough
+        nanosleep(&pause, NULL);
+    }
+}
+
+
+/*
+RunCommands:
+Turns a ';' separated command string into UART lines and feeds it to GetInput until every character has been
+consumed.
+*/
+static void RunCommands(const char *commands)
+{
+    snprintf(Commands, sizeof(Commands), "%s\n", commands);
+    for(char *c=Commands;*c;c++){
+        if(*c == ';'){
+            *c = '\n';                                                         // the UART expects one command per line
+        }
+    }
+    HOST_SetInput(Commands);
+    for(size_t i=0;i<=strlen(Commands);i++){
+        GetInput(&SCOPE);
+    }
+}
+
+
+/*
+Main:
+Simulates the requested number of DMA blocks, then runs the end commands.
+*/
+int main(int argc, char *argv[])
+{
+    int blocks = argc > 1 ? atoi(argv[1]) : DEFAULT_BLOCKS;
+    const SIGNAL_SPEC *ch1 = FindSignal(argc > 2 ? argv[2] : "sine_500hz");
+    const SIGNAL_SPEC *ch2 = FindSignal(argc > 3 ? argv[3] : "square_300hz");
+
+    if(!ch1 || !ch2 || blocks <= 0){
+        fprintf(stderr, "usage: %s [blocks] [ch1 signal] [ch2 signal] [\"command;...\"] [\"command;...\"] [realtime]\n", argv[0]);
+        return 1;
+    }
+
+    Profile_Init();
+    if(argc > 4 && argv[4][0]){
+        RunCommands(argv[4]);
+    }
+    Acq_Configure(SCOPE.acqMode);                                              // what main does once the scope has been started
+    RunCommands("start");
+    Realtime = argc > 6 && !strcmp(argv[6], "realtime");
+    StartNs = NowNs();
+
+    for(int b=0;b<blocks;b++){
+        uint32_t firstSample = (uint32_t)b * SIZE;                             // both channels are sampled by the same SAR scan
+
+        if(ACQ_Stopped){                                                       // a single shot stopped the DMAs - the buffers are left alone
+            WaitForSample(firstSample + SIZE);
+            RunTasks(b);
+            continue;
+        }
+
+        if(SCOPE.acqMode == ACQ_SEPARATE){
+            GenerateSignal(ch1, WAVE.Wave1_Buffer1 ? CH1_Data2 : CH1_Data1, SIZE, firstSample);
+            GenerateSignal(ch2, WAVE.Wave2_Buffer1 ? CH2_Data2 : CH2_Data1, SIZE, firstSample);
+            WaitForSample(firstSample + SIZE);
+            CH1_ISR();                                                         // the DMAs finished a descriptor
+            CH2_ISR();
+            RunTasks(b);                                                       // one pass of the main loop's tasks
+            continue;
+        }
+
+        GenerateSignal(ch1, Scratch[0], SIZE, firstSample);
+        GenerateSignal(ch2, Scratch[1], SIZE, firstSample);
+        for(int s=0;s<ACQ_SEGMENTS;s++){
+            uint16_t *piece1 = (WAVE.Wave1_Buffer1 ? CH1_Data2 : CH1_Data1) + s*ACQ_SEGMENT;  // the half the DMA is on
+            uint16_t *piece2 = (WAVE.Wave2_Buffer1 ? CH2_Data2 : CH2_Data1) + s*ACQ_SEGMENT;
+            for(int i=0;i<ACQ_SEGMENT;i++){
+                uint16_t *pair = i < ACQ_SEGMENT/2 ? piece1 + 2*i : piece2 + 2*(i - ACQ_SEGMENT/2);  // channel 1's piece takes the first half of the pairs
+                pair[0] = Scratch[0][s*ACQ_SEGMENT+i];                         // one (CH1, CH2) pair per SAR scan
+                pair[1] = Scratch[1][s*ACQ_SEGMENT+i];
+            }
+            WaitForSample(firstSample + (s+1)*ACQ_SEGMENT);
+            if(SCOPE.acqMode == ACQ_STREAMING || s == ACQ_SEGMENTS - 1){
+                ACQ_ISR();                                                     // the one DMA finished a block, or a segment when streaming
+                RunTasks(b);                                                   // streaming mode's main loop takes every segment
+            }
+        }
+    }
+
+    RunCommands(argc > 5 ? argv[5] : "profile");
+    return 0;
+}
@@ -0,0 +1,139 @@
+/* ========================================
+ *
+ * Tiny Scope trace converter
+ *
+ * Author: Scott Oslund
+ *
+ * Program Synopsis:
+ * This program turns a binary trace dump (the output of the
+ * trace_dump command, captured from the UART or from the host
+ * simulator) into the Chrome trace JSON format, which can be
+ * opened in chrome://tracing or ui.perfetto.dev. Any text that
+ * precedes the dump is skipped. The ISRs appear as their own
+ * tracks next to the main loop's pipeline stages so stalls and
+ * buffer flips can be read straight off the timeline.
+ *
+ * Build and run (from this directory):
+ *   gcc -O2 -DHOST_BUILD -I. -I../Lab-Project.cydsn TraceToJson.c HostPlatform.c
+ *       ../Lab-Project.cydsn/Profiler.c -o tracetojson
+ *   ./tracetojson capture.bin > trace.json
+ *
+ * ========================================
+*/
+
+/* Included files */
+#include "HelperFunctions.h"
+
+/* Defines for the tracks (thread ids) events are drawn on */
+#define TRACK_CH1_ISR 1
+#define TRACK_CH2_ISR 2
+#define TRACK_PIPELINE 3
+
+
+/*
+FindDump:
+Reads from the file until the trace magic number has been consumed. Returns FALSE if the file ends first.
+*/
+static int FindDump(FILE *file)
+{
+    uint32_t window = 0;
+    int c;
+
+    while((c = fgetc(file)) != EOF){
+        window = (window >> 8) | ((uint32_t)c << 24);        // the dump is little endian
+        if(window == TRACE_MAGIC){
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+
+/*
+SectionTrack:
+Returns the track a profiled section is drawn on - the ISRs get their own tracks since they preempt the main loop.
+*/
+static int SectionTrack(int section)
+{
+    if(section == PROF_CH1_ISR){
+        return TRACK_CH1_ISR;
+    }
+    if(section == PROF_CH2_ISR){
+        return TRACK_CH2_ISR;
+    }
+    return TRACK_PIPELINE;
+}
+
+
+/*
+Main:
+Converts the first dump found in the file (or stdin) to JSON on stdout.
+*/
+int main(int argc, char *argv[])
+{
+    FILE *file = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    TRACE_HEADER header;
+    TRACE_EVENT e;
+    uint64_t time = 0;                                                  // unwrapped tick count
+    uint32_t last = 0;
+
+    if(!file || !FindDump(file)){
+        fprintf(stderr, "no trace dump found\n");
+        return 1;
+    }
+    header.magic = TRACE_MAGIC;
+    if(fread((char *)&header + sizeof(header.magic), sizeof(header) - sizeof(header.magic), 1, file) != 1
+    || header.version != TRACE_VERSION || header.ticksPerUs == 0){
+        fprintf(stderr, "unsupported trace header\n");
+        return 1;
+    }
+
+    printf("{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%u},\"traceEvents\":[\n", (unsigned)header.dropped);
+    printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"CH1 DMA ISR\"}},\n", TRACK_CH1_ISR);
+    printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"CH2 DMA ISR\"}},\n", TRACK_CH2_ISR);
+    printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"main loop\"}}", TRACK_PIPELINE);
+
+    for(int n=0;n<header.count && fread(&e, sizeof(e), 1, file) == 1;n++){
+        if(n == 0){
+            last = e.time;
+        }
+        time += (uint32_t)(e.time - last);                              // unsigned difference survives the counter wrapping
+        last = e.time;
+        double us = (double)time / header.ticksPerUs;
+
+        switch(e.type){
+            case TRACE_DMA_DONE:
+                printf(",\n{\"name\":\"DMA done\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"buffer1\":%d}}",
+                       us, e.arg8 == CHANNEL_1 ? TRACK_CH1_ISR : TRACK_CH2_ISR, e.arg16);
+                break;
+            case TRACE_TRIGGER_FOUND:
+                printf(",\n{\"name\":\"trigger found\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"channel\":%d,\"index\":%d}}",
+                       us, TRACK_PIPELINE, e.arg8, e.arg16);
+                break;
+            case TRACE_TRIGGER_MISSED:
+                printf(",\n{\"name\":\"trigger missed\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"channel\":%d}}",
+                       us, TRACK_PIPELINE, e.arg8);
+                break;
+            case TRACE_STAGE_BEGIN:
+            case TRACE_STAGE_END:
+                if(e.arg8 >= NUM_PROF_SECTIONS){
+                    break;
+                }
+                printf(",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                       PROFILE_NAMES[e.arg8], e.type == TRACE_STAGE_BEGIN ? "B" : "E", us, SectionTrack(e.arg8));
+                break;
+            case TRACE_FRAME_DRAWN:
+                printf(",\n{\"name\":\"frame drawn\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%d}}",
+                       us, TRACK_PIPELINE, e.arg16);
+                break;
+            case TRACE_COMMAND:
+                printf(",\n{\"name\":\"command\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"first\":\"%c\",\"length\":%d}}",
+                       us, TRACK_PIPELINE, (e.arg8 >= ' ' && e.arg8 < 0x7F && e.arg8 != '"' && e.arg8 != '\\') ? e.arg8 : '?', e.arg16);
+                break;
+            default:
+                break;
+        }
+    }
+    printf("\n]}\n");
+    return 0;
+}
@@ -0,0 +1,295 @@
+/* ========================================
+ *
+ * Tiny Scope acquisition definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the kernel that splits a segment of
+ * interleaved pairs in place in the channel buffers and the
+ * bookkeeping that splits each segment once, the DMA and
+ * interrupt set up for each acquisition mode, the segment
+ * count used by streaming mode, the capture memory, stopping
+ * and restarting the DMAs around a single shot and the setacq_
+ * commands that switch between the modes.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* interleaved progress - updated by ACQ_ISR */
+volatile uint32_t ACQ_Segments = 0;                                          // segments completed since the DMAs were configured
+volatile uint32_t ACQ_SegmentTime = 0;                                       // tick time the last segment completed
+int ACQ_Stopped = FALSE;                                                     // TRUE while a single shot has the DMAs stopped
+
+#ifdef HOST_BUILD
+/* the capture memory's stand-in on the host - on the CM4 it is the RAM between the heap and the stack */
+uint16_t ACQ_Pool[ACQ_HOST_POOL_SIZE] __attribute__((aligned(4)));
+uint16_t * const ACQ_PoolEnd = ACQ_Pool + ACQ_HOST_POOL_SIZE;
+#endif
+
+/* the wave structure and channel buffers from main_cm4.c - the buffer flags are reset when the mode changes */
+extern WAVEFORM_DATA WAVE;
+extern uint16_t CH1_Data1[SIZE];
+extern uint16_t CH1_Data2[SIZE];
+extern uint16_t CH2_Data1[SIZE];
+extern uint16_t CH2_Data2[SIZE];
+
+/* channel 2's half of a segment while the segment is split in place */
+static uint16_t Scratch[ACQ_SEGMENT / 2];
+_Static_assert((ACQ_SEGMENT / 2) % ACQ_PAIRS_PER_DESCRIPTOR == 0, "a descriptor never straddles the two channels' pieces of a segment");
+
+/* set once the hardware has been configured, so later mode changes reconfigure it */
+static int AcqConfigured = FALSE;
+static int AcqMode = ACQ_SEPARATE;                                           // the mode the hardware was configured for
+static uint32_t AcqSplit = 0;                                                // segments split so far
+
+
+/*
+Acq_Split:
+Splits a segment of (CH1, CH2) pairs in place. The interleaved DMA leaves the first half of the segment's pairs in
+ch1 and the rest in ch2; afterwards ch1 holds the segment's channel 1 samples and ch2 its channel 2 samples. Both
+samples of a pair come from the same SAR scan, so the channel buffers line up sample for sample. Channel 1 is packed
+forwards in ch1 while ch1's channel 2 samples go to the scratch, ch2 is then worked backwards so nothing is read
+after it has been overwritten, and the scratch fills what is left of ch2.
+*/
+void Acq_Split(uint16_t ch1[], uint16_t ch2[], int size)
+{
+    int half = size / 2;
+    
+    for(int i=0;i<half;i++){
+        Scratch[i] = ch1[2*i+1];
+        ch1[i] = ch1[2*i];                                                    // never ahead of what is still to be read
+    }
+    for(int i=half-1;i>=0;i--){
+        ch1[half+i] = ch2[2*i];
+        ch2[half+i] = ch2[2*i+1];                                             // 2i+1 < half+i - still unwritten going backwards
+    }
+    memcpy(ch2, Scratch, half * sizeof(uint16_t));
+}
+
+
+/*
+Acq_SplitReady:
+Splits every segment the interleaved DMA has finished since the last call, each exactly once. The main loop calls
+this before it reads the channel buffers. A segment more than a block behind is left alone since the DMA is already
+writing over it. Does nothing in separate mode.
+*/
+void Acq_SplitReady(void)
+{
+    uint32_t ready = ACQ_Segments;
+    
+    if(AcqMode == ACQ_SEPARATE){
+        return;
+    }
+    if(ready - AcqSplit > ACQ_SEGMENTS){
+        AcqSplit = ready - ACQ_SEGMENTS;
+    }
+    PROFILE_BEGIN(PROF_SPLIT);
+    for(;AcqSplit!=ready;AcqSplit++){
+        uint32_t segment = AcqSplit % (2 * ACQ_SEGMENTS);                    // position of the segment in both buffers
+        int offset = (segment % ACQ_SEGMENTS) * ACQ_SEGMENT;
+        if(segment < ACQ_SEGMENTS){
+            Acq_Split(CH1_Data1 + offset, CH2_Data1 + offset, ACQ_SEGMENT);
+        } else {
+            Acq_Split(CH1_Data2 + offset, CH2_Data2 + offset, ACQ_SEGMENT);
+        }
+    }
+    PROFILE_END(PROF_SPLIT);
+}
+
+
+/*
+Acq_PoolCheck:
+Checks the capture memory the linker left. It must hold ACQ_POOL_MIN samples for the fixed layouts, and be word
+aligned for the cross-correlation, which borrows it as 32 bit FFT buffers. Returns TRUE if so; otherwise says why
+over the UART and returns FALSE.
+*/
+int Acq_PoolCheck(void)
+{
+    char str[ACQ_LINE_LEN];
+
+    if(ACQ_POOL_SIZE < ACQ_POOL_MIN || (uintptr_t)ACQ_Pool % sizeof(uint32_t)){
+        sprintf(str,"Capture memory of %d samples - it needs %d, word aligned\n",ACQ_POOL_SIZE,ACQ_POOL_MIN);
+        UART_PutString(str);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+#ifndef HOST_BUILD
+/*
+StartInterleaved:
+Builds a circular chain of 2D descriptors for DMA_1 over both ping-pong halves. Each SAR scan triggers one X loop
+that moves CHAN_RESULT[0] and CHAN_RESULT[2]; each Y step moves on to the next pair. The first half of each
+segment's descriptors write into channel 1's piece of the segment and the rest into channel 2's, for Acq_Split to
+sort out in place. Only the last descriptor of a block interrupts - or of every segment in streaming mode.
+Channel 2's DMA and ISR are left off.
+*/
+static void StartInterleaved(int mode)
+{
+    static cy_stc_dma_descriptor_t descriptors[2 * ACQ_DESCRIPTORS];
+    uint16_t *ch1[2] = {CH1_Data1, CH1_Data2};
+    uint16_t *ch2[2] = {CH2_Data1, CH2_Data2};
+    int perInterrupt = mode == ACQ_STREAMING ? ACQ_SEGMENT_DESCRIPTORS : ACQ_DESCRIPTORS;  // descriptors between interrupts
+    cy_stc_dma_descriptor_config_t config = {
+        .retrigger = CY_DMA_RETRIG_IM,
+        .triggerOutType = CY_DMA_1ELEMENT,
+        .channelState = CY_DMA_CHANNEL_ENABLED,
+        .triggerInType = CY_DMA_X_LOOP,                                       // one trigger per SAR scan moves a pair
+        .dataSize = CY_DMA_HALFWORD,
+        .srcTransferSize = CY_DMA_TRANSFER_SIZE_WORD,                         // the result registers are read as words
+        .dstTransferSize = CY_DMA_TRANSFER_SIZE_DATA,
+        .descriptorType = CY_DMA_2D_TRANSFER,
+        .srcAddress = (void *)&(SAR->CHAN_RESULT[0]),
+        .srcXincrement = SAR_CH2_OFFSET,                                      // CHAN_RESULT[0] then CHAN_RESULT[2]
+        .dstXincrement = 1,
+        .xCount = 2,
+        .srcYincrement = 0,                                                   // back to CHAN_RESULT[0] for the next scan
+        .dstYincrement = 2,
+        .yCount = ACQ_PAIRS_PER_DESCRIPTOR,
+    };
+    cy_stc_dma_channel_config_t channel = {
+        .descriptor = &descriptors[0],
+        .preemptable = false,
+        .priority = 0,
+        .enable = false,
+        .bufferable = false,
+    };
+
+    for(int d=0;d<2*ACQ_DESCRIPTORS;d++){
+        int half = d / ACQ_DESCRIPTORS;
+        int segment = (d % ACQ_DESCRIPTORS) / ACQ_SEGMENT_DESCRIPTORS;
+        int k = d % ACQ_SEGMENT_DESCRIPTORS;                                  // descriptor within the segment
+        uint16_t *piece = (k < ACQ_SEGMENT_DESCRIPTORS / 2 ? ch1[half] : ch2[half]) + segment * ACQ_SEGMENT;
+        config.dstAddress = piece + 2 * (k % (ACQ_SEGMENT_DESCRIPTORS / 2)) * ACQ_PAIRS_PER_DESCRIPTOR;
+        config.interruptType = (d + 1) % perInterrupt == 0 ? CY_DMA_DESCR : CY_DMA_DESCR_CHAIN;  // a circular chain never ends, so the rest never interrupt
+        config.nextDescriptor = &descriptors[(d + 1) % (2 * ACQ_DESCRIPTORS)];  // the chain is circular
+        Cy_DMA_Descriptor_Init(&descriptors[d], &config);
+    }
+
+    Cy_DMA_Channel_Init(DMA_1_HW, DMA_1_DW_CHANNEL, &channel);
+    Cy_DMA_Channel_SetInterruptMask(DMA_1_HW, DMA_1_DW_CHANNEL, CY_DMA_INTR_MASK);
+    Cy_SysInt_Init(&CH1_INT_cfg, ACQ_ISR);                                    // the channel 1 interrupt now serves both channels
+    NVIC_EnableIRQ(CH1_INT_cfg.intrSrc);
+    Cy_DMA_Channel_Enable(DMA_1_HW, DMA_1_DW_CHANNEL);
+}
+
+
+/*
+StartSeparate:
+Starts each channel's DMA on its own ping-pong buffers with its own ISR - the original acquisition.
+*/
+static void StartSeparate(void)
+{
+    Cy_SysInt_Init(&CH1_INT_cfg, CH1_ISR);
+    NVIC_EnableIRQ(CH1_INT_cfg.intrSrc);
+    Cy_SysInt_Init(&CH2_INT_cfg, CH2_ISR);
+    NVIC_EnableIRQ(CH2_INT_cfg.intrSrc);
+
+    DMA_1_Start((uint32_t *)&(SAR->CHAN_RESULT[0]),CH1_Data1);               // channel 1 to the channel 1 arrays
+    Cy_DMA_Descriptor_SetSrcAddress(&DMA_1_Descriptor_2, (uint32_t *)&(SAR->CHAN_RESULT[0]));
+    Cy_DMA_Descriptor_SetDstAddress(&DMA_1_Descriptor_2, CH1_Data2);
+    Cy_DMA_Channel_SetInterruptMask(DMA_1_HW,DMA_1_DW_CHANNEL,CY_DMA_INTR_MASK);
+
+    DMA_2_Start((uint32_t *)&(SAR->CHAN_RESULT[2]),CH2_Data1);               // channel 2 to the channel 2 arrays
+    Cy_DMA_Descriptor_SetSrcAddress(&DMA_2_Descriptor_2, (uint32_t *)&(SAR->CHAN_RESULT[2]));
+    Cy_DMA_Descriptor_SetDstAddress(&DMA_2_Descriptor_2, CH2_Data2);
+    Cy_DMA_Channel_SetInterruptMask(DMA_2_HW,DMA_2_DW_CHANNEL,CY_DMA_INTR_MASK);
+}
+#endif /* HOST_BUILD - the host simulator plays the part of the DMAs */
+
+
+/*
+Acq_Configure:
+Sets up the DMAs and interrupts for an acquisition mode. The SAR is stopped while the DMAs are started so that both
+channels begin on the same scan - otherwise a scan landing between the two starts would leave the channels a
+sample apart for good. The buffer flags start over in step with the DMAs.
+*/
+void Acq_Configure(int mode)
+{
+#ifndef HOST_BUILD
+    ADC_StopConvert();
+#endif
+    Acq_Stop();
+
+    WAVE.Wave1_Buffer1 = FALSE;
+    WAVE.Wave2_Buffer1 = FALSE;
+    ACQ_Segments = 0;                                                         // segment 0 is the first of buffer 1
+    AcqSplit = 0;
+    AcqMode = mode;
+
+#ifndef HOST_BUILD
+    if(mode == ACQ_INTERLEAVED || mode == ACQ_STREAMING){
+        StartInterleaved(mode);
+    } else {
+        StartSeparate();
+    }
+    ADC_StartConvert();
+#endif
+    ACQ_Stopped = FALSE;
+    AcqConfigured = TRUE;
+}
+
+
+/*
+Acq_Stop:
+Stops the DMAs and their interrupts so nothing writes to the channel buffers, for a single shot that keeps its
+results there once it is done. The SAR keeps converting since the potentiometers are still read.
+*/
+void Acq_Stop(void)
+{
+#ifndef HOST_BUILD
+    NVIC_DisableIRQ(CH1_INT_cfg.intrSrc);
+    NVIC_DisableIRQ(CH2_INT_cfg.intrSrc);
+    Cy_DMA_Channel_Disable(DMA_1_HW, DMA_1_DW_CHANNEL);
+    Cy_DMA_Channel_Disable(DMA_2_HW, DMA_2_DW_CHANNEL);
+#endif
+    ACQ_Stopped = TRUE;
+}
+
+
+/*
+Acq_Resume:
+Starts the DMAs again if a single shot stopped them. Called when the scope is started.
+*/
+void Acq_Resume(int mode)
+{
+    if(ACQ_Stopped && AcqConfigured){
+        Acq_Configure(mode);
+    }
+}
+
+
+/*
+Acq_Command:
+Handles the setacq_ commands that pick the acquisition mode. Like the trigger settings the mode can only be
+changed while the scope is stopped. Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Acq_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    if(SCOPE->Running){
+        return FALSE;
+    }
+
+    if(!strncasecmp(str,"setacq_interleaved",18)){
+        SCOPE->acqMode = ACQ_INTERLEAVED;
+        UART_PutString("Acquisition set to interleaved\n");
+    } else if(!strncasecmp(str,"setacq_streaming",16)){
+        SCOPE->acqMode = ACQ_STREAMING;
+        UART_PutString("Acquisition set to streaming\n");
+    } else if(!strncasecmp(str,"setacq_separate",15)){
+        SCOPE->acqMode = ACQ_SEPARATE;
+        UART_PutString("Acquisition set to separate\n");
+    } else {
+        return FALSE;
+    }
+
+    if(AcqConfigured){
+        Acq_Configure(SCOPE->acqMode);                                        // the hardware is already running - switch it over now
+    }
+    return TRUE;
+}
@@ -0,0 +1,92 @@
+/* ========================================
+ *
+ * Tiny Scope acquisition header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the two acquisition modes. In separate
+ * mode each channel has its own DMA, ISR and ping-pong flag
+ * (the original design). In interleaved mode one DMA moves
+ * CHAN_RESULT[0] and CHAN_RESULT[2] from each SAR scan, so
+ * both channels always come from the same scans. The pairs
+ * land straight in the channel buffers - the first half of
+ * each segment's pairs in channel 1's piece of it and the rest
+ * in channel 2's - and the DMA only interrupts at the end of a
+ * block. The main loop then splits each segment in place before
+ * anything reads it, so the split costs no interrupt time and
+ * needs only half a segment of scratch. Streaming mode is
+ * interleaved mode with an interrupt for every segment and the
+ * main loop taking each segment of a block as it lands, so it
+ * can search and format while the rest of the block is still
+ * being acquired. The capture memory is the
+ * pool the capture modes record into - only one of them is on
+ * at a time, so they share it. It is the RAM the linker script
+ * leaves between the end of the heap and the bottom of the
+ * stack, so it takes whatever the rest of the build does not
+ * and grows or shrinks with it. The host build stands in a
+ * static array of the size the CM4 build leaves today. A single
+ * shot that needs the channel buffers once it is done stops the
+ * DMAs, and they are started again with the next run.
+ *
+ * ========================================
+*/
+
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines for the acquisition modes */
+#define ACQ_SEPARATE 0            // one DMA and ISR per channel
+#define ACQ_INTERLEAVED 1         // one DMA and ISR for both channels
+#define ACQ_STREAMING 2           // interleaved, with an interrupt for every segment of a block
+#define ACQ_LINE_LEN 100          // length of one line of the acquisition report
+
+/* Defines for the interleaved descriptor chain */
+#define ACQ_PAIRS_PER_DESCRIPTOR 200  // pairs moved by one descriptor (a DataWire Y loop holds at most 256)
+#define ACQ_DESCRIPTORS (SIZE / ACQ_PAIRS_PER_DESCRIPTOR)  // descriptors per ping-pong half
+#define ACQ_SEGMENTS 2            // segments per ping-pong half - streaming mode gets an interrupt for each
+#define ACQ_SEGMENT (SIZE / ACQ_SEGMENTS)  // samples per channel in one segment
+#define ACQ_SEGMENT_DESCRIPTORS (ACQ_DESCRIPTORS / ACQ_SEGMENTS)  // descriptors per segment, half into each channel's piece
+#define SAR_CH2_OFFSET 4          // halfwords from CHAN_RESULT[0] to CHAN_RESULT[2] (DMA increments count data elements)
+
+/* Defines for the capture memory */
+#define ACQ_POOL_MIN 0x4000       // samples the fixed layouts in the capture memory need (the cross-correlation's FFT buffers)
+#define ACQ_HOST_POOL_SIZE 0x4600 // samples the host build's stand-in holds, what the CM4 build leaves (35 KB)
+#define ACQ_POOL_SIZE ((int)(ACQ_PoolEnd - ACQ_Pool))  // samples in the capture memory - only known once linked
+
+/* Globals */
+extern volatile uint32_t ACQ_Segments;
+extern volatile uint32_t ACQ_SegmentTime;
+extern int ACQ_Stopped;
+#ifndef HOST_BUILD
+extern uint16_t ACQ_Pool[] __asm__("__HeapLimit");     // the linker script's end of the heap
+extern uint16_t ACQ_PoolEnd[] __asm__("__StackLimit"); // and bottom of the stack
+#else
+extern uint16_t ACQ_Pool[];
+extern uint16_t * const ACQ_PoolEnd;
+#endif
+
+/* ISRs (in main_cm4.c) - the acquisition mode decides which are connected */
+void CH1_ISR(void);
+void CH2_ISR(void);
+void ACQ_ISR(void);
+
+/* Function prototypes */
+void Acq_Split(uint16_t ch1[], uint16_t ch2[], int size);
+
+void Acq_SplitReady(void);
+
+int Acq_PoolCheck(void);
+
+void Acq_Configure(int mode);
+
+void Acq_Stop(void);
+
+void Acq_Resume(int mode);
+
+int Acq_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* ACQUISITION_H */
@@ -0,0 +1,254 @@
+/* ========================================
+ *
+ * Tiny Scope autoset definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the analysis of a block, the choice of the
+ * settings from it, the offset trims and the autoset command.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the autoset state */
+AUTOSET_STATE AUTOSET = {FALSE, {0, 0}, {0, 0}, {{0}}};
+
+/* the ping-pong buffers and wave structure from main_cm4.c - a stopped scope is set up from the last block */
+extern uint16_t CH1_Data1[SIZE];
+extern uint16_t CH1_Data2[SIZE];
+extern uint16_t CH2_Data1[SIZE];
+extern uint16_t CH2_Data2[SIZE];
+extern WAVEFORM_DATA WAVE;
+
+/* the vertical scales autoset picks from in millivolts per division, most sensitive first */
+static const int AUTOSET_YSCALES[AUTOSET_NUM_YSCALES] = {500, 1000, 1500, 2000};
+
+
+/*
+Autoset_Measure:
+Analyzes count samples of a channel in two passes. The first finds the extremes and the mean; the second counts
+the rising crossings of the middle, where a crossing only counts once the signal has been below the low threshold
+since the last one, and takes the period from the first and last crossings. A channel whose swing is under
+NOISE_THRESHOLD is flat and has no crossings.
+*/
+void Autoset_Measure(const uint16_t arr[], int count, AUTOSET_CHANNEL *m)
+{
+    int min = MAX_ADC_OUTPUT;
+    int max = 0;
+    int32_t sum = 0;
+    int first = 0, last = 0;
+
+    for(int i=0;i<count;i++){
+        int v = (arr[i] & UNDERFLOW_CHECK) ? 0 : arr[i];
+        min = v < min ? v : min;
+        max = v > max ? v : max;
+        sum += v;
+    }
+    m->min = min;
+    m->max = max;
+    m->mean = sum / count;
+    m->edges = 0;
+    m->period = 0;
+    if(max - min < NOISE_THRESHOLD){
+        return;
+    }
+
+    int hysteresis = (max - min) / AUTOSET_HYSTERESIS;
+    int high = (max + min) / 2 + hysteresis;
+    int low = (max + min) / 2 - hysteresis;
+    int below = FALSE;                                                        // TRUE once the signal has gone under the low threshold
+    for(int i=0;i<count;i++){
+        int v = (arr[i] & UNDERFLOW_CHECK) ? 0 : arr[i];
+        if(v <= low){
+            below = TRUE;
+        } else if(below && v >= high){
+            if(!m->edges){
+                first = i;
+            }
+            last = i;
+            m->edges++;
+            below = FALSE;
+        }
+    }
+    if(m->edges >= 2){
+        m->period = (int32_t)((int64_t)(last - first) * INDEX_SCALE / (m->edges - 1));
+    }
+}
+
+
+/*
+Autoset_Choose:
+Picks the settings for the analysis of both channels. The trigger goes on the channel with a period (the larger
+one if both have), rising through its middle, and the timebase puts AUTOSET_SCREEN_PERIODS_X2 / 2 of its periods
+on the screen, rounded to two figures. A channel that swings without a whole period in the block gets the
+slowest timebase; with nothing to trigger on the scope free-runs. The vertical scale is the most sensitive that
+fits the larger swing in AUTOSET_FILL_PIXELS, and offsets gets the offset that centers each channel. Returns the
+trigger channel, or 0 if none.
+*/
+int Autoset_Choose(const AUTOSET_CHANNEL m[2], SCOPE_SETTINGS *SCOPE, int offsets[2])
+{
+    int swing[2] = {m[0].max - m[0].min, m[1].max - m[1].min};
+    int largest = swing[0] >= swing[1] ? swing[0] : swing[1];
+    int trigger = 0;
+
+    for(int c=0;c<2;c++){                                                     // the channel with a period, the larger if both have one
+        if(m[c].period && (!trigger || swing[c] > swing[trigger-1])){
+            trigger = c + 1;
+        }
+    }
+    if(!trigger && largest >= NOISE_THRESHOLD){
+        trigger = swing[0] >= swing[1] ? CHANNEL_1 : CHANNEL_2;              // a slow signal - triggered on with the slowest timebase
+    }
+
+    int y = 0;
+    while(y < AUTOSET_NUM_YSCALES - 1 && -CODE_TO_PIXEL(largest, INVERT_YSCALE/AUTOSET_YSCALES[y]) > AUTOSET_FILL_PIXELS){
+        y++;
+    }
+    SCOPE->yScale = INVERT_YSCALE/AUTOSET_YSCALES[y];
+    for(int c=0;c<2;c++){
+        offsets[c] = Y_PIXELS/2 + CODE_TO_PIXEL((m[c].max + m[c].min) / 2, SCOPE->yScale);
+    }
+
+    if(!trigger){
+        SCOPE->freeRun = TRUE;
+        return 0;
+    }
+    const AUTOSET_CHANNEL *t = &m[trigger-1];
+    int level = (t->max + t->min) / 2;
+    int minLevel = MILLIVOLTS_TO_CODE(MIN_TRIGGER_LEVEL);
+    int maxLevel = MILLIVOLTS_TO_CODE(MAX_TRIGGER_LEVEL);
+    SCOPE->triggerLevel = level < minLevel ? minLevel : (level > maxLevel ? maxLevel : level);
+    SCOPE->triggerDir = POSITIVE;
+    SCOPE->triggerChannel = trigger;
+    SCOPE->freeRun = FALSE;
+
+    int minX = ETS.on ? ETS_MIN_XSCALE : MIN_XSCALE;
+    int xScale = MAX_XSCALE;
+    if(t->period){                                                            // the screen spans X_PIXELS * xScale / INDEX_DIVISOR samples
+        int64_t x = (int64_t)t->period * AUTOSET_SCREEN_PERIODS_X2 * INDEX_DIVISOR / (2 * X_PIXELS * INDEX_SCALE);
+        int unit = 1;
+        while(x / unit >= 100){
+            unit *= 10;
+        }
+        x = (x + unit / 2) / unit * unit;                                     // two figures
+        xScale = x < minX ? minX : (x > MAX_XSCALE ? MAX_XSCALE : (int)x);
+    }
+    SCOPE->xScale = xScale;
+    return trigger;
+}
+
+
+/*
+ReportChannel:
+Sends what the analysis found on one channel over the UART.
+*/
+static void ReportChannel(int channel, const AUTOSET_CHANNEL *m)
+{
+    char line[AUTOSET_LINE_LEN];
+    int mean = m->mean * MAX_VOLTAGE / MAX_ADC_OUTPUT;
+    int swing = (m->max - m->min) * MAX_VOLTAGE / MAX_ADC_OUTPUT;
+
+    if(m->max - m->min < NOISE_THRESHOLD){
+        sprintf(line,"CH%d flat at %d mV\n",channel,mean);
+    } else if(!m->period){
+        sprintf(line,"CH%d %d mV pp, DC %d mV, no whole period in the block\n",channel,swing,mean);
+    } else {
+        sprintf(line,"CH%d %ld HZ, %d mV pp, DC %d mV\n",channel,(long)((int64_t)SAMPLING_RATE * INDEX_SCALE / m->period),swing,mean);
+    }
+    UART_PutString(line);
+}
+
+
+/*
+ScaleMillivolts:
+Returns the millivolts per division of a vertical scale autoset picked.
+*/
+static int ScaleMillivolts(int yScale)
+{
+    for(int y=0;y<AUTOSET_NUM_YSCALES;y++){
+        if(INVERT_YSCALE/AUTOSET_YSCALES[y] == yScale){
+            return AUTOSET_YSCALES[y];
+        }
+    }
+    return INVERT_YSCALE/yScale;
+}
+
+
+/*
+Autoset_Block:
+Analyzes a block of both channels and sets the scope up for it: the scales, an edge trigger in auto sweep mode
+through the middle of the trigger channel and the offset trims. The trigger engine and the average start again
+since the frames they hold were taken with the old settings. Reports what it found and chose.
+*/
+void Autoset_Block(uint16_t ch1[], uint16_t ch2[], SCOPE_SETTINGS *SCOPE)
+{
+    char line[AUTOSET_LINE_LEN];
+    int offsets[2];
+
+    PROFILE_BEGIN(PROF_AUTOSET);
+    AUTOSET.pending = FALSE;
+    Autoset_Measure(ch1, SIZE, &AUTOSET.channel[0]);
+    Autoset_Measure(ch2, SIZE, &AUTOSET.channel[1]);
+    int trigger = Autoset_Choose(AUTOSET.channel, SCOPE, offsets);
+    for(int c=0;c<2;c++){
+        AUTOSET.trim[c] = offsets[c] - AUTOSET.pot[c];
+    }
+    TRIGGER.type = TRIGGER_EDGE;
+    TRIGGER.sweep = SWEEP_AUTO;
+    Trigger_Reset();
+    Avg_Reset();
+    PROFILE_END(PROF_AUTOSET);
+
+    ReportChannel(CHANNEL_1, &AUTOSET.channel[0]);
+    ReportChannel(CHANNEL_2, &AUTOSET.channel[1]);
+    if(trigger){
+        sprintf(line,"Autoset xscale %d us, yscale %d mV, trigger CH%d rising at %d mV\n",SCOPE->xScale,
+                ScaleMillivolts(SCOPE->yScale),trigger,SCOPE->triggerLevel * MAX_VOLTAGE / MAX_ADC_OUTPUT);
+    } else {
+        sprintf(line,"Autoset yscale %d mV, free-running - nothing to trigger on\n",
+                ScaleMillivolts(SCOPE->yScale));
+    }
+    UART_PutString(line);
+}
+
+
+/*
+Autoset_Offset:
+Returns the offset a channel is drawn at for its potentiometer offset pot: pot plus the channel's trim, not below
+the bottom of the screen. The potentiometer offset is remembered so the next autoset can work out the trim.
+*/
+uint16_t Autoset_Offset(int channel, uint16_t pot)
+{
+    AUTOSET.pot[channel-1] = pot;
+    int offset = pot + AUTOSET.trim[channel-1];
+    return offset < 0 ? 0 : offset;
+}
+
+
+/*
+Autoset_Command:
+Handles autoset, which sets the scope up from the next block while running or straight away from the last block
+while stopped, and autoset_clear, which takes the trims off so the potentiometers alone set the offsets again.
+Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Autoset_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    if(!strncasecmp(str,"autoset_clear",13)){
+        AUTOSET.trim[0] = 0;
+        AUTOSET.trim[1] = 0;
+        UART_PutString("Autoset offsets cleared\n");
+    } else if(!strncasecmp(str,"autoset",7)){
+        if(SCOPE->Running){
+            AUTOSET.pending = TRUE;                                           // Proccess_Channel runs it on the next block
+        } else {
+            Autoset_Block(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2, SCOPE);
+        }
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,68 @@
+/* ========================================
+ *
+ * Tiny Scope autoset header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the autoset command. It looks at one block
+ * of each channel: a first pass finds the extremes and the DC
+ * level, and a second counts the rising crossings of the middle
+ * (with hysteresis against noise) and takes the period from the
+ * first and last of them. From these it picks the timebase that
+ * puts two and a half periods on the screen, the vertical scale
+ * that fits the larger signal in six divisions, an edge trigger
+ * through the middle of the channel with a period and an offset
+ * that centers each trace. The potentiometers can't be moved, so
+ * the offset is kept as a trim added to them - they still move
+ * the traces from where autoset put them. Running, the analysis
+ * waits for the next block; stopped, it uses the last one, so
+ * it is done within a block either way.
+ *
+ * ========================================
+*/
+
+#ifndef AUTOSET_H
+#define AUTOSET_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define AUTOSET_HYSTERESIS 8      // the crossing thresholds are this fraction of the swing either side of the middle
+#define AUTOSET_SCREEN_PERIODS_X2 5  // twice the periods the timebase puts on the screen
+#define AUTOSET_FILL_PIXELS (6 * PIXELS_PER_Y)  // the largest signal should fit six divisions
+#define AUTOSET_NUM_YSCALES 4     // vertical scales autoset picks from
+#define AUTOSET_LINE_LEN 100      // length of one line of the autoset report
+
+/* Structures */
+typedef struct AUTOSET_CHANNEL{   // what the analysis found on one channel
+    int min;                      // the smallest code of the block (underflow counts as 0)
+    int max;                      // the largest code of the block
+    int mean;                     // the DC level in codes
+    int edges;                    // rising crossings of the middle
+    int32_t period;               // samples between rising crossings scaled by INDEX_SCALE, or 0 with fewer than two
+}AUTOSET_CHANNEL;
+
+typedef struct AUTOSET_STATE{
+    int pending;                  // TRUE while an autoset waits for the next block
+    int trim[2];                  // pixels added to each potentiometer offset
+    uint16_t pot[2];              // the last potentiometer offset of each channel, without the trim
+    AUTOSET_CHANNEL channel[2];   // the last analysis of each channel
+}AUTOSET_STATE;
+
+/* Globals */
+extern AUTOSET_STATE AUTOSET;
+
+/* Function prototypes */
+void Autoset_Measure(const uint16_t arr[], int count, AUTOSET_CHANNEL *m);
+
+int Autoset_Choose(const AUTOSET_CHANNEL m[2], SCOPE_SETTINGS *SCOPE, int offsets[2]);
+
+void Autoset_Block(uint16_t ch1[], uint16_t ch2[], SCOPE_SETTINGS *SCOPE);
+
+uint16_t Autoset_Offset(int channel, uint16_t pot);
+
+int Autoset_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* AUTOSET_H */
@@ -0,0 +1,142 @@
+/* ========================================
+ *
+ * Tiny Scope waveform averaging definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the averaging accumulator, the per frame
+ * update that folds a frame into it and writes the average
+ * back, and the setavg_ and avg commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the averaging accumulator */
+AVERAGE AVG = {FALSE, AVG_DEFAULT_SHIFT, 0, {{0}}, {0}, FALSE};
+
+/* the wave structure from main_cm4.c - the average is written back into it */
+extern WAVEFORM_DATA WAVE;
+
+
+/*
+Avg_Reset:
+Starts the average again from the next frame. Called when the scope is started and when the settings change.
+*/
+void Avg_Reset(void)
+{
+    AVG.frames = 0;
+}
+
+
+/*
+Avg_Update:
+Folds one channel of a frame into its accumulator and writes the average back over the frame. frames is the
+number of frames averaged including this one: the first sets the accumulator, up to 1 << shift the new frame
+counts 1/frames (an even average of all of them), and after that 1 / (1 << shift). The loop over the columns has
+no branches so the compiler can vectorize it.
+*/
+void Avg_Update(int32_t acc[], int Y[], uint32_t frames, int shift)
+{
+    if(frames <= 1){
+        for(int p=0;p<X_PIXELS;p++){
+            acc[p] = Y[p] * (1 << AVG_FRACTION_BITS);
+        }
+        return;                                                              // the average of one frame is the frame
+    }
+    if(frames <= (1u << shift)){
+        for(int p=0;p<X_PIXELS;p++){
+            acc[p] += (Y[p] * (1 << AVG_FRACTION_BITS) - acc[p]) / (int32_t)frames;
+            Y[p] = (acc[p] + (1 << (AVG_FRACTION_BITS - 1))) >> AVG_FRACTION_BITS;
+        }
+    } else {
+        for(int p=0;p<X_PIXELS;p++){
+            acc[p] += (Y[p] * (1 << AVG_FRACTION_BITS) - acc[p]) >> shift;
+            Y[p] = (acc[p] + (1 << (AVG_FRACTION_BITS - 1))) >> AVG_FRACTION_BITS;
+        }
+    }
+}
+
+
+/*
+SameSettings:
+Returns TRUE if the settings the pixel columns depend on are the ones the average was built with.
+*/
+static int SameSettings(SCOPE_SETTINGS SCOPE)
+{
+    return SCOPE.xScale == AVG.settings.xScale && SCOPE.yScale == AVG.settings.yScale
+    && SCOPE.triggerDir == AVG.settings.triggerDir && SCOPE.triggerLevel == AVG.settings.triggerLevel
+    && SCOPE.triggerChannel == AVG.settings.triggerChannel && SCOPE.acqMode == AVG.settings.acqMode
+    && HIRES.on == AVG.hires;
+}
+
+
+/*
+Avg_Frame:
+Called when a frame has been formatted into the wave structure. In trigger mode with averaging on the frame is
+replaced by the average of it and the frames before it. Free-run frames and the frames the auto timeout draws are
+not aligned to anything, so they are left as they are.
+*/
+void Avg_Frame(SCOPE_SETTINGS SCOPE)
+{
+    if(!AVG.on || SCOPE.freeRun || Trigger_TimedOut()){
+        return;
+    }
+    if(!SameSettings(SCOPE)){
+        Avg_Reset();                                                         // the columns no longer mean the same times and voltages
+        AVG.settings = SCOPE;
+        AVG.hires = HIRES.on;
+    }
+    if(AVG.frames < UINT32_MAX){
+        AVG.frames++;
+    }
+
+    PROFILE_BEGIN(PROF_AVERAGE);
+    Avg_Update(AVG.acc[0], WAVE.Wave1Y, AVG.frames, AVG.shift);
+    Avg_Update(AVG.acc[1], WAVE.Wave2Y, AVG.frames, AVG.shift);
+    PROFILE_END(PROF_AVERAGE);
+}
+
+
+/*
+Avg_Command:
+Handles setavg_on, setavg_off and setavg_count<N>, where N is rounded down to a power of two from 2 to
+1 << AVG_MAX_SHIFT, and avg, which reports the number of frames averaged. Returns TRUE if the command was one of
+these, FALSE otherwise.
+*/
+int Avg_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    char line[AVG_LINE_LEN];
+
+    if(!strncasecmp(str,"setavg_on",9)){
+        AVG.on = TRUE;
+        Avg_Reset();
+        UART_PutString("Averaging on\n");
+    } else if(!strncasecmp(str,"setavg_off",10)){
+        AVG.on = FALSE;
+        UART_PutString("Averaging off\n");
+    } else if(!strncasecmp(str,"setavg_count",12)){
+        int count = atoi(str + 12);
+        if(count < 2 || count > (1 << AVG_MAX_SHIFT)){
+            UART_PutString("Invalid number of frames to average\n");
+            return TRUE;
+        }
+        AVG.shift = 0;
+        while((2 << AVG.shift) <= count){
+            AVG.shift++;                                                     // the largest power of two that is not more than count
+        }
+        Avg_Reset();
+        sprintf(line,"Averaging %d frames\n",1 << AVG.shift);
+        UART_PutString(line);
+    } else if(!strncasecmp(str,"avg",3)){
+        sprintf(line,"Averaging %s, weight 1/%d, %lu frames since reset%s\n",AVG.on ? "on" : "off",1 << AVG.shift,
+                (unsigned long)AVG.frames,SCOPE->freeRun ? " (trigger mode only)" : "");
+        UART_PutString(line);
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
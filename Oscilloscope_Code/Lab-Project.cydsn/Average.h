@@ -0,0 +1,57 @@
+/* ========================================
+ *
+ * Tiny Scope waveform averaging header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides averaging across acquisitions. Each
+ * triggered frame is folded into an accumulator of one fixed
+ * point value per pixel column and channel, and the average is
+ * written back into the frame so it is drawn like any other
+ * trace. The first frames after a reset are averaged evenly
+ * (each of the first N frames counts as much as the others),
+ * after which the average is exponential with a weight of
+ * 1/N, a shift rather than a division. Noise that is not
+ * locked to the trigger falls by the square root of N while
+ * the repetitive signal stays. Any change of the settings the
+ * columns depend on starts the average again.
+ *
+ * ========================================
+*/
+
+#ifndef AVERAGE_H
+#define AVERAGE_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define AVG_FRACTION_BITS 8       // bits below one pixel kept in the accumulator
+#define AVG_DEFAULT_SHIFT 4       // the default weight is 1/16
+#define AVG_MAX_SHIFT 8           // the smallest weight is 1/256
+#define AVG_LINE_LEN 100          // length of one line of the averaging report
+
+/* Structures */
+typedef struct AVERAGE{
+    int on;                       // TRUE while triggered frames are averaged
+    int shift;                    // the weight of a new frame is 1 / (1 << shift) once the average has filled
+    uint32_t frames;              // frames averaged since the last reset
+    int32_t acc[2][X_PIXELS];     // the average of each column of each channel, with AVG_FRACTION_BITS of fraction
+    SCOPE_SETTINGS settings;      // the settings the average was built with - a change resets it
+    int hires;                    // the high resolution setting it was built with
+}AVERAGE;
+
+/* Globals */
+extern AVERAGE AVG;
+
+/* Function prototypes */
+void Avg_Reset(void);
+
+void Avg_Update(int32_t acc[], int Y[], uint32_t frames, int shift);
+
+void Avg_Frame(SCOPE_SETTINGS SCOPE);
+
+int Avg_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* AVERAGE_H */
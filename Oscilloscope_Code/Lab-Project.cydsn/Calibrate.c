@@ -0,0 +1,379 @@
+/* ========================================
+ *
+ * Tiny Scope calibration definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the calibration of each channel, the fit and
+ * the building of the correction tables, the per block
+ * correction, the saving and loading of the points and the
+ * setcal and cal commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the calibration of each channel - no points and no correction until one is taken or loaded */
+CAL_CHANNEL CAL[2] = {
+    {0, {{0}}, 0, 1 << CAL_GAIN_BITS, {0}, FALSE, CAL_NO_POINT, 0, 0, {0}},
+    {0, {{0}}, 0, 1 << CAL_GAIN_BITS, {0}, FALSE, CAL_NO_POINT, 0, 0, {0}},
+};
+
+/* the buffer each channel corrected last, so one that has not been refilled is not corrected twice */
+static const uint16_t *LastCorrected[2];
+
+/* the flash row the points are saved in */
+#ifdef HOST_BUILD
+static uint32_t CAL_FLASH[CAL_ROW_WORDS];                                    // the host keeps the row in memory
+#else
+CY_ALIGN(CAL_ROW_BYTES) static const volatile uint32_t CAL_FLASH[CAL_ROW_WORDS] = {0};  // volatile since it is written behind the compiler's back
+#endif
+
+
+/*
+IdealCode:
+Returns the code an ideal ADC gives for mv millivolts, with CAL_FRACTION_BITS of fraction.
+*/
+static int32_t IdealCode(int32_t mv)
+{
+    return mv * MAX_ADC_OUTPUT * (1 << CAL_FRACTION_BITS) / MAX_VOLTAGE;
+}
+
+
+/*
+Tenths:
+Returns a code with CAL_FRACTION_BITS of fraction in tenths of a millivolt.
+*/
+static int32_t Tenths(int32_t code)
+{
+    return (int32_t)((int64_t)code * MAX_VOLTAGE * 10 / (MAX_ADC_OUTPUT * (1 << CAL_FRACTION_BITS)));
+}
+
+
+/*
+Cal_Build:
+Fits the straight line through the points of a channel by least squares, keeps what is left at each point as the
+INL table, and fills the correction table: the line at each entry's raw code plus the INL interpolated between the
+points around it (and held at the end values past the first and last). The entries are not kept inside the ADC
+range - the corrected samples are, so the table stays a straight line between the points right up to the ends. One point
+only sets the offset; no points give the identity.
+*/
+void Cal_Build(int channel)
+{
+    CAL_CHANNEL *c = &CAL[channel-1];
+    int n = c->points;
+    int64_t sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+    for(int k=0;k<n;k++){
+        int64_t x = c->point[k].code;
+        int64_t y = IdealCode(c->point[k].mv);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    c->gain = 1 << CAL_GAIN_BITS;
+    c->offset = 0;
+    if(n >= 2 && n * sxx - sx * sx > 0){
+        c->gain = (int32_t)((n * sxy - sx * sy) * (1 << CAL_GAIN_BITS) / (n * sxx - sx * sx));
+    }
+    if(n >= 1){
+        c->offset = (int32_t)((sy * (1 << CAL_GAIN_BITS) - c->gain * sx) / (n * (int64_t)(1 << CAL_GAIN_BITS)));
+    }
+    for(int k=0;k<n;k++){
+        c->inl[k] = IdealCode(c->point[k].mv) - c->offset
+                  - (int32_t)(((int64_t)c->gain * c->point[k].code) / (1 << CAL_GAIN_BITS));
+    }
+
+    int k = 0;                                                               // the point at or below the code
+    c->on = FALSE;
+    for(int e=0;e<CAL_ENTRIES;e++){
+        int32_t x = (e << CAL_STEP_BITS) * (1 << CAL_FRACTION_BITS);
+        int32_t v = c->offset + (int32_t)(((int64_t)c->gain * x) / (1 << CAL_GAIN_BITS));
+        while(k < n - 1 && c->point[k+1].code <= x){
+            k++;
+        }
+        if(n >= 2 && x > c->point[k].code && k < n - 1 && c->point[k+1].code > c->point[k].code){
+            v += c->inl[k] + (c->inl[k+1] - c->inl[k]) * (x - c->point[k].code) / (c->point[k+1].code - c->point[k].code);
+        } else if(n >= 2){
+            v += c->inl[k];                                                   // held past the ends
+        }
+        c->lut[e] = v;
+        if(v != x){
+            c->on = TRUE;
+        }
+    }
+}
+
+
+/*
+FindPoint:
+Returns the index of a channel's point of the reference of mv millivolts, or the channel's number of points if it
+has none.
+*/
+static int FindPoint(const CAL_CHANNEL *c, int32_t mv)
+{
+    int k;
+
+    for(k=0;k<c->points && c->point[k].mv != mv;k++);
+    return k;
+}
+
+
+/*
+Cal_AddPoint:
+Adds a point to a channel - the reference of mv millivolts read as code (with CAL_FRACTION_BITS of fraction) - and
+rebuilds its table. A point of a reference the channel already has replaces it. Returns FALSE if the channel has
+no room for another point.
+*/
+int Cal_AddPoint(int channel, int32_t code, int32_t mv)
+{
+    CAL_CHANNEL *c = &CAL[channel-1];
+    int k = FindPoint(c, mv);
+
+    if(k < c->points){                                                        // taking the old point out
+        c->points--;
+        memmove(&c->point[k], &c->point[k+1], (c->points - k) * sizeof(CAL_POINT));
+    } else if(c->points == CAL_MAX_POINTS){
+        return FALSE;
+    }
+    for(k=c->points;k>0 && c->point[k-1].code > code;k--){                   // and putting the new one in order
+        c->point[k] = c->point[k-1];
+    }
+    c->point[k].code = code;
+    c->point[k].mv = mv;
+    c->points++;
+    Cal_Build(channel);
+    return TRUE;
+}
+
+
+/*
+Cal_Correct:
+Puts count samples through a channel's correction table in place, each interpolated between the entries either side
+of it, rounded and kept inside the ADC range. Underflowed samples are left as they are.
+*/
+void Cal_Correct(const CAL_CHANNEL *c, uint16_t arr[], int count)
+{
+    for(int i=0;i<count;i++){
+        uint16_t v = arr[i];
+        if(!(v & UNDERFLOW_CHECK)){
+            int code = v & MAX_ADC_OUTPUT;
+            const int32_t *e = &c->lut[code >> CAL_STEP_BITS];
+            int32_t f = code & ((1 << CAL_STEP_BITS) - 1);
+            int32_t y = (e[0] * (1 << CAL_STEP_BITS) + (e[1] - e[0]) * f + (1 << (CAL_STEP_BITS + CAL_FRACTION_BITS - 1)))
+                      >> (CAL_STEP_BITS + CAL_FRACTION_BITS);
+            arr[i] = y < 0 ? 0 : (y > MAX_ADC_OUTPUT ? MAX_ADC_OUTPUT : y);
+        }
+    }
+}
+
+
+/*
+TakePoint:
+Sums the raw samples of a channel into its pending point. Once CAL_POINT_SAMPLES are in the point is added and
+reported.
+*/
+static void TakePoint(int channel, const uint16_t arr[], int count)
+{
+    CAL_CHANNEL *c = &CAL[channel-1];
+    char line[CAL_LINE_LEN];
+
+    for(int i=0;i<count && c->summed<CAL_POINT_SAMPLES;i++){
+        c->sum += (arr[i] & UNDERFLOW_CHECK) ? 0 : arr[i];
+        c->summed++;
+    }
+    if(c->summed < CAL_POINT_SAMPLES){
+        return;                                                               // in streaming mode a point takes several segments
+    }
+    int32_t code = (int32_t)(((int64_t)c->sum * (1 << CAL_FRACTION_BITS) + CAL_POINT_SAMPLES / 2) / CAL_POINT_SAMPLES);
+    int32_t read = Tenths(code);
+    Cal_AddPoint(channel, code, c->pending);
+    sprintf(line,"CH%d point at %ld mV read as %ld.%ld mV\n",channel,(long)c->pending,(long)(read/10),(long)(read%10));
+    UART_PutString(line);
+    c->pending = CAL_NO_POINT;
+}
+
+
+/*
+Cal_Channels:
+Corrects the newest samples of both channels in place, taking any pending calibration point from the raw samples
+first. Called with each block in block mode and each segment in streaming mode, before the input filters; a
+buffer that is the same as last time (channel 2 has not finished its next block yet) is skipped.
+*/
+void Cal_Channels(uint16_t ch1[], uint16_t ch2[], int count)
+{
+    uint16_t *arr[2] = {ch1, ch2};
+
+    if(!CAL[0].on && !CAL[1].on && CAL[0].pending == CAL_NO_POINT && CAL[1].pending == CAL_NO_POINT){
+        return;
+    }
+    PROFILE_BEGIN(PROF_CALIBRATE);
+    for(int c=0;c<2;c++){
+        if(arr[c] == LastCorrected[c]){
+            continue;
+        }
+        if(CAL[c].pending != CAL_NO_POINT){
+            TakePoint(c + 1, arr[c], count);
+        }
+        if(CAL[c].on){
+            Cal_Correct(&CAL[c], arr[c], count);
+        }
+        LastCorrected[c] = arr[c];
+    }
+    PROFILE_END(PROF_CALIBRATE);
+}
+
+
+/*
+Checksum:
+Returns the checksum of count words: each word is added to the sum rotated a bit.
+*/
+static uint32_t Checksum(const volatile uint32_t words[], int count)
+{
+    uint32_t sum = 0;
+
+    for(int i=0;i<count;i++){
+        sum = ((sum << 1) | (sum >> 31)) + words[i];
+    }
+    return sum;
+}
+
+
+/*
+Cal_Save:
+Writes the points of both channels to the flash row. Returns TRUE if the row was written.
+*/
+int Cal_Save(void)
+{
+    static uint32_t row[CAL_ROW_WORDS];
+    CAL_RECORD *record = (CAL_RECORD *)row;
+
+    memset(row, 0, sizeof(row));
+    record->magic = CAL_MAGIC;
+    for(int c=0;c<2;c++){
+        record->points[c] = CAL[c].points;
+        memcpy(record->point[c], CAL[c].point, sizeof(record->point[c]));
+    }
+    record->checksum = Checksum(row, offsetof(CAL_RECORD, checksum) / sizeof(uint32_t));
+#ifdef HOST_BUILD
+    memcpy(CAL_FLASH, row, sizeof(row));
+    return TRUE;
+#else
+    return Cy_Flash_WriteRow((uint32_t)CAL_FLASH, row) == CY_FLASH_DRV_SUCCESS;
+#endif
+}
+
+
+/*
+Cal_Load:
+Reads the points of both channels back from the flash row and rebuilds their tables. The record is checked and read
+where it is in the row, so no copy of the row is kept. Returns FALSE, leaving the calibration alone, if the row holds
+no record or a damaged one.
+*/
+int Cal_Load(void)
+{
+    const volatile CAL_RECORD *record = (const volatile CAL_RECORD *)CAL_FLASH;
+
+    if(record->magic != CAL_MAGIC || record->checksum != Checksum(CAL_FLASH, offsetof(CAL_RECORD, checksum) / sizeof(uint32_t))
+    || record->points[0] < 0 || record->points[0] > CAL_MAX_POINTS || record->points[1] < 0 || record->points[1] > CAL_MAX_POINTS){
+        return FALSE;
+    }
+    for(int c=0;c<2;c++){
+        CAL[c].points = record->points[c];
+        for(int k=0;k<CAL_MAX_POINTS;k++){
+            CAL[c].point[k].code = record->point[c][k].code;
+            CAL[c].point[k].mv = record->point[c][k].mv;
+        }
+        Cal_Build(c + 1);
+    }
+    return TRUE;
+}
+
+
+/*
+Report:
+Sends the calibration of a channel over the UART: the fitted offset (the correction at code 0) and gain, the
+largest INL correction and each point.
+*/
+static void Report(int channel)
+{
+    CAL_CHANNEL *c = &CAL[channel-1];
+    char line[CAL_LINE_LEN];
+    int32_t worst = 0;
+
+    if(!c->points){
+        sprintf(line,"CH%d not calibrated\n",channel);
+        UART_PutString(line);
+        return;
+    }
+    for(int k=0;k<c->points;k++){
+        int32_t e = c->inl[k] < 0 ? -c->inl[k] : c->inl[k];
+        worst = e > worst ? e : worst;
+    }
+    int32_t offset = Tenths(c->offset);
+    int32_t gain = (int32_t)(((int64_t)c->gain * 10000 + (1 << (CAL_GAIN_BITS - 1))) >> CAL_GAIN_BITS);
+    worst = Tenths(worst);
+    sprintf(line,"CH%d %d points: offset %s%ld.%ld mV, gain %ld.%04ld, INL up to %ld.%ld mV\n",channel,c->points,
+            offset < 0 ? "-" : "",(long)(labs(offset)/10),(long)(labs(offset)%10),(long)(gain/10000),(long)(gain%10000),
+            (long)(worst/10),(long)(worst%10));
+    UART_PutString(line);
+    for(int k=0;k<c->points;k++){
+        int32_t read = Tenths(c->point[k].code);
+        sprintf(line,"  %ld mV read as %ld.%ld mV\n",(long)c->point[k].mv,(long)(read/10),(long)(read%10));
+        UART_PutString(line);
+    }
+}
+
+
+/*
+Cal_Command:
+Handles setcal<1 or 2>_point<mV>, which takes a calibration point from the next block with that reference on the
+channel, and setcal<1 or 2>_clear, which drops the channel's points. cal_save and cal_load write the points to flash
+and read them back, and cal reports both channels. Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Cal_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    if(!strncasecmp(str,"setcal",6)){
+        int channel = str[6] - '0';
+        char *cmd = str + 8;
+        if((channel != CHANNEL_1 && channel != CHANNEL_2) || str[7] != '_'){
+            return FALSE;
+        }
+        CAL_CHANNEL *c = &CAL[channel-1];
+        if(!strncasecmp(cmd,"point",5)){
+            int mv = atoi(cmd + 5);
+            if(cmd[5] < '0' || cmd[5] > '9' || mv > MAX_VOLTAGE){
+                UART_PutString("Invalid reference voltage\n");
+            } else if(!SCOPE->Running){
+                UART_PutString("Start the scope to take a calibration point\n");
+            } else if(c->points == CAL_MAX_POINTS && FindPoint(c, mv) == c->points){   // a point already taken is replaced
+                UART_PutString("No room for another calibration point\n");
+            } else {
+                c->sum = 0;                                                   // Cal_Channels takes it from the next raw samples
+                c->summed = 0;
+                c->pending = mv;
+            }
+        } else if(!strncasecmp(cmd,"clear",5)){
+            c->points = 0;
+            c->pending = CAL_NO_POINT;
+            Cal_Build(channel);
+            UART_PutString("Calibration cleared\n");
+        } else {
+            return FALSE;
+        }
+    } else if(!strncasecmp(str,"cal_save",8)){
+        UART_PutString(Cal_Save() ? "Calibration saved\n" : "Error - calibration not saved\n");
+    } else if(!strncasecmp(str,"cal_load",8)){
+        UART_PutString(Cal_Load() ? "Calibration loaded\n" : "Error - no saved calibration\n");
+    } else if(!strncasecmp(str,"cal",3)){
+        Report(CHANNEL_1);
+        Report(CHANNEL_2);
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
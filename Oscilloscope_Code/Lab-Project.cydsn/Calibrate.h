@@ -0,0 +1,92 @@
+/* ========================================
+ *
+ * Tiny Scope calibration header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the per channel calibration. A known
+ * reference is put on a channel and the mean of a block of its
+ * raw codes is taken as a calibration point. A straight line
+ * fitted through the points gives the offset and gain of the
+ * channel, and what is left at each point is its integral
+ * nonlinearity, interpolated between the points. All three are
+ * folded into a table of the code an ideal ADC would have given
+ * for every sixteenth raw code (so the table is a millivolt
+ * scale, in steps of MAX_VOLTAGE / MAX_ADC_OUTPUT), and each
+ * block is put through it, interpolating between the entries,
+ * as soon as it is in the channel buffer. From then
+ * on the ideal scaling the rest of the scope does (the pixel
+ * formatting, the trigger level, the measurements) is correct
+ * without any of it changing. The points are kept in a flash
+ * row so the calibration survives a restart.
+ *
+ * ========================================
+*/
+
+#ifndef CALIBRATE_H
+#define CALIBRATE_H
+
+/* Includes */
+#include <stdint.h>
+#include <stddef.h>
+
+/* Defines */
+#define CAL_CODES (MAX_ADC_OUTPUT + 1)  // raw codes of the ADC
+#define CAL_STEP_BITS 4           // a correction table entry every 1 << CAL_STEP_BITS raw codes
+#define CAL_ENTRIES ((CAL_CODES >> CAL_STEP_BITS) + 1)  // entries of a correction table, the last one past the top code
+#define CAL_MAX_POINTS 16         // calibration points of each channel
+#define CAL_FRACTION_BITS 4       // fraction bits of the point codes and the fitted line
+#define CAL_GAIN_BITS 16          // fraction bits of the fitted gain
+#define CAL_POINT_SAMPLES SIZE    // raw samples averaged for a point
+#define CAL_NO_POINT -1           // pending when no point is being taken
+#define CAL_ROW_BYTES 512         // a flash row of the PSoC 6, which holds the saved record
+#define CAL_ROW_WORDS (CAL_ROW_BYTES / sizeof(uint32_t))
+#define CAL_MAGIC 0x43414C31      // "CAL1" - marks a row holding a record of this layout
+#define CAL_LINE_LEN 100          // length of one line of the calibration report
+
+/* Structures */
+typedef struct CAL_POINT{
+    int32_t code;                 // the mean raw code the reference read as, with CAL_FRACTION_BITS of fraction
+    int32_t mv;                   // the reference in millivolts
+}CAL_POINT;
+
+typedef struct CAL_CHANNEL{
+    int points;                   // calibration points taken
+    CAL_POINT point[CAL_MAX_POINTS];  // the points in order of code
+    int32_t offset;               // the fitted line: the ideal code at raw code 0, with CAL_FRACTION_BITS of fraction
+    int32_t gain;                 // and ideal codes per raw code, with CAL_GAIN_BITS of fraction
+    int32_t inl[CAL_MAX_POINTS];  // ideal codes left at each point after the line, with CAL_FRACTION_BITS - the INL table
+    int on;                       // TRUE when the table is not the identity
+    int pending;                  // millivolts of the reference a point is being taken of, or CAL_NO_POINT
+    int32_t sum;                  // raw codes summed for the pending point
+    int summed;                   // samples summed for it
+    int32_t lut[CAL_ENTRIES];     // the ideal code of every entry's raw code with CAL_FRACTION_BITS of fraction, everything folded in
+}CAL_CHANNEL;
+
+typedef struct CAL_RECORD{        // what is saved in the flash row
+    uint32_t magic;               // CAL_MAGIC
+    int32_t points[2];            // the points of each channel
+    CAL_POINT point[2][CAL_MAX_POINTS];
+    uint32_t checksum;            // of the words before it
+}CAL_RECORD;
+
+/* Globals */
+extern CAL_CHANNEL CAL[2];
+
+/* Function prototypes */
+void Cal_Build(int channel);
+
+int Cal_AddPoint(int channel, int32_t code, int32_t mv);
+
+void Cal_Correct(const CAL_CHANNEL *c, uint16_t arr[], int count);
+
+void Cal_Channels(uint16_t ch1[], uint16_t ch2[], int count);
+
+int Cal_Save(void);
+
+int Cal_Load(void);
+
+int Cal_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* CALIBRATE_H */
@@ -0,0 +1,430 @@
+/* ========================================
+ *
+ * Tiny Scope cross-correlation definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the fixed point FFT and its twiddle steps,
+ * the direct and FFT cross-correlations, the peak search and
+ * interpolation, the measurement every few blocks and the
+ * setxcorr_ and xcorr commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the delay and phase measurement */
+CROSS_CORR XCORR = {FALSE, XCORR_MAX_LAG, XCORR_DEFAULT_INTERVAL, 0, FALSE, FALSE, 0, 0, FALSE, 0, 0};
+
+/* the wave structure from main_cm4.c, for the channel 1 frequency */
+extern WAVEFORM_DATA WAVE;
+
+/* the FFT buffers - channel 1 goes in as the real part and channel 2 as the imaginary part. They are borrowed from
+the capture memory, which the capture modes give up while the measurement is on */
+static int32_t * const RE = (int32_t *)ACQ_Pool;
+static int32_t * const IM = (int32_t *)ACQ_Pool + XCORR_FFT_SIZE;
+_Static_assert(ACQ_POOL_MIN * sizeof(uint16_t) >= XCORR_POOL_BYTES, "the FFT buffers fit in the capture memory");
+
+/* the correlation at each lag of a direct sum */
+static int64_t DIRECT[2 * XCORR_DIRECT_LAGS + 1];
+
+/* the cosine and sine of 2 pi / len with XCORR_TWIDDLE_BITS fraction bits, for each stage len of the FFT from 2 up -
+the twiddle factors of a stage are worked out by turning a vector round by this step */
+static const int32_t STEP[XCORR_FFT_BITS][2] = {
+    {-1073741824, 0},
+    {0, 1073741824},
+    {759250125, 759250125},
+    {992008094, 410903207},
+    {1053110176, 209476638},
+    {1068571464, 105245103},
+    {1072448455, 52686014},
+    {1073418433, 26350943},
+    {1073660973, 13176464},
+    {1073721611, 6588356},
+    {1073736771, 3294193},
+    {1073740561, 1647099},
+};
+
+/* the measurement in progress - the channels, their means and the sums of the centered samples and their squares */
+static const uint16_t *Ch1;
+static const uint16_t *Ch2;
+static int Count;
+static int32_t Mean1, Mean2;
+static int64_t SumX, SquaresX, SumY, SquaresY;
+static int SpectrumShift;                                                    // the cross spectrum was divided by 1 << SpectrumShift
+
+
+/*
+Fft:
+An in place radix 2 FFT of RE and IM, or the inverse FFT if inverse is TRUE. Neither is scaled - the callers keep
+the input small enough for the gain of XCORR_FFT_SIZE.
+*/
+static void Fft(int inverse)
+{
+    for(int i=1,j=0;i<XCORR_FFT_SIZE;i++){                                   // bit reversed order first
+        int bit = XCORR_FFT_SIZE >> 1;
+        for(;j & bit;bit >>= 1){
+            j ^= bit;
+        }
+        j ^= bit;
+        if(i < j){
+            int32_t t = RE[i]; RE[i] = RE[j]; RE[j] = t;
+            t = IM[i]; IM[i] = IM[j]; IM[j] = t;
+        }
+    }
+    for(int stage=0,len=2;len<=XCORR_FFT_SIZE;stage++,len<<=1){
+        int half = len / 2;
+        int32_t stepR = STEP[stage][0];
+        int32_t stepI = inverse ? STEP[stage][1] : -STEP[stage][1];             // the forward transform turns the other way
+        int32_t wr = 1 << XCORR_TWIDDLE_BITS;
+        int32_t wi = 0;
+        for(int k=0;k<half;k++){
+            for(int a=k;a<XCORR_FFT_SIZE;a+=len){
+                int b = a + half;
+                int32_t tr = (int32_t)(((int64_t)wr * RE[b] - (int64_t)wi * IM[b] + XCORR_ROUND) >> XCORR_TWIDDLE_BITS);
+                int32_t ti = (int32_t)(((int64_t)wr * IM[b] + (int64_t)wi * RE[b] + XCORR_ROUND) >> XCORR_TWIDDLE_BITS);
+                RE[b] = RE[a] - tr;
+                IM[b] = IM[a] - ti;
+                RE[a] += tr;
+                IM[a] += ti;
+            }
+            int32_t next = (int32_t)(((int64_t)wr * stepR - (int64_t)wi * stepI + XCORR_ROUND) >> XCORR_TWIDDLE_BITS);
+            wi = (int32_t)(((int64_t)wi * stepR + (int64_t)wr * stepI + XCORR_ROUND) >> XCORR_TWIDDLE_BITS);
+            wr = next;
+        }
+    }
+}
+
+
+/*
+CrossBin:
+Returns bin k of the cross spectrum, conj(X) times Y, where X and Y are the spectra of the real and imaginary parts
+that went through the FFT together. Both are taken out of bins k and -k of the FFT at twice their size.
+*/
+static void CrossBin(int k, int64_t *pr, int64_t *pi)
+{
+    int m = (XCORR_FFT_SIZE - k) & (XCORR_FFT_SIZE - 1);
+    int64_t xr = (int64_t)RE[k] + RE[m];
+    int64_t xi = (int64_t)IM[k] - IM[m];
+    int64_t yr = (int64_t)IM[k] + IM[m];
+    int64_t yi = (int64_t)RE[m] - RE[k];
+
+    *pr = xr * yr + xi * yi;
+    *pi = xr * yi - xi * yr;
+}
+
+
+/*
+FftCorrelate:
+Leaves the circular cross-correlation of the real and imaginary parts in RE. The cross spectrum is scaled down by
+the power of two that keeps the sum of the sizes of its bins below XCORR_SPECTRUM_BITS - no value of the inverse
+FFT can be larger than that sum, so it cannot overflow, and a spectrum with its power in a few bins (a sine) keeps
+as many bits as one spread over many. Since it belongs to two real signals bin -k is the conjugate of bin k and only
+half of it is worked out.
+*/
+static void FftCorrelate(void)
+{
+    int64_t total = 0;
+    int shift = 0;
+
+    Fft(FALSE);
+    for(int k=0;k<=XCORR_FFT_SIZE/2;k++){
+        int64_t pr, pi;
+        CrossBin(k, &pr, &pi);
+        int64_t size = (pr < 0 ? -pr : pr) + (pi < 0 ? -pi : pi);
+        total += (k == 0 || k == XCORR_FFT_SIZE/2) ? size : 2 * size;      // the other bins stand for their conjugates too
+    }
+    while((total >> shift) >= ((int64_t)1 << XCORR_SPECTRUM_BITS)){
+        shift++;
+    }
+    SpectrumShift = shift;
+    int64_t half = shift ? (int64_t)1 << (shift - 1) : 0;                 // so the bins are rounded rather than cut
+    for(int k=0;k<=XCORR_FFT_SIZE/2;k++){                                   // bins k and -k are only read before either is written
+        int m = (XCORR_FFT_SIZE - k) & (XCORR_FFT_SIZE - 1);
+        int64_t pr, pi;
+        CrossBin(k, &pr, &pi);
+        RE[k] = (int32_t)((pr + half) >> shift);
+        IM[k] = (int32_t)((pi + half) >> shift);
+        RE[m] = RE[k];
+        IM[m] = -IM[k];
+    }
+    Fft(TRUE);
+}
+
+
+/*
+DirectCorrelate:
+Sums the cross-correlation of the real and imaginary parts at each lag of the window into DIRECT, over the
+samples the two overlap at that lag.
+*/
+static void DirectCorrelate(int count, int maxLag)
+{
+    for(int t=-maxLag;t<=maxLag;t++){
+        int64_t sum = 0;
+        int first = t < 0 ? -t : 0;
+        int last = t > 0 ? count - t : count;
+        for(int n=first;n<last;n++){
+            sum += (int64_t)RE[n] * IM[n + t];
+        }
+        DIRECT[t + XCORR_DIRECT_LAGS] = sum;
+    }
+}
+
+
+/*
+Lag:
+Returns the correlation of the centered channels at lag t from whichever correlation the measurement used, in
+codes squared. The FFT result is scaled back up by the shift the cross spectrum was given, less the gain of the
+inverse FFT and of the doubled spectra.
+*/
+static int64_t Lag(int t)
+{
+    int s = SpectrumShift - (XCORR_FFT_BITS + 2);
+
+    if(XCORR.direct){
+        return DIRECT[t + XCORR_DIRECT_LAGS];
+    }
+    return s >= 0 ? (int64_t)RE[t & (XCORR_FFT_SIZE - 1)] * ((int64_t)1 << s) : RE[t & (XCORR_FFT_SIZE - 1)] >> -s;
+}
+
+
+/*
+EndSums:
+Adds the centered samples from first up to (not including) last, and their squares, onto *sum and *squares.
+*/
+static void EndSums(const uint16_t arr[], int32_t mean, int first, int last, int64_t *sum, int64_t *squares)
+{
+    for(int n=first;n<last;n++){
+        int64_t v = ((arr[n] & UNDERFLOW_CHECK) ? 0 : arr[n]) - mean;
+        *sum += v;
+        *squares += v * v;
+    }
+}
+
+
+/*
+Root:
+Returns the integer square root of v.
+*/
+static int64_t Root(int64_t v)
+{
+    int64_t r = 0;
+
+    for(int64_t bit = (int64_t)1 << 62;bit;bit >>= 2){
+        if(v >= r + bit){
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+    }
+    return r;
+}
+
+
+/*
+Normalized:
+Returns the normalized correlation at lag t in 1/(1 << XCORR_NCC_BITS): the covariance of the samples of the two
+channels that overlap at that lag over the square root of the product of their variances. It is 1 where channel 2
+is a copy of channel 1 however little of a period the block holds, so the peak is not pulled about by the ends of
+the block the way the plain correlation's is. The overlap's sums are the whole block's less the samples left off
+each end.
+*/
+static int64_t Normalized(int t)
+{
+    int count = Count;
+    int span = t < 0 ? -t : t;
+    int64_t left = count - span;                                             // samples that overlap
+    int64_t sx = SumX, sxx = SquaresX, sy = SumY, syy = SquaresY;
+    int64_t ex = 0, exx = 0, ey = 0, eyy = 0;
+
+    EndSums(Ch1, Mean1, t < 0 ? 0 : count - span, t < 0 ? span : count, &ex, &exx);
+    EndSums(Ch2, Mean2, t > 0 ? 0 : count - span, t > 0 ? span : count, &ey, &eyy);
+    sx -= ex; sxx -= exx;
+    sy -= ey; syy -= eyy;
+
+    int64_t cov = Lag(t) - sx * sy / left;
+    int64_t vx = sxx - sx * sx / left;
+    int64_t vy = syy - sy * sy / left;
+    if(vx <= 0 || vy <= 0){
+        return 0;
+    }
+    int64_t c = cov * ((int64_t)1 << XCORR_NCC_BITS) / Root(vx << XCORR_NCC_BITS);        // divided by each root in turn
+    return c * ((int64_t)1 << XCORR_NCC_BITS) / Root(vy << XCORR_NCC_BITS);                // so nothing overflows
+}
+
+
+/*
+Xcorr_Measure:
+Measures the delay of ch2 behind ch1 over count samples of each (at most a block), searching lags within the
+window either way. The lag with the highest correlation is found first, so a periodic signal gives the peak nearest
+zero, then moved to the top of the normalized correlation and interpolated. Fills in the delay and returns TRUE, or
+returns FALSE if there was no positive peak (a flat channel, for one).
+*/
+int Xcorr_Measure(const uint16_t ch1[], const uint16_t ch2[], int count)
+{
+    int maxLag = XCORR.maxLag < count ? XCORR.maxLag : count - 1;
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+    int best = -maxLag;
+    int32_t fraction = 0;
+
+    for(int n=0;n<count;n++){
+        sum1 += (ch1[n] & UNDERFLOW_CHECK) ? 0 : ch1[n];
+        sum2 += (ch2[n] & UNDERFLOW_CHECK) ? 0 : ch2[n];
+    }
+    Ch1 = ch1;
+    Ch2 = ch2;
+    Count = count;
+    Mean1 = (int32_t)(sum1 / count);
+    Mean2 = (int32_t)(sum2 / count);
+    SumX = SquaresX = SumY = SquaresY = 0;
+    EndSums(ch1, Mean1, 0, count, &SumX, &SquaresX);
+    EndSums(ch2, Mean2, 0, count, &SumY, &SquaresY);
+    for(int n=0;n<count;n++){                                                // the means are taken off so only the signals correlate
+        RE[n] = ((ch1[n] & UNDERFLOW_CHECK) ? 0 : ch1[n]) - Mean1;
+        IM[n] = ((ch2[n] & UNDERFLOW_CHECK) ? 0 : ch2[n]) - Mean2;
+    }
+    memset(RE + count, 0, (XCORR_FFT_SIZE - count) * sizeof(int32_t));
+    memset(IM + count, 0, (XCORR_FFT_SIZE - count) * sizeof(int32_t));
+
+    XCORR.direct = maxLag <= XCORR_DIRECT_LAGS && (2 * maxLag + 1) * count <= XCORR_DIRECT_BUDGET;
+    if(XCORR.direct){
+        DirectCorrelate(count, maxLag);
+    } else {
+        FftCorrelate();
+    }
+
+    for(int t=-maxLag+1;t<=maxLag;t++){
+        if(Lag(t) > Lag(best)){
+            best = t;
+        }
+    }
+    if(Lag(best) <= 0){
+        XCORR.valid = FALSE;
+        return FALSE;
+    }
+    int64_t b = Normalized(best);
+    for(int steps=0;steps<XCORR_MAX_CLIMB && best > -maxLag;steps++){       // climbing to the top of the normalized peak
+        int64_t a = Normalized(best - 1);
+        if(a <= b){
+            break;
+        }
+        best--;
+        b = a;
+    }
+    for(int steps=0;steps<XCORR_MAX_CLIMB && best < maxLag;steps++){
+        int64_t c = Normalized(best + 1);
+        if(c <= b){
+            break;
+        }
+        best++;
+        b = c;
+    }
+    if(best > -maxLag && best < maxLag){                                     // a peak at the edge of the window is not interpolated
+        int64_t a = Normalized(best - 1);
+        int64_t c = Normalized(best + 1);
+        int64_t curve = a - 2 * b + c;
+        if(curve < 0){
+            fraction = (int32_t)((a - c) * (1 << XCORR_FRACTION_BITS) / (2 * curve));
+        }
+    }
+    XCORR.delay = best * (1 << XCORR_FRACTION_BITS) + fraction;
+    XCORR.delayNs = (int32_t)((int64_t)XCORR.delay * 1000000000 / ((int64_t)SAMPLING_RATE << XCORR_FRACTION_BITS));
+    XCORR.valid = TRUE;
+    return TRUE;
+}
+
+
+/*
+Xcorr_Block:
+Called with every block while the measurement is on. Measures the delay once every interval blocks and works out
+the phase from it if channel 1 has a frequency.
+*/
+void Xcorr_Block(const uint16_t ch1[], const uint16_t ch2[])
+{
+    if(++XCORR.blocks < XCORR.interval){
+        return;
+    }
+    XCORR.blocks = 0;
+    PROFILE_BEGIN(PROF_XCORR);
+    int measured = Xcorr_Measure(ch1, ch2, SIZE);
+    XCORR.phaseValid = measured && WAVE.Freq1 > ERROR;
+    if(measured){
+        Meas_Add(MEAS_DELAY, XCORR.delayNs);
+    }
+    if(XCORR.phaseValid){
+        int64_t phase = (int64_t)XCORR.delay * WAVE.Freq1 * 3600 / ((int64_t)SAMPLING_RATE << XCORR_FRACTION_BITS) % 3600;
+        if(phase >= 1800){
+            phase -= 3600;                                                    // wrapped to half a turn either way
+        } else if(phase < -1800){
+            phase += 3600;
+        }
+        XCORR.phase = (int32_t)phase;
+        Meas_Add(MEAS_PHASE, XCORR.phase);
+    }
+    XCORR.measurements++;
+    PROFILE_END(PROF_XCORR);
+}
+
+
+/*
+Xcorr_Command:
+Handles setxcorr_on, setxcorr_off, setxcorr_lag<samples> and setxcorr_interval<blocks>, and xcorr, which reports
+the settings and the last measurement. Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Xcorr_Command(char str[])
+{
+    char line[XCORR_LINE_LEN];
+    int32_t delay = XCORR.delay < 0 ? -XCORR.delay : XCORR.delay;
+    int32_t phase = XCORR.phase < 0 ? -XCORR.phase : XCORR.phase;
+
+    if(!strncasecmp(str,"setxcorr_on",11)){
+        XCORR.on = TRUE;
+        SEGMENTS.on = FALSE;                                                 // the FFT buffers take over the capture memory
+        DEEP.on = FALSE;
+        LOGIC.on = FALSE;
+        ETS.on = FALSE;
+        Xy_Off();
+        XCORR.blocks = 0;
+        XCORR.valid = FALSE;
+        XCORR.phaseValid = FALSE;
+        XCORR.measurements = 0;
+    } else if(!strncasecmp(str,"setxcorr_off",12)){
+        XCORR.on = FALSE;
+    } else if(!strncasecmp(str,"setxcorr_lag",12)){
+        int lag = atoi(str + 12);
+        if(lag < 1 || lag > XCORR_MAX_LAG){
+            UART_PutString("Invalid correlation window\n");
+            return TRUE;
+        }
+        XCORR.maxLag = lag;
+    } else if(!strncasecmp(str,"setxcorr_interval",17)){
+        int interval = atoi(str + 17);
+        if(interval < 1 || interval > XCORR_MAX_INTERVAL){
+            UART_PutString("Invalid correlation interval\n");
+            return TRUE;
+        }
+        XCORR.interval = interval;
+    } else if(strncasecmp(str,"xcorr",5)){
+        return FALSE;
+    }
+    sprintf(line,"Cross-correlation %s, window %d samples, every %d blocks, %lu measurements\n",XCORR.on ? "on" : "off",
+            XCORR.maxLag,XCORR.interval,(unsigned long)XCORR.measurements);
+    UART_PutString(line);
+    if(XCORR.valid){
+        sprintf(line,"CH2 behind CH1 by %ld ns (%s%ld.%02ld samples, %s)",(long)XCORR.delayNs,XCORR.delay < 0 ? "-" : "",
+                (long)(delay >> XCORR_FRACTION_BITS),(long)(((delay & ((1 << XCORR_FRACTION_BITS) - 1)) * 100) >> XCORR_FRACTION_BITS),
+                XCORR.direct ? "direct" : "FFT");
+        UART_PutString(line);
+        if(XCORR.phaseValid){
+            sprintf(line,", phase %s%ld.%ld deg",XCORR.phase < 0 ? "-" : "",(long)(phase / 10),(long)(phase % 10));
+            UART_PutString(line);
+        }
+        UART_PutString("\n");
+    }
+    return TRUE;
+}
@@ -0,0 +1,76 @@
+/* ========================================
+ *
+ * Tiny Scope cross-correlation header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the delay and phase measurement between
+ * the two channels. Every few blocks the channels (with their
+ * means taken off) are cross-correlated over the block and the
+ * lag of the highest peak within the search window is the delay
+ * of channel 2 behind channel 1. A parabola through the peak
+ * and its two neighbours gives the delay to a fraction of a
+ * sample, and the phase is the delay times the channel 1
+ * frequency. For a small window the correlation is summed
+ * directly; otherwise both channels go through one fixed point
+ * FFT as the real and imaginary parts, the cross spectrum is
+ * formed and transformed back, so the cost of a measurement is
+ * the same whatever the window and the signals. Measuring only
+ * every few blocks keeps the cost per block bounded. The FFT
+ * works in the capture memory, so the measurement and the
+ * capture modes that record into it are not on together.
+ *
+ * ========================================
+*/
+
+#ifndef CORRELATE_H
+#define CORRELATE_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define XCORR_FFT_BITS 12                                  // the FFT is 4096 points
+#define XCORR_FFT_SIZE (1 << XCORR_FFT_BITS)               // room for a block and the largest lag without the ends wrapping onto each other
+#define XCORR_MAX_LAG (XCORR_FFT_SIZE - SIZE)              // largest delay searched either way, in samples
+#define XCORR_POOL_BYTES (2 * XCORR_FFT_SIZE * sizeof(int32_t))  // capture memory the FFT buffers borrow
+#define XCORR_DIRECT_LAGS 32      // largest window that can be summed directly
+#define XCORR_DIRECT_BUDGET (4 * XCORR_FFT_SIZE * XCORR_FFT_BITS)  // multiplies of the two FFTs, the most a direct sum may take
+#define XCORR_TWIDDLE_BITS 30     // fraction bits of the FFT twiddle factors
+#define XCORR_ROUND ((int64_t)1 << (XCORR_TWIDDLE_BITS - 1))  // added before a twiddle product is shifted down so it rounds
+#define XCORR_SPECTRUM_BITS 30    // the bins of the cross spectrum are scaled to add up below this so the inverse FFT cannot overflow
+#define XCORR_NCC_BITS 24         // fraction bits of the normalized correlation
+#define XCORR_MAX_CLIMB 64        // most lags the peak is moved from the highest plain correlation
+#define XCORR_FRACTION_BITS 8     // fraction bits of the delay in samples
+#define XCORR_DEFAULT_INTERVAL 8  // blocks between measurements by default
+#define XCORR_MAX_INTERVAL 1000   // most blocks between measurements
+#define XCORR_MARGIN 40           // distance of the on-screen delay and phase from the bottom of the screen
+#define XCORR_LINE_LEN 120        // length of one line of the correlation report
+
+/* Structures */
+typedef struct CROSS_CORR{
+    int on;                       // TRUE while the delay and phase are measured
+    int maxLag;                   // the search window either way, in samples
+    int interval;                 // blocks between measurements
+    int blocks;                   // blocks since the last measurement
+    int valid;                    // TRUE if the last measurement found a peak
+    int direct;                   // TRUE if the last measurement was summed directly rather than by FFT
+    int32_t delay;                // delay of channel 2 behind channel 1 in 1/(1 << XCORR_FRACTION_BITS) samples
+    int32_t delayNs;              // the same delay in ns
+    int phaseValid;               // TRUE if channel 1 had a frequency to work out the phase from
+    int32_t phase;                // phase of channel 2 behind channel 1 in tenths of a degree, -1800 to 1799
+    uint32_t measurements;        // measurements since the mode was turned on
+}CROSS_CORR;
+
+/* Globals */
+extern CROSS_CORR XCORR;
+
+/* Function prototypes */
+int Xcorr_Measure(const uint16_t ch1[], const uint16_t ch2[], int count);
+
+void Xcorr_Block(const uint16_t ch1[], const uint16_t ch2[]);
+
+int Xcorr_Command(char str[]);
+
+#endif /* CORRELATE_H */
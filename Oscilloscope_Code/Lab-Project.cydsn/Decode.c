@@ -0,0 +1,436 @@
+/* ========================================
+ *
+ * Tiny Scope protocol decode definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the edge extraction, the UART, I2C and SPI
+ * decoders, the event ring with its streaming and drawing, and
+ * the setdec_ and dec commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the decoder */
+DECODER DECODE = {DEC_OFF, DEC_DEFAULT_BAUD, FALSE, MILLIVOLTS_TO_CODE(DEC_DEFAULT_LEVEL), FALSE, FALSE, {0, 0}, 0, FALSE, 0, 0, FALSE,
+                  0, 0, 0, 0, 0, 0, 0, {{0}}};
+
+/* the edges of each channel in the chunk of the block being decoded */
+static uint16_t EDGES[2][DEC_CHUNK];
+
+/* the buffer each channel decoded last, so one that has not been refilled is not decoded twice */
+static const uint16_t *LastDecoded[2];
+
+/* UART bit time in samples with DEC_BIT_BITS of fraction */
+static uint32_t BitTime;
+
+
+/*
+Dec_Edges:
+Thresholds count samples with hysteresis around level and writes the index of each sample where the level changes
+to edges. state is the level before the first sample (TRUE for high) and is left at the level after the last.
+Returns the number of edges.
+*/
+int Dec_Edges(const uint16_t arr[], int count, int level, int *state, uint16_t edges[])
+{
+    int n = 0;
+    int s = *state;
+    int threshold = s ? level - DEC_HYSTERESIS : level + DEC_HYSTERESIS;     // the level the next edge crosses
+
+    for(int i=0;i<count;i++){
+        int v = (arr[i] & UNDERFLOW_CHECK) ? 0 : arr[i];
+        if(s ? v < threshold : v > threshold){
+            edges[n++] = i;
+            s = !s;
+            threshold = s ? level - DEC_HYSTERESIS : level + DEC_HYSTERESIS;
+        }
+    }
+    *state = s;
+    return n;
+}
+
+
+/*
+Dec_Reset:
+Clears the decoder state and the events. Called when the scope is started and when the settings change.
+*/
+void Dec_Reset(void)
+{
+    DECODE.primed = FALSE;
+    DECODE.active = FALSE;
+    DECODE.bits = 0;
+    DECODE.shift = 0;
+    DECODE.time = 0;
+    DECODE.head = 0;
+    DECODE.streamed = 0;
+    DECODE.errors = 0;
+    DECODE.dropped = 0;
+    DECODE.frameTime = 0;
+    LastDecoded[0] = NULL;
+    LastDecoded[1] = NULL;
+    BitTime = ((uint32_t)SAMPLING_RATE << DEC_BIT_BITS) / DECODE.baud;
+}
+
+
+/*
+Emit:
+Adds an event to the ring.
+*/
+static void Emit(uint32_t time, int kind, uint32_t value, int flags)
+{
+    DEC_EVENT *e = &DECODE.ring[DECODE.head & (DEC_RING_SIZE - 1)];
+
+    e->time = time;
+    e->kind = kind;
+    e->value = value;
+    e->flags = flags;
+    DECODE.head++;
+    if(flags & DEC_FLAG_ERROR){
+        DECODE.errors++;
+    }
+}
+
+
+/*
+UartAdvance:
+Reads the bits of the UART frame in progress whose middles come before the sample upTo - the line holds its level
+until the next edge. A start bit that is high again by its middle was a glitch and ends the frame; the stop bit
+ends it with the byte, flagged if the stop bit was low.
+*/
+static void UartAdvance(uint32_t upTo)
+{
+    while(DECODE.active){
+        uint32_t at = DECODE.frameStart + (((2 * DECODE.bits + 1) * BitTime) >> (DEC_BIT_BITS + 1));
+        if((int32_t)(at - upTo) >= 0){
+            return;
+        }
+        int bit = DECODE.line[0];
+        if(DECODE.bits == 0 && bit){
+            DECODE.active = FALSE;
+        } else if(DECODE.bits == 9){
+            Emit(DECODE.frameStart, DEC_EV_BYTE, DECODE.shift, bit ? 0 : DEC_FLAG_ERROR);
+            DECODE.active = FALSE;
+        } else if(DECODE.bits > 0){
+            DECODE.shift |= bit << (DECODE.bits - 1);                         // LSB first
+        }
+        DECODE.bits++;
+    }
+}
+
+
+/*
+UartEdge:
+A falling edge on an idle line starts a frame.
+*/
+static void UartEdge(int channel, uint32_t t)
+{
+    if(channel == 0 && !DECODE.active && !DECODE.line[0]){
+        DECODE.active = TRUE;
+        DECODE.frameStart = t;
+        DECODE.bits = 0;
+        DECODE.shift = 0;
+    }
+}
+
+
+/*
+I2cEdge:
+SDA falling while SCL is high is a start and SDA rising a stop. Inside a transfer each rising SCL edge reads a bit
+of SDA: eight make a byte and the ninth is its ACK (low) or NACK. The first byte after a start is the address.
+*/
+static void I2cEdge(int channel, uint32_t t)
+{
+    if(channel == 1 && DECODE.line[0]){
+        if(!DECODE.line[1]){
+            Emit(t, DEC_EV_START, 0, 0);
+            DECODE.active = TRUE;
+            DECODE.address = TRUE;
+            DECODE.bits = 0;
+            DECODE.shift = 0;
+        } else if(DECODE.active){
+            Emit(t, DEC_EV_STOP, 0, 0);
+            DECODE.active = FALSE;
+        }
+    } else if(channel == 0 && DECODE.line[0] && DECODE.active){
+        if(DECODE.bits == 0){
+            DECODE.frameStart = t;
+        }
+        if(DECODE.bits < 8){
+            DECODE.shift = (DECODE.shift << 1) | DECODE.line[1];             // MSB first
+            DECODE.bits++;
+            return;
+        }
+        int flags = DECODE.line[1] ? DEC_FLAG_ERROR : 0;
+        if(DECODE.address){
+            Emit(DECODE.frameStart, DEC_EV_ADDRESS, DECODE.shift >> 1, flags | ((DECODE.shift & 1) ? DEC_FLAG_READ : 0));
+        } else {
+            Emit(DECODE.frameStart, DEC_EV_DATA, DECODE.shift, flags);
+        }
+        DECODE.address = FALSE;
+        DECODE.bits = 0;
+        DECODE.shift = 0;
+    }
+}
+
+
+/*
+SpiEdge:
+Each sampling clock edge reads a bit of the data, MSB first. A gap of DEC_SPI_GAP samples since the last clock edge
+drops a partial byte, since with no chip select that is the only way to find the byte boundaries again.
+*/
+static void SpiEdge(int channel, uint32_t t)
+{
+    if(channel != 0 || DECODE.line[0] == DECODE.spiFalling){
+        return;
+    }
+    if(t - DECODE.lastClock > DEC_SPI_GAP){
+        DECODE.bits = 0;
+        DECODE.shift = 0;
+    }
+    DECODE.lastClock = t;
+    if(DECODE.bits == 0){
+        DECODE.frameStart = t;
+    }
+    DECODE.shift = (DECODE.shift << 1) | DECODE.line[1];
+    if(++DECODE.bits == 8){
+        Emit(DECODE.frameStart, DEC_EV_BYTE, DECODE.shift, 0);
+        DECODE.bits = 0;
+        DECODE.shift = 0;
+    }
+}
+
+
+/*
+Label:
+Writes the text of an event: a byte in hex (with ! after a framing error), S and P for an I2C start and stop, an
+address with W or R after it, and - after an I2C byte that was not acknowledged.
+*/
+static void Label(const DEC_EVENT *e, char text[])
+{
+    const char *mark = "";
+
+    if(e->flags & DEC_FLAG_ERROR){
+        mark = e->kind == DEC_EV_BYTE ? "!" : "-";
+    }
+    if(e->kind == DEC_EV_START){
+        sprintf(text,"S");
+    } else if(e->kind == DEC_EV_STOP){
+        sprintf(text,"P");
+    } else if(e->kind == DEC_EV_ADDRESS){
+        sprintf(text,"%02X%c%s",e->value,(e->flags & DEC_FLAG_READ) ? 'R' : 'W',mark);
+    } else {
+        sprintf(text,"%02X%s",e->value,mark);
+    }
+}
+
+
+/*
+Stream:
+Sends up to DEC_STREAM_PER_BLOCK of the events not yet streamed over the UART, each as its sample number and label.
+Events the ring has overwritten are counted as dropped.
+*/
+static void Stream(void)
+{
+    char line[DEC_LINE_LEN];
+    char text[DEC_LABEL_LEN];
+
+    if(DECODE.head - DECODE.streamed > DEC_RING_SIZE){
+        DECODE.dropped += DECODE.head - DECODE.streamed - DEC_RING_SIZE;
+        DECODE.streamed = DECODE.head - DEC_RING_SIZE;
+    }
+    for(int k=0;k<DEC_STREAM_PER_BLOCK && DECODE.streamed != DECODE.head;k++){
+        const DEC_EVENT *e = &DECODE.ring[DECODE.streamed & (DEC_RING_SIZE - 1)];
+        Label(e, text);
+        sprintf(line,"dec %lu %s\n",(unsigned long)e->time,text);
+        UART_PutString(line);
+        DECODE.streamed++;
+    }
+}
+
+
+/*
+Dec_Run:
+Decodes the newest count samples of both channels, DEC_CHUNK samples at a time. Each channel's chunk is turned into
+its list of edges, then the edges of both are walked in time order (channel 1 first at the same sample): the UART frame is read up to each edge with
+the level before it, the level changes and the protocol acts on the edge. A buffer that is the same as last time
+(channel 2 has not finished its next block yet) can't be decoded, so the protocol starts over after it.
+*/
+void Dec_Run(uint16_t ch1[], uint16_t ch2[], int count)
+{
+    int n[2] = {0, 0};
+    int next[2] = {0, 0};
+
+    if(DECODE.protocol == DEC_OFF){
+        return;
+    }
+    PROFILE_BEGIN(PROF_DECODE);
+    if(ch1 == LastDecoded[0] || ch2 == LastDecoded[1]){
+        DECODE.active = FALSE;
+        DECODE.bits = 0;
+        DECODE.time += count;
+        PROFILE_END(PROF_DECODE);
+        return;
+    }
+    LastDecoded[0] = ch1;
+    LastDecoded[1] = ch2;
+    if(!DECODE.primed){
+        DECODE.line[0] = ((ch1[0] & UNDERFLOW_CHECK) ? 0 : ch1[0]) > DECODE.level;
+        DECODE.line[1] = ((ch2[0] & UNDERFLOW_CHECK) ? 0 : ch2[0]) > DECODE.level;
+        DECODE.primed = TRUE;
+    }
+
+    int end[2] = {DECODE.line[0], DECODE.line[1]};                          // the edge lists leave these at the levels after each chunk
+    for(int from=0;from<count;from+=DEC_CHUNK){
+        int size = count - from < DEC_CHUNK ? count - from : DEC_CHUNK;
+        n[0] = Dec_Edges(ch1 + from, size, DECODE.level, &end[0], EDGES[0]);
+        if(DECODE.protocol != DEC_UART){
+            n[1] = Dec_Edges(ch2 + from, size, DECODE.level, &end[1], EDGES[1]);
+        }
+        next[0] = 0;
+        next[1] = 0;
+        while(next[0] < n[0] || next[1] < n[1]){
+            int c = (next[1] >= n[1] || (next[0] < n[0] && EDGES[0][next[0]] <= EDGES[1][next[1]])) ? 0 : 1;
+            uint32_t t = DECODE.time + from + EDGES[c][next[c]++];
+            if(DECODE.protocol == DEC_UART){
+                UartAdvance(t);
+            }
+            DECODE.line[c] = !DECODE.line[c];
+            if(DECODE.protocol == DEC_UART){
+                UartEdge(c, t);
+            } else if(DECODE.protocol == DEC_I2C){
+                I2cEdge(c, t);
+            } else {
+                SpiEdge(c, t);
+            }
+        }
+    }
+    DECODE.time += count;
+    if(DECODE.protocol == DEC_UART){
+        UartAdvance(DECODE.time);
+    }
+    PROFILE_END(PROF_DECODE);
+
+    if(DECODE.stream){
+        Stream();
+    }
+}
+
+
+/*
+Dec_FrameStart:
+Called when a frame starts: its first pixel is the sample samplesAgo before the next one to be decoded.
+*/
+void Dec_FrameStart(uint32_t samplesAgo)
+{
+    DECODE.frameTime = DECODE.time - samplesAgo;
+}
+
+
+/*
+Dec_Draw:
+Blanks the labels drawn last time and draws the label of each event inside the frame under the waveforms, at the
+pixel of the sample it began at. A label that would run into the one before it is left out.
+*/
+void Dec_Draw(SCOPE_SETTINGS SCOPE)
+{
+    static int drawnX[DEC_MAX_LABELS];                                       // where the labels on screen are and how long they are
+    static int drawnLen[DEC_MAX_LABELS];
+    static int drawn = 0;
+    uint32_t span = X_PIXELS * SCOPE.xScale / INDEX_DIVISOR;                 // samples in the frame
+    uint32_t first = DECODE.head > DEC_RING_SIZE ? DECODE.head - DEC_RING_SIZE : 0;
+    char text[DEC_LABEL_LEN];
+    int nextX = 0;
+
+    for(int k=0;k<drawn;k++){
+        sprintf(text,"%*s",drawnLen[k],"");
+        GUI_DispStringAt(text,drawnX[k],Y_PIXELS-DEC_MARGIN);
+    }
+    drawn = 0;
+    GUI_SetColor(GUI_WHITE);
+    for(uint32_t k=first;k!=DECODE.head && drawn<DEC_MAX_LABELS;k++){
+        const DEC_EVENT *e = &DECODE.ring[k & (DEC_RING_SIZE - 1)];
+        uint32_t dt = e->time - DECODE.frameTime;                            // events before the frame wrap round to large
+        if(dt >= span){
+            continue;
+        }
+        int x = dt * INDEX_DIVISOR / SCOPE.xScale;
+        if(x < nextX){
+            continue;
+        }
+        Label(e, text);
+        GUI_DispStringAt(text,x,Y_PIXELS-DEC_MARGIN);
+        drawnX[drawn] = x;
+        drawnLen[drawn] = strlen(text);
+        drawn++;
+        nextX = x + DEC_LABEL_WIDTH;
+    }
+}
+
+
+/*
+Dec_Command:
+Handles setdec_off, setdec_uart<baud>, setdec_i2c, setdec_spi and setdec_spifalling, which pick the protocol,
+setdec_level<mV>, the threshold, and setdec_stream_on and setdec_stream_off. dec reports the protocol and the
+event counts. Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Dec_Command(char str[])
+{
+    char line[DEC_LINE_LEN];
+    static const char *NAMES[] = {"off", "UART", "I2C", "SPI"};
+
+    if(!strncasecmp(str,"setdec_off",10)){
+        DECODE.protocol = DEC_OFF;
+    } else if(!strncasecmp(str,"setdec_uart",11)){
+        int baud = atoi(str + 11);
+        if(baud < DEC_MIN_BAUD || baud > DEC_MAX_BAUD){
+            UART_PutString("Invalid baud rate\n");
+            return TRUE;
+        }
+        DECODE.protocol = DEC_UART;
+        DECODE.baud = baud;
+    } else if(!strncasecmp(str,"setdec_i2c",10)){
+        DECODE.protocol = DEC_I2C;
+    } else if(!strncasecmp(str,"setdec_spifalling",17)){
+        DECODE.protocol = DEC_SPI;
+        DECODE.spiFalling = TRUE;
+    } else if(!strncasecmp(str,"setdec_spi",10)){
+        DECODE.protocol = DEC_SPI;
+        DECODE.spiFalling = FALSE;
+    } else if(!strncasecmp(str,"setdec_level",12)){
+        int mv = atoi(str + 12);
+        if(mv < MIN_TRIGGER_LEVEL || mv > MAX_TRIGGER_LEVEL){
+            UART_PutString("Invalid decode threshold\n");
+            return TRUE;
+        }
+        DECODE.level = MILLIVOLTS_TO_CODE(mv);
+    } else if(!strncasecmp(str,"setdec_stream_on",16)){
+        DECODE.stream = TRUE;
+    } else if(!strncasecmp(str,"setdec_stream_off",17)){
+        DECODE.stream = FALSE;
+    } else if(!strncasecmp(str,"dec",3)){
+        if(DECODE.protocol == DEC_UART){
+            sprintf(line,"Decoding UART at %d baud, ",DECODE.baud);
+        } else {
+            sprintf(line,"Decoding %s, ",NAMES[DECODE.protocol]);
+        }
+        UART_PutString(line);
+        sprintf(line,"%lu events, %lu errors, %lu dropped\n",(unsigned long)DECODE.head,(unsigned long)DECODE.errors,
+                (unsigned long)DECODE.dropped);
+        UART_PutString(line);
+        return TRUE;
+    } else {
+        return FALSE;
+    }
+    Dec_Reset();                                                              // the new settings decode from a clean state
+    if(DECODE.protocol == DEC_UART){
+        sprintf(line,"Decoding UART at %d baud\n",DECODE.baud);
+    } else {
+        sprintf(line,"Decoding %s\n",NAMES[DECODE.protocol]);
+    }
+    UART_PutString(line);
+    return TRUE;
+}
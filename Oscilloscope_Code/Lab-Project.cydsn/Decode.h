@@ -0,0 +1,118 @@
+/* ========================================
+ *
+ * Tiny Scope protocol decode header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the serial protocol decoders. Each block
+ * (or in streaming mode each segment) of both channels is
+ * thresholded with hysteresis and run-length encoded into a
+ * list of the samples where each channel changes level, so the
+ * decoders only do work at the edges - a quiet bus costs one
+ * compare per sample. The decoders walk the edges of both
+ * channels in time order and carry their state from one block
+ * to the next:
+ *   UART (channel 1) - 8N1, idle high, at a set baud rate. A
+ *   falling edge starts a frame and the bits are read in the
+ *   middle of each bit time.
+ *   I2C (channel 1 SCL, channel 2 SDA) - start and stop
+ *   conditions, the address and each data byte with its ACK.
+ *   SPI (channel 1 clock, channel 2 data) - MSB first on the
+ *   rising (or falling) clock edge. With no chip select a gap
+ *   in the clock starts a new byte.
+ * The decoded events go into a ring; they are streamed over the
+ * UART a few per block and the ones inside the frame on screen
+ * are drawn under the waveforms as labels.
+ *
+ * ========================================
+*/
+
+#ifndef DECODE_H
+#define DECODE_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines for the protocols */
+#define DEC_OFF 0                 // no decoding
+#define DEC_UART 1                // UART on channel 1
+#define DEC_I2C 2                 // I2C with SCL on channel 1 and SDA on channel 2
+#define DEC_SPI 3                 // SPI with the clock on channel 1 and the data on channel 2
+
+/* Defines for the event kinds */
+#define DEC_EV_BYTE 0             // a UART or SPI byte
+#define DEC_EV_START 1            // an I2C start (or repeated start)
+#define DEC_EV_STOP 2             // an I2C stop
+#define DEC_EV_ADDRESS 3          // an I2C address byte
+#define DEC_EV_DATA 4             // an I2C data byte
+
+/* Defines for the event flags */
+#define DEC_FLAG_ERROR 1          // a UART framing error or an I2C NACK
+#define DEC_FLAG_READ 2           // an I2C read address
+
+/* Defines */
+#define DEC_DEFAULT_LEVEL 1650    // threshold in millivolts by default
+#define DEC_HYSTERESIS 40         // codes either side of the threshold a channel must pass to change level
+#define DEC_DEFAULT_BAUD 9600     // UART baud rate by default
+#define DEC_MIN_BAUD 300          // slowest UART baud rate that can be set
+#define DEC_MAX_BAUD (SAMPLING_RATE / 4)  // fastest - four samples a bit
+#define DEC_BIT_BITS 8            // fraction bits of the UART bit time in samples
+#define DEC_SPI_GAP 64            // samples without a clock edge that start a new SPI byte
+#define DEC_CHUNK 200             // samples whose edges are listed at a time (a streaming segment)
+#define DEC_RING_SIZE 256         // decoded events kept, a power of two
+#define DEC_STREAM_PER_BLOCK 16   // most events streamed over the UART per block, so streaming cannot stall processing
+#define DEC_LABEL_LEN 8           // longest event label, with its terminator
+#define DEC_LABEL_WIDTH 30        // pixels a label takes on screen
+#define DEC_MAX_LABELS (X_PIXELS / DEC_LABEL_WIDTH)  // labels drawn under a frame
+#define DEC_MARGIN 60             // distance of the labels from the bottom of the screen
+#define DEC_LINE_LEN 100          // length of one line of the decode report
+
+/* Structures */
+typedef struct DEC_EVENT{
+    uint32_t time;                // sample number the event began at
+    uint8_t kind;                 // one of the DEC_EV_ kinds
+    uint8_t value;                // the byte, or the 7 bit address
+    uint8_t flags;                // DEC_FLAG_ flags
+}DEC_EVENT;
+
+typedef struct DECODER{
+    int protocol;                 // one of the DEC_ protocols
+    int baud;                     // UART baud rate
+    int spiFalling;               // TRUE to read SPI data on the falling clock edge
+    int level;                    // threshold in codes
+    int stream;                   // TRUE to stream the events over the UART
+    int primed;                   // FALSE until the first sample has set the levels
+    int line[2];                  // level of each channel after the last sample decoded
+    uint32_t time;                // sample number of the next sample
+    int active;                   // TRUE inside a UART frame or an I2C transfer
+    int bits;                     // bits of the byte read so far
+    uint32_t shift;               // and their values
+    int address;                  // TRUE while the next I2C byte is the address
+    uint32_t frameStart;          // sample number of the UART start bit edge
+    uint32_t lastClock;           // sample number of the last SPI clock edge
+    uint32_t head;                // events decoded since the decoder was reset
+    uint32_t streamed;            // events streamed
+    uint32_t errors;              // framing errors and NACKs
+    uint32_t dropped;             // events overwritten before they were streamed
+    uint32_t frameTime;           // sample number of the first pixel of the frame on screen
+    DEC_EVENT ring[DEC_RING_SIZE];
+}DECODER;
+
+/* Globals */
+extern DECODER DECODE;
+
+/* Function prototypes */
+int Dec_Edges(const uint16_t arr[], int count, int level, int *state, uint16_t edges[]);
+
+void Dec_Reset(void);
+
+void Dec_Run(uint16_t ch1[], uint16_t ch2[], int count);
+
+void Dec_FrameStart(uint32_t samplesAgo);
+
+void Dec_Draw(SCOPE_SETTINGS SCOPE);
+
+int Dec_Command(char str[]);
+
+#endif /* DECODE_H */
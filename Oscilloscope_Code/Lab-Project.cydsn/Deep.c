@@ -0,0 +1,489 @@
+/* ========================================
+ *
+ * Tiny Scope deep memory definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the deep memory layout, the single shot
+ * capture, the min/max pyramid and the lookups that read it,
+ * the pan and zoom view and the setdeep_ and deep_ commands.
+ * The record is kept in the capture memory: channel 1, then
+ * channel 2. The pyramid is kept in each channel's buffers once
+ * the DMAs have stopped: the first level in the first buffer and
+ * the levels above in the second, each level as the minimums
+ * followed by the maximums.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the deep memory settings and record - the whole capture memory by default */
+DEEP_MEMORY DEEP = {FALSE, 0, 0, 0, {{0}}, {0}, 0, FALSE, FALSE, 0, 0, 0, {0}};
+
+/* the wave structure from main_cm4.c, for the channel offsets, and the channel buffers the pyramid goes in */
+extern WAVEFORM_DATA WAVE;
+extern uint16_t CH1_Data1[SIZE];
+extern uint16_t CH1_Data2[SIZE];
+extern uint16_t CH2_Data1[SIZE];
+extern uint16_t CH2_Data2[SIZE];
+
+/* the columns drawn last time, so they can be erased - pixel offsets, which emWin keeps in 16 bits as well */
+static int16_t PrevTop[2][X_PIXELS];
+static int16_t PrevBottom[2][X_PIXELS];
+
+
+/*
+BucketSize:
+Returns the number of samples a bucket of a pyramid level covers.
+*/
+static inline int BucketSize(int level)
+{
+    return DEEP_BUCKET << (DEEP_BRANCH_SHIFT * level);
+}
+
+
+/*
+Layout:
+Lays out the pyramid of a record of depth samples per channel. Each channel's first level takes its first buffer
+and the levels above, about a third of its size between them, follow one another in its second.
+*/
+static void Layout(int depth)
+{
+    uint16_t *first[2] = {CH1_Data1, CH2_Data1};
+    uint16_t *rest[2] = {CH1_Data2, CH2_Data2};
+
+    DEEP.levels = 0;
+    for(int k=0;k<DEEP_MAX_LEVELS;k++){
+        int n = (depth + BucketSize(k) - 1) / BucketSize(k);
+        for(int c=0;c<2;c++){
+            DEEP.level[c][k] = k ? rest[c] : first[c];
+            if(k){
+                rest[c] += 2 * n;                                            // a minimum and a maximum per bucket
+            }
+        }
+        DEEP.buckets[k] = n;
+        DEEP.levels++;
+        if(n <= 1){
+            break;                                                           // one bucket covers the whole record
+        }
+    }
+}
+
+
+/*
+Deep_Plan:
+Finds the depth of the record. The pyramid is kept out of the capture memory, so the record takes the whole budget
+- half of it for each channel - up to DEEP_MAX_DEPTH samples.
+*/
+void Deep_Plan(void)
+{
+    int budget = DEEP.budget ? DEEP.budget : ACQ_POOL_SIZE;
+    int depth = budget / 2;
+
+    DEEP.depth = depth < DEEP_MAX_DEPTH ? depth : DEEP_MAX_DEPTH;
+    Layout(DEEP.depth);
+}
+
+
+/*
+Clamp:
+Keeps the view inside the record.
+*/
+static void Clamp(void)
+{
+    if(DEEP.span > DEEP.length){
+        DEEP.span = DEEP.length;
+    }
+    if(DEEP.span < DEEP_MIN_SPAN){
+        DEEP.span = DEEP_MIN_SPAN;
+    }
+    if(DEEP.start > DEEP.length - DEEP.span){
+        DEEP.start = DEEP.length - DEEP.span;
+    }
+    if(DEEP.start < 0){
+        DEEP.start = 0;
+    }
+}
+
+
+/*
+ReadPot:
+Reads a potentiometer as a value from 0 to MAX_ADC_OUTPUT.
+*/
+static int ReadPot(uint32_t chan)
+{
+    int v = (int16_t)ADC_GetResult16(chan);
+
+    if(v < 0){
+        return 0;
+    }
+    return v > MAX_ADC_OUTPUT ? MAX_ADC_OUTPUT : v;
+}
+
+
+/*
+Deep_Reset:
+Throws away the record so the next run captures a new one, and clears it off the screen if it was shown. Called
+when the scope is started.
+*/
+void Deep_Reset(SCOPE_SETTINGS SCOPE)
+{
+    DEEP.length = 0;
+    DEEP.capturing = FALSE;
+    if(DEEP.viewing){
+        DEEP.viewing = FALSE;
+        GUI_Clear();
+        SetBackground(SCOPE, WAVE);
+    }
+}
+
+
+/*
+Deep_Capture:
+Takes one stretch of newly acquired samples (time-aligned on both channels, the first being sample number first).
+The record starts at the first trigger (or straight away in free-run mode) and takes every sample after it until it
+is full. Then the pyramid is built, the scope stops and the whole record is drawn.
+*/
+void Deep_Capture(uint16_t ch1[], uint16_t ch2[], int size, uint64_t first, SCOPE_SETTINGS *SCOPE)
+{
+    char str[DEEP_LINE_LEN];
+    int from = 0;
+
+    if(DEEP.viewing){
+        return;                                                              // one record per run
+    }
+    if(!DEEP.capturing){
+        if(!SCOPE->freeRun){
+            int used;
+            PROFILE_BEGIN(PROF_FIND_TRIGGER);
+            from = Trigger_Next(ch1, ch2, size, *SCOPE, &used);
+            PROFILE_END(PROF_FIND_TRIGGER);
+            if(from < 0){
+                return;
+            }
+            TRACE(TRACE_TRIGGER_FOUND,SCOPE->triggerChannel,from);
+        }
+        DEEP.capturing = TRUE;
+        DEEP.length = 0;
+        DEEP.time = first + from;
+    }
+
+    int n = DEEP.depth - DEEP.length;
+    if(n > size - from){
+        n = size - from;
+    }
+    for(int i=0;i<n;i++){                                                    // negative readings are stored as 0 so they cannot pass for maximums
+        uint16_t v1 = ch1[from + i];
+        uint16_t v2 = ch2[from + i];
+        ACQ_Pool[DEEP.length + i] = (v1 & UNDERFLOW_CHECK) ? 0 : v1;
+        ACQ_Pool[DEEP.depth + DEEP.length + i] = (v2 & UNDERFLOW_CHECK) ? 0 : v2;
+    }
+    DEEP.length += n;
+    if(DEEP.length < DEEP.depth){
+        return;
+    }
+
+    DEEP.capturing = FALSE;
+    Acq_Stop();                                                              // the pyramid takes over the channel buffers
+    Deep_Build();
+    DEEP.viewing = TRUE;
+    DEEP.start = 0;
+    DEEP.span = DEEP.length;
+    DEEP.pot[0] = ReadPot(1);                                                // the view only follows the potentiometers once they move
+    DEEP.pot[1] = ReadPot(3);
+    SCOPE->Running = FALSE;                                                  // a deep capture is a single shot
+
+    sprintf(str,"Deep capture of %d samples (%lu us) done - stopped the scope\n",DEEP.length,
+            (unsigned long)(((uint64_t)DEEP.length * 1000000) / SAMPLING_RATE));
+    UART_PutString(str);
+    GUI_Clear();
+    Deep_Draw(*SCOPE);
+}
+
+
+/*
+Deep_Build:
+Builds the min/max pyramid over the record. The first level reads every sample once and each level above reads
+the one below, so the whole pyramid costs about 1.3 reads per sample. The pyramid is written over the channel
+buffers, so the DMAs must have been stopped.
+*/
+void Deep_Build(void)
+{
+    for(int c=0;c<2;c++){
+        uint16_t *samples = ACQ_Pool + c * DEEP.depth;
+        uint16_t *low = DEEP.level[c][0];
+        uint16_t *high = low + DEEP.buckets[0];
+
+        for(int b=0;b<DEEP.buckets[0];b++){
+            int end = (b + 1) * DEEP_BUCKET < DEEP.length ? (b + 1) * DEEP_BUCKET : DEEP.length;
+            uint16_t lo = samples[b * DEEP_BUCKET];
+            uint16_t hi = lo;
+            for(int i=b*DEEP_BUCKET+1;i<end;i++){
+                if(samples[i] < lo){
+                    lo = samples[i];
+                }
+                if(samples[i] > hi){
+                    hi = samples[i];
+                }
+            }
+            low[b] = lo;
+            high[b] = hi;
+        }
+
+        for(int k=1;k<DEEP.levels;k++){
+            uint16_t *childLow = DEEP.level[c][k-1];
+            uint16_t *childHigh = childLow + DEEP.buckets[k-1];
+            low = DEEP.level[c][k];
+            high = low + DEEP.buckets[k];
+            for(int b=0;b<DEEP.buckets[k];b++){
+                int j = b << DEEP_BRANCH_SHIFT;
+                int end = (b + 1) << DEEP_BRANCH_SHIFT;
+                uint16_t lo = childLow[j];
+                uint16_t hi = childHigh[j];
+                if(end > DEEP.buckets[k-1]){
+                    end = DEEP.buckets[k-1];
+                }
+                for(j++;j<end;j++){
+                    if(childLow[j] < lo){
+                        lo = childLow[j];
+                    }
+                    if(childHigh[j] > hi){
+                        hi = childHigh[j];
+                    }
+                }
+                low[b] = lo;
+                high[b] = hi;
+            }
+        }
+    }
+}
+
+
+/*
+Deep_Range:
+Finds the smallest and largest sample of a channel (0 or 1) from start up to end. Short ranges are read directly;
+longer ones use the highest pyramid level whose buckets are at most half the range, so at most about ten buckets
+are read whatever the length. The buckets at either end may reach a little past the range.
+*/
+void Deep_Range(int channel, int start, int end, uint16_t *low, uint16_t *high)
+{
+    int count = end - start;
+    int k = -1;
+    uint16_t lo;
+    uint16_t hi;
+
+    while(k + 1 < DEEP.levels && 2 * BucketSize(k + 1) <= count){
+        k++;
+    }
+
+    if(k < 0){                                                               // shorter than two buckets - the samples themselves
+        uint16_t *samples = ACQ_Pool + channel * DEEP.depth;
+        lo = samples[start];
+        hi = lo;
+        for(int i=start+1;i<end;i++){
+            if(samples[i] < lo){
+                lo = samples[i];
+            }
+            if(samples[i] > hi){
+                hi = samples[i];
+            }
+        }
+    } else {
+        uint16_t *bucketLow = DEEP.level[channel][k];
+        uint16_t *bucketHigh = bucketLow + DEEP.buckets[k];
+        int last = (end - 1) / BucketSize(k);
+        int b = start / BucketSize(k);
+        lo = bucketLow[b];
+        hi = bucketHigh[b];
+        for(b++;b<=last;b++){
+            if(bucketLow[b] < lo){
+                lo = bucketLow[b];
+            }
+            if(bucketHigh[b] > hi){
+                hi = bucketHigh[b];
+            }
+        }
+    }
+    *low = lo;
+    *high = hi;
+}
+
+
+/*
+Deep_Draw:
+Draws the part of the record in view. Each pixel column is a vertical line from the smallest to the largest sample
+under it, stretched to meet the column before so the trace stays joined up. The last columns are erased first the
+same way UpdateDisplay erases the last waveform.
+*/
+void Deep_Draw(SCOPE_SETTINGS SCOPE)
+{
+    int offsets[2] = {Y_PIXELS-WAVE.Wave1Offset, Y_PIXELS-WAVE.Wave2Offset};
+    GUI_COLOR colors[2] = {GUI_RED, GUI_YELLOW};
+    char str[DEEP_LINE_LEN];
+
+    PROFILE_BEGIN(PROF_UPDATE_DISPLAY);
+    GUI_SetPenSize(2);
+    GUI_SetColor(GUI_BLACK);
+    for(int c=0;c<2;c++){
+        for(int p=0;p<X_PIXELS;p++){
+            GUI_DrawLine(p,PrevTop[c][p]+offsets[c],p,PrevBottom[c][p]+offsets[c]);
+        }
+    }
+    SetBackground(SCOPE, WAVE);
+
+    for(int c=1;c>=0;c--){                                                   // channel 2 first so channel 1 is drawn on top
+        GUI_SetColor(colors[c]);
+        for(int p=0;p<X_PIXELS;p++){
+            int start = DEEP.start + (int)(((int64_t)p * DEEP.span) / X_PIXELS);
+            int end = DEEP.start + (int)(((int64_t)(p + 1) * DEEP.span) / X_PIXELS);
+            uint16_t low, high;
+            if(end <= start){
+                end = start + 1;                                             // zoomed in past one sample per pixel
+            }
+            Deep_Range(c, start, end, &low, &high);
+            int top = CODE_TO_PIXEL(high, SCOPE.yScale);
+            int bottom = CODE_TO_PIXEL(low, SCOPE.yScale);
+            if(p){
+                if(bottom < PrevTop[c][p-1]){
+                    bottom = PrevTop[c][p-1];                                // reaching down to the column before
+                }
+                if(top > PrevBottom[c][p-1]){
+                    top = PrevBottom[c][p-1];                                // reaching up to the column before
+                }
+            }
+            GUI_DrawLine(p,top+offsets[c],p,bottom+offsets[c]);
+            PrevTop[c][p] = top;
+            PrevBottom[c][p] = bottom;
+        }
+    }
+
+    GUI_SetColor(GUI_WHITE);
+    sprintf(str,"Deep %lu us/div at %lu us of %lu us    ",
+            (unsigned long)(((uint64_t)DEEP.span * 1000000) / (SAMPLING_RATE * (X_PIXELS / PIXELS_PER_X))),
+            (unsigned long)(((uint64_t)DEEP.start * 1000000) / SAMPLING_RATE),
+            (unsigned long)(((uint64_t)DEEP.length * 1000000) / SAMPLING_RATE));
+    GUI_DispStringAt(str,MARGIN,Y_PIXELS-DEEP_MARGIN);
+    PROFILE_END(PROF_UPDATE_DISPLAY);
+}
+
+
+/*
+Deep_Poll:
+Lets the potentiometers pan and zoom the record while it is shown: channel 1's moves the view from the start of the
+record to the end, channel 2's zooms from the whole record down to DEEP_MIN_SPAN samples in steps of two. Nothing
+happens until a potentiometer moves past the deadband, so the deep_ commands are not undone straight away.
+*/
+void Deep_Poll(SCOPE_SETTINGS SCOPE)
+{
+    int pan = ReadPot(1);
+    int zoom = ReadPot(3);
+    int steps = 0;
+
+    if(abs(pan - DEEP.pot[0]) < DEEP_POT_DEADBAND && abs(zoom - DEEP.pot[1]) < DEEP_POT_DEADBAND){
+        return;
+    }
+    DEEP.pot[0] = pan;
+    DEEP.pot[1] = zoom;
+
+    while((DEEP.length >> (steps + 1)) >= DEEP_MIN_SPAN){
+        steps++;                                                             // halvings from the whole record to the closest zoom
+    }
+    DEEP.span = DEEP.length >> ((zoom * (steps + 1)) / (MAX_ADC_OUTPUT + 1));
+    DEEP.start = (int)(((int64_t)pan * (DEEP.length - DEEP.span)) / MAX_ADC_OUTPUT);
+    Clamp();
+    Deep_Draw(SCOPE);
+}
+
+
+/*
+Deep_Command:
+Handles the setdeep_ commands, which turn deep memory on or off and set its memory budget in KB
+(setdeep_budget32), and the deep_ view commands: deep_zoomin and deep_zoomout (by two about the middle of the
+view), deep_left and deep_right (by half a screen), deep_full, deep_view<start us>,<span us> and deep_info. The
+settings can only be changed while stopped. Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Deep_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    char toPrint[DEEP_LINE_LEN];
+    int a;
+
+    if(!strncasecmp(str,"setdeep_",8)){
+        if(SCOPE->Running){
+            return FALSE;
+        }
+        if(!strncasecmp(str,"setdeep_on",10)){
+            if(SCOPE->acqMode != ACQ_STREAMING){
+                UART_PutString("Deep memory needs streaming acquisition - enter setacq_streaming first\n");
+                return TRUE;
+            }
+            DEEP.on = TRUE;
+            SEGMENTS.on = FALSE;                                             // the capture modes share the capture memory
+            ETS.on = FALSE;
+            LOGIC.on = FALSE;
+            Xy_Off();
+            XCORR.on = FALSE;
+        } else if(!strncasecmp(str,"setdeep_off",11)){
+            DEEP.on = FALSE;
+            UART_PutString("Deep memory off\n");
+            return TRUE;
+        } else if(!strncasecmp(str,"setdeep_budget",14)){
+            a = atoi(&str[14]);
+            if(a <= 0 || a > (int)(ACQ_POOL_SIZE * sizeof(uint16_t) / BYTES_PER_KB)){
+                sprintf(toPrint,"Invalid budget - at most %d KB\n",(int)(ACQ_POOL_SIZE * sizeof(uint16_t) / BYTES_PER_KB));
+                UART_PutString(toPrint);
+                return TRUE;
+            }
+            DEEP.budget = a * BYTES_PER_KB / sizeof(uint16_t);
+        } else {
+            return FALSE;
+        }
+        Deep_Plan();
+        sprintf(toPrint,"Deep memory %s - %d samples (%lu us) per channel\n",DEEP.on ? "on" : "off",DEEP.depth,
+                (unsigned long)(((uint64_t)DEEP.depth * 1000000) / SAMPLING_RATE));
+        UART_PutString(toPrint);
+        return TRUE;
+    }
+
+    if(strncasecmp(str,"deep_",5)){
+        return FALSE;
+    }
+    if(!DEEP.viewing){
+        UART_PutString("No deep record captured\n");
+        return TRUE;
+    }
+    if(!strncasecmp(str,"deep_zoomin",11)){
+        DEEP.start += DEEP.span / 4;
+        DEEP.span /= 2;
+    } else if(!strncasecmp(str,"deep_zoomout",12)){
+        DEEP.start -= DEEP.span / 2;
+        DEEP.span *= 2;
+    } else if(!strncasecmp(str,"deep_left",9)){
+        DEEP.start -= DEEP.span / 2;
+    } else if(!strncasecmp(str,"deep_right",10)){
+        DEEP.start += DEEP.span / 2;
+    } else if(!strncasecmp(str,"deep_full",9)){
+        DEEP.start = 0;
+        DEEP.span = DEEP.length;
+    } else if(!strncasecmp(str,"deep_view",9)){
+        char *comma = strchr(&str[9],',');
+        if(!comma){
+            UART_PutString("Invalid view - enter deep_view<start us>,<span us>\n");
+            return TRUE;
+        }
+        DEEP.start = MICROSECONDS_TO_SAMPLES(atoi(&str[9]));
+        DEEP.span = MICROSECONDS_TO_SAMPLES(atoi(comma + 1));
+    } else if(!strncasecmp(str,"deep_info",9)){
+        sprintf(toPrint,"%d samples, trigger at sample %lu, view %d to %d, %d pyramid levels\n",DEEP.length,
+                (unsigned long)DEEP.time,DEEP.start,DEEP.start + DEEP.span,DEEP.levels);
+        UART_PutString(toPrint);
+        return TRUE;
+    } else {
+        return FALSE;
+    }
+    Clamp();
+    Deep_Draw(*SCOPE);
+    return TRUE;
+}
@@ -0,0 +1,78 @@
+/* ========================================
+ *
+ * Tiny Scope deep memory header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides deep memory: a single shot capture of
+ * both channels as long as a memory budget (up to all of the
+ * capture memory) allows, instead of one SIZE buffer. When the
+ * record is full the scope and its DMAs stop and a min/max
+ * pyramid is built over the record in the channel buffers,
+ * which the acquisition no longer needs - each level holds the
+ * smallest and largest sample of every bucket, and each bucket
+ * covers four of the level below. The record can then be panned and zoomed with
+ * the deep_ commands or the potentiometers. Every pixel column
+ * is drawn from a few buckets of the level that fits its width,
+ * so a redraw costs the same at any zoom rather than growing
+ * with the number of samples in view.
+ *
+ * ========================================
+*/
+
+#ifndef DEEP_H
+#define DEEP_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define DEEP_BUCKET 8             // samples in a bucket of the first pyramid level
+#define DEEP_BRANCH_SHIFT 2       // each bucket covers 1 << DEEP_BRANCH_SHIFT buckets of the level below
+#define DEEP_MAX_LEVELS 12        // most levels the pyramid can have
+#define DEEP_MAX_DEPTH (DEEP_BUCKET * SIZE / 2)  // deepest record whose first pyramid level fits in a channel buffer
+#define DEEP_MIN_SPAN 80          // fewest samples across the screen when zoomed all the way in
+#define DEEP_POT_DEADBAND 16      // ADC codes a potentiometer must move before the view follows it
+#define DEEP_MARGIN 45            // distance of the view description from the bottom of the screen
+#define DEEP_LINE_LEN 100         // length of one line of the deep memory report
+#define BYTES_PER_KB 1024         // bytes in a kilobyte, for the memory budget
+
+/* Structures */
+typedef struct DEEP_MEMORY{
+    int on;                       // TRUE while each run captures one deep record
+    int budget;                   // samples of the capture memory the record may use, 0 for all of it
+    int depth;                    // samples per channel the budget holds
+    int levels;                   // levels in the min/max pyramid
+    uint16_t *level[2][DEEP_MAX_LEVELS];  // where each channel's minimums of each level start - its maximums follow
+    int buckets[DEEP_MAX_LEVELS]; // buckets in each level
+    int length;                   // samples per channel captured so far
+    int capturing;                // TRUE once the trigger has been found
+    int viewing;                  // TRUE once the record is complete and on the screen
+    uint64_t time;                // number of the trigger sample, counted from the start of the acquisition
+    int start;                    // first sample in view
+    int span;                     // samples across the screen
+    int pot[2];                   // potentiometer readings the view last followed
+}DEEP_MEMORY;
+
+/* Globals */
+extern DEEP_MEMORY DEEP;
+
+/* Function prototypes */
+void Deep_Reset(SCOPE_SETTINGS SCOPE);
+
+void Deep_Plan(void);
+
+void Deep_Capture(uint16_t ch1[], uint16_t ch2[], int size, uint64_t first, SCOPE_SETTINGS *SCOPE);
+
+void Deep_Build(void);
+
+void Deep_Range(int channel, int start, int end, uint16_t *low, uint16_t *high);
+
+void Deep_Draw(SCOPE_SETTINGS SCOPE);
+
+void Deep_Poll(SCOPE_SETTINGS SCOPE);
+
+int Deep_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* DEEP_H */
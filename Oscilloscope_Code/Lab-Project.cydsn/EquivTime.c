@@ -0,0 +1,229 @@
+/* ========================================
+ *
+ * Tiny Scope equivalent time sampling definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the equivalent time grid, the crossing
+ * search that finds each acquisition to a fraction of a
+ * sample, the binning, the formatting of the grid into the
+ * wave structure and the setets_ and ets commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the equivalent time settings */
+EQUIV_TIME ETS;
+
+/* the grid, borrowed from the capture memory while equivalent time is on */
+static EQUIV_GRID * const GRID = (EQUIV_GRID *)ACQ_Pool;
+_Static_assert(sizeof(EQUIV_GRID) <= ACQ_POOL_MIN * sizeof(uint16_t), "the grid fits in the capture memory");
+
+/* the wave structure from main_cm4.c - frames are formatted into it */
+extern WAVEFORM_DATA WAVE;
+
+
+/*
+Ets_Reset:
+Clears the grid so it fills again from nothing if equivalent time is on. Called when equivalent time is turned on,
+when the scope is started and when the timebase or trigger changes. When it is off the capture memory belongs to
+the other modes and is left alone.
+*/
+void Ets_Reset(void)
+{
+    if(!ETS.on){
+        return;
+    }
+    memset(&ETS, 0, sizeof(ETS));
+    memset(GRID, 0, sizeof(EQUIV_GRID));
+    ETS.on = TRUE;
+}
+
+
+/*
+Bin:
+Adds the samples after a crossing into the grid. crossing is the time of the crossing in 1/ETS_PHASE_SCALE of a
+sample; each sample lands in the pixel its time since the crossing would be drawn at, using the same samples per
+pixel (xScale / INDEX_DIVISOR) as the normal frames.
+*/
+static void Bin(uint16_t ch1[], uint16_t ch2[], int first, int crossing, int xScale)
+{
+    for(int j=first;j<SIZE;j++){
+        int bin = (int)(((int64_t)(j * ETS_PHASE_SCALE - crossing) * INDEX_DIVISOR) / (xScale * ETS_PHASE_SCALE));
+        if(bin >= X_PIXELS){
+            break;                                                           // past the right edge of the screen
+        }
+        GRID->sum[0][bin] += (ch1[j] & UNDERFLOW_CHECK) ? 0 : ch1[j];
+        GRID->sum[1][bin] += (ch2[j] & UNDERFLOW_CHECK) ? 0 : ch2[j];
+        if(++GRID->hits[bin] >= ETS_MAX_HITS){
+            GRID->hits[bin] /= 2;                                              // keeps the mean while letting new acquisitions count
+            GRID->sum[0][bin] /= 2;
+            GRID->sum[1][bin] /= 2;
+        }
+    }
+}
+
+
+/*
+Ets_Block:
+Bins one block. Every crossing of the trigger level in the trigger slope is an acquisition (the signal must first
+fall TRIGGER_HYSTERESIS below the level so noise cannot make crossings). The crossing time is interpolated between
+the samples either side of the level. Returns TRUE when enough blocks have been binned for a frame, which is then
+formatted into the wave structure.
+*/
+int Ets_Block(uint16_t ch1[], uint16_t ch2[], SCOPE_SETTINGS SCOPE)
+{
+    uint16_t *trig = SCOPE.triggerChannel == CHANNEL_1 ? ch1 : ch2;
+    int positive = SCOPE.triggerDir == POSITIVE;
+    int level = positive ? SCOPE.triggerLevel : MAX_ADC_OUTPUT - SCOPE.triggerLevel;
+    int armed = FALSE;
+    int last = (trig[0] & UNDERFLOW_CHECK) ? 0 : trig[0];
+
+    if(SCOPE.xScale != ETS.xScale || SCOPE.triggerLevel != ETS.level || SCOPE.triggerDir != ETS.dir
+    || SCOPE.triggerChannel != ETS.channel){
+        Ets_Reset();                                                         // the bins no longer mean the same times
+        ETS.xScale = SCOPE.xScale;
+        ETS.level = SCOPE.triggerLevel;
+        ETS.dir = SCOPE.triggerDir;
+        ETS.channel = SCOPE.triggerChannel;
+    }
+    if(!positive){
+        last = MAX_ADC_OUTPUT - last;                                        // a falling edge is a rising edge of the inverted signal
+    }
+
+    PROFILE_BEGIN(PROF_EQUIV_TIME);
+    for(int i=1;i<SIZE;i++){
+        int v = (trig[i] & UNDERFLOW_CHECK) ? 0 : trig[i];
+        if(!positive){
+            v = MAX_ADC_OUTPUT - v;
+        }
+        if(v < level - TRIGGER_HYSTERESIS){
+            armed = TRUE;
+        } else if(armed && last < level && v >= level){
+            int crossing = (i - 1) * ETS_PHASE_SCALE + ((level - last) * ETS_PHASE_SCALE) / (v - last);
+            armed = FALSE;
+            Bin(ch1, ch2, i, crossing, SCOPE.xScale);
+            ETS.triggers++;
+            ETS.lastTrigger = i;
+        }
+        last = v;
+    }
+    PROFILE_END(PROF_EQUIV_TIME);
+
+    if(++ETS.blocks < ETS_FRAME_BLOCKS){
+        return FALSE;
+    }
+    ETS.blocks = 0;
+    Ets_Format(SCOPE);
+    return TRUE;
+}
+
+
+/*
+Ets_Format:
+Formats the mean of each bin into the wave structure. Bins nothing has landed in yet are filled in by a straight
+line between the nearest filled bins either side (or the nearest one at the ends), so a sparse grid still draws as
+a waveform.
+*/
+void Ets_Format(SCOPE_SETTINGS SCOPE)
+{
+    int *Y[2] = {WAVE.Wave1Y, WAVE.Wave2Y};
+
+    PROFILE_BEGIN(PROF_FORMAT_DATA);
+    for(int c=0;c<2;c++){
+        int prev = -1;                                                       // the last filled bin
+        int prevValue = 0;
+        for(int i=0;i<X_PIXELS;i++){
+            if(!GRID->hits[i]){
+                continue;
+            }
+            int value = GRID->sum[c][i] / GRID->hits[i];
+            int from = prev < 0 ? 0 : prev + 1;
+            for(int k=from;k<i;k++){                                         // the gap since the last filled bin
+                int filled = prev < 0 ? value : prevValue + ((value - prevValue) * (k - prev)) / (i - prev);
+                Y[c][k] = CODE_TO_PIXEL(filled, SCOPE.yScale);
+            }
+            Y[c][i] = CODE_TO_PIXEL(value, SCOPE.yScale);
+            prev = i;
+            prevValue = value;
+        }
+        for(int k=prev+1;k<X_PIXELS;k++){
+            Y[c][k] = CODE_TO_PIXEL(prevValue, SCOPE.yScale);                // after the last filled bin (or all of them if none are)
+        }
+    }
+    for(int i=0;i<X_PIXELS;i++){
+        WAVE.Wave1X[i] = i;
+        WAVE.Wave2X[i] = i;
+    }
+    PROFILE_END(PROF_FORMAT_DATA);
+}
+
+
+/*
+Ets_Report:
+Prints how far the grid has filled: the acquisitions binned, the bins still empty and the fewest and mean hits -
+or that equivalent time is off, since the grid is only there while it is on.
+*/
+void Ets_Report(void)
+{
+    char str[ETS_LINE_LEN];
+    int empty = 0;
+    uint32_t fewest = UINT32_MAX;
+    uint32_t total = 0;
+
+    if(!ETS.on){
+        UART_PutString("Equivalent time off\n");                           // the capture memory holds something else
+        return;
+    }
+    for(int i=0;i<X_PIXELS;i++){
+        if(!GRID->hits[i]){
+            empty++;
+        }
+        if(GRID->hits[i] < fewest){
+            fewest = GRID->hits[i];
+        }
+        total += GRID->hits[i];
+    }
+    sprintf(str,"acquisitions %lu empty bins %d fewest hits %lu mean hits %lu\n",(unsigned long)ETS.triggers,empty,
+            (unsigned long)fewest,(unsigned long)(total / X_PIXELS));
+    UART_PutString(str);
+}
+
+
+/*
+Ets_Command:
+Handles setets_on and setets_off, which can only be given while stopped, and ets (the report) and ets_reset.
+Equivalent time uses the edge trigger's level, slope and channel in either trigger mode. Turning it off brings
+the timebase back into the normal range. Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Ets_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    if(!strncasecmp(str,"setets_on",9) && !SCOPE->Running){
+        ETS.on = TRUE;
+        SEGMENTS.on = FALSE;                                                 // the capture modes each replace the frames
+        DEEP.on = FALSE;                                                     // and the grid takes over the capture memory
+        LOGIC.on = FALSE;
+        Xy_Off();
+        XCORR.on = FALSE;
+        Ets_Reset();
+        UART_PutString("Equivalent time on\n");
+    } else if(!strncasecmp(str,"setets_off",10) && !SCOPE->Running){
+        ETS.on = FALSE;
+        if(SCOPE->xScale < MIN_XSCALE){
+            SCOPE->xScale = MIN_XSCALE;
+        }
+        UART_PutString("Equivalent time off\n");
+    } else if(!strncasecmp(str,"ets_reset",9)){
+        Ets_Reset();
+        UART_PutString("Equivalent time cleared\n");
+    } else if(!strncasecmp(str,"ets",3)){
+        Ets_Report();
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,70 @@
+/* ========================================
+ *
+ * Tiny Scope equivalent time sampling header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides equivalent time sampling for stable
+ * repetitive signals. Every edge of the trigger slope in every
+ * block is an acquisition: where the signal crossed the trigger
+ * level between two samples is found to a fraction of a sample
+ * by interpolation, and the samples after it are added into a
+ * grid of one bin per pixel by their time since that crossing.
+ * Since the crossings fall at a different phase of the sample
+ * clock each time, the bins fill in between the real samples
+ * and the waveform builds up at a much finer time resolution
+ * than the ADC rate - fine enough for timebases down to
+ * ETS_MIN_XSCALE. Each bin keeps a running sum and hit count,
+ * halved when it gets large so a change of the signal shows.
+ * The grid lives in the capture memory, so equivalent time is
+ * not on together with the modes that record into it.
+ *
+ * ========================================
+*/
+
+#ifndef EQUIV_TIME_H
+#define EQUIV_TIME_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define ETS_PHASE_SCALE 256       // crossing times are found to 1/256 of a sample
+#define ETS_MAX_HITS 64           // a bin's sums and hits are halved when it reaches this many hits
+#define ETS_FRAME_BLOCKS 4        // blocks binned between frames (about 18 frames a second)
+#define ETS_MIN_XSCALE 10         // fastest timebase in microseconds per division in equivalent time
+#define ETS_LINE_LEN 100          // length of one line of the equivalent time report
+
+/* Structures */
+typedef struct EQUIV_GRID{        // the bins, in the capture memory
+    uint32_t sum[2][X_PIXELS];    // sum of the samples of each channel that fell in each bin
+    uint16_t hits[X_PIXELS];      // samples that fell in each bin
+}EQUIV_GRID;
+
+typedef struct EQUIV_TIME{
+    int on;                       // TRUE while blocks are binned in equivalent time instead of framed
+    uint32_t triggers;            // acquisitions binned since the grid was cleared
+    int blocks;                   // blocks binned since the last frame
+    int lastTrigger;              // sample of the last crossing of the last block, for the latency
+    int xScale;                   // the timebase and trigger the grid was filled with - a change clears it
+    int level;
+    int dir;
+    int channel;
+}EQUIV_TIME;
+
+/* Globals */
+extern EQUIV_TIME ETS;
+
+/* Function prototypes */
+void Ets_Reset(void);
+
+int Ets_Block(uint16_t ch1[], uint16_t ch2[], SCOPE_SETTINGS SCOPE);
+
+void Ets_Format(SCOPE_SETTINGS SCOPE);
+
+void Ets_Report(void);
+
+int Ets_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* EQUIV_TIME_H */
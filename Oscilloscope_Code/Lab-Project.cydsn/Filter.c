@@ -0,0 +1,418 @@
+/* ========================================
+ *
+ * Tiny Scope input filter definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the fixed point sine the filters are designed
+ * with, the Butterworth, notch and windowed-sinc designs, the
+ * biquad, FIR and AC coupling kernels and the setfilt and filt
+ * commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the filter of each channel */
+FILTER_CHANNEL FILTERS[2] = {
+    {FILT_OFF, FALSE, FILT_DEFAULT_ORDER, FILT_DEFAULT_CUTOFF, FALSE, 0, {{0}}, {0}, {0}},
+    {FILT_OFF, FALSE, FILT_DEFAULT_ORDER, FILT_DEFAULT_CUTOFF, FALSE, 0, {{0}}, {0}, {0}},
+};
+
+/* the buffer each channel filtered last, so one that has not been refilled is not filtered twice */
+static const uint16_t *LastFiltered[2];
+
+
+/*
+QuarterSine:
+Returns the sine of a quarter turn angle, r from 0 to 1 << 30 standing for 0 to pi/2, with FILT_TRIG_BITS fraction
+bits. The series is summed in fixed point; over a quarter turn its terms fall off fast enough that a handful give
+the sine to the last bit.
+*/
+static int32_t QuarterSine(uint32_t r)
+{
+    int64_t x = ((int64_t)r * FILT_PI) >> FILT_TRIG_BITS;                    // the angle in radians
+    int64_t x2 = (x * x) >> FILT_TRIG_BITS;
+    int64_t term = x;
+    int64_t sum = x;
+
+    for(int i=1;i<FILT_SINE_TERMS;i++){
+        term = -((term * x2) >> FILT_TRIG_BITS) / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return (int32_t)sum;
+}
+
+
+/*
+Filt_Sin:
+Returns the sine of phase, a fraction of a turn scaled by 1 << 32, with FILT_TRIG_BITS fraction bits. The cosine is
+the sine a quarter turn on.
+*/
+int32_t Filt_Sin(uint32_t phase)
+{
+    uint32_t r = phase & 0x3FFFFFFF;                                         // the angle within its quadrant
+
+    switch(phase >> 30){
+        case 0:
+            return QuarterSine(r);
+        case 1:
+            return QuarterSine(0x40000000 - r);
+        case 2:
+            return -QuarterSine(r);
+        default:
+            return -QuarterSine(0x40000000 - r);
+    }
+}
+
+
+/*
+Coefficient:
+Returns c / a0 with FILT_COEF_BITS fraction bits, rounded, where c and a0 have FILT_TRIG_BITS.
+*/
+static int32_t Coefficient(int64_t c, int64_t a0)
+{
+    int64_t scaled = c * ((int64_t)1 << FILT_COEF_BITS);
+
+    return (int32_t)((scaled + (c < 0 ? -a0 / 2 : a0 / 2)) / a0);
+}
+
+
+/*
+SetBiquad:
+Sets a lowpass, highpass or notch biquad from the cosine of its frequency and its alpha (the sine over twice the
+quality), as in the usual cookbook designs, normalized so a0 is one.
+*/
+static void SetBiquad(FILTER_SECTION *s, int type, int64_t cs, int64_t alpha)
+{
+    int64_t one = (int64_t)1 << FILT_TRIG_BITS;
+    int64_t a0 = one + alpha;
+
+    if(type == FILT_LOWPASS){
+        s->b0 = Coefficient((one - cs) / 2, a0);
+        s->b1 = Coefficient(one - cs, a0);
+        s->b2 = s->b0;
+    } else if(type == FILT_HIGHPASS){
+        s->b0 = Coefficient((one + cs) / 2, a0);
+        s->b1 = Coefficient(-(one + cs), a0);
+        s->b2 = s->b0;
+    } else {
+        s->b0 = Coefficient(one, a0);
+        s->b1 = Coefficient(-2 * cs, a0);
+        s->b2 = s->b0;
+    }
+    s->a1 = Coefficient(-2 * cs, a0);
+    s->a2 = Coefficient(one - alpha, a0);
+}
+
+
+/*
+DesignFir:
+Designs a lowpass FIR of order + 1 taps as a sinc cut off by a Hamming window, scaled so the taps add up to one,
+or a highpass as one minus the lowpass.
+*/
+static void DesignFir(FILTER_CHANNEL *f, uint32_t phase)
+{
+    int64_t h[FILT_MAX_TAPS];
+    int64_t sum = 0;
+    int32_t total = 0;
+    int middle = f->order / 2;
+
+    for(int k=0;k<=f->order;k++){
+        int m = k - middle;
+        int64_t ideal = m == 0 ? phase >> 1 : (int64_t)Filt_Sin(phase * (uint32_t)m) * ((int64_t)1 << (FILT_TRIG_BITS - 1)) / ((int64_t)FILT_PI * m);
+        int64_t window = FILT_HAMMING_A - (((int64_t)FILT_HAMMING_B * Filt_Sin((uint32_t)(((uint64_t)k << 32) / f->order) + 0x40000000)) >> FILT_TRIG_BITS);
+        h[k] = (ideal * window) >> FILT_TRIG_BITS;
+        sum += h[k];
+    }
+    for(int k=0;k<=f->order;k++){
+        f->taps[k] = (int16_t)((h[k] * (1 << FILT_TAP_BITS) + sum / 2) / sum);
+        total += f->taps[k];
+    }
+    f->taps[middle] += (1 << FILT_TAP_BITS) - total;                         // the rounding is taken up in the middle so the gain at DC is exactly one
+    if(f->type == FILT_HIGHPASS){
+        for(int k=0;k<=f->order;k++){
+            f->taps[k] = -f->taps[k];
+        }
+        f->taps[middle] += 1 << FILT_TAP_BITS;
+    }
+}
+
+
+/*
+Filt_Design:
+Works out the coefficients of a channel's filter from its settings and clears its state. A Butterworth IIR of order
+n is n/2 biquads, the k-th with a quality of 1 / (2 sin((2k-1) pi / 2n)).
+*/
+void Filt_Design(FILTER_CHANNEL *f)
+{
+    uint32_t phase = (uint32_t)(((uint64_t)f->cutoff << 32) / SAMPLING_RATE);
+    int64_t cs = Filt_Sin(phase + 0x40000000);
+    int64_t sn = Filt_Sin(phase);
+
+    memset(f->section, 0, sizeof(f->section));
+    memset(f->taps, 0, sizeof(f->taps));
+    f->sections = 0;
+    f->primed = FALSE;
+    if(f->type == FILT_NOTCH){
+        SetBiquad(&f->section[0], FILT_NOTCH, cs, sn / (2 * FILT_NOTCH_Q));
+        f->sections = 1;
+    } else if((f->type == FILT_LOWPASS || f->type == FILT_HIGHPASS) && f->fir){
+        DesignFir(f, phase);
+    } else if(f->type == FILT_LOWPASS || f->type == FILT_HIGHPASS){
+        f->sections = f->order / 2;
+        for(int k=1;k<=f->sections;k++){
+            int64_t pole = Filt_Sin((uint32_t)(((uint64_t)(2 * k - 1) << 30) / f->order));
+            SetBiquad(&f->section[k-1], f->type, cs, (sn * pole) >> FILT_TRIG_BITS);
+        }
+    }
+}
+
+
+/*
+Clamp:
+Returns a filtered value limited to the range of the ADC.
+*/
+static uint16_t Clamp(int32_t v)
+{
+    return v < 0 ? 0 : (v > MAX_ADC_OUTPUT ? MAX_ADC_OUTPUT : v);
+}
+
+
+/*
+Prime:
+Fills the filter state as if the signal had been at the level of the first sample forever, so the filter does not
+start with a step from zero.
+*/
+static void Prime(FILTER_CHANNEL *f, int32_t code)
+{
+    int32_t in = code << FILT_STATE_BITS;
+
+    for(int k=0;k<f->order;k++){
+        f->work[k] = code;
+    }
+    for(int s=0;s<f->sections;s++){                                           // a highpass passes none of the level on
+        int32_t out = f->type == FILT_HIGHPASS ? 0 : in;
+        f->section[s].x1 = f->section[s].x2 = in;
+        f->section[s].y1 = f->section[s].y2 = out;
+        in = out;
+    }
+    if(f->type == FILT_AC){
+        f->section[0].x1 = in;                                              // AC coupling keeps its last input and output here
+        f->section[0].y1 = 0;
+    }
+}
+
+
+/*
+RunBiquads:
+Runs the samples through the cascade of biquads. The samples inside carry FILT_STATE_BITS fraction bits so the
+rounding of a narrow notch does not build up.
+*/
+static void RunBiquads(FILTER_CHANNEL *f, uint16_t arr[], int count, int32_t offset)
+{
+    for(int n=0;n<count;n++){
+        int32_t v = ((arr[n] & UNDERFLOW_CHECK) ? 0 : arr[n]) << FILT_STATE_BITS;
+        for(int s=0;s<f->sections;s++){
+            FILTER_SECTION *q = &f->section[s];
+            int64_t acc = (int64_t)q->b0 * v + (int64_t)q->b1 * q->x1 + (int64_t)q->b2 * q->x2
+                        - (int64_t)q->a1 * q->y1 - (int64_t)q->a2 * q->y2;
+            int32_t y = (int32_t)((acc + ((int64_t)1 << (FILT_COEF_BITS - 1))) >> FILT_COEF_BITS);
+            q->x2 = q->x1;
+            q->x1 = v;
+            q->y2 = q->y1;
+            q->y1 = y;
+            v = y;
+        }
+        arr[n] = Clamp(((v + (1 << (FILT_STATE_BITS - 1))) >> FILT_STATE_BITS) + offset);
+    }
+}
+
+
+/*
+RunFir:
+Runs the samples through the FIR a chunk at a time. The work buffer holds the last order inputs followed by the
+chunk, so every output is one straight pass over the taps - two at a time with the dual multiply-accumulate. The
+taps are symmetric, so they need not be reversed.
+*/
+static void RunFir(FILTER_CHANNEL *f, uint16_t arr[], int count, int32_t offset)
+{
+    int pairs = (f->order + 2) / 2;                                           // the odd number of taps and a zero
+
+    for(int done=0;done<count;){
+        int chunk = count - done < FILT_CHUNK ? count - done : FILT_CHUNK;
+        int16_t *in = f->work + f->order;
+        for(int n=0;n<chunk;n++){
+            in[n] = (arr[done + n] & UNDERFLOW_CHECK) ? 0 : arr[done + n];
+        }
+        for(int n=0;n<chunk;n++){
+            int32_t acc = 1 << (FILT_TAP_BITS - 1);
+            for(int k=0;k<2*pairs;k+=2){
+                uint32_t x, h;
+                memcpy(&x, &f->work[n + k], sizeof(x));                         // a load of two samples - the M4 allows it unaligned
+                memcpy(&h, &f->taps[k], sizeof(h));
+                acc = FILT_DUAL_MAC(x, h, acc);
+            }
+            arr[done + n] = Clamp((acc >> FILT_TAP_BITS) + offset);
+        }
+        memmove(f->work, f->work + chunk, f->order * sizeof(int16_t));        // the last inputs lead the next chunk
+        done += chunk;
+    }
+}
+
+
+/*
+RunAc:
+AC coupling - a first order highpass with its pole at 1 - 2^-FILT_AC_SHIFT, which takes the level off the signal
+and centers it on the middle of the ADC range.
+*/
+static void RunAc(FILTER_CHANNEL *f, uint16_t arr[], int count)
+{
+    int32_t x1 = f->section[0].x1;
+    int32_t y1 = f->section[0].y1;
+
+    for(int n=0;n<count;n++){
+        int32_t x = ((arr[n] & UNDERFLOW_CHECK) ? 0 : arr[n]) << FILT_STATE_BITS;
+        y1 = x - x1 + y1 - (y1 >> FILT_AC_SHIFT);
+        x1 = x;
+        arr[n] = Clamp(((y1 + (1 << (FILT_STATE_BITS - 1))) >> FILT_STATE_BITS) + FILT_CENTER);
+    }
+    f->section[0].x1 = x1;
+    f->section[0].y1 = y1;
+}
+
+
+/*
+Filt_Run:
+Filters count samples of a channel in place, carrying the state on from the samples it filtered last.
+*/
+void Filt_Run(FILTER_CHANNEL *f, uint16_t arr[], int count)
+{
+    int32_t offset = f->type == FILT_HIGHPASS ? FILT_CENTER : 0;             // a highpass output is centered on the middle of the range
+
+    if(f->type == FILT_OFF || count <= 0){
+        return;
+    }
+    if(!f->primed){
+        Prime(f, (arr[0] & UNDERFLOW_CHECK) ? 0 : arr[0]);
+        f->primed = TRUE;
+    }
+    if(f->type == FILT_AC){
+        RunAc(f, arr, count);
+    } else if(f->fir && f->type != FILT_NOTCH){
+        RunFir(f, arr, count, offset);
+    } else {
+        RunBiquads(f, arr, count, offset);
+    }
+}
+
+
+/*
+Filt_Channels:
+Filters the newest samples of both channels in place. Called with each block in block mode and each segment in
+streaming mode; a buffer that is the same as last time (channel 2 has not finished its next block yet) is skipped.
+*/
+void Filt_Channels(uint16_t ch1[], uint16_t ch2[], int count)
+{
+    if(FILTERS[0].type == FILT_OFF && FILTERS[1].type == FILT_OFF){
+        return;
+    }
+    PROFILE_BEGIN(PROF_FILTER);
+    if(ch1 != LastFiltered[0]){
+        Filt_Run(&FILTERS[0], ch1, count);
+        LastFiltered[0] = ch1;
+    }
+    if(ch2 != LastFiltered[1]){
+        Filt_Run(&FILTERS[1], ch2, count);
+        LastFiltered[1] = ch2;
+    }
+    PROFILE_END(PROF_FILTER);
+}
+
+
+/*
+Describe:
+Writes one line of the filter report for a channel.
+*/
+static void Describe(char line[], int channel, FILTER_CHANNEL *f)
+{
+    if(f->type == FILT_LOWPASS || f->type == FILT_HIGHPASS){
+        sprintf(line,"CH%d %s %d HZ, %s order %d\n",channel,f->type == FILT_LOWPASS ? "lowpass" : "highpass",f->cutoff,
+                f->fir ? "FIR" : "IIR",f->order);
+    } else if(f->type == FILT_AC){
+        sprintf(line,"CH%d AC coupled\n",channel);
+    } else if(f->type == FILT_NOTCH){
+        sprintf(line,"CH%d notch at %d HZ\n",channel,f->cutoff);
+    } else {
+        sprintf(line,"CH%d filter off\n",channel);
+    }
+}
+
+
+/*
+Filt_Command:
+Handles setfilt<1 or 2>_ followed by off, lowpass<HZ>, highpass<HZ>, ac, notch50, notch60, fir, iir or
+order<n>, and filt, which reports the filters of both channels. Returns TRUE if the command was one of these,
+FALSE otherwise.
+*/
+int Filt_Command(char str[])
+{
+    char line[FILT_LINE_LEN];
+
+    if(!strncasecmp(str,"setfilt",7)){
+        int channel = str[7] - '0';
+        char *cmd = str + 9;
+        FILTER_CHANNEL *f;
+        if((channel != CHANNEL_1 && channel != CHANNEL_2) || str[8] != '_'){
+            return FALSE;
+        }
+        f = &FILTERS[channel - 1];
+        if(!strncasecmp(cmd,"off",3)){
+            f->type = FILT_OFF;
+        } else if(!strncasecmp(cmd,"lowpass",7) || !strncasecmp(cmd,"highpass",8)){
+            int lowpass = !strncasecmp(cmd,"lowpass",7);
+            int cutoff = atoi(cmd + (lowpass ? 7 : 8));
+            if(cutoff < FILT_MIN_CUTOFF || cutoff > FILT_MAX_CUTOFF){
+                UART_PutString("Invalid filter cutoff\n");
+                return TRUE;
+            }
+            f->type = lowpass ? FILT_LOWPASS : FILT_HIGHPASS;
+            f->cutoff = cutoff;
+        } else if(!strncasecmp(cmd,"ac",2)){
+            f->type = FILT_AC;
+        } else if(!strncasecmp(cmd,"notch50",7)){
+            f->type = FILT_NOTCH;
+            f->cutoff = FILT_MAINS_50;
+        } else if(!strncasecmp(cmd,"notch60",7)){
+            f->type = FILT_NOTCH;
+            f->cutoff = FILT_MAINS_60;
+        } else if(!strncasecmp(cmd,"fir",3)){
+            f->fir = TRUE;
+        } else if(!strncasecmp(cmd,"iir",3)){
+            f->fir = FALSE;
+            if(f->order > FILT_MAX_IIR_ORDER){
+                f->order = FILT_MAX_IIR_ORDER;                                // an FIR order too high for the biquads
+            }
+        } else if(!strncasecmp(cmd,"order",5)){
+            int order = atoi(cmd + 5);
+            if(order < 2 || order % 2 || order > (f->fir ? FILT_MAX_FIR_ORDER : FILT_MAX_IIR_ORDER)){
+                UART_PutString("Invalid filter order\n");
+                return TRUE;
+            }
+            f->order = order;
+        } else {
+            return FALSE;
+        }
+        Filt_Design(f);
+    } else if(strncasecmp(str,"filt",4)){
+        return FALSE;
+    }
+    Describe(line, CHANNEL_1, &FILTERS[0]);
+    UART_PutString(line);
+    Describe(line, CHANNEL_2, &FILTERS[1]);
+    UART_PutString(line);
+    return TRUE;
+}
@@ -0,0 +1,106 @@
+/* ========================================
+ *
+ * Tiny Scope input filter header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the input filters: each channel can be
+ * lowpass or highpass filtered, AC coupled or notched at 50 or
+ * 60 HZ. The filter runs on the samples in place as soon as a
+ * block (or in streaming mode a segment) is in the channel
+ * buffer, so the trigger, the measurements and the display all
+ * see the filtered signal. Lowpass and highpass are either a
+ * Butterworth IIR of order 2 to 8, a cascade of fixed point
+ * biquads, or a linear phase windowed-sinc FIR of order 2 to 62
+ * whose taps are summed two at a time with the M4's dual
+ * multiply-accumulate. AC coupling is a first order highpass
+ * a few HZ up and the notch is a biquad; both are IIR only since
+ * an FIR that sharp would need thousands of taps. The
+ * coefficients are designed in fixed point when a setting
+ * changes and the filter state carries from one block to the
+ * next so the stream is filtered without seams.
+ *
+ * ========================================
+*/
+
+#ifndef FILTER_H
+#define FILTER_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines for the filter types */
+#define FILT_OFF 0                // no filtering
+#define FILT_LOWPASS 1            // lowpass at the cutoff
+#define FILT_HIGHPASS 2           // highpass at the cutoff
+#define FILT_AC 3                 // AC coupling
+#define FILT_NOTCH 4              // notch at the mains frequency
+
+/* Defines */
+#define FILT_MAX_SECTIONS 4       // biquads of the largest IIR filter
+#define FILT_MAX_IIR_ORDER (2 * FILT_MAX_SECTIONS)
+#define FILT_MAX_TAPS 64          // taps of the largest FIR filter, an even number so they pair up
+#define FILT_MAX_FIR_ORDER (FILT_MAX_TAPS - 2)  // an FIR of order n has n + 1 taps, and n is even for linear phase
+#define FILT_DEFAULT_ORDER 4      // order of a new filter
+#define FILT_DEFAULT_CUTOFF 10000 // cutoff of a new filter in HZ
+#define FILT_MIN_CUTOFF 100       // lowest cutoff in HZ - below it the biquad coefficients lose too many bits
+#define FILT_MAX_CUTOFF 100000    // highest cutoff in HZ, under half the sampling rate
+#define FILT_CHUNK 256            // samples an FIR filters at a time
+#define FILT_COEF_BITS 29         // fraction bits of the biquad coefficients
+#define FILT_STATE_BITS 16        // fraction bits of the samples inside the biquads
+#define FILT_TAP_BITS 15          // fraction bits of the FIR taps
+#define FILT_TRIG_BITS 30         // fraction bits of the sines and cosines the filters are designed with
+#define FILT_PI 1686629713        // pi with FILT_TRIG_BITS - 1 fraction bits (pi / 2 with FILT_TRIG_BITS)
+#define FILT_HAMMING_A 579820585  // 0.54 with FILT_TRIG_BITS fraction bits
+#define FILT_HAMMING_B 493921239  // 0.46 with FILT_TRIG_BITS fraction bits
+#define FILT_SINE_TERMS 8         // terms of the sine series
+#define FILT_AC_SHIFT 13          // AC coupling pole at 1 - 2^-13, about 4.5 HZ
+#define FILT_NOTCH_Q 5            // quality of the notch - 10 HZ wide at 50 HZ
+#define FILT_MAINS_50 50          // notch frequencies in HZ
+#define FILT_MAINS_60 60
+#define FILT_CENTER 0x400         // the code a highpass or AC coupled output is centered on
+#define FILT_LINE_LEN 100         // length of one line of the filter report
+
+/* Two sixteen bit products added to acc - one SMLAD on the M4 */
+#ifdef HOST_BUILD
+#define FILT_DUAL_MAC(x, y, acc) ((acc) + (int16_t)(x) * (int16_t)(y) + (int16_t)((x) >> 16) * (int16_t)((y) >> 16))
+#else
+#define FILT_DUAL_MAC(x, y, acc) ((int32_t)__SMLAD((x), (y), (uint32_t)(acc)))
+#endif
+
+/* Structures */
+typedef struct FILTER_SECTION{
+    int32_t b0, b1, b2;           // feed forward coefficients
+    int32_t a1, a2;               // feedback coefficients
+    int32_t x1, x2;               // the last two inputs
+    int32_t y1, y2;               // the last two outputs
+}FILTER_SECTION;
+
+typedef struct FILTER_CHANNEL{
+    int type;                     // one of the FILT_ types
+    int fir;                      // TRUE for an FIR lowpass or highpass, FALSE for biquads
+    int order;                    // order of the filter
+    int cutoff;                   // cutoff in HZ, or the notch frequency
+    int primed;                   // FALSE until the state has been filled from the first sample
+    int sections;                 // biquads in use
+    FILTER_SECTION section[FILT_MAX_SECTIONS];
+    int16_t taps[FILT_MAX_TAPS];  // FIR taps with the unused ones zero
+    int16_t work[FILT_MAX_TAPS + FILT_CHUNK];  // the last order inputs, then the chunk being filtered
+}FILTER_CHANNEL;
+
+/* Globals */
+extern FILTER_CHANNEL FILTERS[2];
+
+/* Function prototypes */
+int32_t Filt_Sin(uint32_t phase);
+
+void Filt_Design(FILTER_CHANNEL *f);
+
+void Filt_Run(FILTER_CHANNEL *f, uint16_t arr[], int count);
+
+void Filt_Channels(uint16_t ch1[], uint16_t ch2[], int count);
+
+int Filt_Command(char str[]);
+
+#endif /* FILTER_H */
@@ -24,9 +24,11 @@ the y coordinates of points in an array, the size of each array, and the startin
 */
 void DrawWaveForm(int WaveX[X_PIXELS], int WaveY[X_PIXELS], int size, int Start_point)
 {
+    PROFILE_BEGIN(PROF_DRAW_WAVEFORM);
     for(int i=0;i<size-1;i++){                                                           // we iterate through the data in the array
         GUI_DrawLine(WaveX[i],WaveY[i]+Start_point,WaveX[i+1],WaveY[i+1]+Start_point);   // we draw lines between each point in the arrays to form the waveform
     }
+    PROFILE_END(PROF_DRAW_WAVEFORM);
 }
 
 
@@ -167,6 +169,7 @@ the x and y scales.
 */
 void SetBackground(SCOPE_SETTINGS SCOPE, WAVEFORM_DATA WAVE)
 {
+    PROFILE_BEGIN(PROF_SET_BACKGROUND);
     GUI_SetColor(GUI_LIGHTGRAY);                                   // the grid lines are grey and dashed
     GUI_SetLineStyle(GUI_LS_DASH);
     
@@ -192,6 +195,27 @@ void SetBackground(SCOPE_SETTINGS SCOPE, WAVEFORM_DATA WAVE)
         sprintf(str,"Yscale: 1500 mV    ");                        // we need a special case for when the yscale was set to 1500 mv
     }
     GUI_DispStringAt(str,RIGHT_MARGIN,LOWER_MARGIN);
+    if(SCOPE.statsMode){                                           // in statistics mode we also show the update rate and dead time of the last interval
+        sprintf(str,"Upd: %lu.%lu wfm/s  Dead: %lu.%lu %%    ",(unsigned long)STATS.updateRateX10/10,(unsigned long)STATS.updateRateX10%10,
+                (unsigned long)STATS.deadTimeX10/10,(unsigned long)STATS.deadTimeX10%10);
+        GUI_DispStringAt(str,MARGIN,Y_PIXELS-STATS_MARGIN);
+    }
+    if(XCORR.on && XCORR.valid){                                   // the delay of channel 2 behind channel 1, and the phase if channel 1 has a frequency
+        int32_t phase = XCORR.phase < 0 ? -XCORR.phase : XCORR.phase;
+        if(XCORR.phaseValid){
+            sprintf(str,"Dly: %ld ns  Ph: %s%ld.%ld deg    ",(long)XCORR.delayNs,XCORR.phase < 0 ? "-" : "",(long)(phase/10),(long)(phase%10));
+        } else {
+            sprintf(str,"Dly: %ld ns    ",(long)XCORR.delayNs);
+        }
+        GUI_DispStringAt(str,MARGIN,Y_PIXELS-XCORR_MARGIN);
+    }
+    if(MEAS.on){                                                   // the statistics of each measurement after its live value
+        Meas_Draw();
+    }
+    if(MASK.on){                                                   // the pass and fail counts of the mask test
+        Mask_Status();
+    }
+    PROFILE_END(PROF_SET_BACKGROUND);
 }
 
 
@@ -209,6 +233,7 @@ void GetInput(SCOPE_SETTINGS *SCOPE)
     char toPrint[STRLEN];                                                     // string to send responses to the user through the UART
     static int index = 0;                                                     // index for acessing part of the string
     
+    PROFILE_BEGIN(PROF_GET_INPUT);
     
     if(UART_GetArray(str+index, sizeof(char))){                               // add input to the string at location specified by the index
         if(*(str+index) != ' ' && *(str+index) != '\t'){
@@ -217,6 +242,7 @@ void GetInput(SCOPE_SETTINGS *SCOPE)
      
         if(str[index-1] == '\n' || index >= STRLEN-1){                        // this indicates the end of the command from the user
             str[index] = 0;                                                   // adds NULL terminator to string
+            TRACE(TRACE_COMMAND,str[0],index);                                // recording the command in the event trace
             index = 0;                                                        // reseting index to prepare for new user input
             
             /* Long list of checks for each possible command using case-insensitive string comparison 
@@ -243,7 +269,7 @@ void GetInput(SCOPE_SETTINGS *SCOPE)
                 UART_PutString("Trigger source set to channel 2\n");
             } else if(!strncasecmp(str,"setxscale",9)){
                 int xScale = atoi(&str[9]);                                             // set xscale has a number argument - we convert it to an integer
-                if(xScale >= MIN_XSCALE && xScale <= MAX_XSCALE){                       // check if the argument is in the range (if invalid argument atoi returns 0)
+                if(xScale >= (ETS.on ? ETS_MIN_XSCALE : MIN_XSCALE) && xScale <= MAX_XSCALE){   // check if the argument is in the range (if invalid argument atoi returns 0) - equivalent time goes faster
                     SCOPE->xScale = xScale;                                             // updating the scale and we print the result
                     sprintf(toPrint,"set xscale to %d us\n",xScale);
                     UART_PutString(toPrint);
@@ -270,13 +296,131 @@ void GetInput(SCOPE_SETTINGS *SCOPE)
                 }
             } else if(!strncasecmp(str,"start",5)){
                 SCOPE->Running = TRUE;                                                 // starting the scope
+                Acq_Resume(SCOPE->acqMode);                                            // a single shot may have stopped the DMAs
+                Trigger_Reset();                                                       // the trigger engine starts from a clean state
+                Seg_Reset();                                                           // a new run fills the segment memory from the start
+                Deep_Reset(*SCOPE);                                                    // and captures a new deep record
+                Logic_Reset(*SCOPE);                                                   // or logic record
+                Ets_Reset();                                                           // and fills the equivalent time grid again
+                Avg_Reset();                                                           // and averages from the first frame
+                Xy_Reset();                                                            // and plots XY on a clear screen
+                Dec_Reset();                                                           // and decodes from a clean bus state
+                Meas_Reset();                                                          // and starts the measurement statistics again
+                Mask_Reset();                                                          // and the mask counts
                 UART_PutString("Started the scope\n");
             } else if(!strncasecmp(str,"stop",4)){
                 UART_PutString("Stopped the scope\n");
                 SCOPE->Running = FALSE;                                                // stopping the scope
+            } else if(!strncasecmp(str,"settrigger_",11) && !SCOPE->Running){
+                if(!Trigger_Command(str,SCOPE)){                                       // the advanced trigger settings are handled by the trigger engine
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setacq_",7) && !SCOPE->Running){
+                if(!Acq_Command(str,SCOPE)){                                           // the acquisition mode is handled by the acquisition module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setseg_",7) && !SCOPE->Running){
+                if(!Seg_Command(str,SCOPE)){                                           // segmented memory is handled by the segmented memory module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"seg_",4)){
+                if(!Seg_Command(str,SCOPE)){                                           // the segment viewer works while running or stopped
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setdeep_",8) && !SCOPE->Running){
+                if(!Deep_Command(str,SCOPE)){                                          // deep memory is handled by the deep memory module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"deep_",5)){
+                if(!Deep_Command(str,SCOPE)){                                          // panning and zooming the deep record
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setlogic_",9) && !SCOPE->Running){
+                if(!Logic_Command(str,SCOPE)){                                         // the logic analyzer is handled by its own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"logic_",6)){
+                if(!Logic_Command(str,SCOPE)){                                         // ending a logic capture and panning and zooming the record
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setets_",7) || !strncasecmp(str,"ets",3)){
+                if(!Ets_Command(str,SCOPE)){                                           // equivalent time sampling is handled by its own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"sethires_",9) || !strncasecmp(str,"hires",5)){
+                if(!HiRes_Command(str,SCOPE)){                                         // the high resolution mode is handled by its own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setavg_",7) || !strncasecmp(str,"avg",3)){
+                if(!Avg_Command(str,SCOPE)){                                           // averaging across acquisitions is handled by its own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setmath_",8) || !strncasecmp(str,"math",4)){
+                if(!Math_Command(str)){                                                // the math trace is handled by its own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setxy_",6) || !strncasecmp(str,"xy",2)){
+                if(!Xy_Command(str,SCOPE)){                                            // the XY display is handled by its own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setxcorr_",9) || !strncasecmp(str,"xcorr",5)){
+                if(!Xcorr_Command(str)){                                               // the delay and phase measurement is handled by its own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setfilt",7) || !strncasecmp(str,"filt",4)){
+                if(!Filt_Command(str)){                                                // the input filters are handled by their own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setcal",6) || !strncasecmp(str,"cal",3)){
+                if(!Cal_Command(str,SCOPE)){                                           // the calibration is handled by its own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setdec_",7) || !strncasecmp(str,"dec",3)){
+                if(!Dec_Command(str)){                                                 // the protocol decoders are handled by their own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setmeas_",8) || !strncasecmp(str,"meas",4)){
+                if(!Meas_Command(str)){                                                // the measurement statistics are handled by their own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"setmask_",8) || !strncasecmp(str,"mask",4)){
+                if(!Mask_Command(str,SCOPE)){                                          // the mask testing is handled by its own module
+                    UART_PutString("Error - Invalid input\n");
+                }
+            } else if(!strncasecmp(str,"autoset",7)){
+                Autoset_Command(str,SCOPE);                                            // setting the scales and trigger from the signal
+            } else if(!strncasecmp(str,"arm",3) || !strncasecmp(str,"rearm",5)){
+                Trigger_Arm();                                                         // rearming the trigger for another single capture
+            } else if(!strncasecmp(str,"profile_reset",13)){
+                Profile_Reset();                                                       // clearing the section timings
+                UART_PutString("Profile cleared\n");
+            } else if(!strncasecmp(str,"profile",7)){
+                Profile_Dump();                                                        // printing the section timings
+            } else if(!strncasecmp(str,"stats_on",8)){
+                SCOPE->statsMode = TRUE;                                               // showing the update rate and dead time on screen
+                UART_PutString("Statistics mode on\n");
+            } else if(!strncasecmp(str,"stats_off",9)){
+                SCOPE->statsMode = FALSE;
+                UART_PutString("Statistics mode off\n");
+            } else if(!strncasecmp(str,"stats_reset",11)){
+                Stats_Reset();                                                         // clearing the acquisition counters
+                UART_PutString("Statistics cleared\n");
+            } else if(!strncasecmp(str,"stats",5)){
+                Stats_Report();                                                        // printing the acquisition counters and rates
+            } else if(!strncasecmp(str,"latency_reset",13)){
+                Latency_Reset();                                                       // clearing the latency histogram
+                UART_PutString("Latency cleared\n");
+            } else if(!strncasecmp(str,"latency",7)){
+                Latency_Report();                                                      // printing the trigger-to-pixel latency percentiles
+            } else if(!strncasecmp(str,"trace_dump",10)){
+                Trace_Dump();                                                          // sending the event trace in binary
+            } else if(!strncasecmp(str,"trace_clear",11)){
+                Trace_Clear();                                                         // emptying the event trace
+                UART_PutString("Trace cleared\n");
             } else {
                 UART_PutString("Error - Invalid input\n");                             // if the string does not match any command we send an error message
             }
         }
     }
+    PROFILE_END(PROF_GET_INPUT);
 }
\ No newline at end of file
@@ -12,12 +12,19 @@
  * ========================================
 */
 
+#ifndef HELPER_FUNCTIONS_H
+#define HELPER_FUNCTIONS_H
+
 /* Includes */
 #include <stdio.h>
 #include <stdlib.h>
 #include <strings.h>
+#ifdef HOST_BUILD
+#include "HostPlatform.h"         // stand-ins for the PSoC and emWin APIs when the kernels are built on a PC
+#else
 #include "project.h"
 #include "GUI.h"
+#endif
 
 /* Defines */
 #define NEGATIVE 1                // for keeping track of trigger slope
@@ -61,6 +68,11 @@
 #define RIGHT_MARGIN 200          // margin of spacing between text and right edge of the screen 
 #define LOWER_MARGIN 25           // margin of spacing from top to second text (below top text)
 
+/* Conversions from user units */
+#define MILLIVOLTS_TO_CODE(mv) (((mv) * MAX_ADC_OUTPUT) / MAX_VOLTAGE)                    // a voltage in millivolts as an ADC code
+#define MICROSECONDS_TO_SAMPLES(us) ((int)(((int64_t)(us) * SAMPLING_RATE) / 1000000))   // a time in microseconds as a number of samples
+#define CODE_TO_PIXEL(v, yScale) (((v) & UNDERFLOW_CHECK) ? 0 : -(int)(v)*VOLTAGE_INT*(yScale)/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN))   // an ADC code as a y coordinate (negative readings at 0)
+
 /* Defines for timing */
 #define READY_TO_START 35
 #define FIND_MIDDLE 37
@@ -77,6 +89,8 @@ typedef struct SCOPE_SETTINGS{    // structure for holding the settings of the t
     int triggerLevel;             // millivolts for trigger to activate (set to 1500 millivolts by default)
     int Running;                  // for keeping track if the scope is running / has been started (set to false by default)
     int triggerChannel;           // for keeping track of which channel the trigger is set to  (set to channel 1 be default)
+    int statsMode;                // for keeping track of if the update rate and dead time are shown on screen (set to false by default)
+    int acqMode;                  // for keeping track of if the channels are acquired separately or interleaved (set to separate by default)
 }SCOPE_SETTINGS;
 
 typedef struct WAVEFORM_DATA{
@@ -94,6 +108,7 @@ typedef struct WAVEFORM_DATA{
     int Freq2;                    // integer for holding the frequency of the channel 2 waveform
     uint16_t Wave1Offset;         // the offset of the wave 1 determined by reading from the poteniometer
     uint16_t Wave2Offset;         // the offset of the wave 2 determined by reading from the poteniometer
+    uint32_t TriggerTime;         // tick time the trigger sample of the frame was taken (for the trigger-to-pixel latency)
 }WAVEFORM_DATA;
 
 /* Function prototypes */
@@ -109,4 +124,29 @@ void GetInput(SCOPE_SETTINGS *SCOPE);
 
 void SetBackground(SCOPE_SETTINGS SCOPE, WAVEFORM_DATA WAVE);
 
-int FindFrequency(uint16_t arr[], uint16_t middleVal);
\ No newline at end of file
+int FindFrequency(uint16_t arr[], uint16_t middleVal);
+
+/* Subsystem headers - included last since some of them use the structures above */
+#include "Profiler.h"
+#include "Trace.h"
+#include "ScopeStats.h"
+#include "Latency.h"
+#include "Trigger.h"
+#include "Acquisition.h"
+#include "Segmented.h"
+#include "Deep.h"
+#include "EquivTime.h"
+#include "HighRes.h"
+#include "Average.h"
+#include "MathTrace.h"
+#include "XY.h"
+#include "Correlate.h"
+#include "Filter.h"
+#include "Autoset.h"
+#include "Calibrate.h"
+#include "Decode.h"
+#include "Logic.h"
+#include "Measure.h"
+#include "Mask.h"
+
+#endif /* HELPER_FUNCTIONS_H */
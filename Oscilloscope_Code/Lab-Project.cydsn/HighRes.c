@@ -0,0 +1,180 @@
+/* ========================================
+ *
+ * Tiny Scope high resolution definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the boxcar kernel that sums the samples of a
+ * pixel column, the column formatting for block mode and for
+ * streaming mode (where a column can run across the two halves
+ * of the ping-pong buffers) and the sethires_ and hires
+ * commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the high resolution setting */
+HIGH_RES HIRES = {FALSE};
+
+/* the wave structure and channel buffers from main_cm4.c */
+extern WAVEFORM_DATA WAVE;
+extern uint16_t CH1_Data1[SIZE];
+extern uint16_t CH1_Data2[SIZE];
+extern uint16_t CH2_Data1[SIZE];
+extern uint16_t CH2_Data2[SIZE];
+
+
+/*
+ColumnCount:
+Returns the number of samples in the column that starts at index (scaled by INDEX_SCALE): every sample up to the
+start of the next column, and at least one so a column narrower than a sample still shows the sample it is on.
+*/
+static int ColumnCount(uint64_t index, int xScale)
+{
+    uint64_t step = (xScale*INDEX_SCALE)/INDEX_DIVISOR;
+    int count = (int)((index + step) / INDEX_SCALE - index / INDEX_SCALE);
+    return count > 0 ? count : 1;
+}
+
+
+/*
+HiRes_Sum:
+The boxcar kernel - returns the sum of count samples. Underflowed samples count as zero, the same as a single
+underflowed sample is drawn at zero.
+*/
+uint32_t HiRes_Sum(const uint16_t arr[], int count)
+{
+    uint32_t sum = 0;
+
+    for(int j=0;j<count;j++){
+        uint16_t v = arr[j];
+        sum += (v & UNDERFLOW_CHECK) ? 0 : v;                                // compiles to a select, so the loop has no branches
+    }
+    return sum;
+}
+
+
+/*
+HiRes_RingSum:
+Returns the sum of count samples starting at sample number first, where the samples are numbered through the ring
+of both ping-pong halves as in streaming mode. A column that runs off the end of one half is summed in two parts.
+*/
+uint32_t HiRes_RingSum(const uint16_t half1[], const uint16_t half2[], uint64_t first, int count)
+{
+    uint32_t n = first % (2 * SIZE);
+    uint32_t sum = 0;
+
+    while(count > 0){
+        const uint16_t *half = n < SIZE ? half1 + n : half2 + (n - SIZE);
+        int left = SIZE - (int)(n % SIZE);                                   // samples before the end of this half
+        int part = count < left ? count : left;
+        sum += HiRes_Sum(half, part);
+        count -= part;
+        n = (n + part) % (2 * SIZE);
+    }
+    return sum;
+}
+
+
+/*
+HiRes_Mean:
+Returns the mean of a column in 1/(1 << HIRES_FRACTION_BITS) of an ADC code, rounded to the nearest.
+*/
+int32_t HiRes_Mean(uint32_t sum, int count)
+{
+    return (int32_t)((((uint64_t)sum << HIRES_FRACTION_BITS) + count / 2) / count);
+}
+
+
+/*
+HiRes_Y:
+Returns the y coordinate of a column mean, scaled the same way a single sample is but without dropping the
+fraction of a code first.
+*/
+int HiRes_Y(uint32_t sum, int count, int yScale)
+{
+    int64_t mean = HiRes_Mean(sum, count);
+    return (int)(-mean*VOLTAGE_INT*yScale/((int64_t)MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN << HIRES_FRACTION_BITS));
+}
+
+
+/*
+HiRes_Format:
+Proccess_Channel's pixel loop in high resolution mode. Formats pixels from *i on, each from the mean of its column
+of one block; the last column of a block is cut short at the end of the buffer. Returns TRUE when the frame is
+done, or FALSE when the index ran past the block - *index and *i are left where the next block continues from,
+the same as the single sample loops.
+*/
+int HiRes_Format(uint16_t ch1[], uint16_t ch2[], uint64_t *index, int *i, SCOPE_SETTINGS SCOPE)
+{
+    for(;*i<X_PIXELS;(*i)++){
+        int start = *index / INDEX_SCALE;
+        int count = ColumnCount(*index, SCOPE.xScale);
+        if(start + count > SIZE){
+            count = SIZE - start;
+        }
+        WAVE.Wave1X[*i] = *i;
+        WAVE.Wave2X[*i] = *i;
+        WAVE.Wave1Y[*i] = HiRes_Y(HiRes_Sum(ch1 + start, count), count, SCOPE.yScale);
+        WAVE.Wave2Y[*i] = HiRes_Y(HiRes_Sum(ch2 + start, count), count, SCOPE.yScale);
+        if(MATH.op != MATH_OFF){
+            Math_Pixel(*i, start + count - 1, SCOPE);                        // the math trace from the last sample of the column
+        }
+        *index += (SCOPE.xScale*INDEX_SCALE)/INDEX_DIVISOR;
+        if(*index >= MAX_INDEX){
+            *index -= MAX_INDEX;
+            return FALSE;                                                    // the rest of the frame comes from the next block
+        }
+    }
+    return TRUE;
+}
+
+
+/*
+HiRes_Pixel:
+Formats pixel i in streaming mode from the mean of the column starting at next (a sample number scaled by
+INDEX_SCALE). Proccess_Segments only calls this once the last sample of the column has arrived.
+*/
+void HiRes_Pixel(int i, uint64_t next, SCOPE_SETTINGS SCOPE)
+{
+    int count = ColumnCount(next, SCOPE.xScale);
+    uint64_t first = next / INDEX_SCALE;
+
+    WAVE.Wave1X[i] = i;
+    WAVE.Wave2X[i] = i;
+    WAVE.Wave1Y[i] = HiRes_Y(HiRes_RingSum(CH1_Data1, CH1_Data2, first, count), count, SCOPE.yScale);
+    WAVE.Wave2Y[i] = HiRes_Y(HiRes_RingSum(CH2_Data1, CH2_Data2, first, count), count, SCOPE.yScale);
+    if(MATH.op != MATH_OFF){
+        Math_Pixel(i, first + count - 1, SCOPE);                             // the last sample of the column is in the newest segment
+    }
+}
+
+
+/*
+HiRes_Command:
+Handles sethires_on and sethires_off, and hires, which reports how many samples each column averages at the
+current timebase. Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int HiRes_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    char line[HIRES_LINE_LEN];
+    int tenths = SCOPE->xScale * 10 / INDEX_DIVISOR;                         // samples per column in tenths
+
+    if(!strncasecmp(str,"sethires_on",11)){
+        HIRES.on = TRUE;
+        UART_PutString("High resolution on\n");
+    } else if(!strncasecmp(str,"sethires_off",12)){
+        HIRES.on = FALSE;
+        UART_PutString("High resolution off\n");
+    } else if(!strncasecmp(str,"hires",5)){
+        sprintf(line,"High resolution %s, %d.%d samples per column\n",HIRES.on ? "on" : "off",tenths / 10,tenths % 10);
+        UART_PutString(line);
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
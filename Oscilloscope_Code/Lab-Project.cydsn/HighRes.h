@@ -0,0 +1,56 @@
+/* ========================================
+ *
+ * Tiny Scope high resolution header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the high resolution mode. Normally each
+ * pixel column shows the one sample at its start and every
+ * other sample under it is thrown away. In high resolution mode
+ * each column shows the mean of all of its samples instead - a
+ * boxcar (a first order CIC decimator) over the samples between
+ * one column and the next. Averaging N samples divides white
+ * noise by the square root of N, so at slow timebases, where
+ * many samples fall in each column, the trace gains about half
+ * a bit of vertical resolution for every doubling of N. The
+ * means are kept to 1/16 of an ADC code so the extra bits are
+ * not rounded away before they reach the pixel scaling.
+ *
+ * ========================================
+*/
+
+#ifndef HIGH_RES_H
+#define HIGH_RES_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define HIRES_FRACTION_BITS 4     // bits below one ADC code kept in a column mean
+#define HIRES_LINE_LEN 80         // length of one line of the high resolution report
+
+/* Structures */
+typedef struct HIGH_RES{
+    int on;                       // TRUE while the columns are boxcar means instead of single samples
+}HIGH_RES;
+
+/* Globals */
+extern HIGH_RES HIRES;
+
+/* Function prototypes */
+uint32_t HiRes_Sum(const uint16_t arr[], int count);
+
+uint32_t HiRes_RingSum(const uint16_t half1[], const uint16_t half2[], uint64_t first, int count);
+
+int32_t HiRes_Mean(uint32_t sum, int count);
+
+int HiRes_Y(uint32_t sum, int count, int yScale);
+
+int HiRes_Format(uint16_t ch1[], uint16_t ch2[], uint64_t *index, int *i, SCOPE_SETTINGS SCOPE);
+
+void HiRes_Pixel(int i, uint64_t next, SCOPE_SETTINGS SCOPE);
+
+int HiRes_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* HIGH_RES_H */
@@ -0,0 +1,130 @@
+/* ========================================
+ *
+ * Tiny Scope latency definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the latency histogram and the functions for
+ * recording a frame's latency, reading percentiles back out of
+ * the histogram and reporting them over the UART.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the latency histogram */
+LATENCY_HISTOGRAM LATENCY;
+
+
+/*
+BucketOf:
+Returns the histogram bucket of a latency. Values below 2*LATENCY_SUB_BUCKETS get a bucket each, larger values
+are split into LATENCY_SUB_BUCKETS buckets per power of two.
+*/
+static int BucketOf(uint32_t us)
+{
+    if(us < 2 * LATENCY_SUB_BUCKETS){
+        return us;
+    }
+    int octave = 31 - __builtin_clz(us);                                         // position of the highest set bit (at least 3)
+    int bucket = LATENCY_SUB_BUCKETS * (octave - 1) + ((us >> (octave - 2)) & (LATENCY_SUB_BUCKETS - 1));
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+
+/*
+BucketTop:
+Returns the largest latency that falls into a bucket - the inverse of BucketOf.
+*/
+static uint32_t BucketTop(int bucket)
+{
+    if(bucket < 2 * LATENCY_SUB_BUCKETS){
+        return bucket;
+    }
+    int octave = bucket / LATENCY_SUB_BUCKETS + 1;
+    uint32_t width = 1u << (octave - 2);
+    return (LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) * width + width - 1;
+}
+
+
+/*
+Latency_SampleTime:
+Works out the tick time a sample was taken from the time its block completed. The last sample of the block was
+taken when the DMA finished, and each earlier sample one sampling period before the next.
+*/
+uint32_t Latency_SampleTime(uint32_t blockEndTime, uint32_t sample)
+{
+    uint64_t samplesBefore = sample < SIZE ? SIZE - 1 - sample : 0;       // the last sample was taken at the block end time itself
+    return blockEndTime - (uint32_t)(samplesBefore * Profile_TicksPerUs() * US_PER_SECOND / SAMPLING_RATE);
+}
+
+
+/*
+Latency_Record:
+Records the latency of the frame whose trigger sample was taken at triggerTime. It is called once the last LCD
+write for the frame has completed.
+*/
+void Latency_Record(uint32_t triggerTime)
+{
+    uint32_t us = (Profile_Now() - triggerTime) / Profile_TicksPerUs();           // unsigned difference survives the counter wrapping
+
+    LATENCY.buckets[BucketOf(us)]++;
+    LATENCY.count++;
+    LATENCY.totalUs += us;
+    if(us > LATENCY.maxUs){
+        LATENCY.maxUs = us;
+    }
+}
+
+
+/*
+Latency_Percentile:
+Returns the latency in microseconds that the given percent of frames did not exceed. The value is the top of the
+bucket the percentile falls in, so it is at most 25% high, and never more than the max.
+*/
+uint32_t Latency_Percentile(int percent)
+{
+    uint32_t rank = ((uint64_t)LATENCY.count * percent + 99) / 100;               // rank of the frame we are looking for (rounded up)
+    uint32_t seen = 0;
+
+    if(LATENCY.count == 0){
+        return 0;
+    }
+    for(int i=0;i<LATENCY_BUCKETS;i++){
+        seen += LATENCY.buckets[i];
+        if(seen >= rank){
+            uint32_t top = BucketTop(i);
+            return top < LATENCY.maxUs ? top : LATENCY.maxUs;
+        }
+    }
+    return LATENCY.maxUs;
+}
+
+
+/*
+Latency_Reset:
+Clears the histogram.
+*/
+void Latency_Reset(void)
+{
+    memset(&LATENCY, 0, sizeof(LATENCY));
+}
+
+
+/*
+Latency_Report:
+Prints the number of frames and their p50, p99, max and mean trigger-to-pixel latency in microseconds.
+*/
+void Latency_Report(void)
+{
+    char str[LATENCY_LINE_LEN];
+    uint32_t mean = LATENCY.count ? LATENCY.totalUs / LATENCY.count : 0;
+
+    sprintf(str,"frames %lu p50 %lu us p99 %lu us max %lu us mean %lu us\n",(unsigned long)LATENCY.count,
+            (unsigned long)Latency_Percentile(50),(unsigned long)Latency_Percentile(99),(unsigned long)LATENCY.maxUs,
+            (unsigned long)mean);
+    UART_PutString(str);
+}
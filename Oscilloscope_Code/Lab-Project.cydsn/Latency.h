@@ -0,0 +1,52 @@
+/* ========================================
+ *
+ * Tiny Scope latency header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the trigger-to-pixel latency histogram.
+ * Every frame carries the time its trigger sample was taken
+ * (worked out from the time its DMA block completed and the
+ * sample's position in the block). When the last LCD write
+ * of the frame is done the difference is recorded into a
+ * log-linear histogram that gives p50, p99 and max.
+ *
+ * ========================================
+*/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define LATENCY_SUB_BUCKETS 4     // buckets per power of two (each bucket is at most 25% wide)
+#define LATENCY_BUCKETS 100       // number of buckets - covers latencies up to about a minute
+#define LATENCY_LINE_LEN 100      // length of one line of the latency report
+#define US_PER_SECOND 1000000     // microseconds in a second
+
+/* Structures */
+typedef struct LATENCY_HISTOGRAM{
+    uint32_t buckets[LATENCY_BUCKETS]; // number of frames that fell in each bucket
+    uint32_t count;               // number of frames recorded
+    uint32_t maxUs;               // largest latency seen in microseconds
+    uint64_t totalUs;             // sum of all latencies in microseconds, for the mean
+}LATENCY_HISTOGRAM;
+
+/* Globals */
+extern LATENCY_HISTOGRAM LATENCY;
+
+/* Function prototypes */
+uint32_t Latency_SampleTime(uint32_t blockEndTime, uint32_t sample);
+
+void Latency_Record(uint32_t triggerTime);
+
+uint32_t Latency_Percentile(int percent);
+
+void Latency_Reset(void);
+
+void Latency_Report(void);
+
+#endif /* LATENCY_H */
@@ -0,0 +1,505 @@
+/* ========================================
+ *
+ * Tiny Scope logic analyzer definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the edge storage of the logic analyzer, the
+ * single shot capture, the cursors that read the record back,
+ * the pan and zoom view and the setlogic_ and logic_ commands.
+ * The gaps of channel 1 fill the first half of the capture
+ * memory and those of channel 2 the second.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the logic analyzer settings and record */
+LOGIC_ANALYZER LOGIC = {FALSE, MILLIVOLTS_TO_CODE(LOGIC_DEFAULT_LEVEL), (uint32_t)((uint64_t)LOGIC_DEFAULT_TIME * SAMPLING_RATE / 1000),
+                        FALSE, FALSE, 0, 0, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {{0}}, {{0}}, 0, 0, {0, 0}};
+
+/* the wave structure from main_cm4.c, for the channel offsets */
+extern WAVEFORM_DATA WAVE;
+
+/* the edges of one channel of the chunk of the stretch being recorded */
+static uint16_t Edges[DEC_CHUNK];
+
+/* the columns drawn last time, so they can be erased - each end is 0 or -LOGIC_HEIGHT */
+static int8_t PrevTop[2][X_PIXELS];
+static int8_t PrevBottom[2][X_PIXELS];
+
+
+/*
+Put:
+Stores one word of a channel's record, with a checkpoint of the time and level before it if it starts a group of
+LOGIC_CHECK_WORDS.
+*/
+static inline void Put(int channel, uint16_t word)
+{
+    int k = LOGIC.words[channel]++;
+
+    if(!(k & (LOGIC_CHECK_WORDS - 1))){
+        LOGIC.checkTime[channel][k >> LOGIC_CHECK_SHIFT] = LOGIC.at[channel];
+        LOGIC.checkLevel[channel][k >> LOGIC_CHECK_SHIFT] = LOGIC.state[channel];
+    }
+    ACQ_Pool[channel * LOGIC_WORDS + k] = word;
+}
+
+
+/*
+Store:
+Stores an edge of a channel at sample t of the record as the gap since the channel's last edge. Returns FALSE,
+storing nothing, if the words it needs don't fit.
+*/
+static int Store(int channel, uint32_t t)
+{
+    uint32_t gap = t - LOGIC.at[channel];
+
+    if(LOGIC.words[channel] + (int)(gap / LOGIC_ESCAPE) + 1 > LOGIC_WORDS){
+        return FALSE;
+    }
+    while(gap >= LOGIC_ESCAPE){
+        Put(channel, LOGIC_ESCAPE);
+        LOGIC.at[channel] += LOGIC_ESCAPE;
+        gap -= LOGIC_ESCAPE;
+    }
+    Put(channel, gap);
+    LOGIC.at[channel] = t;
+    LOGIC.state[channel] = !LOGIC.state[channel];
+    LOGIC.edges[channel]++;
+    return TRUE;
+}
+
+
+/*
+Logic_Record:
+Adds count samples of both channels to the record, DEC_CHUNK samples at a time. The first samples of a record set
+the starting levels. Returns the number of samples recorded, which is less than count if a channel's memory filled
+up - the record then ends just before the edge that did not fit.
+*/
+int Logic_Record(const uint16_t ch1[], const uint16_t ch2[], int count)
+{
+    const uint16_t *arr[2] = {ch1, ch2};
+    int recorded = 0;
+
+    PROFILE_BEGIN(PROF_LOGIC);
+    if(LOGIC.length == 0){
+        for(int c=0;c<2;c++){
+            LOGIC.start[c] = ((arr[c][0] & UNDERFLOW_CHECK) ? 0 : arr[c][0]) > LOGIC.level;
+            LOGIC.state[c] = LOGIC.start[c];
+            LOGIC.at[c] = 0;
+            LOGIC.words[c] = 0;
+            LOGIC.edges[c] = 0;
+        }
+    }
+    while(recorded < count){
+        int size = count - recorded < DEC_CHUNK ? count - recorded : DEC_CHUNK;
+        int done = size;
+        for(int c=0;c<2;c++){
+            int state = LOGIC.state[c];
+            int n = Dec_Edges(arr[c] + recorded, size, LOGIC.level, &state, Edges);
+            for(int e=0;e<n && Edges[e]<done;e++){
+                if(!Store(c, LOGIC.length + Edges[e])){
+                    done = Edges[e];                                         // channel 1 may have stored edges past this - the cursors stop at the length
+                    break;
+                }
+            }
+        }
+        LOGIC.length += done;
+        recorded += done;
+        if(done < size){
+            break;
+        }
+    }
+    PROFILE_END(PROF_LOGIC);
+    return recorded;
+}
+
+
+/*
+NextEdge:
+Returns the sample of the next edge after a cursor, or LOGIC_NO_EDGE if there is none in the record.
+*/
+static uint32_t NextEdge(const LOGIC_CURSOR *k)
+{
+    const uint16_t *w = ACQ_Pool + k->channel * LOGIC_WORDS;
+    uint32_t t = k->time;
+
+    for(int i=k->word;i<LOGIC.words[k->channel];i++){
+        t += w[i];
+        if(w[i] != LOGIC_ESCAPE){
+            return t < LOGIC.length ? t : LOGIC_NO_EDGE;
+        }
+    }
+    return LOGIC_NO_EDGE;
+}
+
+
+/*
+Logic_Cursor:
+Puts a cursor at the start of a channel's record (0 or 1).
+*/
+void Logic_Cursor(LOGIC_CURSOR *k, int channel)
+{
+    k->channel = channel;
+    k->word = 0;
+    k->time = 0;
+    k->level = LOGIC.start[channel];
+    k->next = NextEdge(k);
+}
+
+
+/*
+Logic_Seek:
+Moves a cursor forward to sample t: afterwards its level is the channel's level at t and next the first edge after
+t. If t is past the next checkpoint the cursor jumps to the last checkpoint before t by binary search, so it never
+reads more than LOGIC_CHECK_WORDS words however many edges it passes.
+*/
+void Logic_Seek(LOGIC_CURSOR *k, uint32_t t)
+{
+    int c = k->channel;
+    const uint16_t *w = ACQ_Pool + c * LOGIC_WORDS;
+    int checks = (LOGIC.words[c] + LOGIC_CHECK_WORDS - 1) >> LOGIC_CHECK_SHIFT;
+    int lo = (k->word >> LOGIC_CHECK_SHIFT) + 1;                              // the first checkpoint ahead of the cursor
+
+    if(k->next > t){
+        return;                                                              // nothing to pass
+    }
+    if(lo < checks && LOGIC.checkTime[c][lo] <= t){
+        int hi = checks - 1;
+        while(lo < hi){
+            int mid = (lo + hi + 1) / 2;
+            if(LOGIC.checkTime[c][mid] <= t){
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        k->word = lo << LOGIC_CHECK_SHIFT;
+        k->time = LOGIC.checkTime[c][lo];
+        k->level = LOGIC.checkLevel[c][lo];
+    }
+    while(k->word < LOGIC.words[c] && k->time + w[k->word] <= t){
+        if(w[k->word] != LOGIC_ESCAPE){
+            k->level = !k->level;
+        }
+        k->time += w[k->word++];
+    }
+    k->next = NextEdge(k);
+}
+
+
+/*
+Clamp:
+Keeps the view inside the record.
+*/
+static void Clamp(int64_t start, int64_t span)
+{
+    if(span > LOGIC.length){
+        span = LOGIC.length;
+    }
+    if(span < LOGIC_MIN_SPAN){
+        span = LOGIC_MIN_SPAN;
+    }
+    if(start > (int64_t)LOGIC.length - span){
+        start = (int64_t)LOGIC.length - span;
+    }
+    if(start < 0){
+        start = 0;
+    }
+    LOGIC.viewStart = start;
+    LOGIC.span = span;
+}
+
+
+/*
+ReadPot:
+Reads a potentiometer as a value from 0 to MAX_ADC_OUTPUT.
+*/
+static int ReadPot(uint32_t chan)
+{
+    int v = (int16_t)ADC_GetResult16(chan);
+
+    if(v < 0){
+        return 0;
+    }
+    return v > MAX_ADC_OUTPUT ? MAX_ADC_OUTPUT : v;
+}
+
+
+/*
+Logic_Reset:
+Throws away the record so the next run captures a new one, and clears it off the screen if it was shown. Called
+when the scope is started.
+*/
+void Logic_Reset(SCOPE_SETTINGS SCOPE)
+{
+    LOGIC.length = 0;
+    LOGIC.capturing = FALSE;
+    if(LOGIC.viewing){
+        LOGIC.viewing = FALSE;
+        GUI_Clear();
+        SetBackground(SCOPE, WAVE);
+    }
+}
+
+
+/*
+Finish:
+Ends the capture: the scope stops and the whole record is drawn.
+*/
+static void Finish(SCOPE_SETTINGS *SCOPE)
+{
+    char str[LOGIC_LINE_LEN];
+
+    LOGIC.capturing = FALSE;
+    LOGIC.viewing = TRUE;
+    Clamp(0, LOGIC.length);
+    LOGIC.pot[0] = ReadPot(1);                                               // the view only follows the potentiometers once they move
+    LOGIC.pot[1] = ReadPot(3);
+    SCOPE->Running = FALSE;                                                  // a logic capture is a single shot
+
+    sprintf(str,"Logic capture of %lu us, %lu and %lu edges in %d%% of the memory - stopped the scope\n",
+            (unsigned long)(((uint64_t)LOGIC.length * 1000000) / SAMPLING_RATE),(unsigned long)LOGIC.edges[0],
+            (unsigned long)LOGIC.edges[1],(LOGIC.words[0] > LOGIC.words[1] ? LOGIC.words[0] : LOGIC.words[1]) * 100 / LOGIC_WORDS);
+    UART_PutString(str);
+    GUI_Clear();
+    Logic_Draw(*SCOPE);
+}
+
+
+/*
+Logic_Capture:
+Takes one stretch of newly acquired samples (time-aligned on both channels, the first being sample number first).
+The record starts at the first trigger (or straight away in free-run mode) and ends when a channel's memory is full
+or it reaches the set length.
+*/
+void Logic_Capture(uint16_t ch1[], uint16_t ch2[], int size, uint64_t first, SCOPE_SETTINGS *SCOPE)
+{
+    int from = 0;
+
+    if(LOGIC.viewing){
+        return;                                                              // one record per run
+    }
+    if(!LOGIC.capturing){
+        if(!SCOPE->freeRun){
+            int used;
+            PROFILE_BEGIN(PROF_FIND_TRIGGER);
+            from = Trigger_Next(ch1, ch2, size, *SCOPE, &used);
+            PROFILE_END(PROF_FIND_TRIGGER);
+            if(from < 0){
+                return;
+            }
+            TRACE(TRACE_TRIGGER_FOUND,SCOPE->triggerChannel,from);
+        }
+        LOGIC.capturing = TRUE;
+        LOGIC.length = 0;
+        LOGIC.time = first + from;
+    }
+
+    int n = size - from;
+    if((uint32_t)n > LOGIC.maxLength - LOGIC.length){
+        n = LOGIC.maxLength - LOGIC.length;
+    }
+    if(Logic_Record(ch1 + from, ch2 + from, n) == n && LOGIC.length < LOGIC.maxLength){
+        return;
+    }
+    Finish(SCOPE);
+}
+
+
+/*
+Logic_Draw:
+Draws the part of the record in view. Each channel is a trace LOGIC_HEIGHT pixels high at its offset. A pixel
+column without an edge under it is a point at the level there, and one with edges is a line from low to high, so
+a burst too fast to resolve shows as a solid bar. One cursor per channel is moved across the view, so the columns
+cost a seek each whatever the zoom. The last columns are erased first the same way UpdateDisplay erases the last
+waveform.
+*/
+void Logic_Draw(SCOPE_SETTINGS SCOPE)
+{
+    int offsets[2] = {Y_PIXELS-WAVE.Wave1Offset, Y_PIXELS-WAVE.Wave2Offset};
+    GUI_COLOR colors[2] = {GUI_RED, GUI_YELLOW};
+    char str[LOGIC_LINE_LEN];
+    LOGIC_CURSOR k;
+
+    PROFILE_BEGIN(PROF_UPDATE_DISPLAY);
+    GUI_SetPenSize(2);
+    GUI_SetColor(GUI_BLACK);
+    for(int c=0;c<2;c++){
+        for(int p=0;p<X_PIXELS;p++){
+            GUI_DrawLine(p,PrevTop[c][p]+offsets[c],p,PrevBottom[c][p]+offsets[c]);
+        }
+    }
+    SetBackground(SCOPE, WAVE);
+
+    for(int c=1;c>=0;c--){                                                   // channel 2 first so channel 1 is drawn on top
+        GUI_SetColor(colors[c]);
+        Logic_Cursor(&k, c);
+        for(int p=0;p<X_PIXELS;p++){
+            uint32_t start = LOGIC.viewStart + (uint32_t)(((uint64_t)p * LOGIC.span) / X_PIXELS);
+            uint32_t end = LOGIC.viewStart + (uint32_t)(((uint64_t)(p + 1) * LOGIC.span) / X_PIXELS);
+            if(end <= start){
+                end = start + 1;                                             // zoomed in past one sample per pixel
+            }
+            Logic_Seek(&k, start);
+            int top = k.level ? -LOGIC_HEIGHT : 0;
+            int bottom = top;
+            if(k.next < end){
+                top = -LOGIC_HEIGHT;
+                bottom = 0;
+            }
+            GUI_DrawLine(p,top+offsets[c],p,bottom+offsets[c]);
+            PrevTop[c][p] = top;
+            PrevBottom[c][p] = bottom;
+        }
+    }
+
+    GUI_SetColor(GUI_WHITE);
+    sprintf(str,"Logic %lu us/div at %lu us of %lu us    ",
+            (unsigned long)(((uint64_t)LOGIC.span * 1000000) / (SAMPLING_RATE * (X_PIXELS / PIXELS_PER_X))),
+            (unsigned long)(((uint64_t)LOGIC.viewStart * 1000000) / SAMPLING_RATE),
+            (unsigned long)(((uint64_t)LOGIC.length * 1000000) / SAMPLING_RATE));
+    GUI_DispStringAt(str,MARGIN,Y_PIXELS-LOGIC_MARGIN);
+    PROFILE_END(PROF_UPDATE_DISPLAY);
+}
+
+
+/*
+Logic_Poll:
+Lets the potentiometers pan and zoom the record while it is shown, the same way they do a deep record: channel 1's
+moves the view from the start of the record to the end, channel 2's zooms from the whole record down to
+LOGIC_MIN_SPAN samples in steps of two.
+*/
+void Logic_Poll(SCOPE_SETTINGS SCOPE)
+{
+    int pan = ReadPot(1);
+    int zoom = ReadPot(3);
+    int steps = 0;
+
+    if(abs(pan - LOGIC.pot[0]) < LOGIC_POT_DEADBAND && abs(zoom - LOGIC.pot[1]) < LOGIC_POT_DEADBAND){
+        return;
+    }
+    LOGIC.pot[0] = pan;
+    LOGIC.pot[1] = zoom;
+
+    while((LOGIC.length >> (steps + 1)) >= LOGIC_MIN_SPAN){
+        steps++;                                                             // halvings from the whole record to the closest zoom
+    }
+    int64_t span = LOGIC.length >> ((zoom * (steps + 1)) / (MAX_ADC_OUTPUT + 1));
+    Clamp(((int64_t)pan * (LOGIC.length - span)) / MAX_ADC_OUTPUT, span);
+    Logic_Draw(SCOPE);
+}
+
+
+/*
+Logic_Command:
+Handles the setlogic_ commands, which turn the logic analyzer on or off and set its threshold (setlogic_level<mV>)
+and longest record (setlogic_time<ms>) while stopped, logic_end, which ends a capture early, and the logic_ view
+commands: logic_zoomin and logic_zoomout (by two about the middle of the view), logic_left and logic_right (by half
+a screen), logic_full, logic_view<start us>,<span us> and logic_info. Returns TRUE if the command was one of these,
+FALSE otherwise.
+*/
+int Logic_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    char toPrint[LOGIC_LINE_LEN];
+    int64_t start = LOGIC.viewStart;
+    int64_t span = LOGIC.span;
+    int a;
+
+    if(!strncasecmp(str,"setlogic_",9)){
+        if(SCOPE->Running){
+            return FALSE;
+        }
+        if(!strncasecmp(str,"setlogic_on",11)){
+            if(SCOPE->acqMode != ACQ_STREAMING){
+                UART_PutString("The logic analyzer needs streaming acquisition - enter setacq_streaming first\n");
+                return TRUE;
+            }
+            LOGIC.on = TRUE;
+            SEGMENTS.on = FALSE;                                             // the capture modes share the capture memory
+            DEEP.on = FALSE;
+            ETS.on = FALSE;
+            Xy_Off();
+            XCORR.on = FALSE;
+        } else if(!strncasecmp(str,"setlogic_off",12)){
+            LOGIC.on = FALSE;
+            UART_PutString("Logic analyzer off\n");
+            return TRUE;
+        } else if(!strncasecmp(str,"setlogic_level",14)){
+            a = atoi(&str[14]);
+            if(a < MIN_TRIGGER_LEVEL || a > MAX_TRIGGER_LEVEL){
+                UART_PutString("Invalid logic threshold\n");
+                return TRUE;
+            }
+            LOGIC.level = MILLIVOLTS_TO_CODE(a);
+        } else if(!strncasecmp(str,"setlogic_time",13)){
+            a = atoi(&str[13]);
+            if(a <= 0 || a > LOGIC_MAX_TIME){
+                sprintf(toPrint,"Invalid record length - at most %d ms\n",LOGIC_MAX_TIME);
+                UART_PutString(toPrint);
+                return TRUE;
+            }
+            LOGIC.maxLength = (uint32_t)((uint64_t)a * SAMPLING_RATE / 1000);
+        } else {
+            return FALSE;
+        }
+        sprintf(toPrint,"Logic analyzer %s - up to %lu ms, threshold %d mV\n",LOGIC.on ? "on" : "off",
+                (unsigned long)(((uint64_t)LOGIC.maxLength * 1000 + SAMPLING_RATE / 2) / SAMPLING_RATE),LOGIC.level * MAX_VOLTAGE / MAX_ADC_OUTPUT);
+        UART_PutString(toPrint);
+        return TRUE;
+    }
+
+    if(strncasecmp(str,"logic_",6)){
+        return FALSE;
+    }
+    if(!strncasecmp(str,"logic_end",9)){
+        if(!LOGIC.capturing){
+            UART_PutString("No logic capture in progress\n");
+        } else {
+            Finish(SCOPE);
+        }
+        return TRUE;
+    }
+    if(!LOGIC.viewing){
+        UART_PutString("No logic record captured\n");
+        return TRUE;
+    }
+    if(!strncasecmp(str,"logic_zoomin",12)){
+        start += span / 4;
+        span /= 2;
+    } else if(!strncasecmp(str,"logic_zoomout",13)){
+        start -= span / 2;
+        span *= 2;
+    } else if(!strncasecmp(str,"logic_left",10)){
+        start -= span / 2;
+    } else if(!strncasecmp(str,"logic_right",11)){
+        start += span / 2;
+    } else if(!strncasecmp(str,"logic_full",10)){
+        start = 0;
+        span = LOGIC.length;
+    } else if(!strncasecmp(str,"logic_view",10)){
+        char *comma = strchr(&str[10],',');
+        if(!comma){
+            UART_PutString("Invalid view - enter logic_view<start us>,<span us>\n");
+            return TRUE;
+        }
+        start = ((int64_t)atoi(&str[10]) * SAMPLING_RATE) / 1000000;
+        span = ((int64_t)atoi(comma + 1) * SAMPLING_RATE) / 1000000;
+    } else if(!strncasecmp(str,"logic_info",10)){
+        sprintf(toPrint,"%lu samples, trigger at sample %lu, %lu and %lu edges, %d and %d words, view %lu to %lu\n",
+                (unsigned long)LOGIC.length,(unsigned long)LOGIC.time,(unsigned long)LOGIC.edges[0],
+                (unsigned long)LOGIC.edges[1],LOGIC.words[0],LOGIC.words[1],(unsigned long)LOGIC.viewStart,
+                (unsigned long)(LOGIC.viewStart + LOGIC.span));
+        UART_PutString(toPrint);
+        return TRUE;
+    } else {
+        return FALSE;
+    }
+    Clamp(start, span);
+    Logic_Draw(*SCOPE);
+    return TRUE;
+}
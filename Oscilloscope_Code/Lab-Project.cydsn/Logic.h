@@ -0,0 +1,100 @@
+/* ========================================
+ *
+ * Tiny Scope logic analyzer header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the logic analyzer mode: a single shot
+ * capture of both channels as digital signals. Each segment is
+ * thresholded with hysteresis into the samples where a channel
+ * changes level (the same edge lists the protocol decoders
+ * use) and only the gaps between the edges are stored, one
+ * 16 bit word each, in the capture memory. A gap too long for
+ * a word is stored as escape words of LOGIC_ESCAPE samples
+ * without an edge followed by the rest. A record therefore
+ * lasts as long as its edges allow rather than the number of
+ * samples - the same memory that holds 100 ms of deep memory
+ * holds seconds of a slow bus. Every LOGIC_CHECK_WORDS words
+ * a checkpoint keeps the time and level there, so the level
+ * at any sample is a binary search and a short scan away and
+ * each pixel column is drawn in about the same time at any
+ * zoom, however many edges it covers. The record can be
+ * panned and zoomed with the logic_ commands or the
+ * potentiometers like a deep record.
+ *
+ * ========================================
+*/
+
+#ifndef LOGIC_H
+#define LOGIC_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define LOGIC_WORDS (ACQ_POOL_MIN / 2)  // words of the capture memory each channel's gaps may use
+#define LOGIC_ESCAPE 0xFFFF       // a word of this many samples without an edge, the gap going on in the next word
+#define LOGIC_CHECK_SHIFT 6       // a checkpoint every 1 << LOGIC_CHECK_SHIFT words
+#define LOGIC_CHECK_WORDS (1 << LOGIC_CHECK_SHIFT)
+#define LOGIC_MAX_CHECKS (LOGIC_WORDS / LOGIC_CHECK_WORDS + 1)
+#define LOGIC_NO_EDGE UINT32_MAX  // the next edge of a cursor with none left
+#define LOGIC_DEFAULT_LEVEL 1650  // threshold in millivolts by default
+#define LOGIC_DEFAULT_TIME 2000   // longest record in milliseconds by default
+#define LOGIC_MAX_TIME 60000      // longest that can be set
+#define LOGIC_MIN_SPAN 80         // fewest samples across the screen when zoomed all the way in
+#define LOGIC_HEIGHT 50           // pixels between the low and high level of a channel
+#define LOGIC_POT_DEADBAND 16     // ADC codes a potentiometer must move before the view follows it
+#define LOGIC_MARGIN 45           // distance of the view description from the bottom of the screen
+#define LOGIC_LINE_LEN 160        // length of one line of the logic report
+
+/* Structures */
+typedef struct LOGIC_CURSOR{      // a place in the record of one channel
+    int channel;                  // 0 or 1
+    int word;                     // the next word to read
+    uint32_t time;                // sample the words before it reach
+    int level;                    // level after them
+    uint32_t next;                // sample of the next edge, or LOGIC_NO_EDGE
+}LOGIC_CURSOR;
+
+typedef struct LOGIC_ANALYZER{
+    int on;                       // TRUE while each run captures one logic record
+    int level;                    // threshold in codes
+    uint32_t maxLength;           // samples the record stops at if the memory lasts that long
+    int capturing;                // TRUE once the trigger has been found
+    int viewing;                  // TRUE once the record is complete and on the screen
+    uint32_t length;              // samples captured so far
+    uint64_t time;                // number of the trigger sample, counted from the start of the acquisition
+    int start[2];                 // level of each channel at the first sample
+    int state[2];                 // and after the last
+    uint32_t at[2];               // sample the stored words of each channel reach
+    int words[2];                 // words stored
+    uint32_t edges[2];            // edges stored
+    uint32_t checkTime[2][LOGIC_MAX_CHECKS];  // sample and level before every LOGIC_CHECK_WORDS-th word
+    uint8_t checkLevel[2][LOGIC_MAX_CHECKS];
+    uint32_t viewStart;           // first sample in view
+    uint32_t span;                // samples across the screen
+    int pot[2];                   // potentiometer readings the view last followed
+}LOGIC_ANALYZER;
+
+/* Globals */
+extern LOGIC_ANALYZER LOGIC;
+
+/* Function prototypes */
+void Logic_Reset(SCOPE_SETTINGS SCOPE);
+
+int Logic_Record(const uint16_t ch1[], const uint16_t ch2[], int count);
+
+void Logic_Capture(uint16_t ch1[], uint16_t ch2[], int size, uint64_t first, SCOPE_SETTINGS *SCOPE);
+
+void Logic_Cursor(LOGIC_CURSOR *k, int channel);
+
+void Logic_Seek(LOGIC_CURSOR *k, uint32_t t);
+
+void Logic_Draw(SCOPE_SETTINGS SCOPE);
+
+void Logic_Poll(SCOPE_SETTINGS SCOPE);
+
+int Logic_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* LOGIC_H */
@@ -0,0 +1,439 @@
+/* ========================================
+ *
+ * Tiny Scope mask testing definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the mask, the cutting of each triggered
+ * block into the mask's columns, the test of each frame against
+ * the mask, the counts and failure snapshot, its outline on the
+ * screen and the setmask_ and mask commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the formatted frames, in main_cm4.c */
+extern WAVEFORM_DATA WAVE;
+
+/* the frame being cut from the blocks - the highest and lowest y coordinate of each column so far */
+static int16_t High[X_PIXELS];
+static int16_t Low[X_PIXELS];
+static int Column = X_PIXELS;                                               // the column being filled, X_PIXELS while waiting for a trigger
+static uint64_t Next;                                                        // scaled index of its first sample, from the start of the frame's first block
+static uint64_t Offset;                                                      // scaled index of the start of the current block, the same way
+
+/* the mask - off and open until one is made or loaded */
+MASK_TEST MASK = {FALSE, FALSE, CHANNEL_1, FALSE, DEFAULT, DEFAULT, {0}, {0}, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, {0},
+                  FALSE, 0, {0}, {0}};
+
+
+/*
+Pixel:
+Returns the y coordinate of a voltage in millivolts at a y scale.
+*/
+static int Pixel(int mv, int yScale)
+{
+    return CODE_TO_PIXEL(MILLIVOLTS_TO_CODE(mv), yScale);
+}
+
+
+/*
+Millivolts:
+Returns the millivolts a number of pixels of height stands for at a y scale.
+*/
+static int Millivolts(int pixels, int yScale)
+{
+    return (int)((int64_t)pixels * MAX_VOLTAGE * VOLTAGE_SCALE_DOWN / ((int64_t)VOLTAGE_INT * yScale));
+}
+
+
+/*
+Mask_Reset:
+Clears the counts and the failure snapshot, keeping the mask. Called when the scope is started and when a new mask
+is made or loaded.
+*/
+void Mask_Reset(void)
+{
+    MASK.frames = 0;
+    MASK.passed = 0;
+    MASK.failed = 0;
+    MASK.violations = 0;
+    MASK.skipped = 0;
+    MASK.snapFrame = 0;
+}
+
+
+/*
+Mask_Test:
+Returns the number of columns of a frame outside the mask, given the highest and lowest y coordinate the frame takes
+in each column (the same array twice for a frame of single points). The comparisons are added up rather than
+branched on so the loop runs the same for every frame and the compiler can do several columns at a time.
+*/
+int Mask_Test(const int16_t high[], const int16_t low[], const int16_t top[], const int16_t bottom[], int count)
+{
+    int out = 0;
+
+    for(int i=0;i<count;i++){
+        out += (high[i] < top[i]) | (low[i] > bottom[i]);
+    }
+    return out;
+}
+
+
+/*
+Bound:
+Returns a y coordinate limited to what a bound of the mask holds. Past the screen either way is as good as open.
+*/
+static int16_t Bound(int y)
+{
+    if(y > MASK_OPEN){
+        return MASK_OPEN;
+    }
+    return y < -MASK_OPEN ? -MASK_OPEN : y;
+}
+
+
+/*
+Open:
+Takes the limits off every column of the mask and makes it for the current scales.
+*/
+static void Open(SCOPE_SETTINGS SCOPE)
+{
+    for(int i=0;i<X_PIXELS;i++){
+        MASK.top[i] = -MASK_OPEN;
+        MASK.bottom[i] = MASK_OPEN;
+    }
+    MASK.xScale = SCOPE.xScale;
+    MASK.yScale = SCOPE.yScale;
+    MASK.defined = TRUE;
+}
+
+
+/*
+Mask_Create:
+Makes the mask from a frame: each column may be margin pixels above the highest and below the lowest of the frame's
+columns within MASK_SPREAD of it, so a trace jittering by a column still passes.
+*/
+void Mask_Create(const int y[], int margin)
+{
+    for(int i=0;i<X_PIXELS;i++){
+        int top = y[i];
+        int bottom = y[i];
+        for(int j=i-MASK_SPREAD;j<=i+MASK_SPREAD;j++){
+            if(j >= 0 && j < X_PIXELS){
+                top = y[j] < top ? y[j] : top;
+                bottom = y[j] > bottom ? y[j] : bottom;
+            }
+        }
+        MASK.top[i] = Bound(top - margin);
+        MASK.bottom[i] = Bound(bottom + margin);
+    }
+    MASK.defined = TRUE;
+}
+
+
+/*
+Snapshot:
+Keeps a failing frame with where it left the mask and by how much. Each column keeps the side of it that is out of
+the mask, or its middle if it is in.
+*/
+static void Snapshot(const int16_t high[], const int16_t low[], int out)
+{
+    MASK.snapFrame = MASK.frames;
+    MASK.snapColumns = out;
+    MASK.snapFirst = -1;
+    MASK.snapWorst = 0;
+    MASK.snapExcess = 0;
+    for(int i=0;i<X_PIXELS;i++){
+        int excess = high[i] < MASK.top[i] ? MASK.top[i] - high[i] : low[i] > MASK.bottom[i] ? low[i] - MASK.bottom[i] : 0;
+        if(excess && MASK.snapFirst < 0){
+            MASK.snapFirst = i;
+        }
+        if(excess > MASK.snapExcess){
+            MASK.snapWorst = i;
+            MASK.snapExcess = excess;
+        }
+    }
+    for(int i=0;i<X_PIXELS;i++){
+        MASK.snapY[i] = high[i] < MASK.top[i] ? high[i] : low[i] > MASK.bottom[i] ? low[i] : (high[i] + low[i]) / 2;
+    }
+}
+
+
+/*
+Mask_Frame:
+Tests one frame of the mask's channel, given as the highest and lowest y coordinate of each column, and counts it.
+A failing frame is kept and stops the scope if stop on fail is set.
+*/
+void Mask_Frame(const int16_t high[], const int16_t low[], SCOPE_SETTINGS *SCOPE)
+{
+    char line[MASK_LINE_LEN];
+
+    PROFILE_BEGIN(PROF_MASK);
+    int out = Mask_Test(high, low, MASK.top, MASK.bottom, X_PIXELS);
+    MASK.frames++;
+    if(!out){
+        MASK.passed++;
+        PROFILE_END(PROF_MASK);
+        return;
+    }
+    MASK.failed++;
+    MASK.violations += out;
+    Snapshot(high, low, out);
+    PROFILE_END(PROF_MASK);
+    if(MASK.stopOnFail && SCOPE->Running){
+        SCOPE->Running = FALSE;                                              // the failing frame is kept for mask_show
+        sprintf(line,"Mask failed in frame %lu - stopped the scope\n",(unsigned long)MASK.snapFrame);
+        UART_PutString(line);
+    }
+}
+
+
+/*
+Mask_Block:
+Called with every block (or streaming segment) of the mask's channel as it arrives, before the display's frame
+rate limit, with the first trigger in it scaled by INDEX_SCALE or ERROR. From a trigger the samples are cut into
+X_PIXELS columns at the mask's time scale, the way a frame is formatted, and the highest and lowest sample of each
+column are kept; a frame can run on into the blocks after. Once the last column is in the frame is tested. Free-run
+has nothing to line the columns up with, and a trigger at other scales than the mask's doesn't line up with it,
+so neither is tested.
+*/
+void Mask_Block(const uint16_t samples[], int size, uint64_t found, SCOPE_SETTINGS *SCOPE)
+{
+    uint64_t step = (SCOPE->xScale*INDEX_SCALE)/INDEX_DIVISOR;
+    int64_t base;
+
+    if(!MASK.on || SCOPE->freeRun){
+        Column = X_PIXELS;
+        return;
+    }
+    if(Column == X_PIXELS){
+        if(found == ERROR){
+            return;
+        }
+        if(SCOPE->xScale != MASK.xScale || SCOPE->yScale != MASK.yScale){
+            MASK.skipped++;
+            return;
+        }
+        Column = 0;
+        Next = found;
+        Offset = 0;
+    }
+
+    PROFILE_BEGIN(PROF_MASK);
+    base = (int64_t)(Offset / INDEX_SCALE);                                  // the block's first sample, counted from the frame's first block
+    for(;Column<X_PIXELS;Column++){
+        int64_t from = (int64_t)(Next / INDEX_SCALE) - base;
+        int64_t to = (int64_t)((Next + step) / INDEX_SCALE) - base;
+        if(to <= from){
+            to = from + 1;                                                   // zoomed in past one sample per column
+        }
+        if(from >= size){
+            break;                                                           // the column starts in a later block
+        }
+        int64_t i = from < 0 ? 0 : from;                                     // a column begun in an earlier block carries on
+        int16_t high = from < 0 ? High[Column] : MASK_OPEN;
+        int16_t low = from < 0 ? Low[Column] : -MASK_OPEN;
+        for(;i<to && i<size;i++){
+            int16_t y = CODE_TO_PIXEL(samples[i], SCOPE->yScale);
+            high = y < high ? y : high;
+            low = y > low ? y : low;
+        }
+        High[Column] = high;
+        Low[Column] = low;
+        if(to > size){
+            break;                                                           // the rest of the column is in the next block
+        }
+        Next += step;
+    }
+    Offset += (uint64_t)size * INDEX_SCALE;
+    PROFILE_END(PROF_MASK);
+
+    if(Column == X_PIXELS){
+        Mask_Frame(High, Low, SCOPE);
+    }
+}
+
+
+/*
+Outline:
+Draws one side of the mask at an offset, leaving out the columns with no limit.
+*/
+static void Outline(const int16_t bound[], int offset)
+{
+    for(int i=0;i<X_PIXELS-1;i++){
+        if(bound[i] > -MASK_OPEN && bound[i] < MASK_OPEN && bound[i+1] > -MASK_OPEN && bound[i+1] < MASK_OPEN){
+            GUI_DrawLine(i,bound[i]+offset,i+1,bound[i+1]+offset);
+        }
+    }
+}
+
+
+/*
+Mask_Erase:
+Draws over the mask drawn last time with the background color.
+*/
+void Mask_Erase(void)
+{
+    if(!MASK.drawn){
+        return;
+    }
+    GUI_SetColor(GUI_BLACK);
+    Outline(MASK.drawnTop, MASK.drawnOffset);
+    Outline(MASK.drawnBottom, MASK.drawnOffset);
+    MASK.drawn = FALSE;
+}
+
+
+/*
+Mask_Draw:
+Draws the outline of the mask at the offset of its channel, under the waveforms. Called from UpdateDisplay while
+the mask is on.
+*/
+void Mask_Draw(int offset)
+{
+    GUI_SetColor(GUI_BLUE);
+    Outline(MASK.top, offset);
+    Outline(MASK.bottom, offset);
+    memcpy(MASK.drawnTop, MASK.top, sizeof(MASK.drawnTop));
+    memcpy(MASK.drawnBottom, MASK.bottom, sizeof(MASK.drawnBottom));
+    MASK.drawnOffset = offset;
+    MASK.drawn = TRUE;
+}
+
+
+/*
+Mask_Status:
+Shows the pass and fail counts. Called from SetBackground while the mask is on.
+*/
+void Mask_Status(void)
+{
+    char line[MASK_LINE_LEN];
+
+    sprintf(line,"Mask: %lu pass %lu fail    ",(unsigned long)MASK.passed,(unsigned long)MASK.failed);
+    GUI_DispStringAt(line,MARGIN,Y_PIXELS-MASK_MARGIN);
+}
+
+
+/*
+ParseValues:
+Reads up to max comma separated numbers from a command argument. Returns how many were read.
+*/
+static int ParseValues(char str[], int values[], int max)
+{
+    int count = 0;
+
+    while(count < max && *str){
+        values[count++] = atoi(str);
+        str = strchr(str, ',');
+        if(!str){
+            break;
+        }
+        str++;
+    }
+    return count;
+}
+
+
+/*
+Mask_Command:
+Handles setmask_create<mV>, which makes the mask from the frame on the screen of the mask's channel with a margin
+of mV either side (MASK_DEFAULT_MARGIN if none is given), setmask_cols<first>,<last>,<low mV>,<high mV>, which
+loads the limits of a range of columns (a limit of 0 or less, or of MAX_VOLTAGE or more, leaves that side open),
+setmask_on, setmask_off, setmask_ch1, setmask_ch2, setmask_stop_on and setmask_stop_off, and mask_reset,
+mask_snapshot, which reports the latest failing frame, mask_show, which puts it back on the screen while the
+scope is stopped, and mask, which reports the counts. Returns TRUE if the command was one of these, FALSE
+otherwise.
+*/
+int Mask_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    char line[MASK_LINE_LEN];
+    int values[MASK_MAX_VALUES];
+
+    if(!strncasecmp(str,"setmask_create",14)){
+        int margin = str[14] >= '0' && str[14] <= '9' ? atoi(&str[14]) : MASK_DEFAULT_MARGIN;
+        if(margin < 0 || margin > MAX_VOLTAGE){
+            UART_PutString("Invalid mask margin\n");
+            return TRUE;
+        }
+        Mask_Create(MASK.channel == CHANNEL_2 ? WAVE.Wave2Y : WAVE.Wave1Y, -Pixel(margin, SCOPE->yScale));
+        MASK.xScale = SCOPE->xScale;
+        MASK.yScale = SCOPE->yScale;
+        MASK.on = TRUE;
+        Mask_Reset();
+        sprintf(line,"Mask made from channel %d with a margin of %d mV\n",MASK.channel,margin);
+        UART_PutString(line);
+    } else if(!strncasecmp(str,"setmask_cols",12)){
+        if(ParseValues(&str[12], values, MASK_MAX_VALUES) != MASK_MAX_VALUES || values[0] < 0 || values[1] < values[0]
+        || values[1] >= X_PIXELS || values[3] < values[2]){
+            UART_PutString("Invalid mask columns - setmask_cols<first>,<last>,<low mV>,<high mV>\n");
+            return TRUE;
+        }
+        if(!MASK.defined || MASK.xScale != SCOPE->xScale || MASK.yScale != SCOPE->yScale){
+            Open(*SCOPE);                                                    // a mask for other scales is started again
+        }
+        for(int i=values[0];i<=values[1];i++){
+            MASK.bottom[i] = values[2] <= 0 ? MASK_OPEN : Bound(Pixel(values[2], SCOPE->yScale));
+            MASK.top[i] = values[3] >= MAX_VOLTAGE ? -MASK_OPEN : Bound(Pixel(values[3], SCOPE->yScale));
+        }
+        MASK.on = TRUE;
+        Mask_Reset();
+        sprintf(line,"Mask columns %d to %d loaded\n",values[0],values[1]);
+        UART_PutString(line);
+    } else if(!strncasecmp(str,"setmask_on",10)){
+        if(!MASK.defined){
+            UART_PutString("No mask - make one with setmask_create or setmask_cols\n");
+            return TRUE;
+        }
+        MASK.on = TRUE;
+        UART_PutString("Mask testing on\n");
+    } else if(!strncasecmp(str,"setmask_off",11)){
+        MASK.on = FALSE;
+        UART_PutString("Mask testing off\n");
+    } else if(!strncasecmp(str,"setmask_ch1",11) || !strncasecmp(str,"setmask_ch2",11)){
+        MASK.channel = str[10] == '2' ? CHANNEL_2 : CHANNEL_1;
+        sprintf(line,"Mask tests channel %d\n",MASK.channel);
+        UART_PutString(line);
+    } else if(!strncasecmp(str,"setmask_stop_on",15)){
+        MASK.stopOnFail = TRUE;
+        UART_PutString("The scope stops on a mask failure\n");
+    } else if(!strncasecmp(str,"setmask_stop_off",16)){
+        MASK.stopOnFail = FALSE;
+        UART_PutString("The scope runs on through mask failures\n");
+    } else if(!strncasecmp(str,"mask_reset",10)){
+        Mask_Reset();
+        UART_PutString("Mask counts cleared\n");
+    } else if(!strncasecmp(str,"mask_snapshot",13)){
+        if(!MASK.snapFrame){
+            UART_PutString("No failing frame\n");
+            return TRUE;
+        }
+        sprintf(line,"Frame %lu failed in %d columns from %d us, worst at %d us by %d mV\n",(unsigned long)MASK.snapFrame,
+                MASK.snapColumns,MASK.snapFirst*MASK.xScale/PIXELS_PER_X,MASK.snapWorst*MASK.xScale/PIXELS_PER_X,
+                Millivolts(MASK.snapExcess, MASK.yScale));
+        UART_PutString(line);
+    } else if(!strncasecmp(str,"mask_show",9)){
+        if(SCOPE->Running || !MASK.snapFrame){
+            UART_PutString("Stop the scope after a failing frame to show it\n");
+            return TRUE;
+        }
+        int *y = MASK.channel == CHANNEL_2 ? WAVE.Wave2Y : WAVE.Wave1Y;
+        for(int i=0;i<X_PIXELS;i++){
+            y[i] = MASK.snapY[i];
+        }
+        sprintf(line,"Frame %lu on the screen\n",(unsigned long)MASK.snapFrame);
+        UART_PutString(line);
+    } else if(!strncasecmp(str,"mask",4)){
+        sprintf(line,"Mask ch%d %s: %lu frames %lu pass %lu fail, %lu columns out, %lu skipped\n",MASK.channel,
+                MASK.on ? "on" : "off",(unsigned long)MASK.frames,(unsigned long)MASK.passed,(unsigned long)MASK.failed,
+                (unsigned long)MASK.violations,(unsigned long)MASK.skipped);
+        UART_PutString(line);
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,93 @@
+/* ========================================
+ *
+ * Tiny Scope mask testing header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides pass/fail testing of the frames against a
+ * mask: the lowest and highest y coordinate each pixel column
+ * of one channel may take. A mask is made from the frame on the
+ * screen widened by a margin either side of it and by a column
+ * either way, or loaded over the UART a range of columns at a
+ * time. Every triggered block is then tested against it as it
+ * arrives, not only the few the display has time to format:
+ * from the trigger the block is cut into the mask's columns at
+ * the mask's time scale, and the smallest and largest sample
+ * of each column are tested, so a glitch between the samples a
+ * frame would draw is caught too. The test of a frame is one
+ * pass over the columns counting the ones outside the mask
+ * without a branch in the loop, and only a failing frame is
+ * looked at again. The frames tested, passed and
+ * failed and the columns out of the mask are counted, the
+ * latest failing frame is kept so it can be reported or put
+ * back on the screen, and the scope can be stopped on the
+ * first failure.
+ *
+ * ========================================
+*/
+
+#ifndef MASK_H
+#define MASK_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define MASK_OPEN INT16_MAX       // bound of a column with no limit, past any y coordinate the screen can show
+#define MASK_SPREAD 1             // columns either way a mask made from a frame covers, for trigger jitter
+#define MASK_DEFAULT_MARGIN 200   // millivolts either side of the frame a mask is made with by default
+#define MASK_MARGIN 140           // distance of the pass/fail counts from the bottom of the screen
+#define MASK_LINE_LEN 160         // length of one line of the mask report
+#define MASK_MAX_VALUES 4         // most numbers a mask command takes
+
+/* Structures */
+typedef struct MASK_TEST{
+    int on;                       // TRUE while each frame is tested
+    int defined;                  // TRUE once a mask has been made or loaded
+    int channel;                  // CHANNEL_1 or CHANNEL_2
+    int stopOnFail;               // TRUE to stop the scope on the first failing frame
+    int xScale;                   // the settings the mask's columns were made for
+    int yScale;
+    int16_t top[X_PIXELS];        // smallest y coordinate of each column (the highest voltage)
+    int16_t bottom[X_PIXELS];     // largest y coordinate of each column (the lowest voltage)
+    uint32_t frames;              // frames tested since the reset - one from each triggered block
+    uint32_t passed;
+    uint32_t failed;
+    uint32_t violations;          // columns out of the mask over all failing frames
+    uint32_t skipped;             // triggers not tested since the scales differ from the mask's
+    uint32_t snapFrame;           // number of the latest failing frame, counted from 1
+    int snapColumns;              // columns of it out of the mask
+    int snapFirst;                // first column out
+    int snapWorst;                // the column furthest out,
+    int snapExcess;               // and by how many pixels
+    int16_t snapY[X_PIXELS];      // the frame itself
+    int drawn;                    // TRUE while the mask is on the screen
+    int drawnOffset;              // the offset it was drawn at
+    int16_t drawnTop[X_PIXELS];   // and the bounds drawn, for erasing
+    int16_t drawnBottom[X_PIXELS];
+}MASK_TEST;
+
+/* Globals */
+extern MASK_TEST MASK;
+
+/* Function prototypes */
+void Mask_Reset(void);
+
+int Mask_Test(const int16_t high[], const int16_t low[], const int16_t top[], const int16_t bottom[], int count);
+
+void Mask_Create(const int y[], int margin);
+
+void Mask_Frame(const int16_t high[], const int16_t low[], SCOPE_SETTINGS *SCOPE);
+
+void Mask_Block(const uint16_t samples[], int size, uint64_t found, SCOPE_SETTINGS *SCOPE);
+
+void Mask_Draw(int offset);
+
+void Mask_Erase(void);
+
+void Mask_Status(void);
+
+int Mask_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* MASK_H */
@@ -0,0 +1,175 @@
+/* ========================================
+ *
+ * Tiny Scope math channel definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the math kernels that work out the math
+ * trace at the samples a frame is drawn from, the formatting
+ * of the results into the pixels of the trace and the setmath_
+ * and math commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the math trace */
+MATH_CHANNEL MATH = {MATH_OFF, CHANNEL_1, MATH_DEFAULT_SCALE, Y_PIXELS / 2, NULL, NULL, 0, 0, 0, 0, 0, 0, 0, {0}, {0}, FALSE, 0};
+
+/* the names of the operations, for the report */
+static const char *MATH_NAMES[] = {"off", "CH1+CH2", "CH1-CH2", "CH1*CH2", "integral", "derivative"};
+
+
+/*
+Math_Block:
+Hands the math trace the count samples of a block or segment that belong to the frame, from channel buffers that
+point at the first of them, sample number first. restart is TRUE at the left edge of a frame: the integral starts
+from zero there and the derivative from the first sample. Otherwise both carry on from the end of the last block
+or segment. The integral's sum over all of the samples is taken now, so the next block can carry on from it even
+once these samples have been overwritten.
+*/
+void Math_Block(const uint16_t ch1[], const uint16_t ch2[], uint64_t first, int count, int restart)
+{
+    const uint16_t *src = MATH.source == CHANNEL_1 ? ch1 : ch2;
+
+    PROFILE_BEGIN(PROF_MATH);
+    if(restart){
+        MATH.sum = 0;
+        MATH.last = MATH_CODE(src[0]);
+    } else {
+        MATH.sum = MATH.endSum;
+        MATH.last = MATH.endLast;
+    }
+    MATH.ch1 = ch1;
+    MATH.ch2 = ch2;
+    MATH.first = first;
+    MATH.count = count;
+    MATH.cursor = 0;
+    if(MATH.op == MATH_INTEGRAL){
+        int32_t sum = MATH.sum;
+        for(int j=0;j<count;j++){
+            sum += MATH_CODE(src[j]);
+        }
+        MATH.endSum = sum;
+    }
+    MATH.endLast = MATH_CODE(src[count - 1]);
+    PROFILE_END(PROF_MATH);
+}
+
+
+/*
+Math_Value:
+Works out the math trace at sample n of the current block or segment, in ADC code units. The integral adds in
+the samples since the last point first, so the points of a frame must be asked for in order.
+*/
+int32_t Math_Value(uint64_t n)
+{
+    int j = (int)(n - MATH.first);
+    const uint16_t *src = MATH.source == CHANNEL_1 ? MATH.ch1 : MATH.ch2;
+
+    switch(MATH.op){
+        case MATH_ADD:
+            return MATH_CODE(MATH.ch1[j]) + MATH_CODE(MATH.ch2[j]);
+        case MATH_SUB:
+            return MATH_CODE(MATH.ch1[j]) - MATH_CODE(MATH.ch2[j]);
+        case MATH_MUL:
+            return (MATH_CODE(MATH.ch1[j]) * MATH_CODE(MATH.ch2[j])) >> MATH_PRODUCT_SHIFT;
+        case MATH_INTEGRAL: {
+            int32_t sum = MATH.sum;
+            int k = MATH.cursor;
+            for(;k<=j;k++){
+                sum += MATH_CODE(src[k]);
+            }
+            MATH.sum = sum;
+            MATH.cursor = k;
+            return sum;
+        }
+        case MATH_DERIVATIVE:
+            return MATH_CODE(src[j]) - (j > 0 ? MATH_CODE(src[j - 1]) : MATH.last);
+        default:
+            return 0;
+    }
+}
+
+
+/*
+Math_Pixel:
+Formats pixel i of the math trace from sample n, scaled like the channels and then by the math scale. The
+integral is divided by the samples across the screen first. The coordinate is limited to a screen height either
+side of the zero so a large result cannot wrap the display's coordinates.
+*/
+void Math_Pixel(int i, uint64_t n, SCOPE_SETTINGS SCOPE)
+{
+    int64_t value = Math_Value(n);
+    int64_t y;
+
+    if(MATH.op == MATH_INTEGRAL){
+        value = value * INDEX_DIVISOR / ((int64_t)X_PIXELS * SCOPE.xScale);
+    }
+    y = -value*VOLTAGE_INT*SCOPE.yScale*MATH.scale/((int64_t)MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN*MATH_DEFAULT_SCALE);
+    if(y > Y_PIXELS){
+        y = Y_PIXELS;
+    } else if(y < -Y_PIXELS){
+        y = -Y_PIXELS;
+    }
+    MATH.Y[i] = (int)y;
+}
+
+
+/*
+Math_Command:
+Handles setmath_off, setmath_add, setmath_sub, setmath_mul, setmath_integral, setmath_derivative,
+setmath_source<1 or 2>, setmath_scale<percent> and setmath_offset<pixels>, and math, which reports the settings.
+Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Math_Command(char str[])
+{
+    char line[MATH_LINE_LEN];
+
+    if(!strncasecmp(str,"setmath_offset",14)){                               // before setmath_off, which it starts with
+        int offset = atoi(str + 14);
+        if(offset < 0 || offset > Y_PIXELS){
+            UART_PutString("Invalid math offset\n");
+            return TRUE;
+        }
+        MATH.offset = offset;
+    } else if(!strncasecmp(str,"setmath_off",11)){
+        MATH.op = MATH_OFF;
+    } else if(!strncasecmp(str,"setmath_add",11)){
+        MATH.op = MATH_ADD;
+    } else if(!strncasecmp(str,"setmath_sub",11)){
+        MATH.op = MATH_SUB;
+    } else if(!strncasecmp(str,"setmath_mul",11)){
+        MATH.op = MATH_MUL;
+    } else if(!strncasecmp(str,"setmath_integral",16)){
+        MATH.op = MATH_INTEGRAL;
+    } else if(!strncasecmp(str,"setmath_derivative",18)){
+        MATH.op = MATH_DERIVATIVE;
+    } else if(!strncasecmp(str,"setmath_source",14)){
+        int source = atoi(str + 14);
+        if(source != CHANNEL_1 && source != CHANNEL_2){
+            UART_PutString("Invalid channel for the math source\n");
+            return TRUE;
+        }
+        MATH.source = source;
+    } else if(!strncasecmp(str,"setmath_scale",13)){
+        int scale = atoi(str + 13);
+        if(scale < 1 || scale > MATH_MAX_SCALE){
+            UART_PutString("Invalid math scale\n");
+            return TRUE;
+        }
+        MATH.scale = scale;
+    } else if(strncasecmp(str,"math",4)){
+        return FALSE;
+    }
+    if(MATH.op == MATH_INTEGRAL || MATH.op == MATH_DERIVATIVE){
+        sprintf(line,"Math %s of channel %d, scale %d%%, offset %d\n",MATH_NAMES[MATH.op],MATH.source,MATH.scale,MATH.offset);
+    } else {
+        sprintf(line,"Math %s, scale %d%%, offset %d\n",MATH_NAMES[MATH.op],MATH.scale,MATH.offset);
+    }
+    UART_PutString(line);
+    return TRUE;
+}
@@ -0,0 +1,84 @@
+/* ========================================
+ *
+ * Tiny Scope math channel header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the math trace: CH1 + CH2, CH1 - CH2,
+ * CH1 x CH2 (the instantaneous power when the channels are a
+ * voltage and a current), or the running integral or the
+ * derivative of one channel. Nothing is stored per sample: each
+ * drawn point is worked out from the channel buffers as it is
+ * formatted, and the integral is carried forward from one point
+ * to the next over every sample of the frame in between, so it
+ * still sees the whole signal. A block or segment hands over
+ * its samples first, and its running sum at the end is taken
+ * then, while they are still in the buffers. The results are
+ * in ADC code units: the sum and difference as codes, the product scaled down by
+ * MATH_PRODUCT_SHIFT so full scale times full scale is full
+ * scale, the integral as the running sum of codes since the left
+ * edge of the screen (drawn divided by the samples across the
+ * screen, so a steady level integrates up to itself at the
+ * right edge), and the derivative as the change in codes from
+ * one sample to the next. The trace is drawn with its own scale
+ * (a percentage of the channel scale) and offset.
+ *
+ * ========================================
+*/
+
+#ifndef MATH_TRACE_H
+#define MATH_TRACE_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines for the math operations */
+#define MATH_OFF 0                // no math trace
+#define MATH_ADD 1                // CH1 + CH2
+#define MATH_SUB 2                // CH1 - CH2
+#define MATH_MUL 3                // CH1 x CH2
+#define MATH_INTEGRAL 4           // running integral of the source channel
+#define MATH_DERIVATIVE 5         // derivative of the source channel
+
+/* Defines */
+#define MATH_PRODUCT_SHIFT 11     // a product is divided by the ADC range so it stays in code units
+#define MATH_DEFAULT_SCALE 100    // percent of the channel scale the trace is drawn at by default
+#define MATH_MAX_SCALE 10000      // largest scale in percent
+#define MATH_LINE_LEN 100         // length of one line of the math report
+#define MATH_CODE(v) (((v) & UNDERFLOW_CHECK) ? 0 : (int32_t)(v))   // an ADC code, with negative readings at 0
+
+/* Structures */
+typedef struct MATH_CHANNEL{
+    int op;                       // one of the MATH_ operations
+    int source;                   // channel the integral and derivative are taken of
+    int scale;                    // percent of the channel scale the trace is drawn at
+    int offset;                   // pixels from the bottom of the screen the zero of the trace is drawn at
+    const uint16_t *ch1;          // the frame's samples in the current block or segment
+    const uint16_t *ch2;
+    uint64_t first;               // the number of the sample ch1 and ch2 point at
+    int count;                    // and how many follow it
+    int cursor;                   // the next of them the integral has not added in yet
+    int32_t sum;                  // the running integral up to the cursor
+    int32_t last;                 // the source sample before the first, for the derivative
+    int32_t endSum;               // the running integral and last sample at the end of the block or segment,
+    int32_t endLast;              // which the next one carries on from
+    int Y[X_PIXELS];              // the pixel coordinates of the trace
+    int PrevY[X_PIXELS];          // the coordinates last drawn (used for erasing)
+    int drawn;                    // TRUE if PrevY is on the screen
+    int drawnOffset;              // the offset PrevY was drawn at
+}MATH_CHANNEL;
+
+/* Globals */
+extern MATH_CHANNEL MATH;
+
+/* Function prototypes */
+void Math_Block(const uint16_t ch1[], const uint16_t ch2[], uint64_t first, int count, int restart);
+
+int32_t Math_Value(uint64_t n);
+
+void Math_Pixel(int i, uint64_t n, SCOPE_SETTINGS SCOPE);
+
+int Math_Command(char str[]);
+
+#endif /* MATH_TRACE_H */
@@ -0,0 +1,317 @@
+/* ========================================
+ *
+ * Tiny Scope measurement statistics definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the running and windowed accumulators of the
+ * measurements, their on-screen lines and the setmeas_ and
+ * meas commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the statistics - off screen and over every value since the reset by default */
+MEAS_STATS MEAS = {FALSE, 0, {{0}}};
+
+/* how each measurement is labelled, and what its values are divided by to give the units shown */
+static const char *MEAS_NAMES[NUM_MEAS] = {"F1", "F2", "Dly", "Ph"};
+static const char *MEAS_UNITS[NUM_MEAS] = {"HZ", "HZ", "ns", "deg"};
+static const int MEAS_DIVISORS[NUM_MEAS] = {1, 1, 1, 10};
+
+
+/*
+Divide:
+Returns a / b rounded to the nearest, halves away from zero. b must be positive.
+*/
+static int64_t Divide(int64_t a, int64_t b)
+{
+    return a < 0 ? -((-a + b / 2) / b) : (a + b / 2) / b;
+}
+
+
+/*
+Sqrt:
+Returns the square root of v rounded to the nearest integer, worked out bit by bit.
+*/
+static uint64_t Sqrt(uint64_t v)
+{
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while(bit > v){
+        bit >>= 2;
+    }
+    while(bit){
+        if(v >= root + bit){
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return v > root ? root + 1 : root;                                       // v is what is left after root squared
+}
+
+
+/*
+Half:
+Returns a difference with MEAS_FRACTION_BITS of fraction rounded to MEAS_HALF_BITS, so the product of two fits.
+*/
+static inline int64_t Half(int64_t d)
+{
+    return (d + (1 << (MEAS_HALF_BITS - 1))) >> MEAS_HALF_BITS;
+}
+
+
+/*
+Meas_Reset:
+Clears the statistics of every measurement. Called when the scope is started and when the window changes.
+*/
+void Meas_Reset(void)
+{
+    memset(MEAS.stat, 0, sizeof(MEAS.stat));
+}
+
+
+/*
+Meas_Mean:
+Returns the mean of a measurement's values with MEAS_FRACTION_BITS of fraction, or 0 if it has none. The mean is
+taken from the exact sum each time, so it can't drift however many values go in.
+*/
+int64_t Meas_Mean(const MEAS_STAT *s)
+{
+    if(!s->count){
+        return 0;
+    }
+    return Divide(s->sum * (1 << MEAS_FRACTION_BITS), s->count);
+}
+
+
+/*
+Meas_Sigma:
+Returns the sample standard deviation of a measurement's values with MEAS_HALF_BITS of fraction, or 0 with fewer
+than two values.
+*/
+int64_t Meas_Sigma(const MEAS_STAT *s)
+{
+    if(s->count < 2){
+        return 0;
+    }
+    return Sqrt(s->m2 / (s->count - 1));
+}
+
+
+/*
+Rescan:
+Finds the smallest and largest value in the window ring.
+*/
+static void Rescan(MEAS_STAT *s)
+{
+    s->min = s->ring[0];
+    s->max = s->ring[0];
+    for(uint32_t i=1;i<s->count;i++){
+        s->min = s->ring[i] < s->min ? s->ring[i] : s->min;
+        s->max = s->ring[i] > s->max ? s->ring[i] : s->max;
+    }
+}
+
+
+/*
+Rebuild:
+Works the sum of squares of a full window out again from the values in the ring, so the rounding of the updates
+in between is thrown away.
+*/
+static void Rebuild(MEAS_STAT *s)
+{
+    int64_t mean = Meas_Mean(s);
+
+    s->m2 = 0;
+    for(uint32_t i=0;i<s->count;i++){
+        int64_t d = Half(((int64_t)s->ring[i] << MEAS_FRACTION_BITS) - mean);
+        s->m2 += d * d;
+    }
+    Rescan(s);
+}
+
+
+/*
+Slide:
+Puts a value into a full window in place of the oldest one. The sum of squares changes by (x - y)(x + y - the old
+mean - the new mean) for the new value x and the old one y. The smallest and largest are only searched for again
+if the old value was one of them.
+*/
+static void Slide(MEAS_STAT *s, int32_t x)
+{
+    int32_t y = s->ring[s->head];
+    int64_t before = Meas_Mean(s);
+
+    s->ring[s->head] = x;
+    s->head = (s->head + 1) % MEAS.window;
+    s->sum += (int64_t)x - y;
+    if(!s->head){
+        Rebuild(s);                                                          // once per lap of the ring
+        return;
+    }
+    int64_t after = Meas_Mean(s);
+    s->m2 += Half(((int64_t)x - y) << MEAS_FRACTION_BITS) * Half((((int64_t)x + y) << MEAS_FRACTION_BITS) - before - after);
+    if(s->m2 < 0){
+        s->m2 = 0;
+    }
+    if(y == s->min || y == s->max){
+        Rescan(s);
+    } else {
+        s->min = x < s->min ? x : s->min;
+        s->max = x > s->max ? x : s->max;
+    }
+}
+
+
+/*
+Meas_Add:
+Adds a new value of a measurement (one of the MEAS_ ids). Until the window is full (always, with no window) this is
+Welford's update: the sum of squares grows by the value's difference from the mean before it times its difference
+from the mean after it.
+*/
+void Meas_Add(int which, int32_t x)
+{
+    MEAS_STAT *s = &MEAS.stat[which];
+
+    PROFILE_BEGIN(PROF_MEASURE);
+    s->last = x;
+    if(MEAS.window && s->count == (uint32_t)MEAS.window){
+        Slide(s, x);
+    } else {
+        int64_t v = (int64_t)x << MEAS_FRACTION_BITS;
+        int64_t before = Meas_Mean(s);
+        s->count++;
+        s->sum += x;
+        int64_t after = Meas_Mean(s);
+        s->m2 += Half(v - before) * Half(v - after);
+        if(s->count == 1 || x < s->min){
+            s->min = x;
+        }
+        if(s->count == 1 || x > s->max){
+            s->max = x;
+        }
+        if(MEAS.window){
+            s->ring[s->head] = x;
+            s->head = (s->head + 1) % MEAS.window;
+        }
+    }
+    PROFILE_END(PROF_MEASURE);
+}
+
+
+/*
+Fixed:
+Writes a value of a measurement with bits of fraction in the units shown, to a tenth if decimals is TRUE.
+*/
+static void Fixed(char out[], int64_t v, int bits, int which, int decimals)
+{
+    int64_t tenths = Divide(v * 10, (int64_t)MEAS_DIVISORS[which] << bits);
+    int64_t whole = tenths < 0 ? -tenths : tenths;
+
+    if(decimals){
+        sprintf(out,"%s%ld.%ld",tenths < 0 ? "-" : "",(long)(whole/10),(long)(whole%10));
+    } else {
+        sprintf(out,"%ld",(long)Divide(tenths, 10));
+    }
+}
+
+
+/*
+Describe:
+Writes the statistics of a measurement as one line.
+*/
+static void Describe(char line[], int which)
+{
+    const MEAS_STAT *s = &MEAS.stat[which];
+    int decimals = MEAS_DIVISORS[which] > 1;
+    char last[STRLEN], mean[STRLEN], sigma[STRLEN], min[STRLEN], max[STRLEN];
+
+    if(!s->count){
+        sprintf(line,"%s no values",MEAS_NAMES[which]);
+        return;
+    }
+    Fixed(last, s->last, 0, which, decimals);
+    Fixed(mean, Meas_Mean(s), MEAS_FRACTION_BITS, which, TRUE);
+    Fixed(sigma, Meas_Sigma(s), MEAS_HALF_BITS, which, TRUE);
+    Fixed(min, s->min, 0, which, decimals);
+    Fixed(max, s->max, 0, which, decimals);
+    sprintf(line,"%s %s %s avg %s sd %s [%s %s] n%lu",MEAS_NAMES[which],last,MEAS_UNITS[which],mean,sigma,min,max,
+            (unsigned long)s->count);
+}
+
+
+/*
+Meas_Draw:
+Shows the statistics of each measurement with values on its own line, the live value first. Called from
+SetBackground while the statistics are on.
+*/
+void Meas_Draw(void)
+{
+    char line[MEAS_LINE_LEN];
+    int row = 0;
+
+    for(int m=0;m<NUM_MEAS;m++){
+        if(MEAS.stat[m].count){
+            Describe(line, m);
+            strcat(line,"    ");                                              // blanking what a longer line left last time
+            GUI_DispStringAt(line,MARGIN,Y_PIXELS-MEAS_MARGIN+row*MEAS_SPACING);
+            row++;
+        }
+    }
+}
+
+
+/*
+Meas_Command:
+Handles setmeas_on and setmeas_off, which show or hide the statistics, setmeas_window<n>, which makes them cover
+the latest n values (0 for every value since the reset), meas_reset and meas, which reports them. Returns TRUE if
+the command was one of these, FALSE otherwise.
+*/
+int Meas_Command(char str[])
+{
+    char line[MEAS_LINE_LEN];
+
+    if(!strncasecmp(str,"setmeas_on",10)){
+        MEAS.on = TRUE;
+        UART_PutString("Measurement statistics shown\n");
+    } else if(!strncasecmp(str,"setmeas_off",11)){
+        MEAS.on = FALSE;
+        UART_PutString("Measurement statistics hidden\n");
+    } else if(!strncasecmp(str,"setmeas_window",14)){
+        int n = atoi(&str[14]);
+        if(n == 1 || n < 0 || n > MEAS_MAX_WINDOW){
+            sprintf(line,"Invalid window - 0 for all values or 2 to %d\n",MEAS_MAX_WINDOW);
+            UART_PutString(line);
+            return TRUE;
+        }
+        MEAS.window = n;
+        Meas_Reset();
+        if(n){
+            sprintf(line,"Statistics over the latest %d values\n",n);
+        } else {
+            sprintf(line,"Statistics over all values\n");
+        }
+        UART_PutString(line);
+    } else if(!strncasecmp(str,"meas_reset",10)){
+        Meas_Reset();
+        UART_PutString("Measurement statistics cleared\n");
+    } else if(!strncasecmp(str,"meas",4)){
+        for(int m=0;m<NUM_MEAS;m++){
+            Describe(line, m);
+            strcat(line,"\n");
+            UART_PutString(line);
+        }
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
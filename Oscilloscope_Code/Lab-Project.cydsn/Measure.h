@@ -0,0 +1,80 @@
+/* ========================================
+ *
+ * Tiny Scope measurement statistics header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the statistics of the measurements: the
+ * frequency of each channel and, while the cross-correlation
+ * is on, the delay and phase between them. Every new value
+ * goes into a running accumulator - the count, the smallest
+ * and largest, the sum for the mean and Welford's sum of
+ * squared differences from the mean for the standard
+ * deviation - so adding a value is a few integer operations
+ * and nothing is kept per value. In windowed mode the
+ * statistics cover the latest values only: a ring of them
+ * lets the oldest be taken out as each new one goes in, and
+ * the sum of squares is worked out again from the ring once
+ * per lap so rounding can't build up. The statistics are
+ * shown beside the live values and reported over the UART.
+ *
+ * ========================================
+*/
+
+#ifndef MEASURE_H
+#define MEASURE_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines for the measurements */
+#define MEAS_FREQ1 0              // channel 1 frequency in HZ
+#define MEAS_FREQ2 1              // channel 2 frequency in HZ
+#define MEAS_DELAY 2              // delay of channel 2 behind channel 1 in ns
+#define MEAS_PHASE 3              // phase of channel 2 behind channel 1 in tenths of a degree
+#define NUM_MEAS 4
+
+/* Defines */
+#define MEAS_FRACTION_BITS 8      // fraction bits of the mean and the sum of squares
+#define MEAS_HALF_BITS (MEAS_FRACTION_BITS / 2)  // each difference loses this many before squaring so the square fits
+#define MEAS_MAX_WINDOW 64        // most values the windowed statistics can cover (a few seconds of frames)
+#define MEAS_MARGIN 120           // distance of the first line of statistics from the bottom of the screen
+#define MEAS_SPACING 15           // and between the lines
+#define MEAS_LINE_LEN 100         // length of one line of the statistics report
+
+/* Structures */
+typedef struct MEAS_STAT{
+    uint32_t count;               // values accumulated (in windowed mode, at most the window)
+    int32_t last;                 // the latest value
+    int32_t min;                  // the smallest value
+    int32_t max;                  // and the largest
+    int64_t sum;                  // sum of the values, for the mean
+    int64_t m2;                   // sum of squared differences from the mean, with MEAS_FRACTION_BITS of fraction
+    int head;                     // next slot of the window ring
+    int32_t ring[MEAS_MAX_WINDOW];  // the latest values in windowed mode
+}MEAS_STAT;
+
+typedef struct MEAS_STATS{
+    int on;                       // TRUE to show the statistics on screen
+    int window;                   // values the statistics cover, or 0 for all of them since the reset
+    MEAS_STAT stat[NUM_MEAS];
+}MEAS_STATS;
+
+/* Globals */
+extern MEAS_STATS MEAS;
+
+/* Function prototypes */
+void Meas_Reset(void);
+
+void Meas_Add(int which, int32_t x);
+
+int64_t Meas_Mean(const MEAS_STAT *s);
+
+int64_t Meas_Sigma(const MEAS_STAT *s);
+
+void Meas_Draw(void);
+
+int Meas_Command(char str[]);
+
+#endif /* MEASURE_H */
@@ -0,0 +1,99 @@
+/* ========================================
+ *
+ * Tiny Scope profiler definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the profile table and the functions for
+ * starting the cycle counter, clearing the table and dumping
+ * it over the UART.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the profile table - one entry per section define in Profiler.h */
+PROFILE_SECTION PROFILE_TABLE[NUM_PROF_SECTIONS];
+
+/* names printed for each section in the dump, in the order of the section defines */
+const char *PROFILE_NAMES[NUM_PROF_SECTIONS] = {
+    "CH1_ISR", "CH2_ISR", "FindMiddle", "FindFreq", "FindTrigger",
+    "FormatData", "GetInput", "SetBackground", "DrawWaveForm", "UpdateDisplay",
+    "Split", "EquivTime", "Average", "Math", "XY", "XCorr", "Filter", "Autoset", "Calibrate", "Decode", "Logic", "Measure", "Mask"
+};
+
+
+/*
+Profile_Init:
+Enables the DWT cycle counter (the host clock needs no setup) and clears the profile table.
+*/
+void Profile_Init(void)
+{
+#ifndef HOST_BUILD
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;           // the DWT unit only runs with trace enabled
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;                       // starting the cycle counter
+#endif
+    Profile_Reset();
+}
+
+
+/*
+Profile_Reset:
+Clears the accumulated timings of every section.
+*/
+void Profile_Reset(void)
+{
+    for(int i=0;i<NUM_PROF_SECTIONS;i++){
+        PROFILE_TABLE[i].count = 0;
+        PROFILE_TABLE[i].min = UINT32_MAX;                    // min starts high so the first pass replaces it
+        PROFILE_TABLE[i].max = 0;
+        PROFILE_TABLE[i].total = 0;
+    }
+}
+
+
+/*
+Profile_TicksPerUs:
+Returns the number of ticks in one microsecond, used for converting the table to time.
+*/
+uint32_t Profile_TicksPerUs(void)
+{
+#ifdef HOST_BUILD
+    return HOST_TICKS_PER_US;
+#else
+    return SystemCoreClock / 1000000;
+#endif
+}
+
+
+/*
+Profile_Dump:
+Prints the profile table over the UART. Each line gives the section name, how many times it ran, and its
+min, max and mean duration in ticks followed by the mean in microseconds.
+*/
+void Profile_Dump(void)
+{
+#if PROFILING
+    char str[PROFILE_LINE_LEN];
+    uint32_t ticksPerUs = Profile_TicksPerUs();
+
+    sprintf(str,"section count min max mean (ticks, %lu per us) mean_us\n",(unsigned long)ticksPerUs);
+    UART_PutString(str);
+    for(int i=0;i<NUM_PROF_SECTIONS;i++){
+        PROFILE_SECTION s = PROFILE_TABLE[i];                  // copying so an interrupt cannot change it mid line
+        if(s.count == 0){
+            continue;                                          // sections that never ran are left out
+        }
+        uint32_t mean = s.total / s.count;
+        sprintf(str,"%s %lu %lu %lu %lu %lu\n",PROFILE_NAMES[i],(unsigned long)s.count,(unsigned long)s.min,
+                (unsigned long)s.max,(unsigned long)mean,(unsigned long)(mean / ticksPerUs));
+        UART_PutString(str);
+    }
+#else
+    UART_PutString("Profiling is compiled out\n");
+#endif
+}
@@ -0,0 +1,128 @@
+/* ========================================
+ *
+ * Tiny Scope profiler header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the section markers used to measure
+ * where the CM4's time goes. PROFILE_BEGIN and PROFILE_END
+ * read the DWT cycle counter (or a monotonic clock on the
+ * host) and accumulate the min, max and mean duration of
+ * each named section into a fixed table. Setting PROFILING
+ * to 0 removes every marker at compile time.
+ *
+ * ========================================
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/* Includes */
+#include <stdint.h>
+#ifdef HOST_BUILD
+#include <time.h>
+#endif
+
+/* Compile time switch - define PROFILING as 0 to compile all of the markers out */
+#ifndef PROFILING
+#define PROFILING 1
+#endif
+
+/* Defines for the profiled sections */
+#define PROF_CH1_ISR 0            // channel 1 DMA interrupt
+#define PROF_CH2_ISR 1            // channel 2 DMA interrupt
+#define PROF_FIND_MIDDLE 2        // FIND_MIDDLE stage of Proccess_Channel
+#define PROF_FIND_FREQ 3          // FIND_FREQ stage of Proccess_Channel
+#define PROF_FIND_TRIGGER 4       // trigger search in the FORMAT_DATA stage
+#define PROF_FORMAT_DATA 5        // building the pixel coordinates in the FORMAT_DATA stage
+#define PROF_GET_INPUT 6          // polling the UART for commands
+#define PROF_SET_BACKGROUND 7     // redrawing the grid and readouts
+#define PROF_DRAW_WAVEFORM 8      // one DrawWaveForm call
+#define PROF_UPDATE_DISPLAY 9     // a whole display update
+#define PROF_SPLIT 10             // splitting interleaved segments in place in the channel buffers
+#define PROF_EQUIV_TIME 11        // binning a block into the equivalent time grid
+#define PROF_AVERAGE 12           // folding a frame into the average
+#define PROF_MATH 13              // working out the math trace for a block or segment
+#define PROF_XY 14                // plotting a block into the XY hit buffer
+#define PROF_XCORR 15             // one cross-correlation delay measurement
+#define PROF_FILTER 16            // filtering a block or segment of both channels
+#define PROF_AUTOSET 17           // analyzing a block and choosing the autoset settings
+#define PROF_CALIBRATE 18         // correcting a block or segment of both channels
+#define PROF_DECODE 19            // decoding a block or segment of both channels
+#define PROF_LOGIC 20             // storing the edges of a segment of both channels
+#define PROF_MEASURE 21           // adding a value to the measurement statistics
+#define PROF_MASK 22              // testing a frame against the mask
+#define NUM_PROF_SECTIONS 23      // number of entries in the profile table
+#define PROFILE_LINE_LEN 96       // length of one line of the profile dump
+#define HOST_TICKS_PER_US 1000    // the host clock counts nanoseconds
+
+/* Structures */
+typedef struct PROFILE_SECTION{   // accumulated timing of one section
+    uint32_t start;               // tick count when the section was last entered
+    uint32_t count;               // number of completed passes through the section
+    uint32_t min;                 // shortest pass in ticks
+    uint32_t max;                 // longest pass in ticks
+    uint64_t total;               // sum of all passes in ticks, for the mean
+}PROFILE_SECTION;
+
+/* Globals */
+extern PROFILE_SECTION PROFILE_TABLE[NUM_PROF_SECTIONS];
+extern const char *PROFILE_NAMES[NUM_PROF_SECTIONS];
+
+/* Function prototypes */
+void Profile_Init(void);
+
+void Profile_Reset(void);
+
+void Profile_Dump(void);
+
+uint32_t Profile_TicksPerUs(void);
+
+
+/*
+Profile_Now:
+Returns the current tick count - CPU cycles from the DWT counter on target, nanoseconds on the host.
+*/
+static inline uint32_t Profile_Now(void)
+{
+#ifdef HOST_BUILD
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+
+/*
+Profile_End:
+Closes a section opened with PROFILE_BEGIN and folds its duration into the table. Unsigned subtraction
+keeps the result right across a counter wrap.
+*/
+static inline void Profile_End(int section)
+{
+    PROFILE_SECTION *s = &PROFILE_TABLE[section];
+    uint32_t ticks = Profile_Now() - s->start;
+
+    s->count++;
+    s->total += ticks;
+    if(ticks < s->min){
+        s->min = ticks;
+    }
+    if(ticks > s->max){
+        s->max = ticks;
+    }
+}
+
+/* Section markers - each also records a stage event in the trace (see Trace.h) */
+#if PROFILING
+#define PROFILE_BEGIN(section) do{ TRACE_SECTION(TRACE_STAGE_BEGIN, section); PROFILE_TABLE[section].start = Profile_Now(); }while(0)
+#define PROFILE_END(section) do{ Profile_End(section); TRACE_SECTION(TRACE_STAGE_END, section); }while(0)
+#else
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+#endif
+
+#endif /* PROFILER_H */
@@ -0,0 +1,152 @@
+/* ========================================
+ *
+ * Tiny Scope acquisition statistics definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file keeps the acquisition counters, turns them into
+ * an update rate and a dead-time percentage once per interval,
+ * and reports them over the UART.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the statistics - counters since the last reset and the results of the last complete interval */
+ACQ_STATS STATS;
+
+
+/*
+Difference:
+Returns the counts that happened between two copies of the counters.
+*/
+static ACQ_COUNTS Difference(const ACQ_COUNTS *now, const ACQ_COUNTS *then)
+{
+    ACQ_COUNTS d;
+    d.blocks = now->blocks - then->blocks;
+    d.usedBlocks = now->usedBlocks - then->usedBlocks;
+    d.frames = now->frames - then->frames;
+    d.drawnFrames = now->drawnFrames - then->drawnFrames;
+    d.shownSamples = now->shownSamples - then->shownSamples;
+    return d;
+}
+
+
+/*
+Stats_Reset:
+Clears all counters and results and starts a new interval.
+*/
+void Stats_Reset(void)
+{
+    memset(&STATS, 0, sizeof(STATS));
+}
+
+
+/*
+Stats_BlockUsed:
+Counts a block that a frame was (at least partly) formatted from.
+*/
+void Stats_BlockUsed(void)
+{
+    STATS.total.usedBlocks++;
+}
+
+
+/*
+Stats_FrameFormatted:
+Counts a frame that passed the trigger check and was turned into pixel coordinates.
+*/
+void Stats_FrameFormatted(void)
+{
+    STATS.total.frames++;
+}
+
+
+/*
+Stats_FrameDrawn:
+Counts a frame drawn on the display along with the span of signal it shows, which depends on the xScale it
+was formatted with (each pixel steps xScale/INDEX_DIVISOR samples through the buffer).
+*/
+void Stats_FrameDrawn(int xScale)
+{
+    STATS.total.drawnFrames++;
+    STATS.total.shownSamples += (uint64_t)X_PIXELS * xScale / INDEX_DIVISOR;
+}
+
+
+/*
+Stats_UpdateRateX10:
+Returns the number of frames drawn per second of acquired signal, times 10.
+*/
+uint32_t Stats_UpdateRateX10(const ACQ_COUNTS *counts)
+{
+    if(counts->blocks == 0){
+        return 0;
+    }
+    return (uint64_t)counts->drawnFrames * 10 * SAMPLING_RATE / ((uint64_t)counts->blocks * SIZE);
+}
+
+
+/*
+Stats_DeadTimeX10:
+Returns the percentage of acquired signal time that never appeared on the screen, times 10.
+*/
+uint32_t Stats_DeadTimeX10(const ACQ_COUNTS *counts)
+{
+    uint64_t acquired = (uint64_t)counts->blocks * SIZE;
+    uint64_t shown = counts->shownSamples;
+
+    if(acquired == 0){
+        return 0;
+    }
+    if(shown > acquired){
+        shown = acquired;                                      // slow timebases show more than one block per frame
+    }
+    return 1000 - shown * 1000 / acquired;
+}
+
+
+/*
+Stats_Update:
+Called from the main loop. Once a full interval of blocks has been acquired it computes the update rate and
+dead time of that interval and starts the next one.
+*/
+void Stats_Update(void)
+{
+    ACQ_COUNTS now = STATS.total;
+    ACQ_COUNTS interval = Difference(&now, &STATS.intervalStart);
+
+    if(interval.blocks >= STATS_INTERVAL_BLOCKS){
+        STATS.updateRateX10 = Stats_UpdateRateX10(&interval);
+        STATS.deadTimeX10 = Stats_DeadTimeX10(&interval);
+        STATS.intervalStart = now;
+    }
+}
+
+
+/*
+Stats_Report:
+Prints the counters since the last reset and the rates they give, followed by the rates of the last interval.
+*/
+void Stats_Report(void)
+{
+    char str[STATS_LINE_LEN];
+    ACQ_COUNTS now = STATS.total;
+    uint32_t rate = Stats_UpdateRateX10(&now);
+    uint32_t dead = Stats_DeadTimeX10(&now);
+
+    sprintf(str,"blocks %lu used %lu skipped %lu\n",(unsigned long)now.blocks,(unsigned long)now.usedBlocks,
+            (unsigned long)(now.blocks - now.usedBlocks));
+    UART_PutString(str);
+    sprintf(str,"triggered frames %lu drawn frames %lu\n",(unsigned long)now.frames,(unsigned long)now.drawnFrames);
+    UART_PutString(str);
+    sprintf(str,"update rate %lu.%lu wfm/s dead time %lu.%lu %%\n",(unsigned long)rate/10,(unsigned long)rate%10,
+            (unsigned long)dead/10,(unsigned long)dead%10);
+    UART_PutString(str);
+    sprintf(str,"last interval %lu.%lu wfm/s dead time %lu.%lu %%\n",(unsigned long)STATS.updateRateX10/10,
+            (unsigned long)STATS.updateRateX10%10,(unsigned long)STATS.deadTimeX10/10,(unsigned long)STATS.deadTimeX10%10);
+    UART_PutString(str);
+}
@@ -0,0 +1,76 @@
+/* ========================================
+ *
+ * Tiny Scope acquisition statistics header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the counters used to measure the
+ * waveform update rate and the acquisition dead time - how
+ * much of the sampled signal never makes it to the screen.
+ * Time is measured in acquired samples rather than with a
+ * clock, so the host simulator reproduces the same numbers
+ * as the hardware for the same signal and settings.
+ *
+ * ========================================
+*/
+
+#ifndef SCOPE_STATS_H
+#define SCOPE_STATS_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define STATS_INTERVAL_BLOCKS 72  // blocks in one measurement interval (72 * 3200 samples is about 1 second)
+#define STATS_LINE_LEN 80         // length of one line of the statistics report
+#define STATS_MARGIN 20           // distance of the on-screen statistics from the bottom of the screen
+
+/* Structures */
+typedef struct ACQ_COUNTS{        // counters for one span of time
+    volatile uint32_t blocks;     // DMA blocks acquired on channel 1 (counted in CH1_ISR)
+    uint32_t usedBlocks;          // blocks a frame was formatted from
+    uint32_t frames;              // frames that passed the trigger check and were formatted
+    uint32_t drawnFrames;         // frames drawn on the display
+    uint64_t shownSamples;        // acquired samples that appeared in a drawn frame
+}ACQ_COUNTS;
+
+typedef struct ACQ_STATS{
+    ACQ_COUNTS total;             // counts since the last reset
+    ACQ_COUNTS intervalStart;     // copy of total taken when the current interval started
+    uint32_t updateRateX10;       // drawn frames per second over the last complete interval, times 10
+    uint32_t deadTimeX10;         // percent of the last complete interval never shown, times 10
+}ACQ_STATS;
+
+/* Globals */
+extern ACQ_STATS STATS;
+
+/* Function prototypes */
+void Stats_Reset(void);
+
+void Stats_BlockUsed(void);
+
+void Stats_FrameFormatted(void);
+
+void Stats_FrameDrawn(int xScale);
+
+void Stats_Update(void);
+
+void Stats_Report(void);
+
+uint32_t Stats_UpdateRateX10(const ACQ_COUNTS *counts);
+
+uint32_t Stats_DeadTimeX10(const ACQ_COUNTS *counts);
+
+
+/*
+Stats_BlockAcquired:
+Counts one completed DMA block. Called from CH1_ISR, which is the only writer of the block count, so the main
+loop can read it without disabling interrupts.
+*/
+static inline void Stats_BlockAcquired(void)
+{
+    STATS.total.blocks++;
+}
+
+#endif /* SCOPE_STATS_H */
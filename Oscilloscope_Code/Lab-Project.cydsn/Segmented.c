@@ -0,0 +1,349 @@
+/* ========================================
+ *
+ * Tiny Scope segmented memory definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the segment timestamps,
+ * the capture that fills a segment at every trigger and
+ * re-arms straight after it, the viewer that shows one segment
+ * or overlays them all, and the setseg_ and seg_ commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the segment memory - segment k of the capture memory holds length samples of channel 1 followed by length samples of channel 2 */
+SEGMENT_MEMORY SEGMENTS = {FALSE, SEG_DEFAULT_LENGTH, 0, 0, FALSE, 0, 0, FALSE};
+
+/* the wave structure and draw flag from main_cm4.c - the viewer draws through them */
+extern WAVEFORM_DATA WAVE;
+extern int ReadyToDraw_ch1;
+
+
+/*
+MaxSlots:
+Returns the most segments of a given length that fit in the capture memory.
+*/
+static int MaxSlots(int length)
+{
+    int slots = ACQ_POOL_SIZE / SEG_STRIDE(length);
+    return slots < SEG_MAX_SLOTS ? slots : SEG_MAX_SLOTS;
+}
+
+
+/*
+Slot:
+Returns the start of segment n in the capture memory. Its trigger time comes first, then channel 1 and channel 2.
+*/
+static uint16_t *Slot(int n)
+{
+    return ACQ_Pool + SEG_STRIDE(SEGMENTS.length) * n;
+}
+
+
+/*
+SegmentTime:
+Returns the number of the trigger sample of segment n, counted from the start of the acquisition. The time is
+copied out since the slots are only 2 byte aligned.
+*/
+static uint64_t SegmentTime(int n)
+{
+    uint64_t time;
+    memcpy(&time, Slot(n), sizeof(time));
+    return time;
+}
+
+
+/*
+FormatSegment:
+Formats a segment into pixel coordinates at the current xscale and yscale, starting at its trigger sample. A
+segment shorter than the screen holds its last sample to the right edge.
+*/
+static void FormatSegment(int n, int X[], int Y1[], int Y2[], SCOPE_SETTINGS SCOPE)
+{
+    uint16_t *ch1 = Slot(n) + SEG_TIME_WORDS;
+    uint16_t *ch2 = ch1 + SEGMENTS.length;
+    uint32_t index = 0;
+
+    for(int i=0;i<X_PIXELS;i++){
+        int k = index / INDEX_SCALE;
+        if(k >= SEGMENTS.length){
+            k = SEGMENTS.length - 1;
+        }
+        X[i] = i;
+        Y1[i] = CODE_TO_PIXEL(ch1[k], SCOPE.yScale);
+        Y2[i] = CODE_TO_PIXEL(ch2[k], SCOPE.yScale);
+        index += (SCOPE.xScale*INDEX_SCALE)/INDEX_DIVISOR;
+    }
+}
+
+
+/*
+PrintTime:
+Prints a sample number as the time since the start of the acquisition in seconds and microseconds.
+*/
+static void PrintTime(char str[], uint64_t sample)
+{
+    unsigned long seconds = sample / SAMPLING_RATE;
+    unsigned long us = ((sample % SAMPLING_RATE) * 1000000) / SAMPLING_RATE;
+
+    sprintf(str,"%lu.%06lu s",seconds,us);
+}
+
+
+/*
+ClearOverlay:
+Clears the overlaid segments off the screen so the normal drawing can take over again.
+*/
+static void ClearOverlay(SCOPE_SETTINGS SCOPE)
+{
+    if(SEGMENTS.overlaid){
+        SEGMENTS.overlaid = FALSE;
+        GUI_Clear();
+        SetBackground(SCOPE, WAVE);
+    }
+}
+
+
+/*
+Seg_Reset:
+Empties the segment memory so the next trigger captures into the first slot. Called when the scope is started and
+when the segment settings change.
+*/
+void Seg_Reset(void)
+{
+    SEGMENTS.count = 0;
+    SEGMENTS.capturing = FALSE;
+    SEGMENTS.filled = 0;
+    SEGMENTS.shown = 0;
+}
+
+
+/*
+Seg_Capture:
+Takes one stretch of newly acquired samples (time-aligned on both channels, the first being sample number first).
+While a segment is being filled the samples are copied into it and the engine is only kept in step - a trigger
+inside a segment does not start another. As soon as the segment is full the engine searches from the next sample,
+so several segments can start in one stretch. In free-run mode the segments are captured back to back.
+*/
+void Seg_Capture(uint16_t ch1[], uint16_t ch2[], int size, uint64_t first, SCOPE_SETTINGS SCOPE)
+{
+    int scan = 0;                                                            // next sample for the trigger engine
+    int copy = 0;                                                            // next sample to copy into the segment
+    char str[SEG_LINE_LEN];
+
+    while(SEGMENTS.count < SEGMENTS.slots){
+        if(SEGMENTS.capturing){
+            uint16_t *slot = Slot(SEGMENTS.count) + SEG_TIME_WORDS;
+            int n = SEGMENTS.length - SEGMENTS.filled;
+            if(n > size - copy){
+                n = size - copy;
+            }
+            memcpy(slot + SEGMENTS.filled, ch1 + copy, n * sizeof(uint16_t));
+            memcpy(slot + SEGMENTS.length + SEGMENTS.filled, ch2 + copy, n * sizeof(uint16_t));
+            SEGMENTS.filled += n;
+            copy += n;
+            if(copy > scan){
+                if(!SCOPE.freeRun){
+                    Trigger_Feed(ch1 + scan, ch2 + scan, copy - scan, SCOPE);   // the trigger is not armed during a capture
+                }
+                scan = copy;
+            }
+            if(SEGMENTS.filled < SEGMENTS.length){
+                return;                                                      // the segment carries on into the next stretch
+            }
+            SEGMENTS.capturing = FALSE;
+            SEGMENTS.count++;
+            TRACE(TRACE_TRIGGER_FOUND,SCOPE.triggerChannel,SEGMENTS.count);
+            if(SEGMENTS.count == SEGMENTS.slots){
+                sprintf(str,"Segment memory full - %d segments captured\n",SEGMENTS.count);
+                UART_PutString(str);
+                return;
+            }
+        }
+        if(scan >= size){
+            return;
+        }
+
+        int used = 0;
+        int32_t event = 0;                                                   // free run starts the next segment straight away
+        if(!SCOPE.freeRun){
+            PROFILE_BEGIN(PROF_FIND_TRIGGER);
+            event = Trigger_Next(ch1 + scan, ch2 + scan, size - scan, SCOPE, &used);
+            PROFILE_END(PROF_FIND_TRIGGER);
+            if(event < 0){
+                return;                                                      // the engine has taken the rest of the stretch
+            }
+        }
+        copy = scan + event;                                                 // a pulse is captured from where it began
+        scan += used;
+        uint64_t time = first + copy;
+        memcpy(Slot(SEGMENTS.count), &time, sizeof(time));
+        SEGMENTS.capturing = TRUE;
+        SEGMENTS.filled = 0;
+    }
+}
+
+
+/*
+Seg_Show:
+Formats segment n (counted from 0) into the wave structure and asks for it to be drawn.
+*/
+void Seg_Show(int n, SCOPE_SETTINGS SCOPE)
+{
+    char str[SEG_LINE_LEN];
+    char time[STRLEN];
+
+    ClearOverlay(SCOPE);
+    SEGMENTS.shown = n;
+    FormatSegment(n, WAVE.Wave1X, WAVE.Wave1Y, WAVE.Wave2Y, SCOPE);
+    Copy(WAVE.Wave1X, WAVE.Wave2X);
+    ReadyToDraw_ch1 = TRUE;
+
+    PrintTime(time, SegmentTime(n));
+    sprintf(str,"Segment %d of %d at %s\n",n + 1,SEGMENTS.count,time);
+    UART_PutString(str);
+}
+
+
+/*
+Seg_Overlay:
+Draws every captured segment on top of each other so their differences stand out. The screen is cleared first
+and again when the viewer goes back to a single segment, since the overlay is too many lines to erase one by one.
+Each segment is formatted into the wave structure in turn - nothing else draws from it until the overlay is left.
+*/
+void Seg_Overlay(SCOPE_SETTINGS SCOPE)
+{
+    char str[SEG_LINE_LEN];
+
+    SEGMENTS.overlaid = TRUE;
+    GUI_Clear();
+    SetBackground(SCOPE, WAVE);
+    GUI_SetPenSize(2);
+    for(int n=0;n<SEGMENTS.count;n++){
+        FormatSegment(n, WAVE.Wave1X, WAVE.Wave1Y, WAVE.Wave2Y, SCOPE);
+        GUI_SetColor(GUI_YELLOW);
+        DrawWaveForm(WAVE.Wave1X,WAVE.Wave2Y,X_PIXELS,Y_PIXELS-WAVE.Wave2Offset);
+        GUI_SetColor(GUI_RED);
+        DrawWaveForm(WAVE.Wave1X,WAVE.Wave1Y,X_PIXELS,Y_PIXELS-WAVE.Wave1Offset);
+    }
+
+    sprintf(str,"Overlaid %d segments\n",SEGMENTS.count);
+    UART_PutString(str);
+}
+
+
+/*
+Seg_List:
+Prints the time of every captured segment and the time since the one before it.
+*/
+void Seg_List(void)
+{
+    char str[SEG_LINE_LEN];
+    char time[STRLEN];
+
+    sprintf(str,"%d of %d segments of %d samples\n",SEGMENTS.count,SEGMENTS.slots,SEGMENTS.length);
+    UART_PutString(str);
+    for(int n=0;n<SEGMENTS.count;n++){
+        uint64_t gap = n ? SegmentTime(n) - SegmentTime(n-1) : 0;
+        PrintTime(time, SegmentTime(n));
+        sprintf(str,"%d %s +%lu us\n",n + 1,time,(unsigned long)((gap * 1000000) / SAMPLING_RATE));
+        UART_PutString(str);
+    }
+}
+
+
+/*
+Seg_Command:
+Handles the setseg_ commands, which turn segmented memory on or off and set the segment length in microseconds
+(setseg_length500) and the number of segments (setseg_count100), and the seg_ viewer commands: seg_show3,
+seg_next, seg_prev, seg_overlay and seg_list. The settings can only be changed while stopped; the viewer works
+either way. Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Seg_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    char toPrint[SEG_LINE_LEN];
+    int a;
+
+    if(!strncasecmp(str,"setseg_",7)){
+        if(SCOPE->Running){
+            return FALSE;
+        }
+        if(!strncasecmp(str,"setseg_on",9)){
+            if(SCOPE->acqMode != ACQ_STREAMING){
+                UART_PutString("Segmented memory needs streaming acquisition - enter setacq_streaming first\n");
+                return TRUE;
+            }
+            SEGMENTS.on = TRUE;
+            if(!SEGMENTS.slots){
+                SEGMENTS.slots = MaxSlots(SEGMENTS.length);                  // as many as fit until a count is set
+            }
+            DEEP.on = FALSE;                                                 // the capture modes share the capture memory
+            ETS.on = FALSE;
+            LOGIC.on = FALSE;
+            Xy_Off();
+            XCORR.on = FALSE;
+            UART_PutString("Segmented memory on\n");
+        } else if(!strncasecmp(str,"setseg_off",10)){
+            SEGMENTS.on = FALSE;
+            UART_PutString("Segmented memory off\n");
+        } else if(!strncasecmp(str,"setseg_length",13)){
+            a = MICROSECONDS_TO_SAMPLES(atoi(&str[13]));
+            if(a < SEG_MIN_LENGTH || MaxSlots(a) == 0){
+                UART_PutString("Invalid segment length\n");
+                return TRUE;
+            }
+            SEGMENTS.length = a;
+            SEGMENTS.slots = MaxSlots(a);                                    // as many segments as now fit
+            sprintf(toPrint,"%d segments of %d samples\n",SEGMENTS.slots,SEGMENTS.length);
+            UART_PutString(toPrint);
+        } else if(!strncasecmp(str,"setseg_count",12)){
+            a = atoi(&str[12]);
+            if(a <= 0 || a > MaxSlots(SEGMENTS.length)){
+                sprintf(toPrint,"Invalid segment count - at most %d at this length\n",MaxSlots(SEGMENTS.length));
+                UART_PutString(toPrint);
+                return TRUE;
+            }
+            SEGMENTS.slots = a;
+            sprintf(toPrint,"%d segments of %d samples\n",SEGMENTS.slots,SEGMENTS.length);
+            UART_PutString(toPrint);
+        } else {
+            return FALSE;
+        }
+        Seg_Reset();
+        return TRUE;
+    }
+
+    if(!strncasecmp(str,"seg_list",8)){
+        Seg_List();
+        return TRUE;
+    }
+    if(strncasecmp(str,"seg_show",8) && strncasecmp(str,"seg_next",8)
+    && strncasecmp(str,"seg_prev",8) && strncasecmp(str,"seg_overlay",11)){
+        return FALSE;
+    }
+    if(!SEGMENTS.count){
+        UART_PutString("No segments captured\n");
+        return TRUE;
+    }
+
+    if(!strncasecmp(str,"seg_show",8)){
+        a = atoi(&str[8]);
+        if(a < 1 || a > SEGMENTS.count){
+            UART_PutString("Invalid segment number\n");
+            return TRUE;
+        }
+        Seg_Show(a - 1, *SCOPE);
+    } else if(!strncasecmp(str,"seg_next",8)){
+        Seg_Show((SEGMENTS.shown + 1) % SEGMENTS.count, *SCOPE);
+    } else if(!strncasecmp(str,"seg_prev",8)){
+        Seg_Show((SEGMENTS.shown + SEGMENTS.count - 1) % SEGMENTS.count, *SCOPE);
+    } else {
+        Seg_Overlay(*SCOPE);
+    }
+    return TRUE;
+}
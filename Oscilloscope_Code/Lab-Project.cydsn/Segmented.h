@@ -0,0 +1,65 @@
+/* ========================================
+ *
+ * Tiny Scope segmented memory header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides segmented memory for bursty signals.
+ * Instead of filling a whole frame after each trigger, every
+ * trigger captures a short segment of both channels into the
+ * next of N slots in the capture memory, stamped with its 64 bit
+ * sample number, and the trigger re-arms on the very next
+ * sample after the segment ends. The idle time between bursts
+ * is never stored, so the pool holds hundreds of events. It
+ * runs on the streaming acquisition, where every sample goes
+ * through the trigger engine. Once the pool is full (or the
+ * scope is stopped) the viewer steps through the segments or
+ * overlays all of them.
+ *
+ * ========================================
+*/
+
+#ifndef SEGMENTED_H
+#define SEGMENTED_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define SEG_MAX_SLOTS 1024        // most segments the pool can be split into
+#define SEG_MIN_LENGTH 16         // shortest segment in samples per channel
+#define SEG_DEFAULT_LENGTH 320    // default segment length in samples per channel (about 1.4 ms)
+#define SEG_LINE_LEN 120          // length of one line of the segment list
+#define SEG_TIME_WORDS (sizeof(uint64_t) / sizeof(uint16_t)) // pool words ahead of each segment holding its trigger time
+#define SEG_STRIDE(length) (2 * (length) + SEG_TIME_WORDS)   // pool words of one slot: the time, then each channel
+
+/* Structures */
+typedef struct SEGMENT_MEMORY{
+    int on;                       // TRUE while triggers are captured into segments instead of frames
+    int length;                   // samples per channel in each segment
+    int slots;                    // number of segments (N) the pool is split into, 0 until segmented memory is first used
+    int count;                    // segments captured so far
+    int capturing;                // TRUE while a segment is being filled
+    int filled;                   // samples of the current segment filled so far
+    int shown;                    // the segment the viewer shows
+    int overlaid;                 // TRUE while all of the segments are overlaid on the screen
+}SEGMENT_MEMORY;
+
+/* Globals */
+extern SEGMENT_MEMORY SEGMENTS;
+
+/* Function prototypes */
+void Seg_Reset(void);
+
+void Seg_Capture(uint16_t ch1[], uint16_t ch2[], int size, uint64_t first, SCOPE_SETTINGS SCOPE);
+
+void Seg_Show(int n, SCOPE_SETTINGS SCOPE);
+
+void Seg_Overlay(SCOPE_SETTINGS SCOPE);
+
+void Seg_List(void);
+
+int Seg_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* SEGMENTED_H */
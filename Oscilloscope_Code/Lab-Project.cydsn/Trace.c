@@ -0,0 +1,61 @@
+/* ========================================
+ *
+ * Tiny Scope event trace definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the trace ring and the functions for
+ * clearing it and sending it over the UART in binary.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the trace ring and the count of events ever recorded (the slot is the count modulo TRACE_SIZE) */
+TRACE_EVENT TRACE_RING[TRACE_SIZE];
+volatile uint32_t TraceHead = 0;
+volatile uint8_t TraceEnabled = TRUE;
+
+
+/*
+Trace_Clear:
+Empties the ring.
+*/
+void Trace_Clear(void)
+{
+    TraceEnabled = FALSE;
+    TraceHead = 0;
+    TraceEnabled = TRUE;
+}
+
+
+/*
+Trace_Dump:
+Sends the ring over the UART as a TRACE_HEADER followed by the events, oldest first. Recording is paused
+while the dump is sent so the events cannot change underneath it, and resumes with an empty ring.
+*/
+void Trace_Dump(void)
+{
+    TRACE_HEADER header;
+    uint32_t head;
+
+    TraceEnabled = FALSE;                                          // events recorded from here on are dropped
+    head = TraceHead;
+
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.count = head < TRACE_SIZE ? head : TRACE_SIZE;          // once the ring wraps it holds the newest TRACE_SIZE events
+    header.ticksPerUs = Profile_TicksPerUs();
+    header.dropped = head - header.count;
+    UART_PutArrayBlocking(&header, sizeof(header));
+
+    for(uint32_t n=head-header.count;n!=head;n++){
+        UART_PutArrayBlocking(&TRACE_RING[n & (TRACE_SIZE-1)], sizeof(TRACE_EVENT));
+    }
+
+    TraceHead = 0;
+    TraceEnabled = TRUE;
+}
@@ -0,0 +1,103 @@
+/* ========================================
+ *
+ * Tiny Scope event trace header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides a fixed-size ring of compact, time
+ * stamped events for seeing how the ISRs and the processing
+ * stages interleave. Slots are claimed with one atomic
+ * increment so ISRs and the main loop can record events
+ * without locks or disabling interrupts. The ring is dumped
+ * in binary over the UART and turned into a timeline on the
+ * PC by Host/TraceToJson.c. Setting TRACING to 0 removes
+ * every event at compile time.
+ *
+ * ========================================
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/* Includes */
+#include <stdint.h>
+#include "Profiler.h"
+
+/* Compile time switch - define TRACING as 0 to compile all of the events out */
+#ifndef TRACING
+#define TRACING 1
+#endif
+
+/* Defines */
+#define TRACE_SIZE 256            // number of events in the ring (must be a power of 2) - about 40 blocks
+#define TRACE_MAGIC 0x52545354    // "TSTR" - marks the start of a binary dump
+#define TRACE_VERSION 1           // format version of the binary dump
+
+/* Defines for the event types */
+#define TRACE_DMA_DONE 1          // a DMA descriptor completed - arg8 is the channel, arg16 the buffer flag
+#define TRACE_TRIGGER_FOUND 2     // trigger search succeeded - arg8 is the channel, arg16 the sample index
+#define TRACE_TRIGGER_MISSED 3    // trigger search found nothing - arg8 is the channel
+#define TRACE_STAGE_BEGIN 4       // a profiled section started - arg8 is the PROF_ section id
+#define TRACE_STAGE_END 5         // a profiled section ended - arg8 is the PROF_ section id
+#define TRACE_FRAME_DRAWN 6       // a frame finished drawing - arg16 is the frame number
+#define TRACE_COMMAND 7           // a UART command was received - arg8 is its first character, arg16 its length
+
+/* Sections whose begin and end are also traced (GetInput runs every pass of the main loop and would flood the ring) */
+#define TRACE_SECTION_MASK (((1u << NUM_PROF_SECTIONS) - 1) & ~(1u << PROF_GET_INPUT))
+_Static_assert(NUM_PROF_SECTIONS < 32, "the section mask has one bit per profiled section and 1u << 32 is undefined");
+
+/* Structures */
+typedef struct TRACE_EVENT{       // one 8 byte event
+    uint32_t time;                // tick count from Profile_Now
+    uint8_t type;                 // one of the TRACE_ event types
+    uint8_t arg8;                 // small event argument
+    uint16_t arg16;               // larger event argument
+}TRACE_EVENT;
+
+typedef struct TRACE_HEADER{      // sent ahead of the events in a binary dump
+    uint32_t magic;               // TRACE_MAGIC
+    uint16_t version;             // TRACE_VERSION
+    uint16_t count;               // number of events that follow, oldest first
+    uint32_t ticksPerUs;          // for converting the event times to microseconds
+    uint32_t dropped;             // number of older events that were overwritten
+}TRACE_HEADER;
+
+/* Globals */
+extern TRACE_EVENT TRACE_RING[TRACE_SIZE];
+extern volatile uint32_t TraceHead;
+extern volatile uint8_t TraceEnabled;
+
+/* Function prototypes */
+void Trace_Clear(void);
+
+void Trace_Dump(void);
+
+
+/*
+Trace_Record:
+Claims the next slot with an atomic increment and fills it. Safe to call from ISRs and the main loop at once;
+if the ring is full the oldest event is overwritten.
+*/
+static inline void Trace_Record(uint8_t type, uint8_t arg8, uint16_t arg16)
+{
+    if(!TraceEnabled){
+        return;
+    }
+    TRACE_EVENT *e = &TRACE_RING[__atomic_fetch_add(&TraceHead, 1, __ATOMIC_RELAXED) & (TRACE_SIZE-1)];
+    e->time = Profile_Now();
+    e->type = type;
+    e->arg8 = arg8;
+    e->arg16 = arg16;
+}
+
+/* Event markers */
+#if TRACING
+#define TRACE(type, arg8, arg16) Trace_Record((type), (arg8), (arg16))
+#define TRACE_SECTION(type, section) do{ if(TRACE_SECTION_MASK & (1u << (section))) Trace_Record((type), (section), 0); }while(0)
+#else
+#define TRACE(type, arg8, arg16)
+#define TRACE_SECTION(type, section)
+#endif
+
+#endif /* TRACE_H */
@@ -0,0 +1,653 @@
+/* ========================================
+ *
+ * Tiny Scope trigger engine definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file implements the streaming trigger engine for the
+ * pulse width, runt, window, timeout and logic triggers along
+ * with the settrigger_ commands that configure them. Each block
+ * is scanned once, one comparator step per sample, and the
+ * index of the first event in the block is kept for FORMAT_DATA.
+ * It also holds the holdoff and sweep state machines.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the advanced trigger settings - edge trigger by default */
+TRIGGER_SETTINGS TRIGGER = {TRIGGER_EDGE, PULSE_LESS, 0, 0, 0, 0, 0, LOGIC_AND, {QUAL_RISING, QUAL_ANY}, SWEEP_AUTO, 0, 0};
+
+/* the comparator state carried between blocks */
+TRIGGER_STATE TRIGGER_ENGINE;
+
+/* names of the logic trigger qualifiers in the order of the QUAL_ defines */
+static const char *QUAL_NAMES[] = {"any", "high", "low", "rising", "falling"};
+
+
+/*
+ZoneOf:
+Returns the zone a sample is in relative to the low and high thresholds. A threshold must be passed by
+TRIGGER_HYSTERESIS before the zone changes so noise around a threshold does not count as crossings.
+*/
+static inline int ZoneOf(int v, int zone, int low, int high)
+{
+    if(v >= high + TRIGGER_HYSTERESIS || (zone == ZONE_HIGH && v >= high - TRIGGER_HYSTERESIS)){
+        return ZONE_HIGH;
+    }
+    if(v < low - TRIGGER_HYSTERESIS || (zone == ZONE_LOW && v < low + TRIGGER_HYSTERESIS)){
+        return ZONE_LOW;
+    }
+    return ZONE_MIDDLE;
+}
+
+
+/*
+AboveLevel:
+A comparator with hysteresis - returns TRUE if a sample is above the trigger level given whether the last one was.
+*/
+static inline int AboveLevel(int v, int wasAbove, int level)
+{
+    return wasAbove ? v >= level - TRIGGER_HYSTERESIS : v >= level + TRIGGER_HYSTERESIS;
+}
+
+
+/*
+QualifierMet:
+Checks one channel's logic trigger qualifier given whether the channel is above the trigger level now and was at
+the sample before. Edge qualifiers only hold on the sample of the edge.
+*/
+static inline int QualifierMet(int qualifier, int now, int before)
+{
+    switch(qualifier){
+        case QUAL_HIGH:
+            return now;
+        case QUAL_LOW:
+            return !now;
+        case QUAL_RISING:
+            return now && !before;
+        case QUAL_FALLING:
+            return !now && before;
+        default:
+            return TRUE;
+    }
+}
+
+
+/*
+EventAccepted:
+Applies holdoff to a trigger event. An event inside the holdoff time, or one of the events being held off, is
+ignored; otherwise it is accepted and the holdoff starts again. Every event must be passed through here, not just
+the first in a block, so the holdoff stays in step with the signal.
+*/
+static inline int EventAccepted(TRIGGER_STATE *s)
+{
+    if(s->holdoff){
+        return FALSE;
+    }
+    if(s->skip){
+        s->skip--;
+        return FALSE;
+    }
+    s->holdoff = TRIGGER.holdoffTime;
+    s->skip = TRIGGER.holdoffEvents;
+    return TRUE;
+}
+
+
+/*
+PulseMatches:
+Checks a pulse width in samples against the pulse condition.
+*/
+static inline int PulseMatches(uint32_t width)
+{
+    switch(TRIGGER.pulseCondition){
+        case PULSE_LESS:
+            return width < (uint32_t)TRIGGER.pulseMax;
+        case PULSE_GREATER:
+            return width > (uint32_t)TRIGGER.pulseMin;
+        default:
+            return width >= (uint32_t)TRIGGER.pulseMin && width <= (uint32_t)TRIGGER.pulseMax;
+    }
+}
+
+
+/*
+Trigger_Reset:
+Forgets the comparator state so the next block starts fresh. Called whenever the trigger settings change.
+*/
+void Trigger_Reset(void)
+{
+    memset(&TRIGGER_ENGINE, 0, sizeof(TRIGGER_ENGINE));
+    TRIGGER_ENGINE.result = ERROR;
+}
+
+
+/*
+Trigger_Streams:
+Returns TRUE if the trigger is found by streaming every block through the engine. The advanced types always are;
+the edge trigger is too when holdoff is on, since holdoff has to see every edge rather than those in one buffer.
+*/
+int Trigger_Streams(SCOPE_SETTINGS SCOPE)
+{
+    return !SCOPE.freeRun && (TRIGGER.type != TRIGGER_EDGE || TRIGGER.holdoffTime || TRIGGER.holdoffEvents);
+}
+
+
+/*
+ScanChannel:
+Streams a stretch of the trigger channel through the engine, updating the comparator state for every sample, and
+returns the index of the first event in it (or -1 if there was none). Pulse and runt events report the sample
+where the pulse began (or 0 if it began before the stretch) so the whole pulse is drawn; window and timeout events
+report the sample where they happened. If stop is set the scan ends just after the first event and used is set to
+the number of samples taken, so the caller can carry on from there.
+*/
+static int32_t ScanChannel(uint16_t arr[], int size, SCOPE_SETTINGS SCOPE, int stop, int *used)
+{
+    TRIGGER_STATE s = TRIGGER_ENGINE;                                        // working on a local copy keeps the state in registers
+    int positive = SCOPE.triggerDir == POSITIVE;
+    int low = TRIGGER.lowLevel;
+    int high = TRIGGER.highLevel;
+    int32_t found = -1;                                                      // index of the first event in this block
+    int i;
+
+    if(TRIGGER.type != TRIGGER_RUNT && TRIGGER.type != TRIGGER_WINDOW){
+        low = SCOPE.triggerLevel;                                            // the others compare against the single trigger level
+        high = SCOPE.triggerLevel;
+    }
+
+    for(i=0;i<size;i++){
+        int v = (arr[i] & UNDERFLOW_CHECK) ? 0 : arr[i];                     // negative readings are treated as 0
+        int zone = ZoneOf(v, s.zone, low, high);
+
+        if(!s.primed){                                                       // the first sample only sets the comparators
+            s.primed = TRUE;
+            s.zone = zone;
+            s.high = zone == ZONE_HIGH;
+            continue;
+        }
+        s.run++;
+        if(s.holdoff){
+            s.holdoff--;
+        }
+
+        switch(TRIGGER.type){
+            case TRIGGER_EDGE: {
+                int high_now = zone == ZONE_HIGH;
+                if(high_now != s.high){
+                    s.high = high_now;
+                    if(high_now == positive && EventAccepted(&s) && found < 0){
+                        found = i;                                           // a crossing of the selected slope
+                    }
+                }
+                break;
+            }
+            case TRIGGER_PULSE: {
+                int high_now = zone == ZONE_HIGH;
+                if(high_now != s.high){                                      // an edge through the trigger level
+                    s.high = high_now;
+                    if(high_now == positive){                                // leading edge of a pulse of the selected polarity
+                        s.inPulse = TRUE;
+                        s.run = 0;
+                    } else if(s.inPulse){                                    // trailing edge - the pulse is complete
+                        s.inPulse = FALSE;
+                        if(PulseMatches(s.run) && EventAccepted(&s) && found < 0){
+                            found = i > (int)s.run ? i - (int)s.run : 0;
+                        }
+                    }
+                }
+                break;
+            }
+            case TRIGGER_RUNT:
+                if(zone != s.zone){
+                    int from = positive ? ZONE_LOW : ZONE_HIGH;              // a positive runt starts low, a negative one starts high
+                    int to = positive ? ZONE_HIGH : ZONE_LOW;
+                    if(s.zone == from && zone == ZONE_MIDDLE){
+                        s.armed = TRUE;                                      // crossed the first threshold
+                        s.run = 0;
+                    } else if(s.armed && zone == to){
+                        s.armed = FALSE;                                     // a full pulse, not a runt
+                    } else if(s.armed && zone == from){
+                        s.armed = FALSE;                                     // fell back without reaching the second threshold
+                        if(EventAccepted(&s) && found < 0){
+                            found = i > (int)s.run ? i - (int)s.run : 0;
+                        }
+                    } else if(zone != ZONE_MIDDLE){
+                        s.armed = FALSE;                                     // jumped straight across the band
+                    }
+                }
+                break;
+            case TRIGGER_WINDOW:
+                if(s.zone == ZONE_MIDDLE && zone != ZONE_MIDDLE && EventAccepted(&s) && found < 0){
+                    found = i;                                               // the signal left the band
+                }
+                break;
+            case TRIGGER_TIMEOUT: {
+                int high_now = zone == ZONE_HIGH;
+                if(high_now != s.high){
+                    s.high = high_now;
+                    if(high_now == positive){                                // an edge of the trigger slope restarts the timer
+                        s.run = 0;
+                    }
+                }
+                if(s.run >= (uint32_t)TRIGGER.timeout){
+                    s.run = 0;                                               // fires again after each further timeout of silence
+                    if(EventAccepted(&s) && found < 0){
+                        found = i;
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        s.zone = zone;
+        if(stop && found >= 0){
+            i++;                                                             // this sample has been taken
+            break;
+        }
+    }
+
+    *used = i;
+    s.result = found < 0 ? ERROR : (uint32_t)found * INDEX_SCALE;
+    TRIGGER_ENGINE = s;
+    return found;
+}
+
+
+/*
+Trigger_Scan:
+Streams one block of the trigger channel through the engine and returns the first event in the block as its index
+scaled by INDEX_SCALE (or ERROR if there was none).
+*/
+uint32_t Trigger_Scan(uint16_t arr[], int size, SCOPE_SETTINGS SCOPE)
+{
+    int used;
+    ScanChannel(arr, size, SCOPE, FALSE, &used);
+    return TRIGGER_ENGINE.result;
+}
+
+
+/*
+ScanLogic:
+Streams a stretch of each channel through the logic trigger in a single interleaved pass. The two blocks must be
+the ones taken at the same time (both ping-pong buffers fill in lockstep). The trigger fires on the sample where
+the combined condition becomes true, so a level-only condition such as CH1 high AND CH2 high fires when it starts
+to hold rather than on every sample. Returns the first event the same way as ScanChannel, including stop and used.
+*/
+static int32_t ScanLogic(uint16_t ch1[], uint16_t ch2[], int size, SCOPE_SETTINGS SCOPE, int stop, int *used)
+{
+    TRIGGER_STATE s = TRIGGER_ENGINE;
+    int level = SCOPE.triggerLevel;                                          // both channels use the trigger level
+    int q1 = TRIGGER.qualifier[0];
+    int q2 = TRIGGER.qualifier[1];
+    int orLogic = TRIGGER.logicOp == LOGIC_OR;
+    int32_t found = -1;
+    int i;
+
+    if(q1 == QUAL_ANY && q2 == QUAL_ANY){
+        s.result = ERROR;                                                    // nothing to look for
+        TRIGGER_ENGINE = s;
+        *used = size;
+        return -1;
+    }
+
+    for(i=0;i<size;i++){
+        int v1 = (ch1[i] & UNDERFLOW_CHECK) ? 0 : ch1[i];
+        int v2 = (ch2[i] & UNDERFLOW_CHECK) ? 0 : ch2[i];
+        int high1 = AboveLevel(v1, s.high, level);
+        int high2 = AboveLevel(v2, s.high2, level);
+        int met;
+
+        if(!s.primed){                                                       // the first sample only sets the comparators
+            s.primed = TRUE;
+            s.high = high1;
+            s.high2 = high2;
+            s.met = TRUE;                                                    // a condition already holding is not an event
+            continue;
+        }
+        if(s.holdoff){
+            s.holdoff--;
+        }
+
+        if(orLogic){                                                         // don't care qualifiers cannot satisfy an OR
+            met = (q1 != QUAL_ANY && QualifierMet(q1, high1, s.high))
+               || (q2 != QUAL_ANY && QualifierMet(q2, high2, s.high2));
+        } else {
+            met = QualifierMet(q1, high1, s.high) && QualifierMet(q2, high2, s.high2);
+        }
+        if(met && !s.met && EventAccepted(&s) && found < 0){
+            found = i;                                                       // the combined condition just became true
+        }
+        s.met = met;
+        s.high = high1;
+        s.high2 = high2;
+        if(stop && found >= 0){
+            i++;
+            break;
+        }
+    }
+
+    *used = i;
+    s.result = found < 0 ? ERROR : (uint32_t)found * INDEX_SCALE;
+    TRIGGER_ENGINE = s;
+    return found;
+}
+
+
+/*
+Trigger_ScanLogic:
+Streams one block of each channel through the logic trigger and returns the first event in the block the same way
+as Trigger_Scan.
+*/
+uint32_t Trigger_ScanLogic(uint16_t ch1[], uint16_t ch2[], int size, SCOPE_SETTINGS SCOPE)
+{
+    int used;
+    ScanLogic(ch1, ch2, size, SCOPE, FALSE, &used);
+    return TRIGGER_ENGINE.result;
+}
+
+
+/*
+Trigger_Next:
+Streams the time-aligned channels through the engine (the trigger channel, or both for the logic trigger) until the
+next event and returns its index, or -1 if there is none. used is set to the number of samples taken: the caller
+continues from there so no sample is streamed twice. This lets a capture re-arm on the very next sample.
+*/
+int32_t Trigger_Next(uint16_t ch1[], uint16_t ch2[], int size, SCOPE_SETTINGS SCOPE, int *used)
+{
+    if(TRIGGER.type == TRIGGER_LOGIC){
+        return ScanLogic(ch1, ch2, size, SCOPE, TRUE, used);
+    }
+    return ScanChannel(SCOPE.triggerChannel == CHANNEL_1 ? ch1 : ch2, size, SCOPE, TRUE, used);
+}
+
+
+/*
+Trigger_Feed:
+Streams the time-aligned channels through the engine without looking for an event, so the comparators stay in step
+with the signal while nothing is waiting on a trigger (such as during a segment capture). Events are still passed
+through holdoff.
+*/
+void Trigger_Feed(uint16_t ch1[], uint16_t ch2[], int size, SCOPE_SETTINGS SCOPE)
+{
+    int used;
+
+    if(TRIGGER.type == TRIGGER_LOGIC){
+        ScanLogic(ch1, ch2, size, SCOPE, FALSE, &used);
+    } else {
+        ScanChannel(SCOPE.triggerChannel == CHANNEL_1 ? ch1 : ch2, size, SCOPE, FALSE, &used);
+    }
+}
+
+
+/*
+ParseQualifier:
+Reads a logic trigger qualifier name. Returns -1 if it is not one.
+*/
+static int ParseQualifier(char str[])
+{
+    if(!strncasecmp(str,"high",4)){
+        return QUAL_HIGH;
+    } else if(!strncasecmp(str,"low",3)){
+        return QUAL_LOW;
+    } else if(!strncasecmp(str,"rising",6)){
+        return QUAL_RISING;
+    } else if(!strncasecmp(str,"falling",7)){
+        return QUAL_FALLING;
+    } else if(!strncasecmp(str,"any",3)){
+        return QUAL_ANY;
+    }
+    return -1;
+}
+
+
+/*
+Trigger_Find:
+Returns the trigger point in a buffer for the current trigger type, in the same form as FindTrigger. The edge
+trigger without holdoff searches the buffer directly; otherwise the result of the scan of the buffer's block is
+returned.
+*/
+uint64_t Trigger_Find(uint16_t arr[], SCOPE_SETTINGS SCOPE)
+{
+    if(!Trigger_Streams(SCOPE)){
+        return FindTrigger(arr, SCOPE);
+    }
+    return TRIGGER_ENGINE.result;
+}
+
+
+/*
+Trigger_Sweep:
+The sweep state machine. It takes the trigger search result for the block being formatted and returns the index
+to format the frame from, or ERROR if the frame should wait for a later block. In auto mode a frame is drawn from
+the start of the block once AUTO_TIMEOUT_BLOCKS blocks have gone by without a trigger, and the frame is marked as
+untriggered until the next one.
+*/
+uint64_t Trigger_Sweep(uint64_t found)
+{
+    if(found != ERROR){
+        TRIGGER_ENGINE.waiting = 0;
+        TRIGGER_ENGINE.timedOut = FALSE;
+        return found;
+    }
+    TRIGGER_ENGINE.waiting++;
+    if(TRIGGER.sweep == SWEEP_AUTO && TRIGGER_ENGINE.waiting >= AUTO_TIMEOUT_BLOCKS){
+        TRIGGER_ENGINE.waiting = 0;
+        TRIGGER_ENGINE.timedOut = TRUE;
+        return 0;                                                            // free run for this frame
+    }
+    return ERROR;
+}
+
+
+/*
+Trigger_FrameDone:
+Called when a frame has been formatted. A single capture disarms the trigger so nothing more is processed until
+it is rearmed.
+*/
+void Trigger_FrameDone(SCOPE_SETTINGS SCOPE)
+{
+    if(!SCOPE.freeRun && TRIGGER.sweep == SWEEP_SINGLE){
+        TRIGGER_ENGINE.disarmed = TRUE;
+        UART_PutString("Single capture done - enter arm to capture again\n");
+    }
+}
+
+
+/*
+Trigger_Armed:
+Returns FALSE while a single capture is being held.
+*/
+int Trigger_Armed(void)
+{
+    return !TRIGGER_ENGINE.disarmed;
+}
+
+
+/*
+Trigger_TimedOut:
+Returns TRUE if the latest frame was drawn by the auto timeout rather than by a trigger.
+*/
+int Trigger_TimedOut(void)
+{
+    return TRIGGER_ENGINE.timedOut;
+}
+
+
+/*
+Trigger_Arm:
+Rearms the trigger for another single capture. The comparators start fresh so nothing from before counts.
+*/
+void Trigger_Arm(void)
+{
+    Trigger_Reset();
+    UART_PutString("Trigger armed\n");
+}
+
+
+/*
+ParsePair:
+Reads one or two comma separated numbers from a command argument. Returns how many were read.
+*/
+static int ParsePair(char str[], int *first, int *second)
+{
+    char *comma = strchr(str, ',');
+
+    *first = atoi(str);
+    if(!comma){
+        return 1;
+    }
+    *second = atoi(comma + 1);
+    return 2;
+}
+
+
+/*
+Trigger_Command:
+Handles the settrigger_ commands for the advanced trigger types. Times are given in microseconds and levels in
+millivolts, with two values separated by a comma (settrigger_runt500,1500). The logic trigger takes a qualifier
+for each channel (settrigger_ch1rising, settrigger_ch2high) and how they combine (settrigger_logicand). The
+sweep mode and holdoff are set here as well (settrigger_sweepsingle, settrigger_holdoff200). Returns
+TRUE if the command was one of these, FALSE otherwise. Like the other trigger settings they can only be changed
+while stopped.
+*/
+int Trigger_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    char toPrint[STRLEN];
+    int a = 0;
+    int b = 0;
+
+    if(SCOPE->Running){
+        return FALSE;
+    }
+
+    if(!strncasecmp(str,"settrigger_typeedge",19)){
+        TRIGGER.type = TRIGGER_EDGE;
+        UART_PutString("Trigger type set to edge\n");
+    } else if(!strncasecmp(str,"settrigger_typepulse",20)){
+        if(TRIGGER.pulseMin == 0 && TRIGGER.pulseMax == 0){                 // a width of 0 samples would never trigger
+            UART_PutString("Set a pulse width first\n");
+            return TRUE;
+        }
+        TRIGGER.type = TRIGGER_PULSE;
+        UART_PutString("Trigger type set to pulse width\n");
+    } else if(!strncasecmp(str,"settrigger_typerunt",19)){
+        TRIGGER.type = TRIGGER_RUNT;
+        UART_PutString("Trigger type set to runt\n");
+    } else if(!strncasecmp(str,"settrigger_typewindow",21)){
+        TRIGGER.type = TRIGGER_WINDOW;
+        UART_PutString("Trigger type set to window\n");
+    } else if(!strncasecmp(str,"settrigger_typetimeout",22)){
+        if(TRIGGER.timeout == 0){                                            // a timeout of 0 samples would trigger on every sample
+            UART_PutString("Set a trigger timeout first\n");
+            return TRUE;
+        }
+        TRIGGER.type = TRIGGER_TIMEOUT;
+        UART_PutString("Trigger type set to timeout\n");
+    } else if(!strncasecmp(str,"settrigger_typelogic",20)){
+        TRIGGER.type = TRIGGER_LOGIC;
+        UART_PutString("Trigger type set to logic\n");
+    } else if(!strncasecmp(str,"settrigger_logicand",19)){
+        TRIGGER.logicOp = LOGIC_AND;
+        UART_PutString("Logic trigger set to CH1 AND CH2\n");
+    } else if(!strncasecmp(str,"settrigger_logicor",18)){
+        TRIGGER.logicOp = LOGIC_OR;
+        UART_PutString("Logic trigger set to CH1 OR CH2\n");
+    } else if(!strncasecmp(str,"settrigger_ch1",14) || !strncasecmp(str,"settrigger_ch2",14)){
+        int channel = str[13] - '1';                                         // 0 for channel 1, 1 for channel 2
+        a = ParseQualifier(&str[14]);
+        if(a < 0){
+            UART_PutString("Invalid qualifier - use high, low, rising, falling or any\n");
+            return TRUE;
+        }
+        TRIGGER.qualifier[channel] = a;
+        sprintf(toPrint,"Channel %d qualifier set to %s\n",channel+1,QUAL_NAMES[a]);
+        UART_PutString(toPrint);
+    } else if(!strncasecmp(str,"settrigger_pulse_less",21)){
+        a = atoi(&str[21]);
+        if(MICROSECONDS_TO_SAMPLES(a) < 1 || a > MAX_TRIGGER_TIME){         // shorter than a sample would never trigger
+            UART_PutString("Invalid pulse width\n");
+            return TRUE;
+        }
+        TRIGGER.pulseCondition = PULSE_LESS;
+        TRIGGER.pulseMax = MICROSECONDS_TO_SAMPLES(a);
+        sprintf(toPrint,"Pulse width set to < %d us\n",a);
+        UART_PutString(toPrint);
+    } else if(!strncasecmp(str,"settrigger_pulse_greater",24)){
+        a = atoi(&str[24]);
+        if(MICROSECONDS_TO_SAMPLES(a) < 1 || a > MAX_TRIGGER_TIME){
+            UART_PutString("Invalid pulse width\n");
+            return TRUE;
+        }
+        TRIGGER.pulseCondition = PULSE_GREATER;
+        TRIGGER.pulseMin = MICROSECONDS_TO_SAMPLES(a);
+        sprintf(toPrint,"Pulse width set to > %d us\n",a);
+        UART_PutString(toPrint);
+    } else if(!strncasecmp(str,"settrigger_pulse_range",22)){
+        if(ParsePair(&str[22],&a,&b) != 2 || a < 0 || b > MAX_TRIGGER_TIME
+           || MICROSECONDS_TO_SAMPLES(b) <= MICROSECONDS_TO_SAMPLES(a)){     // the range must span at least a sample
+            UART_PutString("Invalid pulse width range\n");
+            return TRUE;
+        }
+        TRIGGER.pulseCondition = PULSE_RANGE;
+        TRIGGER.pulseMin = MICROSECONDS_TO_SAMPLES(a);
+        TRIGGER.pulseMax = MICROSECONDS_TO_SAMPLES(b);
+        sprintf(toPrint,"Pulse width set to %d-%d us\n",a,b);
+        UART_PutString(toPrint);
+    } else if(!strncasecmp(str,"settrigger_sweepauto",20)){
+        TRIGGER.sweep = SWEEP_AUTO;
+        UART_PutString("Sweep set to auto\n");
+    } else if(!strncasecmp(str,"settrigger_sweepnormal",22)){
+        TRIGGER.sweep = SWEEP_NORMAL;
+        UART_PutString("Sweep set to normal\n");
+    } else if(!strncasecmp(str,"settrigger_sweepsingle",22)){
+        TRIGGER.sweep = SWEEP_SINGLE;
+        UART_PutString("Sweep set to single\n");
+    } else if(!strncasecmp(str,"settrigger_holdoffevents",24)){
+        a = atoi(&str[24]);
+        if(a < 0 || a > MAX_HOLDOFF_EVENTS){
+            UART_PutString("Invalid holdoff\n");
+            return TRUE;
+        }
+        TRIGGER.holdoffEvents = a;
+        sprintf(toPrint,"Holdoff set to %d events\n",a);
+        UART_PutString(toPrint);
+    } else if(!strncasecmp(str,"settrigger_holdoff",18)){
+        a = atoi(&str[18]);
+        if(a < 0 || a > MAX_TRIGGER_TIME){
+            UART_PutString("Invalid holdoff\n");
+            return TRUE;
+        }
+        TRIGGER.holdoffTime = MICROSECONDS_TO_SAMPLES(a);
+        sprintf(toPrint,"Holdoff set to %d us\n",a);
+        UART_PutString(toPrint);
+    } else if(!strncasecmp(str,"settrigger_runt",15) || !strncasecmp(str,"settrigger_window",17)){
+        int offset = (str[11] == 'r' || str[11] == 'R') ? 15 : 17;          // both take a low and a high level
+        if(ParsePair(&str[offset],&a,&b) != 2 || a < MIN_TRIGGER_LEVEL || b <= a || b > MAX_TRIGGER_LEVEL){
+            UART_PutString("Invalid thresholds\n");
+            return TRUE;
+        }
+        TRIGGER.lowLevel = MILLIVOLTS_TO_CODE(a);
+        TRIGGER.highLevel = MILLIVOLTS_TO_CODE(b);
+        sprintf(toPrint,"Thresholds set to %d and %d mV\n",a,b);
+        UART_PutString(toPrint);
+    } else if(!strncasecmp(str,"settrigger_timeout",18)){
+        a = atoi(&str[18]);
+        if(MICROSECONDS_TO_SAMPLES(a) < 1 || a > MAX_TRIGGER_TIME){         // under a sample would trigger on every sample
+            UART_PutString("Invalid timeout\n");
+            return TRUE;
+        }
+        TRIGGER.timeout = MICROSECONDS_TO_SAMPLES(a);
+        sprintf(toPrint,"Trigger timeout set to %d us\n",a);
+        UART_PutString(toPrint);
+    } else {
+        return FALSE;
+    }
+
+    Trigger_Reset();                                                         // the old comparator state no longer applies
+    return TRUE;
+}
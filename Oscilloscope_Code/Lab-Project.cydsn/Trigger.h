@@ -0,0 +1,134 @@
+/* ========================================
+ *
+ * Tiny Scope trigger engine header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the advanced trigger types: pulse width,
+ * runt, window and timeout. Unlike the edge trigger, which
+ * looks for a crossing inside the buffer being drawn, these
+ * conditions can span block boundaries, so the engine streams
+ * through every block of the trigger channel in a single pass
+ * and carries its comparator state from one block to the next.
+ * The edge trigger is still served by FindTrigger. The logic
+ * trigger combines a qualifier on each channel (AND or OR) and
+ * walks the time-aligned blocks of both channels together.
+ * The sweep state machine (auto, normal or single) decides what
+ * happens when no trigger is found, and holdoff (a time or a
+ * number of events) keeps every trigger after an accepted one
+ * from counting until it has passed.
+ *
+ * ========================================
+*/
+
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines for the trigger types */
+#define TRIGGER_EDGE 0            // crossing of the trigger level (FindTrigger, or the engine when holdoff is on)
+#define TRIGGER_PULSE 1           // a pulse whose width meets the pulse condition
+#define TRIGGER_RUNT 2            // a pulse that crosses the low threshold but not the high one
+#define TRIGGER_WINDOW 3          // the signal leaves the band between the low and high thresholds
+#define TRIGGER_TIMEOUT 4         // no edge of the trigger slope for the timeout
+#define TRIGGER_LOGIC 5           // the qualifiers of both channels combined with AND or OR
+
+/* Defines for the pulse width conditions */
+#define PULSE_LESS 0              // width shorter than pulseMax
+#define PULSE_GREATER 1           // width longer than pulseMin
+#define PULSE_RANGE 2             // width between pulseMin and pulseMax
+
+/* Defines for the logic trigger qualifiers of each channel */
+#define QUAL_ANY 0                // don't care
+#define QUAL_HIGH 1               // above the trigger level
+#define QUAL_LOW 2                // below the trigger level
+#define QUAL_RISING 3             // crosses the trigger level going up
+#define QUAL_FALLING 4            // crosses the trigger level going down
+
+/* Defines for combining the qualifiers */
+#define LOGIC_AND 0               // every qualifier that is not QUAL_ANY must hold
+#define LOGIC_OR 1                // any qualifier that is not QUAL_ANY may hold
+
+/* Defines for the sweep modes */
+#define SWEEP_AUTO 0              // an untriggered frame is drawn if no trigger comes within the auto timeout
+#define SWEEP_NORMAL 1            // only triggered frames are drawn
+#define SWEEP_SINGLE 2            // one triggered frame is drawn, then the scope waits to be rearmed
+
+/* Defines for the comparator zones */
+#define ZONE_LOW 0                // below the low threshold
+#define ZONE_MIDDLE 1             // between the thresholds
+#define ZONE_HIGH 2               // above the high threshold
+
+#define TRIGGER_HYSTERESIS 25     // ADC codes a threshold must be passed by before a crossing counts (filters noise)
+#define MAX_TRIGGER_TIME 1000000  // longest pulse width, timeout or holdoff in microseconds that can be set
+#define MAX_HOLDOFF_EVENTS 10000  // most trigger events that can be held off
+#define AUTO_TIMEOUT_BLOCKS 8     // blocks searched without a trigger before auto mode draws anyway (about 110 ms)
+
+/* Structures */
+typedef struct TRIGGER_SETTINGS{  // settings of the advanced trigger types (set to edge by default)
+    int type;                     // one of the TRIGGER_ types
+    int pulseCondition;           // one of the PULSE_ conditions
+    int pulseMin;                 // shortest pulse width in samples
+    int pulseMax;                 // longest pulse width in samples
+    int lowLevel;                 // low threshold in ADC codes for runt and window triggers
+    int highLevel;                // high threshold in ADC codes for runt and window triggers
+    int timeout;                  // samples without an edge before a timeout trigger
+    int logicOp;                  // LOGIC_AND or LOGIC_OR for the logic trigger
+    int qualifier[2];             // QUAL_ qualifier of channel 1 and channel 2 for the logic trigger
+    int sweep;                    // one of the SWEEP_ modes
+    int holdoffTime;              // samples after an accepted trigger before the next can be accepted (0 for none)
+    int holdoffEvents;            // trigger events ignored after an accepted trigger (0 for none)
+}TRIGGER_SETTINGS;
+
+typedef struct TRIGGER_STATE{     // comparator state carried from one block to the next
+    int primed;                   // FALSE until the first sample has set the comparators
+    int high;                     // TRUE while the signal is above the trigger level (with hysteresis)
+    int zone;                     // ZONE_ the signal is in relative to the low and high thresholds
+    int armed;                    // TRUE while a runt candidate is in progress
+    int inPulse;                  // TRUE while a pulse of the selected polarity is being timed
+    uint32_t run;                 // samples since the current pulse, runt or edge (or the last timeout) began
+    int high2;                    // TRUE while channel 2 is above the trigger level, for the logic trigger
+    int met;                      // TRUE while the combined logic condition holds
+    uint32_t holdoff;             // samples of holdoff time left
+    uint32_t skip;                // events left to hold off
+    int waiting;                  // blocks searched without a trigger, for the auto timeout
+    int timedOut;                 // TRUE while the frame being formatted was drawn by the auto timeout
+    int disarmed;                 // TRUE once a single capture is done, until it is rearmed
+    uint32_t result;              // the result of the last scan (index * INDEX_SCALE or ERROR)
+}TRIGGER_STATE;
+
+/* Globals */
+extern TRIGGER_SETTINGS TRIGGER;
+extern TRIGGER_STATE TRIGGER_ENGINE;
+
+/* Function prototypes */
+void Trigger_Reset(void);
+
+int Trigger_Streams(SCOPE_SETTINGS SCOPE);
+
+uint32_t Trigger_Scan(uint16_t arr[], int size, SCOPE_SETTINGS SCOPE);
+
+uint32_t Trigger_ScanLogic(uint16_t ch1[], uint16_t ch2[], int size, SCOPE_SETTINGS SCOPE);
+
+int32_t Trigger_Next(uint16_t ch1[], uint16_t ch2[], int size, SCOPE_SETTINGS SCOPE, int *used);
+
+void Trigger_Feed(uint16_t ch1[], uint16_t ch2[], int size, SCOPE_SETTINGS SCOPE);
+
+uint64_t Trigger_Find(uint16_t arr[], SCOPE_SETTINGS SCOPE);
+
+uint64_t Trigger_Sweep(uint64_t found);
+
+void Trigger_FrameDone(SCOPE_SETTINGS SCOPE);
+
+int Trigger_Armed(void);
+
+int Trigger_TimedOut(void);
+
+void Trigger_Arm(void);
+
+int Trigger_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* TRIGGER_H */
@@ -0,0 +1,173 @@
+/* ========================================
+ *
+ * Tiny Scope XY display definitions
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file holds the hit buffer and lit pixel list, the
+ * decay and plotting of a block, the drawing of the pixels
+ * whose level changed and the setxy_ and xy commands.
+ *
+ * ========================================
+*/
+
+/* included file */
+#include "HelperFunctions.h"
+
+/* the XY display */
+XY_DISPLAY XY = {FALSE, 0, 0, 0, 0};
+
+/* the hit buffer and the column and row of each lit cell, in the capture memory */
+static uint8_t * const HITS = (uint8_t *)ACQ_Pool;
+static uint8_t * const LIT_X = (uint8_t *)ACQ_Pool + XY_HIT_BYTES;
+static uint8_t * const LIT_Y = (uint8_t *)ACQ_Pool + XY_HIT_BYTES + XY_MAX_ACTIVE;
+_Static_assert(XY_COLUMNS <= UINT8_MAX + 1 && XY_ROWS <= UINT8_MAX + 1, "a cell's column and row each fit a byte");
+
+/* the color of each level */
+static const GUI_COLOR XY_COLORS[XY_LEVELS] = {GUI_BLACK, 0x004000, 0x008000, GUI_GREEN};
+
+
+/*
+Xy_Reset:
+Clears the hit buffer, the list and the screen if the XY display is on. When it is off the capture memory belongs
+to the other modes and is left alone.
+*/
+void Xy_Reset(void)
+{
+    if(!XY.on){
+        return;
+    }
+    memset(HITS, 0, XY_HIT_BYTES);
+    XY.active = 0;
+    XY.dropped = 0;
+    XY.drawn = 0;
+    XY.blocks = 0;
+    GUI_Clear();
+}
+
+
+/*
+Xy_Off:
+Turns the XY display off and clears its pixels from the screen. Called by setxy_off and by the capture modes
+that take over the capture memory.
+*/
+void Xy_Off(void)
+{
+    if(XY.on){
+        XY.on = FALSE;
+        GUI_Clear();
+    }
+}
+
+
+/*
+Xy_Block:
+Decays every lit pixel to 3/4 of its hits, then plots size sample pairs of a block. A point off the screen is
+skipped, as is a point on an unlit pixel once the list is full. Only the hit buffer changes here - Xy_Draw puts
+the changes on the screen.
+*/
+void Xy_Block(uint16_t ch1[], uint16_t ch2[], int size, SCOPE_SETTINGS SCOPE)
+{
+    int32_t gain = (int32_t)(((int64_t)VOLTAGE_INT * SCOPE.yScale << XY_GAIN_SHIFT) / (MAX_ADC_OUTPUT * VOLTAGE_SCALE_DOWN));
+
+    PROFILE_BEGIN(PROF_XY);
+    for(int k=0;k<XY.active;k++){
+        uint8_t *b = &HITS[LIT_Y[k] * XY_COLUMNS + LIT_X[k]];
+        *b = (*b & ~XY_HIT_MASK) | (((*b & XY_HIT_MASK) * 3) >> 2);
+    }
+    for(int j=0;j<size;j++){
+        int32_t v1 = (ch1[j] & UNDERFLOW_CHECK) ? 0 : ch1[j];
+        int32_t v2 = (ch2[j] & UNDERFLOW_CHECK) ? 0 : ch2[j];
+        int x = X_PIXELS / 2 + (((v1 - XY_CENTER) * gain) >> XY_GAIN_SHIFT);
+        int y = Y_PIXELS / 2 - (((v2 - XY_CENTER) * gain) >> XY_GAIN_SHIFT);
+        if(x < 0 || x >= X_PIXELS || y < 0 || y >= Y_PIXELS){
+            continue;
+        }
+        x >>= XY_CELL_SHIFT;
+        y >>= XY_CELL_SHIFT;
+        uint8_t *b = &HITS[y * XY_COLUMNS + x];
+        if(!*b){
+            if(XY.active == (int)XY_MAX_ACTIVE){
+                XY.dropped++;
+                continue;
+            }
+            LIT_X[XY.active] = x;                                             // a cell joins the list when it is first hit
+            LIT_Y[XY.active] = y;
+            XY.active++;
+        }
+        int hits = (*b & XY_HIT_MASK) + XY_HIT_WEIGHT;
+        *b = (*b & ~XY_HIT_MASK) | (hits > XY_HIT_MASK ? XY_HIT_MASK : hits);
+    }
+    XY.blocks++;
+    PROFILE_END(PROF_XY);
+}
+
+
+/*
+Xy_Draw:
+Redraws the lit cells whose level no longer matches the one they are shown at, each as a square of pixels. A cell
+that has decayed to no hits is drawn black and leaves the list.
+*/
+void Xy_Draw(void)
+{
+    GUI_COLOR color = GUI_BLACK;
+
+    GUI_SetColor(color);
+    for(int k=0;k<XY.active;){
+        uint8_t *b = &HITS[LIT_Y[k] * XY_COLUMNS + LIT_X[k]];
+        int hits = *b & XY_HIT_MASK;
+        int level = hits ? 1 + (hits - 1) / XY_LEVEL_STEP : 0;
+        if(level != *b >> XY_LEVEL_SHIFT){
+            if(XY_COLORS[level] != color){
+                color = XY_COLORS[level];
+                GUI_SetColor(color);
+            }
+            int x = LIT_X[k] << XY_CELL_SHIFT;
+            int y = LIT_Y[k] << XY_CELL_SHIFT;
+            GUI_FillRect(x, y, x + XY_CELL - 1, y + XY_CELL - 1);
+            XY.drawn++;
+        }
+        if(!hits){
+            *b = 0;
+            XY.active--;                                                      // the last entry takes its place
+            LIT_X[k] = LIT_X[XY.active];
+            LIT_Y[k] = LIT_Y[XY.active];
+            continue;
+        }
+        *b = (level << XY_LEVEL_SHIFT) | hits;
+        k++;
+    }
+}
+
+
+/*
+Xy_Command:
+Handles setxy_on and setxy_off, which can only be given while stopped, and xy, which reports the lit cells, the
+points dropped and the cell writes per block. Returns TRUE if the command was one of these, FALSE otherwise.
+*/
+int Xy_Command(char str[], SCOPE_SETTINGS *SCOPE)
+{
+    char line[XY_LINE_LEN];
+
+    if(!strncasecmp(str,"setxy_on",8) && !SCOPE->Running){
+        XY.on = TRUE;
+        SEGMENTS.on = FALSE;                                                 // the capture memory holds the hit buffer now
+        DEEP.on = FALSE;
+        ETS.on = FALSE;
+        LOGIC.on = FALSE;
+        XCORR.on = FALSE;
+        Xy_Reset();
+        UART_PutString("XY display on\n");
+    } else if(!strncasecmp(str,"setxy_off",9) && !SCOPE->Running){
+        Xy_Off();
+        UART_PutString("XY display off\n");
+    } else if(!strncasecmp(str,"xy",2)){
+        sprintf(line,"XY %s, %d lit cells, %lu points dropped, %lu cell writes per block\n",XY.on ? "on" : "off",
+                XY.active,(unsigned long)XY.dropped,(unsigned long)(XY.blocks ? XY.drawn / XY.blocks : 0));
+        UART_PutString(line);
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
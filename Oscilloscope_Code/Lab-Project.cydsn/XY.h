@@ -0,0 +1,71 @@
+/* ========================================
+ *
+ * Tiny Scope XY display header file
+ *
+ * Author: Scott Oslund
+ *
+ * File Synopsis:
+ * This file provides the XY display: channel 1 across and
+ * channel 2 up, both at the channel scale and centered on the
+ * middle of the ADC range, for phase relationships and
+ * Lissajous patterns. Every sample pair of every block is a
+ * point. Points are not drawn as they come - they are added to
+ * a hit buffer of one byte per cell of 2x2 screen pixels, which
+ * decays a little every block, and each cell is shown at one of
+ * a few brightness levels picked from its hits. A list of the
+ * cells that are lit is kept so the decay and the drawing only
+ * visit those, and a cell is only redrawn when its level
+ * changes, so a block of thousands of points costs a few
+ * hundred cell writes rather than a line per pair. The hit
+ * buffer and the list live in the capture memory, which the XY
+ * display shares with segmented and deep memory.
+ *
+ * ========================================
+*/
+
+#ifndef XY_H
+#define XY_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define XY_CELL_SHIFT 1           // a cell of the hit buffer is 1 << XY_CELL_SHIFT pixels square
+#define XY_CELL (1 << XY_CELL_SHIFT)
+#define XY_COLUMNS (X_PIXELS >> XY_CELL_SHIFT)  // cells across the screen
+#define XY_ROWS (Y_PIXELS >> XY_CELL_SHIFT)     // and down it
+#define XY_HIT_BYTES (XY_COLUMNS * XY_ROWS)     // one byte for each cell
+#define XY_MAX_ACTIVE ((2 * ACQ_POOL_MIN - XY_HIT_BYTES) / 2)  // lit cells the rest of the capture memory can list, a byte each for the column and row
+#define XY_HIT_MASK 0x3F          // the low bits of a cell's byte count its hits
+#define XY_LEVEL_SHIFT 6          // the high bits hold the level the cell is shown at
+#define XY_HIT_WEIGHT 8           // hits a point adds to its cell
+#define XY_LEVELS 4               // brightness levels, including off
+#define XY_LEVEL_STEP 21          // hits per brightness level
+#define XY_CENTER 0x400           // the ADC code drawn at the middle of the screen
+#define XY_GAIN_SHIFT 16          // fraction bits of the code to pixel gain
+#define XY_LINE_LEN 100           // length of one line of the XY report
+
+/* Structures */
+typedef struct XY_DISPLAY{
+    int on;                       // TRUE while blocks are plotted in XY instead of framed
+    int active;                   // cells in the lit list
+    uint32_t dropped;             // points not plotted because the list was full
+    uint32_t drawn;               // cell writes since the mode was turned on
+    uint32_t blocks;              // blocks plotted since the mode was turned on
+}XY_DISPLAY;
+
+/* Globals */
+extern XY_DISPLAY XY;
+
+/* Function prototypes */
+void Xy_Reset(void);
+
+void Xy_Off(void);
+
+void Xy_Block(uint16_t ch1[], uint16_t ch2[], int size, SCOPE_SETTINGS SCOPE);
+
+void Xy_Draw(void);
+
+int Xy_Command(char str[], SCOPE_SETTINGS *SCOPE);
+
+#endif /* XY_H */
@@ -20,9 +20,9 @@
 /* Included libraries */
 #include "HelperFunctions.h"                                                  // this file also has additional included files within it
 
-SCOPE_SETTINGS SCOPE = {DEFAULT,DEFAULT,TRUE,POSITIVE,DEFAULT, FALSE, TRUE};  // instatiating the scope structure with the default values
+SCOPE_SETTINGS SCOPE = {DEFAULT,DEFAULT,TRUE,POSITIVE,DEFAULT, FALSE, TRUE, FALSE, ACQ_SEPARATE};  // instatiating the scope structure with the default values
 
-WAVEFORM_DATA WAVE = {{0},{0},{0},{0},FALSE,FALSE,{0},{0},{0},{0},0,0,0,0};   // intantiating the wave structure with the default values
+WAVEFORM_DATA WAVE = {{0},{0},{0},{0},FALSE,FALSE,{0},{0},{0},{0},0,0,0,0,0};   // intantiating the wave structure with the default values
 
 /* Ping pong buffers for storing adc data - 2 per channel */
 uint16_t CH1_Data1[SIZE];                                                     // channel 1 ping pong buffers
@@ -34,6 +34,10 @@ uint16_t CH2_Data2[SIZE];
 uint8_t CH1_FLAG = FALSE;                                                     // channel 1 flag to indicate the DMA finished
 int ReadyToDraw_ch1 = FALSE;                                                  // flag for drawing each channel
 
+/* Time stamps */
+volatile uint32_t CH1_BlockTime = 0;                                          // tick time the last channel 1 buffer finished filling
+volatile uint32_t CH2_BlockTime = 0;                                          // tick time the last channel 2 buffer finished filling
+
 
 /*
 CH1_ISR:
@@ -42,6 +46,8 @@ raises a flag, and updates the buffer that was most recently finised.
 */
 void CH1_ISR()
 {
+    PROFILE_BEGIN(PROF_CH1_ISR);
+    CH1_BlockTime = Profile_Now();                                 // the last sample of the buffer was just taken
     Cy_DMA_Channel_ClearInterrupt(DMA_1_HW,DMA_1_DW_CHANNEL);      // clearing the interrupt
     
     CH1_FLAG = TRUE;                                               // raising a flag indicating an event has occured for main to respond to
@@ -51,6 +57,9 @@ void CH1_ISR()
     }else{
         WAVE.Wave1_Buffer1 = TRUE;   
     }
+    TRACE(TRACE_DMA_DONE,CHANNEL_1,WAVE.Wave1_Buffer1);           // recording which buffer just finished
+    Stats_BlockAcquired();                                         // counting the block for the update rate statistics
+    PROFILE_END(PROF_CH1_ISR);
 }
 
 /*
@@ -60,6 +69,8 @@ raises a flag, and updates the buffer that was most recently finised.
 */
 void CH2_ISR()
 {
+    PROFILE_BEGIN(PROF_CH2_ISR);
+    CH2_BlockTime = Profile_Now();
     Cy_DMA_Channel_ClearInterrupt(DMA_2_HW,DMA_2_DW_CHANNEL);      // clearing the interrupt
     
     if(WAVE.Wave2_Buffer1){                                        // If buffer 1 was last read from it is no longer not ready to be read from (false) otherwise we set it to true
@@ -67,6 +78,41 @@ void CH2_ISR()
     }else{
         WAVE.Wave2_Buffer1 = TRUE;   
     }
+    TRACE(TRACE_DMA_DONE,CHANNEL_2,WAVE.Wave2_Buffer1);
+    PROFILE_END(PROF_CH2_ISR);
+}
+
+/*
+ACQ_ISR:
+This ISR responds to the interleaved DMA finishing a block of (CH1, CH2) pairs, or a segment of one in streaming
+mode. It only counts the segments - the main loop splits them in place with Acq_SplitReady. Once a whole buffer is
+in it updates both buffer flags together, since both channels come from the same scans they always point at the
+same half.
+*/
+void ACQ_ISR()
+{
+    PROFILE_BEGIN(PROF_CH1_ISR);
+    uint32_t now = Profile_Now();                                  // the last pair of the segment was just taken
+    Cy_DMA_Channel_ClearInterrupt(DMA_1_HW,DMA_1_DW_CHANNEL);      // clearing the interrupt
+    
+    ACQ_SegmentTime = now;
+    ACQ_Segments += SCOPE.acqMode == ACQ_STREAMING ? 1 : ACQ_SEGMENTS;  // streaming mode works through the segments by this count
+    
+    if(ACQ_Segments % ACQ_SEGMENTS == 0){
+        CH1_BlockTime = now;
+        CH2_BlockTime = now;
+        CH1_FLAG = TRUE;                                           // raising a flag indicating an event has occured for main to respond to
+        
+        if(WAVE.Wave1_Buffer1){                                    // flipping to the buffer that just finished
+            WAVE.Wave1_Buffer1 = FALSE;   
+        }else{
+            WAVE.Wave1_Buffer1 = TRUE;   
+        }
+        WAVE.Wave2_Buffer1 = WAVE.Wave1_Buffer1;
+        TRACE(TRACE_DMA_DONE,CHANNEL_1,WAVE.Wave1_Buffer1);
+        Stats_BlockAcquired();
+    }
+    PROFILE_END(PROF_CH1_ISR);
 }
 
 /*
@@ -84,12 +130,75 @@ void Proccess_Channel()
     static uint16_t middleVal = 0;                                // keeps track of middle data point of the current buffer for channel 1
     static uint16_t middleVal2 = 0;                               // keeps track of middle data point of the current buffer for channel 2
     static uint64_t index=0;                                      // for indexing the ping-pong buffer
+    int formatting = FALSE;                                       // set once this call starts formatting so the profile section is closed at reset
+    
+    Acq_SplitReady();                                             // an interleaved block is split before anything reads it
+    if(!Trigger_Armed()){
+        return;                                                   // a single capture is held until it is rearmed - there is nothing to do
+    }
+    
+    if(SCOPE.acqMode != ACQ_STREAMING){                           // the calibration and input filters run on the newest block before anything looks at it
+        Cal_Channels(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2, SIZE);
+        Filt_Channels(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2, SIZE);
+        Dec_Run(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2, SIZE);
+    }
+    
+    if(AUTOSET.pending){                                          // an autoset waiting on this block sets the scope up before it is framed
+        Autoset_Block(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2, &SCOPE);
+    }
+    
+    if(XCORR.on){                                                 // the delay between the channels is measured every few blocks in every mode
+        Xcorr_Block(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2);
+    }
+    
+    if(ETS.on){                                                   // equivalent time bins every block instead of framing one now and then
+        if(Ets_Block(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2, SCOPE)){
+            WAVE.TriggerTime = Latency_SampleTime(CH1_BlockTime, ETS.lastTrigger);
+            ReadyToDraw_ch1 = TRUE;
+            Stats_FrameFormatted();
+        }
+        Stats_BlockUsed();
+        return;
+    }
+    
+    if(XY.on){                                                    // the XY display plots every pair of every block
+        Xy_Block(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2, SIZE, SCOPE);
+        WAVE.TriggerTime = CH1_BlockTime;
+        ReadyToDraw_ch1 = TRUE;
+        Stats_FrameFormatted();
+        Stats_BlockUsed();
+        return;
+    }
+    
+    if(SCOPE.acqMode == ACQ_STREAMING && iterations1 >= FORMAT_DATA){
+        iterations1 = 0;                                          // in streaming mode frames are formatted by Proccess_Segments - this only keeps the measurements going
+        return;
+    }
+    
+    if(Trigger_Streams(SCOPE) && SCOPE.acqMode != ACQ_STREAMING){                                   // the advanced triggers watch every block since their conditions can span blocks
+        PROFILE_BEGIN(PROF_FIND_TRIGGER);
+        if(TRIGGER.type == TRIGGER_LOGIC){                        // both channels fill in lockstep so blocks of the same buffer are aligned
+            Trigger_ScanLogic(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave1_Buffer1 ? CH2_Data1 : CH2_Data2, SIZE, SCOPE);
+        } else if(SCOPE.triggerChannel == CHANNEL_1){
+            Trigger_Scan(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, SIZE, SCOPE);
+        } else {
+            Trigger_Scan(WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2, SIZE, SCOPE);
+        }
+        PROFILE_END(PROF_FIND_TRIGGER);
+    }
     
-    if(iterations1 == READY_TO_START){
+    if(MASK.on && SCOPE.acqMode != ACQ_STREAMING){                // every triggered block is tested against the mask, not only the ones framed
+        uint16_t *trigger = SCOPE.triggerChannel == CHANNEL_2 ? (WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2) : (WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2);
+        uint16_t *masked = MASK.channel == CHANNEL_2 ? (WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2) : (WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2);
+        Mask_Block(masked, SIZE, SCOPE.freeRun ? ERROR : Trigger_Find(trigger, SCOPE), &SCOPE);
+    }
+    
+    if(iterations1 == READY_TO_START && SCOPE.acqMode != ACQ_STREAMING){
         ReadyToDraw_ch1 = FALSE;                                  // when enough iterations pass that we are ready to update the data we are no longer ready to draw    
     }
     
     if(iterations1 == FIND_MIDDLE){                               // at this iteration stage we calculate the middle of both channels
+        PROFILE_BEGIN(PROF_FIND_MIDDLE);
         if(WAVE.Wave1_Buffer1){
             middleVal = Middle(CH1_Data1);                        // calculating the middle of ping-pong buffer 1 or 2 depending on which last finished updating   
         } else {
@@ -100,9 +209,11 @@ void Proccess_Channel()
         } else {
             middleVal2 = Middle(CH2_Data2);   
         }
+        PROFILE_END(PROF_FIND_MIDDLE);
     }
     
     if(iterations1 == FIND_FREQ){                                 // at this iteration stage we calculate the signal's frequency using the middle value
+        PROFILE_BEGIN(PROF_FIND_FREQ);
         uint16_t freq = 0;
         if(middleVal == 0){
             freq = 0;                                             // if there was no middle value (a flat signal) there is no frequency - we set it to 0
@@ -113,6 +224,7 @@ void Proccess_Channel()
         }
         if(freq != ERROR){
             WAVE.Freq1 = freq;   
+            Meas_Add(MEAS_FREQ1, freq);                            // every new frequency goes into its statistics
         }
         if(middleVal2 == 0){                                       // we repeat for channel 2
             freq = 0;                                              // if there was no middle value (a flat signal) there is no frequency - we set it to 0
@@ -123,103 +235,113 @@ void Proccess_Channel()
         }
         if(freq != ERROR){
             WAVE.Freq2 = freq;   
+            Meas_Add(MEAS_FREQ2, freq);
         }
+        PROFILE_END(PROF_FIND_FREQ);
     }
     
     if(iterations1 == FORMAT_DATA &&                               // at this iteration stage we look for a trigger if the scope is in trigger mode
         !(SCOPE.freeRun || SCOPE.triggerChannel != CHANNEL_1)){
         if(WAVE.Wave1_Buffer1){
-            index = FindTrigger(CH1_Data1,SCOPE);                  // looking for a trigger in channel 1 buffer 1
-            if(index == ERROR){                                    // if we get an error we restart and look for a new trigger
+            PROFILE_BEGIN(PROF_FIND_TRIGGER);
+            index = Trigger_Sweep(Trigger_Find(CH1_Data1,SCOPE));   // looking for a trigger in channel 1 buffer 1
+            PROFILE_END(PROF_FIND_TRIGGER);
+            if(index == ERROR){                                    // no trigger yet - the sweep mode says to wait for the next block
+                TRACE(TRACE_TRIGGER_MISSED,CHANNEL_1,0);
                 iterations1--;
                 index = 0;
                 goto reset;
             }
+            TRACE(TRACE_TRIGGER_FOUND,CHANNEL_1,index/INDEX_SCALE);
         } else {
-            index = FindTrigger(CH1_Data2, SCOPE);                  // looking for a trigger in channel 1 buffer 2
-            if(index == ERROR){                                     // if we get an error we restart and look for a new trigger
+            PROFILE_BEGIN(PROF_FIND_TRIGGER);
+            index = Trigger_Sweep(Trigger_Find(CH1_Data2,SCOPE));   // looking for a trigger in channel 1 buffer 2
+            PROFILE_END(PROF_FIND_TRIGGER);
+            if(index == ERROR){                                     // no trigger yet - the sweep mode says to wait for the next block
+                TRACE(TRACE_TRIGGER_MISSED,CHANNEL_1,0);
                 iterations1--;
                 index = 0;
                 goto reset;  
             }
+            TRACE(TRACE_TRIGGER_FOUND,CHANNEL_1,index/INDEX_SCALE);
         }
     } else if(iterations1 == FORMAT_DATA &&                         // we repeat if the trigger channel is channel 2
         !(SCOPE.freeRun || SCOPE.triggerChannel != CHANNEL_2)){
         if(WAVE.Wave2_Buffer1){
-            index = FindTrigger(CH2_Data2, SCOPE);                  // looking for a trigger in channel 2 buffer 1  
-            if(index == ERROR){                                     // if we get an error we restart and look for a new trigger
+            PROFILE_BEGIN(PROF_FIND_TRIGGER);
+            index = Trigger_Sweep(Trigger_Find(CH2_Data1,SCOPE));   // looking for a trigger in channel 2 buffer 1  
+            PROFILE_END(PROF_FIND_TRIGGER);
+            if(index == ERROR){                                     // no trigger yet - the sweep mode says to wait for the next block
+                TRACE(TRACE_TRIGGER_MISSED,CHANNEL_2,0);
                 iterations1--;
                 index = 0;
                 goto reset;
             }
+            TRACE(TRACE_TRIGGER_FOUND,CHANNEL_2,index/INDEX_SCALE);
         } else {
-            index = FindTrigger(CH2_Data1, SCOPE);                  // looking for a trigger in channel 2 buffer 2
-            if(index == ERROR){                                     // if we get an error we restart and look for a new trigger
+            PROFILE_BEGIN(PROF_FIND_TRIGGER);
+            index = Trigger_Sweep(Trigger_Find(CH2_Data2,SCOPE));   // looking for a trigger in channel 2 buffer 2
+            PROFILE_END(PROF_FIND_TRIGGER);
+            if(index == ERROR){                                     // no trigger yet - the sweep mode says to wait for the next block
+                TRACE(TRACE_TRIGGER_MISSED,CHANNEL_2,0);
                 iterations1--;
                 index = 0;
                 goto reset;  
             }
+            TRACE(TRACE_TRIGGER_FOUND,CHANNEL_2,index/INDEX_SCALE);
         }
     }else {
         index = 0;                                                  // if we are in free run mode we start at index 0 of the data
     }
     
     if(iterations1 >= FORMAT_DATA){                                 // when we have passed the trigger check above, we start printing the data
-        if(WAVE.Wave1_Buffer1){                                     // we check which buffer we should read from
+        PROFILE_BEGIN(PROF_FORMAT_DATA);
+        formatting = TRUE;
+        if(i == 0){                                                 // a new frame starts - it carries the time of its trigger sample
+            if(!SCOPE.freeRun && SCOPE.triggerChannel == CHANNEL_2){
+                WAVE.TriggerTime = Latency_SampleTime(CH2_BlockTime,index/INDEX_SCALE);
+            } else {
+                WAVE.TriggerTime = Latency_SampleTime(CH1_BlockTime,index/INDEX_SCALE);
+            }
+            Dec_FrameStart(SIZE - index/INDEX_SCALE);              // the decoded events are placed from the frame's first sample
+        }
+        if(MATH.op != MATH_OFF){                                    // the math trace is handed the block from the frame's first sample
+            uint16_t *math1 = WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2;
+            uint16_t *math2 = WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2;
+            int from = i == 0 ? index/INDEX_SCALE : 0;
+            Math_Block(math1 + from, math2 + from, from, SIZE - from, i == 0);
+        }
+        if(HIRES.on){                                               // high resolution - each pixel is the mean of its column
+            if(!HiRes_Format(WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2, WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2, &index, &i, SCOPE)){
+                goto reset;                                         // the frame runs on into the next block
+            }
+            i=0;
+            iterations1 = 0;
+            ReadyToDraw_ch1 = TRUE;
+            Avg_Frame(SCOPE);
+            Stats_FrameFormatted();
+            Trigger_FrameDone(SCOPE);
+        } else {
+            uint16_t *ch1 = WAVE.Wave1_Buffer1 ? CH1_Data1 : CH1_Data2;   // the buffers are picked once for the block
+            uint16_t *ch2 = WAVE.Wave2_Buffer1 ? CH2_Data1 : CH2_Data2;
             for(;i<X_PIXELS;i++){                                   // iterating through all pixels to set to create a waveform
+                uint16_t v1 = ch1[index/INDEX_SCALE];
+                uint16_t v2 = ch2[index/INDEX_SCALE];
                 WAVE.Wave1X[i] = i;
-                if(CH1_Data1[index/INDEX_SCALE] & UNDERFLOW_CHECK){
+                WAVE.Wave2X[i] = i;
+                if(v1 & UNDERFLOW_CHECK){
                     WAVE.Wave1Y[i] = 0;                             // if there is overflow we set y coordinate to zero
                 } else {                                            // otherwise we set the y-coordinate to the scaled ADC value
-                    WAVE.Wave1Y[i] = (-CH1_Data1[index/INDEX_SCALE]*VOLTAGE_INT*SCOPE.yScale/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN));
+                    WAVE.Wave1Y[i] = -v1*VOLTAGE_INT*SCOPE.yScale/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN);
                 }
-                if(WAVE.Wave2_Buffer1){                             // we repeat the process for channel 2
-                        WAVE.Wave2X[i] = i;                               
-                        if(CH2_Data1[index/INDEX_SCALE] & UNDERFLOW_CHECK){
-                            WAVE.Wave2Y[i] = 0;                     // adding channel 2 data to the channel 2 coordinates        
-                        } else {                                          
-                            WAVE.Wave2Y[i] = -CH2_Data1[index/INDEX_SCALE]*SCOPE.yScale*VOLTAGE_INT/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN);
-                        }
-                    } else {
-                        WAVE.Wave2X[i] = i;                         // adding channel 2 data to the channel 2 coordinates                 
-                        if(CH2_Data2[index/INDEX_SCALE] & UNDERFLOW_CHECK){
-                            WAVE.Wave2Y[i] = 0;                          
-                        } else {                                          
-                            WAVE.Wave2Y[i] = -CH2_Data1[index/INDEX_SCALE]*SCOPE.yScale*VOLTAGE_INT/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN);
-                        }
-                    }
-                index += (SCOPE.xScale*INDEX_SCALE)/INDEX_DIVISOR;  // updating the index (it is scaled to prevent floating point math)
-                if(index > MAX_INDEX){
-                    index -= MAX_INDEX;
-                    goto reset;                                     // we reset the index and function if the index is out of bounds from the array
+                if(v2 & UNDERFLOW_CHECK){                           // we repeat the process for channel 2
+                    WAVE.Wave2Y[i] = 0;
+                } else {
+                    WAVE.Wave2Y[i] = -v2*SCOPE.yScale*VOLTAGE_INT/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN);
                 }
-            }
-            i=0;
-            iterations1 = 0;
-            ReadyToDraw_ch1 = TRUE;                                 // if we get to this point we are done - we are ready to draw
-        } else {                                                    // this is a repeat of the code above but using channel 1's buffer 2
-            for(;i<X_PIXELS;i++){
-                WAVE.Wave1X[i] = i;
-                if(CH1_Data2[index/INDEX_SCALE] & UNDERFLOW_CHECK){
-                    WAVE.Wave1Y[i] = 0;                             // if there is overflow we set y coordinate to zero 
-                } else {                                            // otherwise we set the y-coordinate to the scaled ADC value 
-                    WAVE.Wave1Y[i] = (-CH1_Data2[index/INDEX_SCALE]*VOLTAGE_INT*SCOPE.yScale/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN));
+                if(MATH.op != MATH_OFF){
+                    Math_Pixel(i,index/INDEX_SCALE,SCOPE);          // the math trace from the same sample
                 }
-                if(WAVE.Wave2_Buffer1){
-                        WAVE.Wave2X[i] = i;                         // adding channel 2 data to the channel 2 coordinates                          
-                        if(CH2_Data1[index/INDEX_SCALE] & UNDERFLOW_CHECK){
-                            WAVE.Wave2Y[i] = 0;                     // if there is overflow we set y coordinate to zero                          
-                        } else {                                    // otherwise we set the y-coordinate to the scaled ADC value                                         
-                            WAVE.Wave2Y[i] = -CH2_Data2[index/INDEX_SCALE]*SCOPE.yScale*VOLTAGE_INT/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN);
-                        }
-                    } else {
-                        WAVE.Wave2X[i] = i;                         // adding channel 2 data to the channel 2 coordinates                                
-                        if(CH2_Data2[index/INDEX_SCALE] & UNDERFLOW_CHECK){
-                            WAVE.Wave2Y[i] = 0;                     // if there is overflow we set y coordinate to zero                         
-                        } else {                                          
-                            WAVE.Wave2Y[i] = -CH2_Data2[index/INDEX_SCALE]*SCOPE.yScale*VOLTAGE_INT/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN);
-                        }
-                    }
                 index += (SCOPE.xScale*INDEX_SCALE)/INDEX_DIVISOR;  // updating the index (it is scaled to prevent floating point math)
                 if(index >= MAX_INDEX){
                     index -= MAX_INDEX;
@@ -229,43 +351,269 @@ void Proccess_Channel()
             i=0;
             iterations1 = 0;
             ReadyToDraw_ch1 = TRUE;                                 // if we get to this point we are done - we are ready to draw
+            Avg_Frame(SCOPE);
+            Stats_FrameFormatted();
+            Trigger_FrameDone(SCOPE);
         }
     }
     
     reset:
+    if(formatting){
+        PROFILE_END(PROF_FORMAT_DATA);
+        Stats_BlockUsed();                                          // this block made it into a frame
+    }
     iterations1++;                                                  // incrementing the number of times we passed through this function
 }
 
 
+/*
+SegmentTrigger:
+Streams one segment of each channel through the trigger engine and returns the first trigger in it (scaled by
+INDEX_SCALE) or ERROR.
+*/
+static uint64_t SegmentTrigger(uint16_t ch1[], uint16_t ch2[])
+{
+    if(TRIGGER.type == TRIGGER_LOGIC){
+        return Trigger_ScanLogic(ch1, ch2, ACQ_SEGMENT, SCOPE);
+    }
+    return Trigger_Scan(SCOPE.triggerChannel == CHANNEL_1 ? ch1 : ch2, ACQ_SEGMENT, SCOPE);
+}
+
+/*
+Proccess_Segments:
+This function does the work of Proccess_Channel's FORMAT_DATA stage in streaming mode, one segment at a time as
+the segments arrive. Each new segment is split in place in the channel buffers and streamed through the trigger
+engine.
+Once a frame has started (at a trigger, or straight away in free-run mode) the pixels are formatted as far as the
+samples have arrived, so the frame is ready to draw as soon as its last sample is in rather than a block later.
+With segmented memory, deep memory or the logic analyzer on the segments go to Seg_Capture, Deep_Capture or
+Logic_Capture instead.
+Samples are numbered from the start of the acquisition; sample n is in half (n / SIZE) % 2 of the buffers.
+*/
+void Proccess_Segments()
+{
+    static uint32_t done = 0;                                     // segments processed so far
+    static int framing = FALSE;                                   // TRUE while a frame is being formatted
+    static int i = 0;                                             // the next pixel of the frame
+    static uint64_t next = 0;                                     // sample number of the next pixel, scaled by INDEX_SCALE
+    static int blockUsed = FALSE;                                 // TRUE if the current block went into a frame, for the statistics
+    uint32_t ready = ACQ_Segments;
+    
+    Acq_SplitReady();
+    if(ready - done > ACQ_SEGMENTS){                              // more than a buffer behind (or the DMAs were restarted) - the old segments are gone
+        done = ready;
+        framing = FALSE;
+        SEGMENTS.capturing = FALSE;                               // a segment cannot be stitched across the gap
+    }
+    
+    while(done != ready && SCOPE.Running){                        // a single shot that stopped the scope is left as it is
+        uint32_t segment = done % (2 * ACQ_SEGMENTS);             // position of the segment in both buffers
+        int half = segment >= ACQ_SEGMENTS;
+        int offset = (segment % ACQ_SEGMENTS) * ACQ_SEGMENT;
+        uint16_t *ch1 = (half ? CH1_Data2 : CH1_Data1) + offset;
+        uint16_t *ch2 = (half ? CH2_Data2 : CH2_Data1) + offset;
+        uint64_t first = (uint64_t)done * ACQ_SEGMENT;            // number of the first sample of the segment
+        uint64_t found = 0;
+        int started = FALSE;                                      // TRUE if a frame starts in this segment
+        
+        Cal_Channels(ch1, ch2, ACQ_SEGMENT);                      // the calibration and input filters run on each segment as it arrives
+        Filt_Channels(ch1, ch2, ACQ_SEGMENT);
+        Dec_Run(ch1, ch2, ACQ_SEGMENT);                           // and the protocol decoders see every sample
+        
+        if(SEGMENTS.on || DEEP.on || LOGIC.on || ETS.on || XY.on){  // segmented, deep memory and logic capture from the trigger instead of building frames
+            if(SEGMENTS.on){                                      // (equivalent time and XY take whole blocks in Proccess_Channel)
+                Seg_Capture(ch1, ch2, ACQ_SEGMENT, first, SCOPE);
+            } else if(DEEP.on){
+                Deep_Capture(ch1, ch2, ACQ_SEGMENT, first, &SCOPE);
+            } else if(LOGIC.on){
+                Logic_Capture(ch1, ch2, ACQ_SEGMENT, first, &SCOPE);
+            }
+            done++;
+            continue;
+        }
+        
+        if(!SCOPE.freeRun && Trigger_Armed()){                    // every segment goes through the engine so its state stays continuous
+            PROFILE_BEGIN(PROF_FIND_TRIGGER);
+            found = SegmentTrigger(ch1, ch2);
+            PROFILE_END(PROF_FIND_TRIGGER);
+        }
+        
+        if(MASK.on){                                              // every triggered segment is tested against the mask, not only the ones framed
+            Mask_Block(MASK.channel == CHANNEL_2 ? ch2 : ch1, ACQ_SEGMENT, Trigger_Armed() && !SCOPE.freeRun ? found : ERROR, &SCOPE);
+        }
+        
+        if(!framing && !ReadyToDraw_ch1 && Trigger_Armed()){      // looking for the start of the next frame once the last one is drawn
+            if(!SCOPE.freeRun && (found != ERROR || (done + 1) % ACQ_SEGMENTS == 0)){
+                found = Trigger_Sweep(found);                     // the auto timeout counts whole buffers
+            } else if(!SCOPE.freeRun){
+                found = ERROR;
+            }
+            if(found != ERROR){
+                framing = TRUE;
+                started = TRUE;
+                i = 0;
+                next = first * INDEX_SCALE + found;
+                Dec_FrameStart(first + ACQ_SEGMENT - next / INDEX_SCALE);
+                WAVE.TriggerTime = Latency_SampleTime(ACQ_SegmentTime, SIZE - ((uint64_t)ready * ACQ_SEGMENT - next / INDEX_SCALE));
+                if(!SCOPE.freeRun){
+                    TRACE(TRACE_TRIGGER_FOUND,SCOPE.triggerChannel,(next / INDEX_SCALE) % SIZE);
+                }
+            }
+        }
+        
+        if(framing){                                              // formatting every pixel whose sample has arrived
+            uint64_t end = (first + ACQ_SEGMENT) * INDEX_SCALE;
+            uint64_t step = (SCOPE.xScale*INDEX_SCALE)/INDEX_DIVISOR;
+            if(MATH.op != MATH_OFF){                              // the math trace from the first sample of the frame on
+                int from = started ? (int)(next / INDEX_SCALE - first) : 0;
+                Math_Block(ch1 + from, ch2 + from, first + from, ACQ_SEGMENT - from, started);
+            }
+            PROFILE_BEGIN(PROF_FORMAT_DATA);
+            for(;i<X_PIXELS && HIRES.on && next<end && next+step<end+INDEX_SCALE;i++){
+                HiRes_Pixel(i, next, SCOPE);                      // high resolution waits for the last sample of the column
+                next += step;
+            }
+            for(;i<X_PIXELS && !HIRES.on && next<end;i++){
+                uint32_t n = (next / INDEX_SCALE) % (2 * SIZE);
+                uint16_t v1 = n < SIZE ? CH1_Data1[n] : CH1_Data2[n - SIZE];
+                uint16_t v2 = n < SIZE ? CH2_Data1[n] : CH2_Data2[n - SIZE];
+                WAVE.Wave1X[i] = i;
+                WAVE.Wave2X[i] = i;
+                if(v1 & UNDERFLOW_CHECK){
+                    WAVE.Wave1Y[i] = 0;                           // if there is overflow we set y coordinate to zero
+                } else {
+                    WAVE.Wave1Y[i] = (-v1*VOLTAGE_INT*SCOPE.yScale/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN));
+                }
+                if(v2 & UNDERFLOW_CHECK){
+                    WAVE.Wave2Y[i] = 0;
+                } else {
+                    WAVE.Wave2Y[i] = -v2*SCOPE.yScale*VOLTAGE_INT/(MAX_ADC_OUTPUT*VOLTAGE_SCALE_DOWN);
+                }
+                if(MATH.op != MATH_OFF){
+                    Math_Pixel(i, next / INDEX_SCALE, SCOPE);
+                }
+                next += step;
+            }
+            PROFILE_END(PROF_FORMAT_DATA);
+            blockUsed = TRUE;
+            if(i == X_PIXELS){
+                framing = FALSE;
+                ReadyToDraw_ch1 = TRUE;                           // the frame is done - it is drawn on this pass of the main loop
+                Avg_Frame(SCOPE);
+                    Stats_FrameFormatted();
+                Trigger_FrameDone(SCOPE);
+            }
+        }
+        
+        done++;
+        if(done % ACQ_SEGMENTS == 0){                             // the end of a block
+            if(blockUsed){
+                Stats_BlockUsed();
+            }
+            blockUsed = FALSE;
+        }
+    }
+}
+
 /*
 UpdateDisplay:
 This function updates the dispaly by drawing over the previous waveforms, reseting the background,
-and drawing the new waveform
+and drawing the new waveform (and the math trace when one is on)
 */
 void UpdateDisplay()
 {
+    static uint16_t frames = 0;                                                           // number of frames drawn, for the trace
+    
+    PROFILE_BEGIN(PROF_UPDATE_DISPLAY);
+    if(XY.on){                                                                            // the XY display only redraws the pixels that changed
+        Xy_Draw();
+        PROFILE_END(PROF_UPDATE_DISPLAY);
+        TRACE(TRACE_FRAME_DRAWN,0,frames++);
+        Stats_FrameDrawn(SCOPE.xScale);
+        return;
+    }
     GUI_SetPenSize(2);
     GUI_SetColor(GUI_BLACK);
     DrawWaveForm(WAVE.Prev_Wave2X,WAVE.Prev_Wave2Y,X_PIXELS,Y_PIXELS-WAVE.Wave2Offset);   // drawing over previous waveforms with the background color
     DrawWaveForm(WAVE.Prev_Wave1X,WAVE.Prev_Wave1Y,X_PIXELS,Y_PIXELS-WAVE.Wave1Offset);
+    if(MATH.drawn){
+        DrawWaveForm(WAVE.Prev_Wave1X,MATH.PrevY,X_PIXELS,Y_PIXELS-MATH.drawnOffset);     // and over the previous math trace
+        MATH.drawn = FALSE;
+    }
+    Mask_Erase();                                                                         // and over the previous mask
     SetBackground(SCOPE, WAVE);                                                           // reseting the background
             
-    WAVE.Wave1Offset = ADC_GetResult16(1) / ADC_SCALE_DOWN;                               // reading from potentiometers to allow for scrolling
-    WAVE.Wave2Offset = ADC_GetResult16(3) / ADC_SCALE_DOWN;
+    WAVE.Wave1Offset = Autoset_Offset(CHANNEL_1, ADC_GetResult16(1) / ADC_SCALE_DOWN);   // reading from potentiometers to allow for scrolling (plus any autoset trim)
+    WAVE.Wave2Offset = Autoset_Offset(CHANNEL_2, ADC_GetResult16(3) / ADC_SCALE_DOWN);
+    if(DECODE.protocol != DEC_OFF){
+        Dec_Draw(SCOPE);                                                                  // the decoded labels go under the waveforms
+    }
+    if(MASK.on){
+        Mask_Draw(Y_PIXELS-(MASK.channel == CHANNEL_2 ? WAVE.Wave2Offset : WAVE.Wave1Offset));  // and so does the mask
+    }
     
     GUI_SetColor(GUI_YELLOW);
     DrawWaveForm(WAVE.Wave2X,WAVE.Wave2Y,X_PIXELS,Y_PIXELS-WAVE.Wave2Offset);             // drawing the waveforms
     GUI_SetColor(GUI_RED);
     DrawWaveForm(WAVE.Wave1X,WAVE.Wave1Y,X_PIXELS,Y_PIXELS-WAVE.Wave1Offset);
+    if(MATH.op != MATH_OFF && !ETS.on && !SEGMENTS.on){                                   // the math trace is only formatted with the normal frames
+        GUI_SetColor(GUI_GREEN);
+        DrawWaveForm(WAVE.Wave1X,MATH.Y,X_PIXELS,Y_PIXELS-MATH.offset);
+        Copy(MATH.Y,MATH.PrevY);
+        MATH.drawn = TRUE;
+        MATH.drawnOffset = MATH.offset;
+    }
     Copy(WAVE.Wave1X,WAVE.Prev_Wave1X);                                                   // copying the data so we know what to erase next time
     Copy(WAVE.Wave2X,WAVE.Prev_Wave2X);
     Copy(WAVE.Wave2Y,WAVE.Prev_Wave2Y);
     Copy(WAVE.Wave1Y,WAVE.Prev_Wave1Y);
+    PROFILE_END(PROF_UPDATE_DISPLAY);
+    TRACE(TRACE_FRAME_DRAWN,0,frames++);
+    Stats_FrameDrawn(SCOPE.xScale);
+}
+
+/*
+RunTasks:
+This function makes one pass through the tasks of the main loop: checking for user input, processing a finished
+buffer and updating the display. It is kept apart from main so the host simulator runs exactly the same tasks.
+*/
+void RunTasks(uint16_t mainIterations)
+{
+    GetInput(&SCOPE);                                                              // checking for new user input
+    
+    if(SCOPE.Running && SCOPE.acqMode == ACQ_STREAMING){                           // in streaming mode the segments are worked through as they arrive
+        Proccess_Segments();
+    }
+    
+    if(CH1_FLAG && SCOPE.Running){                                                 // when channel 1 finishes transfering data process the data
+        CH1_FLAG = FALSE;                                                          // lowering the flag
+        Proccess_Channel();
+    }
+    
+    if((ReadyToDraw_ch1 && (SCOPE.Running || SEGMENTS.on))                         // checking if we can update the display (ready to draw) - the segment viewer draws while stopped too
+    || (!SCOPE.Running && mainIterations==0x2000 && !SEGMENTS.overlaid && !DEEP.viewing && !LOGIC.viewing)){
+        ReadyToDraw_ch1 = FALSE;
+        UpdateDisplay();                                                           // updating display
+        if(SCOPE.Running && !SEGMENTS.on){
+            Latency_Record(WAVE.TriggerTime);                                      // the last LCD write of the frame is done
+        }
+    }
+    
+    if(DEEP.viewing && !SCOPE.Running){
+        Deep_Poll(SCOPE);                                                          // the potentiometers pan and zoom the deep record
+    }
+    
+    if(LOGIC.viewing && !SCOPE.Running){
+        Logic_Poll(SCOPE);                                                         // or the logic record
+    }
+    
+    Stats_Update();                                                                // closing the statistics interval when it is complete
 }
 
+#ifndef HOST_BUILD
 /*
 Main:
-This function first waits for the user to enter in start, then it inits all of the hardware. It starts the DMAs and ADC and responds to 
+This function first waits for the user to enter in start, then it inits all of the hardware. It starts the ADC and DMAs and responds to 
 interrupt events by calling functions to process the data and by printing the waveforms
 */
 int main(void)
@@ -276,6 +624,11 @@ int main(void)
     
     Cy_SCB_UART_Init(UART_HW, &UART_config,&UART_context);                         // initializing the UART
     Cy_SCB_UART_Enable(UART_HW);                                                   // enabling the UART
+    Profile_Init();                                                                // starting the cycle counter for the profiler
+    Cal_Load();                                                                    // the calibration saved in flash, if there is one
+    if(!Acq_PoolCheck()){
+        for(;;){}                                                                  // the capture modes would run into the stack - going no further
+    }
     
     UART_PutString("Welcome to Scott Oslund's oscilloscope!\n");                   // printing welcome message
     
@@ -283,14 +636,6 @@ int main(void)
         GetInput(&SCOPE);
     }
     
-    /* Initializing the interrupts of the DMAs for both channel 2 and channel 1 */
-    Cy_SysInt_Init(&CH1_INT_cfg, CH1_ISR);
-    NVIC_EnableIRQ(CH1_INT_cfg.intrSrc);
-    Cy_DMA_Channel_SetInterruptMask(DMA_1_HW,DMA_1_DW_CHANNEL,CY_DMA_INTR_MASK); 
-    Cy_SysInt_Init(&CH2_INT_cfg, CH2_ISR);
-    NVIC_EnableIRQ(CH2_INT_cfg.intrSrc);
-    Cy_DMA_Channel_SetInterruptMask(DMA_2_HW,DMA_2_DW_CHANNEL,CY_DMA_INTR_MASK);
-    
     /* Initing the NewHaven display and setting the background */
     GUI_Init();
     GUI_SetFont(GUI_FONT_16B_1);
@@ -298,39 +643,16 @@ int main(void)
     GUI_Clear();
     SetBackground(SCOPE, WAVE);
     
-    /* Starting the ADC */
+    /* Starting the ADC, then the DMAs and their interrupts for the acquisition mode (this also starts the conversions) */
     ADC_Start();
-    ADC_StartConvert();
-    
-    /* Starting the first DMA to transfer data from channel 1 to the channel 1 arrays */
-    DMA_1_Start((uint32_t *)&(SAR->CHAN_RESULT[0]),CH1_Data1);
-    Cy_DMA_Descriptor_SetSrcAddress(&DMA_1_Descriptor_2, (uint32_t *)&(SAR->CHAN_RESULT[0]));
-    Cy_DMA_Descriptor_SetDstAddress(&DMA_1_Descriptor_2, CH1_Data2);
-    
-    /* Starting the second DMA to tranfer data from channel 2 to the channel 2 arrays */
-    DMA_2_Start((uint32_t *)&(SAR->CHAN_RESULT[2]),CH2_Data1);
-    Cy_DMA_Descriptor_SetSrcAddress(&DMA_2_Descriptor_2, (uint32_t *)&(SAR->CHAN_RESULT[2]));
-    Cy_DMA_Descriptor_SetDstAddress(&DMA_2_Descriptor_2, CH2_Data2);
+    Acq_Configure(SCOPE.acqMode);
     
     uint16_t mainIterations = 0;                                                   // variable for keeping tack of passes through the main loop                                    
     
     /* infinite loop with each tasks */
     for(;;){
-        
-        GetInput(&SCOPE);                                                          // checking for new user input
-        
-        if(CH1_FLAG && SCOPE.Running){                                             // when channel 1 finishes transfering data process the data
-            CH1_FLAG = FALSE;                                                      // lowering the flag
-            Proccess_Channel();
-        }
-       
-
-        if((ReadyToDraw_ch1 && SCOPE.Running)                                      // checking if we can update the display (ready to draw)
-        || (!SCOPE.Running && mainIterations==0x2000)){
-            ReadyToDraw_ch1 = FALSE;
-            UpdateDisplay();                                                       // updating display
-        }
-
+        RunTasks(mainIterations);
         mainIterations++;                                                          // incrementing the number loops we finished
     }
 }
+#endif /* HOST_BUILD - the host simulator provides its own main loop */